@@ -0,0 +1,97 @@
+// Arduino.h (host shim)
+//
+// Just enough of the ESP32 Arduino core for the expansion's SMBus modules to
+// compile unchanged on Linux. Time is simulated: millis()/micros() read the
+// simulator clock, delay()/delayMicroseconds() advance it, and bus traffic
+// advances it by the wire time of each transaction (see sim_bus.h).
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define HEX 16
+#define DEC 10
+
+// ---- simulated clock ----
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+
+// ---- GPIO (SDA/SCL observation only) ----
+void pinMode(uint8_t pin, uint8_t mode);
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// ---- String (subset) ----
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(int v, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%d", v);
+    s_ = buf;
+  }
+  String(unsigned v, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%u", v);
+    s_ = buf;
+  }
+  String(uint8_t v, int base = DEC) : String((unsigned)v, base) {}
+
+  size_t length() const { return s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o ? o : ""; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+
+private:
+  std::string s_;
+};
+
+// ---- Serial (stdout, can be muted by the simulator) ----
+class HostSerial {
+public:
+  bool enabled = true;
+  void begin(unsigned long) {}
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* s)    { return enabled ? fputs(s, stdout), strlen(s) : 0; }
+  size_t print(const String& s)  { return print(s.c_str()); }
+  size_t print(int v)            { return (size_t)this->printf("%d", v); }
+  size_t println()               { return print("\n"); }
+  size_t println(const char* s)  { return print(s) + println(); }
+  size_t println(const String& s){ return println(s.c_str()); }
+  size_t println(int v)          { return print(v) + println(); }
+};
+extern HostSerial Serial;
+
+// ---- IPAddress (broadcast targets only) ----
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { o_[0]=a; o_[1]=b; o_[2]=c; o_[3]=d; }
+  uint8_t operator[](int i) const { return o_[i & 3]; }
+private:
+  uint8_t o_[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,49 @@
+// Preferences.h (host shim)
+//
+// NVS stand-in for ExpConfig: namespaces of key -> bytes kept in memory for
+// the life of the process (each scenario is a fresh fork, so nothing leaks).
+
+#pragma once
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+  bool begin(const char* ns, bool readOnly = false) {
+    auto it = store().find(ns);
+    if (it == store().end()) {
+      if (readOnly) return false;
+      it = store().emplace(ns, Ns()).first;
+    }
+    ns_ = &it->second;
+    return true;
+  }
+  void end() { ns_ = nullptr; }
+  bool clear() { if (ns_) ns_->clear(); return ns_ != nullptr; }
+  bool remove(const char* key) { return ns_ && ns_->erase(key) > 0; }
+
+  size_t putUInt(const char* key, uint32_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint32_t getUInt(const char* key, uint32_t def = 0) {
+    uint32_t v = def;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+  }
+  size_t putBytes(const char* key, const void* v, size_t len) {
+    if (!ns_) return 0;
+    const uint8_t* p = (const uint8_t*)v;
+    (*ns_)[key].assign(p, p + len);
+    return len;
+  }
+  size_t getBytes(const char* key, void* out, size_t cap) {
+    if (!ns_) return 0;
+    auto it = ns_->find(key);
+    if (it == ns_->end() || it->second.size() > cap) return 0;
+    memcpy(out, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+private:
+  typedef std::map<std::string, std::vector<uint8_t>> Ns;
+  static std::map<std::string, Ns>& store() { static std::map<std::string, Ns> s; return s; }
+  Ns* ns_ = nullptr;
+};
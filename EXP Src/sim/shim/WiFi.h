@@ -0,0 +1,15 @@
+// WiFi.h (host shim)
+//
+// The simulated expansion is always associated; UDPStat only asks for status().
+
+#pragma once
+#include "Arduino.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_DISCONNECTED = 6, WL_CONNECTED = 3 } wl_status_t;
+
+class WiFiClass {
+public:
+  wl_status_t status() { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,37 @@
+// WiFiUdp.h (host shim)
+//
+// Outbound-only WiFiUDP. Every finished packet is handed to the simulator
+// (sim_udp_capture) so the bench can decode what the modules broadcast.
+
+#pragma once
+#include "Arduino.h"
+
+// Implemented by the simulator; receives each packet at endPacket().
+void sim_udp_capture(uint16_t port, const uint8_t* data, size_t len);
+
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port) { local_port_ = port; return 1; }
+  void    stop() {}
+
+  int beginPacket(const char* host, uint16_t port) { (void)host; port_ = port; len_ = 0; return 1; }
+  int beginPacket(IPAddress ip, uint16_t port)     { (void)ip;   port_ = port; len_ = 0; return 1; }
+  int endPacket() { sim_udp_capture(port_, buf_, len_); len_ = 0; return 1; }
+
+  size_t write(uint8_t b) { if (len_ >= sizeof(buf_)) return 0; buf_[len_++] = b; return 1; }
+  size_t write(const uint8_t* d, size_t n) { size_t k = 0; while (k < n && write(d[k])) ++k; return k; }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(int v) { char b[16]; snprintf(b, sizeof(b), "%d", v); return print(b); }
+
+  // Nothing is ever received in the simulator.
+  int parsePacket() { return 0; }
+  int read(uint8_t*, size_t) { return -1; }
+  int read(char*, size_t) { return -1; }
+
+private:
+  uint16_t local_port_ = 0;
+  uint16_t port_ = 0;
+  uint8_t  buf_[1472];   // one Ethernet-sized datagram
+  size_t   len_ = 0;
+};
@@ -0,0 +1,46 @@
+// Wire.h (host shim)
+//
+// TwoWire with the ESP32 core's call signatures, backed by the simulated
+// Xbox SMBus in sim_bus.cpp. Return codes follow the ESP32 core:
+// endTransmission() -> 0 ok, 2 address NACK, 3 data NACK, 5 timeout;
+// requestFrom() -> number of bytes received (0 on NACK/timeout).
+
+#pragma once
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  void setTimeOut(uint16_t timeOutMillis);
+  uint32_t getClock() const { return clock_hz_; }
+  uint16_t getTimeOut() const { return timeout_ms_; }
+
+  void    beginTransmission(uint8_t address);
+  void    beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  size_t  write(uint8_t data);
+  size_t  write(const uint8_t* data, size_t len);
+  uint8_t endTransmission(bool sendStop);
+  uint8_t endTransmission() { return endTransmission(true); }
+
+  uint8_t requestFrom(int address, int quantity, int sendStop);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity) { return requestFrom((int)address, (int)quantity, 1); }
+
+  int available();
+  int read();
+  int peek();
+
+private:
+  uint32_t clock_hz_   = 100000;
+  uint16_t timeout_ms_ = 50;
+
+  uint8_t  tx_addr_ = 0;
+  uint8_t  tx_buf_[128];
+  size_t   tx_len_ = 0;
+
+  uint8_t  rx_buf_[128];
+  size_t   rx_len_ = 0;
+  size_t   rx_pos_ = 0;
+};
+
+extern TwoWire Wire;
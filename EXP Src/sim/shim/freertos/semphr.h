@@ -0,0 +1,31 @@
+// freertos/semphr.h (host shim)
+//
+// The simulator is single-threaded, so a mutex is a flag. A take on a held
+// mutex fails immediately (after advancing the clock by the timeout), which
+// is what a contended take looks like to the caller.
+
+#pragma once
+#include "FreeRTOS.h"
+
+struct SimMutex { bool held = false; };
+typedef SimMutex* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new SimMutex(); }
+
+void delay(uint32_t ms);
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks) {
+  if (!m) return pdFALSE;
+  if (m->held) {
+    if (ticks != portMAX_DELAY && ticks > 0) delay(ticks);
+    return pdFALSE;
+  }
+  m->held = true;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m) {
+  if (!m || !m->held) return pdFALSE;
+  m->held = false;
+  return pdTRUE;
+}
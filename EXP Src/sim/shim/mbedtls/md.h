@@ -0,0 +1,19 @@
+// mbedtls/md.h (host shim)
+//
+// Only the HMAC-SHA1 entry point used by eeprom_min.cpp. Backed by a small
+// SHA-1 in sim_arduino.cpp so the simulator has no external dependencies.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { MBEDTLS_MD_NONE = 0, MBEDTLS_MD_SHA1 = 4 } mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t { mbedtls_md_type_t type; } mbedtls_md_info_t;
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type);
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info,
+                    const unsigned char* key, size_t keylen,
+                    const unsigned char* input, size_t ilen,
+                    unsigned char* output);
@@ -0,0 +1,129 @@
+// sim_arduino.cpp
+//
+// Host implementations behind the shim headers: Serial, WiFi, the status
+// LED, base64 and the HMAC-SHA1 used by the EEPROM HDD-key derivation.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <base64.h>
+#include <mbedtls/md.h>
+
+HostSerial Serial;
+WiFiClass  WiFi;
+
+uint32_t g_sim_led_writes = 0;
+extern "C" void neopixelWrite(uint8_t, uint8_t, uint8_t, uint8_t) { g_sim_led_writes++; }
+
+int HostSerial::printf(const char* fmt, ...) {
+  if (!enabled) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vprintf(fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+// ---------------- base64 ----------------
+String base64::encode(const uint8_t* data, size_t length) {
+  static const char tbl[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve(((length + 2) / 3) * 4);
+  for (size_t i = 0; i < length; i += 3) {
+    const uint32_t b = ((uint32_t)data[i] << 16)
+                     | ((i + 1 < length) ? (uint32_t)data[i + 1] << 8 : 0)
+                     | ((i + 2 < length) ? (uint32_t)data[i + 2] : 0);
+    out += tbl[(b >> 18) & 63];
+    out += tbl[(b >> 12) & 63];
+    out += (i + 1 < length) ? tbl[(b >> 6) & 63] : '=';
+    out += (i + 2 < length) ? tbl[b & 63] : '=';
+  }
+  return String(out);
+}
+
+// ---------------- SHA-1 ----------------
+namespace {
+
+struct Sha1 {
+  uint32_t h[5];
+  uint8_t  buf[64];
+  uint64_t total = 0;
+  size_t   used = 0;
+
+  Sha1() { h[0]=0x67452301; h[1]=0xEFCDAB89; h[2]=0x98BADCFE; h[3]=0x10325476; h[4]=0xC3D2E1F0; }
+
+  static uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+  void block(const uint8_t* p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i)
+      w[i] = ((uint32_t)p[4*i] << 24) | ((uint32_t)p[4*i+1] << 16) | ((uint32_t)p[4*i+2] << 8) | p[4*i+3];
+    for (int i = 16; i < 80; ++i) w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; ++i) {
+      uint32_t f, k;
+      if      (i < 20) { f = (b & c) | (~b & d);          k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+      const uint32_t t = rol(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = rol(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+
+  void update(const uint8_t* p, size_t n) {
+    total += n;
+    while (n--) {
+      buf[used++] = *p++;
+      if (used == 64) { block(buf); used = 0; }
+    }
+  }
+
+  void final(uint8_t out[20]) {
+    const uint64_t bits = total * 8;
+    const uint8_t pad = 0x80;
+    update(&pad, 1);
+    const uint8_t zero = 0;
+    while (used != 56) update(&zero, 1);
+    uint8_t len[8];
+    for (int i = 0; i < 8; ++i) len[i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(len, 8);
+    for (int i = 0; i < 5; ++i) {
+      out[4*i]   = (uint8_t)(h[i] >> 24);
+      out[4*i+1] = (uint8_t)(h[i] >> 16);
+      out[4*i+2] = (uint8_t)(h[i] >> 8);
+      out[4*i+3] = (uint8_t)(h[i]);
+    }
+  }
+};
+
+const mbedtls_md_info_t kSha1Info = { MBEDTLS_MD_SHA1 };
+
+} // namespace
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+  return md_type == MBEDTLS_MD_SHA1 ? &kSha1Info : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info,
+                    const unsigned char* key, size_t keylen,
+                    const unsigned char* input, size_t ilen,
+                    unsigned char* output) {
+  if (!md_info || md_info->type != MBEDTLS_MD_SHA1) return -1;
+
+  uint8_t k[64] = {0};
+  if (keylen > 64) {
+    Sha1 hk; hk.update(key, keylen); hk.final(k);
+  } else {
+    memcpy(k, key, keylen);
+  }
+
+  uint8_t ipad[64], opad[64];
+  for (int i = 0; i < 64; ++i) { ipad[i] = k[i] ^ 0x36; opad[i] = k[i] ^ 0x5C; }
+
+  uint8_t inner[20];
+  Sha1 hi; hi.update(ipad, 64); hi.update(input, ilen); hi.final(inner);
+  Sha1 ho; ho.update(opad, 64); ho.update(inner, 20); ho.final(output);
+  return 0;
+}
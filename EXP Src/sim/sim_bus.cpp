@@ -0,0 +1,231 @@
+// sim_bus.cpp
+//
+// Simulated SMBus devices, the Wire shim on top of them, and SDA/SCL
+// observation for the poller's bus-idle checks.
+
+#include "sim_bus.h"
+#include <Wire.h>
+
+namespace SimBus {
+
+static uint64_t s_now_us = 0;
+static Device   s_dev[128];
+static Stats    s_stats;
+static std::vector<Txn> s_log;
+static bool     s_logging = false;
+static uint32_t s_rng = 1;
+static uint32_t s_low_from_ms = 0;
+static uint32_t s_low_to_ms = 0;
+
+uint64_t nowUs() { return s_now_us; }
+void advanceUs(uint64_t us) { s_now_us += us; }
+
+static uint32_t now_ms() { return (uint32_t)(s_now_us / 1000); }
+
+static uint32_t xorshift() {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+void reset(uint32_t seed) {
+  s_now_us = 0;
+  for (auto& d : s_dev) d = Device();
+  s_stats = Stats();
+  s_log.clear();
+  s_rng = seed ? seed : 1;
+  s_low_from_ms = s_low_to_ms = 0;
+}
+
+Device& device(uint8_t addr) {
+  Device& d = s_dev[addr & 0x7F];
+  d.present = true;
+  return d;
+}
+
+void setReg(uint8_t addr, uint8_t reg, uint8_t value) { device(addr).regs[reg] = value; }
+
+void setWordLE(uint8_t addr, uint8_t reg, uint16_t value) {
+  setReg(addr, reg, (uint8_t)(value & 0xFF));
+  setReg(addr, (uint8_t)(reg + 1), (uint8_t)(value >> 8));
+}
+
+void scriptReg(uint8_t addr, uint8_t reg, const std::vector<Device::Step>& steps) {
+  device(addr).script[reg] = steps;
+}
+
+void holdLinesLow(uint32_t fromMs, uint32_t toMs) {
+  s_low_from_ms = fromMs;
+  s_low_to_ms = toMs;
+}
+
+const Stats& stats() { return s_stats; }
+const std::vector<Txn>& log() { return s_log; }
+void setLogging(bool on) { s_logging = on; }
+void clearStats() { s_stats = Stats(); s_log.clear(); }
+
+bool linesHigh() {
+  const uint32_t t = now_ms();
+  return !(t >= s_low_from_ms && t < s_low_to_ms);
+}
+
+static uint8_t reg_value(Device& d, uint8_t reg) {
+  const auto& steps = d.script[reg];
+  if (steps.empty()) return d.regs[reg];
+  const uint32_t t = now_ms();
+  uint8_t v = steps.front().value;
+  for (const auto& s : steps) {
+    if (s.ms > t) break;
+    v = s.value;
+  }
+  return v;
+}
+
+static bool nack_now(const Device& d) {
+  if (!d.present) return true;
+  const uint32_t t = now_ms();
+  if (d.nackToMs > d.nackFromMs && t >= d.nackFromMs && t < d.nackToMs) return true;
+  return d.nackPerMille && (xorshift() % 1000) < d.nackPerMille;
+}
+
+// Bits on the wire: START, address byte + ACK, data bytes + ACK each, STOP.
+static uint32_t phase_us(size_t dataBytes, bool stop, uint32_t clockHz) {
+  const uint32_t bits = 1 + 9 * (uint32_t)(1 + dataBytes) + (stop ? 1 : 0);
+  return (uint32_t)(((uint64_t)bits * 1000000ULL + clockHz - 1) / clockHz);
+}
+
+static void account(uint8_t addr, uint8_t reg, size_t len, bool isRead,
+                    uint8_t result, uint32_t durUs) {
+  const uint64_t start = s_now_us;
+  s_now_us += durUs;
+  s_stats.busyUs += durUs;
+  s_stats.busyUsByAddr[addr & 0x7F] += durUs;
+  s_stats.phases++;
+  if (isRead) s_stats.readPhases++;
+  if (result == 2 || result == 3) s_stats.nacks++;
+  if (result == 5) s_stats.timeouts++;
+  if (durUs > s_stats.maxPhaseUs) s_stats.maxPhaseUs = durUs;
+  if (s_logging) s_log.push_back({start, durUs, addr, reg, (uint8_t)len, isRead, result});
+}
+
+uint8_t writePhase(uint8_t addr, const uint8_t* data, size_t len,
+                   bool stop, uint32_t clockHz, uint16_t timeoutMs) {
+  Device& d = s_dev[addr & 0x7F];
+  const uint8_t reg = len ? data[0] : d.ptr;   // log the register the master asked for
+  if (!linesHigh()) {
+    account(addr, reg, 0, false, 5, (uint32_t)timeoutMs * 1000);
+    return 5;
+  }
+  if (nack_now(d)) {
+    account(addr, reg, 0, false, 2, phase_us(0, true, clockHz));
+    return 2;
+  }
+  if (len > 0) {
+    d.ptr = data[0];
+    for (size_t i = 1; i < len; ++i) {
+      d.regs[(uint8_t)(data[0] + i - 1)] = data[i];
+      s_stats.dataWrites++;
+    }
+  }
+  account(addr, d.ptr, len, false, 0, phase_us(len, stop, clockHz));
+  return 0;
+}
+
+uint8_t readPhase(uint8_t addr, uint8_t* out, size_t len,
+                  bool stop, uint32_t clockHz, uint16_t timeoutMs) {
+  Device& d = s_dev[addr & 0x7F];
+  const uint8_t startReg = d.ptr;
+  if (!linesHigh()) {
+    account(addr, startReg, 0, true, 5, (uint32_t)timeoutMs * 1000);
+    return 5;
+  }
+  if (nack_now(d)) {
+    account(addr, startReg, 0, true, 2, phase_us(0, true, clockHz));
+    return 2;
+  }
+
+  d.reads++;
+  uint32_t stretch = d.stretchUs;
+  if (d.longStretchEvery && (d.reads % d.longStretchEvery) == 0) stretch += d.longStretchUs;
+  if (stretch > (uint32_t)timeoutMs * 1000) {
+    // Master gives up while the slave holds SCL
+    account(addr, startReg, 0, true, 5, (uint32_t)timeoutMs * 1000);
+    return 5;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    out[i] = reg_value(d, d.ptr);
+    d.ptr = (uint8_t)(d.ptr + 1);
+  }
+  account(addr, startReg, len, true, 0, phase_us(len, stop, clockHz) + stretch);
+  return 0;
+}
+
+} // namespace SimBus
+
+// ===================== Wire shim =====================
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda; (void)scl;
+  if (frequency) clock_hz_ = frequency;
+  tx_len_ = rx_len_ = rx_pos_ = 0;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  if (frequency) clock_hz_ = frequency;
+  return true;
+}
+
+void TwoWire::setTimeOut(uint16_t timeOutMillis) { timeout_ms_ = timeOutMillis; }
+
+void TwoWire::beginTransmission(uint8_t address) {
+  tx_addr_ = address;
+  tx_len_ = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (tx_len_ >= sizeof(tx_buf_)) return 0;
+  tx_buf_[tx_len_++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) ++n;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  const uint8_t rc = SimBus::writePhase(tx_addr_, tx_buf_, tx_len_, sendStop, clock_hz_, timeout_ms_);
+  tx_len_ = 0;
+  return rc;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+  rx_len_ = rx_pos_ = 0;
+  if (quantity <= 0) return 0;
+  if ((size_t)quantity > sizeof(rx_buf_)) quantity = (int)sizeof(rx_buf_);
+  const uint8_t rc = SimBus::readPhase((uint8_t)address, rx_buf_, (size_t)quantity,
+                                       sendStop != 0, clock_hz_, timeout_ms_);
+  if (rc != 0) return 0;
+  rx_len_ = (size_t)quantity;
+  return (uint8_t)quantity;
+}
+
+int TwoWire::available() { return (int)(rx_len_ - rx_pos_); }
+int TwoWire::read() { return rx_pos_ < rx_len_ ? rx_buf_[rx_pos_++] : -1; }
+int TwoWire::peek() { return rx_pos_ < rx_len_ ? rx_buf_[rx_pos_] : -1; }
+
+// ===================== GPIO shim =====================
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int  digitalRead(uint8_t) { return SimBus::linesHigh() ? HIGH : LOW; }
+
+// ===================== clock shim =====================
+unsigned long millis() { return (unsigned long)(SimBus::nowUs() / 1000); }
+unsigned long micros() { return (unsigned long)SimBus::nowUs(); }
+void delay(uint32_t ms) { SimBus::advanceUs((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { SimBus::advanceUs(us); }
@@ -0,0 +1,89 @@
+// sim_bus.h
+//
+// Simulated Original Xbox SMBus for host builds of the expansion firmware.
+//
+// - Devices are register files with an auto-incrementing pointer, like the
+//   real SMC (0x10), encoders (0x45 Conexant, 0x6A Focus, 0x70 Xcalibur) and
+//   the 24C02 EEPROM (0x54). Absent addresses NACK.
+// - Registers can be fixed or scripted over simulated time.
+// - Faults: random or windowed NACKs, clock stretching (including stretches
+//   longer than the Wire timeout), and SDA/SCL held low.
+// - Every phase is timed at the configured Wire clock and advances the
+//   simulated clock, so pacing code sees realistic millis() progress and the
+//   bench can report bus occupancy.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace SimBus {
+
+  // ---- clock ----
+  uint64_t nowUs();
+  void     advanceUs(uint64_t us);
+
+  // ---- devices ----
+  struct Device {
+    bool     present = false;
+    uint8_t  regs[256] = {0};
+    uint8_t  ptr = 0;
+
+    // faults
+    uint16_t nackPerMille = 0;      // random NACK chance per transaction phase
+    uint32_t stretchUs = 0;         // clock stretch added to every read phase
+    uint32_t longStretchEvery = 0;  // every Nth read stretches longStretchUs (0 = never)
+    uint32_t longStretchUs = 0;
+    uint32_t nackFromMs = 0;        // NACK everything inside [from, to)
+    uint32_t nackToMs = 0;
+
+    // scripted registers: value of reg follows (t_ms, value) steps
+    struct Step { uint32_t ms; uint8_t value; };
+    std::vector<Step> script[256];
+
+    // bookkeeping
+    uint32_t reads = 0;
+  };
+
+  void    reset(uint32_t seed = 1);
+  Device& device(uint8_t addr);                       // marks present
+  void    setReg(uint8_t addr, uint8_t reg, uint8_t value);
+  void    setWordLE(uint8_t addr, uint8_t reg, uint16_t value); // lo @reg, hi @reg+1
+  void    scriptReg(uint8_t addr, uint8_t reg, const std::vector<Device::Step>& steps);
+  void    holdLinesLow(uint32_t fromMs, uint32_t toMs);
+
+  // ---- observation ----
+  struct Txn {
+    uint64_t startUs;
+    uint32_t durUs;
+    uint8_t  addr;
+    uint8_t  reg;      // register pointer at the start of the phase
+    uint8_t  len;      // data bytes (excluding address byte)
+    bool     isRead;
+    uint8_t  result;   // 0 ok, 2 addr NACK, 3 data NACK, 5 timeout
+  };
+
+  struct Stats {
+    uint64_t busyUs = 0;
+    uint32_t phases = 0;
+    uint32_t readPhases = 0;
+    uint32_t dataWrites = 0;   // bytes written beyond the register pointer
+    uint32_t nacks = 0;
+    uint32_t timeouts = 0;
+    uint32_t maxPhaseUs = 0;
+    uint64_t busyUsByAddr[128] = {0};
+  };
+
+  const Stats& stats();
+  const std::vector<Txn>& log();
+  void  setLogging(bool on);
+  void  clearStats();
+
+  // ---- used by the Wire/GPIO shims ----
+  bool    linesHigh();
+  uint8_t writePhase(uint8_t addr, const uint8_t* data, size_t len,
+                     bool stop, uint32_t clockHz, uint16_t timeoutMs);
+  uint8_t readPhase(uint8_t addr, uint8_t* out, size_t len,
+                    bool stop, uint32_t clockHz, uint16_t timeoutMs);
+
+} // namespace SimBus
@@ -0,0 +1,427 @@
+// smbus_bench.cpp
+//
+// Runs the expansion's unmodified SMBus stack (xbox_smbus_poll.cpp,
+// smbus_ext.cpp, eeprom_min.cpp) against the simulated bus and reports:
+//
+// - bus occupancy per minute (steady state) and during startup,
+// - per-device busy time, NACKs, timeouts and the longest single phase,
+// - what the modules concluded (temps, fan, encoder, resolution, version,
+//   HDD key) against what the scenario programmed,
+// - round-robin ordering of the poller and the read-only guarantee,
+// - what UDPStat actually sends on 50504 (cache_manager.cpp and udp_stat.cpp
+//   are built in too): sends per hour against how often the raw values change,
+//   and the delay from a published change to its packet.
+// - how often the idle-aware loop wakes: the loop sleeps to the earliest
+//   nextDueMs() like Type_D_exp.ino, so a module that under-reports its
+//   deadline shows up as a scenario mismatch.
+//
+// Each scenario runs in a forked child so module statics start fresh.
+// Usage: smbus_bench [scenario ...] [-m minutes] [-t] [-c key=value,...]
+//   -t dumps a bus trace; -c applies runtime config (exp_config.h) first.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "sim_bus.h"
+#include "xbox_smbus_poll.h"
+#include "smbus_ext.h"
+#include "eeprom_min.h"
+#include "cache_manager.h"
+#include "udp_stat.h"
+#include "led_stat.h"
+#include "exp_config.h"
+#include <mbedtls/md.h>
+
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Wire clock the poller was built with (same default as the firmware);
+// pacing defaults come from exp_config.h and can be changed with -c
+#ifndef SMBUS_I2C_CLOCK_HZ
+#define SMBUS_I2C_CLOCK_HZ 55000
+#endif
+
+static const uint8_t SMC  = 0x10;
+static const uint8_t CONX = 0x45;
+static const uint8_t FOCS = 0x6A;
+static const uint8_t XCAL = 0x70;
+static const uint8_t EE   = 0x54;
+
+// ---------------- captured broadcasts ----------------
+static SMBusExt::Status g_ext = {-1, -1, -1, -1, -1, -1, -1};
+static uint32_t g_ext_count = 0;
+static std::string g_ee_hdd;
+static uint32_t g_ee_packets = 0;
+
+// UDPStat status packets and change-to-send latency
+static uint32_t g_stat_sends = 0;
+static uint32_t g_change_at = 0;          // first unsent change (0 = none)
+static uint32_t g_lat_n = 0, g_lat_sum = 0, g_lat_max = 0;
+extern uint32_t g_sim_led_writes;   // sim_arduino.cpp
+
+static void on_cache_change() {
+  if (!g_change_at) g_change_at = millis() ? millis() : 1;
+  UDPStat::notifyChanged();
+}
+
+void sim_udp_capture(uint16_t port, const uint8_t* data, size_t len) {
+  if (port == 50504 && len == sizeof(XboxStatus)) {
+    g_stat_sends++;
+    if (g_change_at) {
+      const uint32_t lat = millis() - g_change_at;
+      g_lat_n++;
+      g_lat_sum += lat;
+      if (lat > g_lat_max) g_lat_max = lat;
+      g_change_at = 0;
+    }
+  } else if (port == 50505 && len == sizeof(SMBusExt::Status)) {
+    memcpy(&g_ext, data, sizeof(g_ext));
+    g_ext_count++;
+  } else if (port == 50506) {
+    g_ee_packets++;
+    const std::string s((const char*)data, len);
+    if (s.rfind("EE:HDD=", 0) == 0) g_ee_hdd = s.substr(7);
+  }
+}
+
+// ---------------- EEPROM image builder ----------------
+static const uint8_t KEY_V10   [16] = { 0x2A,0x3B,0xAD,0x2C,0xB1,0x94,0x4F,0x93,0xAA,0xCD,0xCD,0x7E,0x0A,0xC2,0xEE,0x5A };
+static const uint8_t KEY_V11_14[16] = { 0x1D,0xF3,0x5C,0x83,0x8E,0xC9,0xB6,0xFC,0xBD,0xF6,0x61,0xAB,0x4F,0x06,0x33,0xE4 };
+static const uint8_t KEY_V16   [16] = { 0x2B,0x84,0x57,0xBE,0x9B,0x1E,0x65,0xC6,0xCD,0x9D,0x2B,0xCE,0xC1,0xA2,0x09,0x61 };
+
+static void rc4(const uint8_t* key, size_t klen, uint8_t* buf, size_t len) {
+  uint8_t S[256];
+  for (int n = 0; n < 256; ++n) S[n] = (uint8_t)n;
+  uint8_t j = 0;
+  for (int n = 0; n < 256; ++n) {
+    j = (uint8_t)(j + S[n] + key[n % klen]);
+    const uint8_t t = S[n]; S[n] = S[j]; S[j] = t;
+  }
+  uint8_t i = 0; j = 0;
+  for (size_t n = 0; n < len; ++n) {
+    i = (uint8_t)(i + 1);
+    j = (uint8_t)(j + S[i]);
+    const uint8_t t = S[i]; S[i] = S[j]; S[j] = t;
+    buf[n] ^= S[(uint8_t)(S[i] + S[j])];
+  }
+}
+
+static void hmac(const uint8_t* key, const uint8_t* msg, size_t len, uint8_t out[20]) {
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), key, 16, msg, len, out);
+}
+
+// Lays out a 24C02 image the way the factory does: HMAC at 0x00, RC4'd
+// confounder + HDD key at 0x14, serial/MAC/region in the clear.
+static std::string load_eeprom(const uint8_t verKey[16], uint8_t seed) {
+  uint8_t rom[256];
+  for (int i = 0; i < 256; ++i) rom[i] = (uint8_t)(i * 7 + seed);
+
+  uint8_t plain[28] = {0};
+  for (int i = 0; i < 24; ++i) plain[i] = (uint8_t)(0x31 * (i + 1) + seed);
+  uint8_t chk[20], rc4key[20];
+  hmac(verKey, plain, sizeof(plain), chk);
+  hmac(verKey, chk, sizeof(chk), rc4key);
+  uint8_t enc[28];
+  memcpy(enc, plain, sizeof(enc));
+  rc4(rc4key, sizeof(rc4key), enc, sizeof(enc));
+
+  memcpy(&rom[0x00], chk, 20);
+  memcpy(&rom[0x14], enc, 28);
+  memcpy(&rom[0x34], "207384923405", 12);
+  const uint8_t mac[6] = { 0x00, 0x50, 0xF2, 0x12, 0x34, seed };
+  memcpy(&rom[0x40], mac, 6);
+  rom[0x58] = 0x00;
+
+  for (int i = 0; i < 256; ++i) SimBus::setReg(EE, (uint8_t)i, rom[i]);
+
+  char hex[33];
+  for (int i = 0; i < 16; ++i) snprintf(&hex[2 * i], 3, "%02X", plain[8 + i]);
+  return std::string(hex);
+}
+
+// ---------------- scenarios ----------------
+struct Expect {
+  int cpu, board, fan;
+  int enc, xboxVer, width, height;
+  std::string hdd;
+  int tempTol;   // allowed |raw - expected| for temps (jittering scenarios)
+};
+
+static void smc_base(uint8_t cpu, uint8_t board, uint8_t fanRaw, uint8_t av, uint8_t consoleVer) {
+  SimBus::setReg(SMC, 0x09, cpu);
+  SimBus::setReg(SMC, 0x0A, board);
+  SimBus::setReg(SMC, 0x10, fanRaw);
+  SimBus::setReg(SMC, 0x03, 0x60);   // tray closed
+  SimBus::setReg(SMC, 0x04, av);
+  SimBus::setReg(SMC, 0x01, 0x50);   // PIC version
+  SimBus::setReg(SMC, 0x00, consoleVer);
+}
+
+static Expect sc_conexant_v10() {
+  smc_base(45, 32, 10, 0x06, 0x01);
+  // fan ramps up and CPU warms during the run
+  SimBus::scriptReg(SMC, 0x10, {{0, 10}, {90000, 25}});
+  SimBus::scriptReg(SMC, 0x09, {{0, 45}, {75000, 52}});
+  SimBus::setReg(CONX, 0x2E, 0x00);  // SD, AV-pack fallback
+  const std::string hdd = load_eeprom(KEY_V10, 0x11);
+  return {52, 32, 50, CONX, 1, 720, 480, hdd, 0};
+}
+
+static Expect sc_focus_v14_720p() {
+  smc_base(50, 35, 15, 0x01, 0x04);
+  SimBus::setWordLE(FOCS, 0x32, 0xFE05);           // PID, LSB first
+  SimBus::setWordLE(FOCS, 0x92, (1u << 12));        // VID_CNTL0: HDTV, progressive
+  const std::string hdd = load_eeprom(KEY_V11_14, 0x22);
+  return {50, 35, 30, FOCS, 4, 1280, 720, hdd, 0};
+}
+
+static Expect sc_xcalibur_v16_1080i() {
+  smc_base(48, 40, 20, 0x01, 0xFF);                 // SMC does not report version
+  SimBus::setReg(XCAL, 0x00, 0x00);
+  SimBus::setReg(XCAL, 0x1C, 0x05);                 // 1080i
+  const std::string hdd = load_eeprom(KEY_V16, 0x33);
+  return {48, 28, 40, XCAL, 6, 1920, 1080, hdd, 0}; // board temp 1.6-corrected
+}
+
+static Expect sc_flaky_smc() {
+  Expect e = sc_conexant_v10();
+  SimBus::device(SMC).nackPerMille = 150;           // 15% of phases NACK
+  return e;
+}
+
+static Expect sc_stretching_xcal() {
+  Expect e = sc_xcalibur_v16_1080i();
+  SimBus::Device& smc = SimBus::device(SMC);
+  smc.stretchUs = 1500;                             // every read stretched 1.5 ms
+  smc.longStretchEvery = 25;                        // ...and every 25th past the Wire timeout
+  smc.longStretchUs = 120000;
+  return e;
+}
+
+// Steady console whose SMC temps flicker ±1 °C between reads
+static Expect sc_jittery_steady() {
+  Expect e = sc_focus_v14_720p();
+  std::vector<SimBus::Device::Step> cpu, board;
+  uint32_t r = 12345;
+  for (uint32_t t = 0; t < 3600000; t += 700) {
+    r = r * 1103515245u + 12345u;
+    cpu.push_back({t, (uint8_t)(50 + ((r >> 16) % 3) - 1)});
+    board.push_back({t, (uint8_t)(35 + ((r >> 20) & 1))});
+  }
+  SimBus::scriptReg(SMC, 0x09, cpu);
+  SimBus::scriptReg(SMC, 0x0A, board);
+  e.tempTol = 1;
+  return e;
+}
+
+static Expect sc_wedged_bus() {
+  Expect e = sc_focus_v14_720p();
+  SimBus::holdLinesLow(20000, 45000);               // SDA/SCL low for 25 s after grace
+  return e;
+}
+
+struct Scenario {
+  const char* name;
+  const char* desc;
+  Expect (*setup)();
+};
+
+static const Scenario kScenarios[] = {
+  { "conexant_v10",      "v1.0 Conexant, SD composite, fan/CPU ramp", sc_conexant_v10 },
+  { "focus_v14_720p",    "v1.4 Focus FS454, 720p component",          sc_focus_v14_720p },
+  { "xcalibur_v16_1080i","v1.6 Xcalibur, 1080i, SMC version 0xFF",    sc_xcalibur_v16_1080i },
+  { "flaky_smc",         "v1.0 with 15% SMC NACKs (backoff)",         sc_flaky_smc },
+  { "stretching_xcal",   "v1.6 with clock stretch + timeouts",        sc_stretching_xcal },
+  { "jittery_steady",    "v1.4 idle, CPU/board temps flicker ±1 °C",  sc_jittery_steady },
+  { "wedged_bus",        "v1.4 with lines held low 20-45 s",          sc_wedged_bus },
+};
+
+// ---------------- run one scenario ----------------
+static bool check_round_robin() {
+  // Poller write phases to SMC temp/fan registers must cycle 09 -> 0A -> 10.
+  static const uint8_t order[3] = { 0x09, 0x0A, 0x10 };
+  int expect = -1;
+  for (const auto& t : SimBus::log()) {
+    if (t.addr != SMC || t.isRead) continue;
+    int idx = -1;
+    for (int i = 0; i < 3; ++i) if (t.reg == order[i]) idx = i;
+    if (idx < 0) continue;
+    if (expect >= 0 && idx != expect) return false;
+    expect = (idx + 1) % 3;
+  }
+  return true;
+}
+
+static int run_scenario(const Scenario& sc, uint32_t minutes, bool trace) {
+  SimBus::reset(0xC0FFEE);
+  Serial.enabled = false;
+  const Expect ex = sc.setup();
+  SimBus::setLogging(true);
+
+  Cache_Manager::begin();
+  Cache_Manager::setChangeCallback(on_cache_change);
+  XboxSMBusPoll::begin(7, 6);
+  SMBusExt::begin();
+  UDPStat::begin();
+  LedStat::begin();
+  const unsigned long appStart = millis();
+
+  // How often the raw values change, sampled every 5 s (the old check cadence)
+  XboxStatus lastRaw;
+  uint32_t rawChanges = 0, nextCheck = 5000, sendsAtWarm = 0, ledAtWarm = 0;
+  uint32_t passes = 0, passesAtWarm = 0;
+  auto differs = [](const XboxStatus& a, const XboxStatus& b) {
+    return a.fanSpeed != b.fanSpeed || a.cpuTemp != b.cpuTemp || a.ambientTemp != b.ambientTemp;
+  };
+
+  XboxSMBusStatus st;
+  bool sawGood = false, eeSent = false;
+
+  const uint32_t warmMs = 60000;
+  const uint32_t endMs  = warmMs + minutes * 60000;
+  SimBus::Stats atWarm;
+  bool warmTaken = false;
+
+  while (millis() < endMs) {
+    if (!warmTaken && millis() >= warmMs) {
+      atWarm = SimBus::stats();
+      sendsAtWarm = g_stat_sends;
+      ledAtWarm = g_sim_led_writes;
+      passesAtWarm = passes;
+      warmTaken = true;
+    }
+
+    const bool xboxReady = (millis() - appStart) >= ExpConfig::get(ExpConfig::Key::BootGrace);
+    if (xboxReady && XboxSMBusPoll::poll(st)) {
+      Cache_Manager::updateFromSmbus(st);
+      sawGood = true;
+    }
+    if (millis() >= nextCheck) {
+      nextCheck += 5000;
+      if (millis() >= warmMs && differs(Cache_Manager::getRawStatus(), lastRaw)) rawChanges++;
+      lastRaw = Cache_Manager::getRawStatus();
+    }
+    SMBusExt::loop();
+    if (xboxReady && !eeSent && sawGood) {
+      XboxEEPROM::broadcastOnce();
+      eeSent = true;
+    }
+    LedStat::loop();
+    UDPStat::loop();
+    XboxEEPROM::tick();
+
+    // Sleep to the earliest deadline, as the firmware loop does (the UDP
+    // listeners' poll cap is left out: nothing arrives on them here)
+    const uint32_t now = millis();
+    uint32_t due = now + 1000;
+    auto sooner = [&](uint32_t t) { if ((int32_t)(t - due) < 0) due = t; };
+    sooner(LedStat::nextDueMs());
+    sooner(SMBusExt::nextDueMs());
+    sooner(UDPStat::nextDueMs());
+    sooner(XboxEEPROM::nextDueMs());
+    sooner(nextCheck);
+    if (!warmTaken) sooner(warmMs);
+    sooner(xboxReady ? XboxSMBusPoll::nextDueMs() : appStart + ExpConfig::get(ExpConfig::Key::BootGrace));
+    passes++;
+    delay((int32_t)(due - now) > 0 ? due - now : 1);
+  }
+
+  const SimBus::Stats& s = SimBus::stats();
+  const double steadyMs = (double)(s.busyUs - atWarm.busyUs) / 1000.0;
+  const double perMin   = steadyMs / minutes;
+  const uint32_t phasesPerMin = (s.phases - atWarm.phases) / minutes;
+
+  auto devMs = [&](uint8_t a) { return (double)(s.busyUsByAddr[a] - atWarm.busyUsByAddr[a]) / 1000.0 / minutes; };
+  const double encMs = devMs(CONX) + devMs(FOCS) + devMs(XCAL);
+
+  const bool okTemps = abs(st.cpuTemp - ex.cpu) <= ex.tempTol &&
+                       abs(st.boardTemp - ex.board) <= ex.tempTol && st.fanSpeed == ex.fan;
+  const bool okExt   = g_ext.encoderType == ex.enc && g_ext.xboxVer == ex.xboxVer &&
+                       g_ext.videoWidth == ex.width && g_ext.videoHeight == ex.height;
+  const bool okHdd   = g_ee_hdd == ex.hdd;
+  const bool okRR    = check_round_robin();
+  const bool okRO    = s.dataWrites == 0;
+  const XboxStatus& pub = Cache_Manager::getStatus();
+  const bool okCache = abs(pub.cpuTemp - ex.cpu) <= ex.tempTol &&
+                       abs(pub.ambientTemp - ex.board) <= ex.tempTol && pub.fanSpeed == ex.fan;
+
+  printf("\n== %s: %s\n", sc.name, sc.desc);
+  printf("  occupancy   %8.1f ms/min (%.3f%%)  %u phases/min  startup %.1f ms\n",
+         perMin, perMin / 600.0, phasesPerMin, (double)atWarm.busyUs / 1000.0);
+  printf("  by device   SMC %.1f  encoder %.1f  EEPROM %.1f ms/min\n",
+         devMs(SMC), encMs, devMs(EE));
+  printf("  faults      %u NACKs  %u timeouts  longest phase %.2f ms\n",
+         s.nacks, s.timeouts, s.maxPhaseUs / 1000.0);
+  printf("  poller      CPU=%d Board=%d Fan=%d%%  (expect %d/%d/%d)  %s\n",
+         st.cpuTemp, st.boardTemp, st.fanSpeed, ex.cpu, ex.board, ex.fan, okTemps ? "OK" : "MISMATCH");
+  printf("  ext         enc=0x%02X ver=%d %dx%d  (%u pkts)  %s\n",
+         g_ext.encoderType & 0xFF, g_ext.xboxVer, g_ext.videoWidth, g_ext.videoHeight,
+         g_ext_count, okExt ? "OK" : "MISMATCH");
+  printf("  eeprom      HDD=%s  (%u pkts)  %s\n",
+         g_ee_hdd.empty() ? "-" : g_ee_hdd.c_str(), g_ee_packets, okHdd ? "OK" : "MISMATCH");
+  printf("  ordering    round-robin %s  read-only %s\n",
+         okRR ? "OK" : "BROKEN", okRO ? "OK" : "VIOLATED");
+  printf("  cache       CPU=%d Amb=%d Fan=%d%%  raw changes %u/h  %s\n",
+         pub.cpuTemp, pub.ambientTemp, pub.fanSpeed, rawChanges * 60 / minutes, okCache ? "OK" : "MISMATCH");
+  printf("  udp stat    %u sends/h  change->send avg %u ms  max %u ms  (%u changes)\n",
+         (g_stat_sends - sendsAtWarm) * 60 / minutes,
+         g_lat_n ? g_lat_sum / g_lat_n : 0, g_lat_max, g_lat_n);
+  printf("  status led  %u writes/h\n", (g_sim_led_writes - ledAtWarm) * 60 / minutes);
+  printf("  idle loop   %u passes/h  (a 1 ms spin is 3600000/h)\n", (passes - passesAtWarm) * 60 / minutes);
+
+  if (trace) {
+    for (const auto& t : SimBus::log()) {
+      printf("  %10.3f ms  %s 0x%02X reg 0x%02X len %u  %5u us  rc=%u\n",
+             t.startUs / 1000.0, t.isRead ? "RD" : "WR", t.addr, t.reg, t.len, t.durUs, t.result);
+    }
+  }
+  return (okTemps && okExt && okHdd && okRR && okRO && okCache) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  uint32_t minutes = 10;
+  bool trace = false;
+  std::vector<const Scenario*> pick;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-m") && i + 1 < argc) { minutes = (uint32_t)atoi(argv[++i]); continue; }
+    if (!strcmp(argv[i], "-t")) { trace = true; continue; }
+    if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+      // Runtime config, as sent over the config channel (e.g. smbus_tick=1000)
+      char bad[48];
+      ExpConfig::apply(argv[++i], bad, sizeof(bad));
+      if (bad[0]) { fprintf(stderr, "rejected config: %s\n", bad); return 2; }
+      continue;
+    }
+    bool found = false;
+    for (const auto& sc : kScenarios) {
+      if (!strcmp(argv[i], sc.name)) { pick.push_back(&sc); found = true; }
+    }
+    if (!found) { fprintf(stderr, "unknown scenario: %s\n", argv[i]); return 2; }
+  }
+  if (pick.empty()) for (const auto& sc : kScenarios) pick.push_back(&sc);
+  if (minutes == 0) minutes = 1;
+
+  char cfg[512];
+  ExpConfig::toJson(cfg, sizeof(cfg));
+  printf("SMBus bench: %u min steady state after 60 s, clock %u Hz, tick %u ms\n",
+         minutes, (unsigned)SMBUS_I2C_CLOCK_HZ, (unsigned)ExpConfig::get(ExpConfig::Key::SmbusMinTick));
+  printf("config %s\n", cfg);
+
+  int failures = 0;
+  for (const Scenario* sc : pick) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+      const int rc = run_scenario(*sc, minutes, trace);
+      fflush(stdout);
+      _exit(rc);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+  }
+  printf("\n%d/%zu scenarios matched expectations\n", (int)pick.size() - failures, pick.size());
+  return failures ? 1 : 0;
+}
@@ -8,6 +8,8 @@
 // - Startup "grace" avoids poking the Xbox during boot.
 // - EEPROM broadcast is one-shot, after grace + WiFi + first good poll.
 // - Minimal serial prints to reduce timing noise.
+// - Idle-aware: each module reports when it next has work and the loop
+//   sleeps until the earliest of those (see idle.h) instead of spinning.
 
 #include "xbox_smbus_poll.h"
 #include "parser_xboxsmbus.h"
@@ -17,6 +19,10 @@
 #include "led_stat.h"
 #include "smbus_ext.h"
 #include "eeprom_min.h"
+#include "history.h"
+#include "idle.h"
+#include "exp_config.h"
+#include "exp_remote.h"
 #include <Wire.h>
 
 // ====== Hardware pins (set to your wiring) ======
@@ -28,8 +34,18 @@
 #endif
 
 // ====== Startup grace (don’t touch SMBus during Xbox boot) ======
-#ifndef XBOX_BOOT_GRACE_MS
-#define XBOX_BOOT_GRACE_MS 8000UL  // 8s default; override if you want
+// XBOX_BOOT_GRACE_MS: runtime "boot_grace" (exp_config.h), so it can be tuned
+// per console over the config channel.
+
+// ====== Idle loop ======
+// The UDP listeners (50506 titles, 50507 history, 50508 config) are polled, so the loop
+// never sleeps longer than this while they are open.
+#ifndef IDLE_SOCKET_POLL_MS
+#define IDLE_SOCKET_POLL_MS 50
+#endif
+// Upper bound on any single sleep
+#ifndef IDLE_MAX_SLEEP_MS
+#define IDLE_MAX_SLEEP_MS 1000
 #endif
 
 static unsigned long g_appStartMs = 0;
@@ -46,8 +62,12 @@ void setup() {
   Serial.begin(115200);
   delay(150); // let USB CDC settle a bit
 
+  ExpConfig::begin();   // pacing overrides from NVS, before anything uses them
+  ExpRemote::begin();
   WiFiMgr::begin();
   Cache_Manager::begin();
+  Cache_Manager::setChangeCallback(UDPStat::notifyChanged);
+  History::begin();
 
   // Initialize SMBus users; they manage Wire/pacing/locks themselves
   XboxSMBusPoll::begin(I2C_SDA_PIN, I2C_SCL_PIN);
@@ -57,6 +77,7 @@ void setup() {
     UDPStat::begin();
   }
 
+  Idle::begin();
   g_appStartMs = millis();
   Serial.println("[Main] Type-D firmware started.");
 }
@@ -66,8 +87,11 @@ void loop() {
   LedStat::loop();
   WiFiMgr::loop();
   Cache_Manager::pollTitleUdp(); // Type-D app broadcaster
+  History::loop();               // 1 Hz sampling, batched flash writes, backfill requests
+  ExpRemote::loop();             // config requests (UDP), reboot after OTA
 
-  const bool xboxReady = (millis() - g_appStartMs) >= XBOX_BOOT_GRACE_MS;
+  const uint32_t bootGraceMs = ExpConfig::get(ExpConfig::Key::BootGrace);
+  const bool xboxReady = (millis() - g_appStartMs) >= bootGraceMs;
 
   // ===== SMBus temp/fan poller (module-paced & lock-protected) =====
   // We call it every loop; it will self-throttle and take the lock when safe.
@@ -102,16 +126,39 @@ void loop() {
 
   // ===== Modest status print every 5s =====
   static unsigned long lastPrint = 0;
-  if (millis() - lastPrint > 5000UL) {
+  if (millis() - lastPrint >= 5000UL) {
     lastPrint = millis();
     const XboxStatus& st = Cache_Manager::getStatus();
+    const Idle::Stats is = Idle::takeStats();
     Serial.printf("[Main] Fan=%d%% CPU=%dC Amb=%dC App='%s'%s WiFi=%s\n",
                   st.fanSpeed, st.cpuTemp, st.ambientTemp, st.currentApp,
                   xboxReady ? "" : " (boot-grace)",
                   WiFiMgr::isConnected() ? "on" : "off");
+    Serial.printf("[Idle] %s idle=%u%% passes=%u (timer %u, notify %u) "
+                  "late avg/max=%u/%uus notify avg/max=%u/%uus\n",
+                  Idle::pmMode(), is.spanMs ? (unsigned)(is.sleptMs * 100ULL / is.spanMs) : 0u,
+                  (unsigned)is.passes, (unsigned)is.timerWakes, (unsigned)is.notifyWakes,
+                  (unsigned)is.lateAvgUs, (unsigned)is.lateMaxUs,
+                  (unsigned)is.notifyAvgUs, (unsigned)is.notifyMaxUs);
   }
 
-  // Light cooperative yield; lets WiFi/UDP run smoothly without jittering SMBus.
-  // (Avoid long blocking work here; all bus work happens inside modules with pacing.)
-  delay(1);
+  // ===== Sleep until the earliest module deadline =====
+  // Bus work stays inside the modules' own pacing; this only decides how long
+  // nothing at all is due. Another task can cut it short with Idle::wake().
+  const uint32_t now = millis();
+  uint32_t due = now + IDLE_MAX_SLEEP_MS;
+  due = Idle::earliest(due, LedStat::nextDueMs());
+  due = Idle::earliest(due, WiFiMgr::nextDueMs());
+  due = Idle::earliest(due, History::nextDueMs());
+  due = Idle::earliest(due, SMBusExt::nextDueMs());
+  due = Idle::earliest(due, lastPrint + 5000UL);
+  due = Idle::earliest(due, ExpRemote::nextDueMs());
+  if (xboxReady) due = Idle::earliest(due, XboxSMBusPoll::nextDueMs());
+  else           due = Idle::earliest(due, g_appStartMs + bootGraceMs);
+  if (WiFiMgr::isConnected()) {
+    due = Idle::earliest(due, now + IDLE_SOCKET_POLL_MS);   // 50506 / 50507 / 50508 listeners
+    due = Idle::earliest(due, UDPStat::nextDueMs());
+    due = Idle::earliest(due, XboxEEPROM::nextDueMs());
+  }
+  Idle::sleepUntil(due);
 }
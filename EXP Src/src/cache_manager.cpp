@@ -1,53 +1,311 @@
+// cache_manager.cpp
+//
+// Latest Xbox status for the UDP sender, with a small filter stage on the
+// polled signals. SMC temps jitter by ±1 °C between reads; publishing every
+// flicker makes UDPStat send (and the display latch its overlay) on nearly
+// every check. Each signal runs median-of-N -> EMA -> deadband/hysteresis,
+// and only the published value is what getStatus() returns.
+// - When a published value actually changes, the change callback fires so the
+//   sender can react without polling.
+// - Writes happen from one task (loop()) inside a seqlock; readers on any
+//   core copy a Snapshot without taking a lock and retry if a write raced
+//   them. Each field carries its sample time, so a field that stops updating
+//   (bus wedged, console off) reads as invalid once its TTL passes.
+
 #include "cache_manager.h"
 #include "xbox_smbus_poll.h"
 #include <WiFiUdp.h>
+#include <atomic>
 #include <cstring>
+#include <math.h>
+
+// ---- Freshness (override at build time) ----
+#ifndef CACHE_TTL_SMBUS_MS
+#define CACHE_TTL_SMBUS_MS     45000  // fan/temps: outlasts a few poller backoff rounds
+#endif
+#ifndef CACHE_TTL_APP_MS
+#define CACHE_TTL_APP_MS       0      // title is announced once per launch; keep it
+#endif
+#ifndef CACHE_SNAPSHOT_RETRIES
+#define CACHE_SNAPSHOT_RETRIES 64
+#endif
+
+// ---- Filter defaults (override at build time) ----
+#ifndef CACHE_TEMP_MEDIAN_N
+#define CACHE_TEMP_MEDIAN_N        3
+#endif
+#ifndef CACHE_TEMP_EMA_ALPHA
+#define CACHE_TEMP_EMA_ALPHA       0.35f
+#endif
+#ifndef CACHE_TEMP_DEADBAND_C
+#define CACHE_TEMP_DEADBAND_C      1.0f   // ignore <1 °C drift of the smoothed value
+#endif
+#ifndef CACHE_TEMP_HYSTERESIS_C
+#define CACHE_TEMP_HYSTERESIS_C    0.5f   // extra needed to reverse direction
+#endif
+#ifndef CACHE_SETTLE_MS
+#define CACHE_SETTLE_MS            45000  // a rounded value steady this long is published
+#endif
+#ifndef CACHE_FAN_MEDIAN_N
+#define CACHE_FAN_MEDIAN_N         1      // fan steps are real; pass through
+#endif
+#ifndef CACHE_FAN_EMA_ALPHA
+#define CACHE_FAN_EMA_ALPHA        1.0f
+#endif
+#ifndef CACHE_FAN_DEADBAND_PCT
+#define CACHE_FAN_DEADBAND_PCT     0.0f
+#endif
+
+#define CACHE_FILTER_MAX_N 7
+
+static XboxStatus cache;   // published (filtered)
+static XboxStatus raw;     // last accepted samples
+static uint32_t   g_titleId = 0;
+static char       g_titleName[64] = {0};
+
+// Seqlock-guarded state: odd g_seq = write in progress
+static std::atomic<uint32_t> g_seq{0};
+static uint32_t g_sampledMs[(int)Cache_Manager::Field::Count];
+static uint32_t g_ttlMs[(int)Cache_Manager::Field::Count] = {
+    CACHE_TTL_SMBUS_MS, CACHE_TTL_SMBUS_MS, CACHE_TTL_SMBUS_MS, CACHE_TTL_APP_MS
+};
+static std::atomic<uint32_t> g_version{0};
+
+static inline void write_begin() {
+    g_seq.store(g_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+static inline void write_end() {
+    g_seq.store(g_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+static inline void stamp(Cache_Manager::Field f) {
+    uint32_t now = millis();
+    g_sampledMs[(int)f] = now ? now : 1;   // 0 means "never sampled"
+}
+
+struct SignalFilter {
+    Cache_Manager::FilterConfig cfg;
+    int     win[CACHE_FILTER_MAX_N];
+    uint8_t count;
+    uint8_t head;
+    float   ema;
+    bool    primed;
+    int     published;
+    bool    hasPublished;
+    int8_t  lastDir;     // direction of the last published move (-1/0/+1)
+    int      settleVal;   // rounded EMA while it differs from published
+    bool     settling;
+    uint32_t settleFromMs;  // since when it has held
+};
+
+static SignalFilter g_filters[(int)Cache_Manager::Signal::Count];
+static Cache_Manager::ChangeCallback g_onChange = nullptr;
+
+// Call inside write_begin()/write_end(); returns true if the value moved.
+static inline bool publish_int(int& field, int value) {
+    if (field == value) return false;
+    field = value;
+    g_version.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
 
-static XboxStatus cache;
+// Callback runs after the write is closed so it can snapshot safely.
+static inline void notify(bool changed) {
+    if (changed && g_onChange) g_onChange();
+}
+
+static const Cache_Manager::FilterConfig kDefaultCfg[(int)Cache_Manager::Signal::Count] = {
+    { CACHE_FAN_MEDIAN_N,  CACHE_FAN_EMA_ALPHA,  CACHE_FAN_DEADBAND_PCT, 0.0f },
+    { CACHE_TEMP_MEDIAN_N, CACHE_TEMP_EMA_ALPHA, CACHE_TEMP_DEADBAND_C,  CACHE_TEMP_HYSTERESIS_C },
+    { CACHE_TEMP_MEDIAN_N, CACHE_TEMP_EMA_ALPHA, CACHE_TEMP_DEADBAND_C,  CACHE_TEMP_HYSTERESIS_C },
+};
+
+static Cache_Manager::FilterConfig sanitize(Cache_Manager::FilterConfig c) {
+    if (c.medianN < 1) c.medianN = 1;
+    if (c.medianN > CACHE_FILTER_MAX_N) c.medianN = CACHE_FILTER_MAX_N;
+    if ((c.medianN & 1) == 0) c.medianN++;          // odd windows have a true median
+    if (!(c.emaAlpha > 0.0f) || c.emaAlpha > 1.0f) c.emaAlpha = 1.0f;
+    if (!(c.deadband >= 0.0f)) c.deadband = 0.0f;
+    if (!(c.hysteresis >= 0.0f)) c.hysteresis = 0.0f;
+    return c;
+}
+
+static void filter_reset(SignalFilter& f) {
+    const Cache_Manager::FilterConfig cfg = f.cfg;
+    memset(&f, 0, sizeof(f));
+    f.cfg = cfg;
+}
+
+static int median_of(const SignalFilter& f) {
+    int tmp[CACHE_FILTER_MAX_N];
+    const uint8_t n = f.count;
+    for (uint8_t i = 0; i < n; ++i) tmp[i] = f.win[i];
+    for (uint8_t i = 1; i < n; ++i) {              // insertion sort, n <= 7
+        int v = tmp[i];
+        int j = i - 1;
+        while (j >= 0 && tmp[j] > v) { tmp[j + 1] = tmp[j]; --j; }
+        tmp[j + 1] = v;
+    }
+    return tmp[n / 2];
+}
+
+// Feed one raw sample; returns the published value.
+static int filter_push(SignalFilter& f, int sample) {
+    const uint8_t n = f.cfg.medianN;
+    f.win[f.head] = sample;
+    f.head = (uint8_t)((f.head + 1) % n);
+    if (f.count < n) f.count++;
+
+    const float med = (float)median_of(f);
+    if (!f.primed) { f.ema = med; f.primed = true; }
+    else           { f.ema += f.cfg.emaAlpha * (med - f.ema); }
+
+    const int target = (int)lroundf(f.ema);
+    if (!f.hasPublished) {
+        f.published = target;
+        f.hasPublished = true;
+        return f.published;
+    }
+
+    const float diff = f.ema - (float)f.published;
+    const int8_t dir = (diff > 0.0f) ? 1 : (diff < 0.0f ? -1 : 0);
+    if (dir == 0 || target == f.published) {
+        f.settling = false;
+        return f.published;
+    }
+
+    // The EMA only approaches a new level, so the deadband alone can leave
+    // the published value short of it for good (a 1-unit step never moved
+    // it, a 5-unit one stopped at 4). A rounded value that holds for
+    // CACHE_SETTLE_MS is taken whatever the deadband; flicker doesn't hold
+    // that long.
+    if (!f.settling || target != f.settleVal) {
+        f.settleVal = target;
+        f.settling = true;
+        f.settleFromMs = millis();
+    }
+
+    float need = f.cfg.deadband;
+    if (f.lastDir != 0 && dir != f.lastDir) need += f.cfg.hysteresis;
+    if (fabsf(diff) >= need || millis() - f.settleFromMs >= CACHE_SETTLE_MS) {
+        f.published = target;
+        f.lastDir = dir;
+        f.settling = false;
+    }
+    return f.published;
+}
+
+static SignalFilter& filter(Cache_Manager::Signal s) { return g_filters[(int)s]; }
 
 void Cache_Manager::begin() {
+    for (int i = 0; i < (int)Signal::Count; ++i) g_filters[i].cfg = sanitize(kDefaultCfg[i]);
     reset();
 }
 
+void Cache_Manager::setChangeCallback(ChangeCallback cb) {
+    g_onChange = cb;
+}
+
 void Cache_Manager::reset() {
+    write_begin();
     cache.fanSpeed = -1;
     cache.cpuTemp = -1000;
     cache.ambientTemp = -1000;
     memset(cache.currentApp, 0, sizeof(cache.currentApp));
+    raw = cache;
+    g_titleId = 0;
+    memset(g_titleName, 0, sizeof(g_titleName));
+    memset(g_sampledMs, 0, sizeof(g_sampledMs));
+    g_version.fetch_add(1, std::memory_order_relaxed);
+    write_end();
+    for (auto& f : g_filters) filter_reset(f);
+}
+
+void Cache_Manager::setFilterConfig(Signal s, const FilterConfig& cfg) {
+    if (s >= Signal::Count) return;
+    filter(s).cfg = sanitize(cfg);
+    filter_reset(filter(s));   // window size may have changed; restart cleanly
+}
+
+Cache_Manager::FilterConfig Cache_Manager::getFilterConfig(Signal s) {
+    if (s >= Signal::Count) return kDefaultCfg[0];
+    return filter(s).cfg;
+}
+
+float Cache_Manager::getSmoothed(Signal s) {
+    if (s >= Signal::Count || !filter(s).primed) return NAN;
+    return filter(s).ema;
 }
 
 void Cache_Manager::setFanSpeed(int percent) {
     if (percent < 0) percent = 0;
     if (percent > 100) percent = 100;
-    cache.fanSpeed = percent;
+    const int pub = filter_push(filter(Signal::Fan), percent);
+    write_begin();
+    raw.fanSpeed = percent;
+    stamp(Field::Fan);
+    const bool changed = publish_int(cache.fanSpeed, pub);
+    write_end();
+    notify(changed);
 }
 
 void Cache_Manager::setCpuTemp(int celsius) {
     // Accept only valid range for Xbox (avoid garbage)
     if (celsius > 0 && celsius < 100) {
-        cache.cpuTemp = celsius;
+        const int pub = filter_push(filter(Signal::CpuTemp), celsius);
+        write_begin();
+        raw.cpuTemp = celsius;
+        stamp(Field::CpuTemp);
+        const bool changed = publish_int(cache.cpuTemp, pub);
+        write_end();
+        notify(changed);
     }
 }
 
 void Cache_Manager::setAmbientTemp(int celsius) {
     if (celsius > 0 && celsius < 100) {
-        cache.ambientTemp = celsius;
+        const int pub = filter_push(filter(Signal::AmbientTemp), celsius);
+        write_begin();
+        raw.ambientTemp = celsius;
+        stamp(Field::AmbientTemp);
+        const bool changed = publish_int(cache.ambientTemp, pub);
+        write_end();
+        notify(changed);
     }
 }
 
 void Cache_Manager::setCurrentApp(const char *name) {
+    setTitle(name, 0);
+}
+
+void Cache_Manager::setTitle(const char *name, uint32_t titleId) {
     if (name && *name) {
-        strncpy(cache.currentApp, name, sizeof(cache.currentApp) - 1);
+        char full[sizeof(g_titleName)] = {0};
+        strncpy(full, name, sizeof(full) - 1);
+        const bool changed = titleId != g_titleId || memcmp(full, g_titleName, sizeof(full)) != 0;
+        write_begin();
+        memcpy(g_titleName, full, sizeof(g_titleName));
+        g_titleId = titleId;
+        memcpy(cache.currentApp, full, sizeof(cache.currentApp) - 1);
         cache.currentApp[sizeof(cache.currentApp) - 1] = 0;
-        //Serial.printf("[CacheMgr] App name updated: %s\n", cache.currentApp);
+        memcpy(raw.currentApp, cache.currentApp, sizeof(raw.currentApp));
+        stamp(Field::App);
+        if (changed) g_version.fetch_add(1, std::memory_order_relaxed);
+        write_end();
+        notify(changed);
+        //Serial.printf("[CacheMgr] App name updated: %s (TID %08X)\n", g_titleName, titleId);
     }
 }
 
 // --- PATCH: update cache from SMBus struct ---
+// Only fields the poller actually read this tick are fed to the filters;
+// the others are carried over in the struct and would count as duplicates.
 void Cache_Manager::updateFromSmbus(const XboxSMBusStatus& st) {
-    setFanSpeed(st.fanSpeed);
-    setCpuTemp(st.cpuTemp);
-    setAmbientTemp(st.boardTemp); // or st.ambientTemp, if that's your struct field
+    if (st.fresh & SMBUS_FRESH_FAN)   setFanSpeed(st.fanSpeed);
+    if (st.fresh & SMBUS_FRESH_CPU)   setCpuTemp(st.cpuTemp);
+    if (st.fresh & SMBUS_FRESH_BOARD) setAmbientTemp(st.boardTemp); // or st.ambientTemp, if that's your struct field
     // setCurrentApp(st.app); // Only if app name is available in st
 }
 
@@ -55,6 +313,50 @@ const XboxStatus& Cache_Manager::getStatus() {
     return cache;
 }
 
+const XboxStatus& Cache_Manager::getRawStatus() {
+    return raw;
+}
+
+bool Cache_Manager::snapshot(Snapshot& out) {
+    Snapshot tmp;
+    for (int attempt = 0; attempt < CACHE_SNAPSHOT_RETRIES; ++attempt) {
+        const uint32_t s0 = g_seq.load(std::memory_order_acquire);
+        if (s0 & 1) { yield(); continue; }   // writer mid-update
+
+        tmp.status = cache;
+        tmp.titleId = g_titleId;
+        memcpy(tmp.titleName, g_titleName, sizeof(tmp.titleName));
+        memcpy(tmp.sampledMs, g_sampledMs, sizeof(tmp.sampledMs));
+        tmp.version = g_version.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (g_seq.load(std::memory_order_relaxed) != s0) continue;
+
+        const uint32_t now = millis();
+        tmp.validMask = 0;
+        for (int i = 0; i < (int)Field::Count; ++i) {
+            if (!tmp.sampledMs[i]) continue;
+            if (g_ttlMs[i] && (now - tmp.sampledMs[i]) > g_ttlMs[i]) continue;
+            tmp.validMask |= (uint8_t)(1u << i);
+        }
+        out = tmp;
+        return true;
+    }
+    return false;
+}
+
+uint32_t Cache_Manager::version() {
+    return g_version.load(std::memory_order_relaxed);
+}
+
+void Cache_Manager::setTtlMs(Field f, uint32_t ms) {
+    if (f < Field::Count) g_ttlMs[(int)f] = ms;
+}
+
+uint32_t Cache_Manager::getTtlMs(Field f) {
+    return (f < Field::Count) ? g_ttlMs[(int)f] : 0;
+}
+
 static WiFiUDP g_appUdp;
 static bool g_udpBound = false;
 
@@ -68,21 +370,33 @@ static bool recv_line_udp(WiFiUDP& u, char* buf, size_t buflen) {
     return true;
 }
 
-// Very tolerant parser: accept either "APP:Name|TID:0xXXXXXX" or just raw title
-static void parse_app_payload(const char* in, char* outName32) {
+// Very tolerant parser: accept either "APP:Name|TID:0xXXXXXXXX" or just raw title.
+// TID may be hex with or without 0x. Our own EE:/status frames on this port are ignored.
+static bool parse_app_payload(const char* in, char* outName, size_t outLen, uint32_t* outTid) {
+    *outTid = 0;
+    outName[0] = 0;
+    if (!strncmp(in, "EE:", 3)) return false;
+
     const char* p = strstr(in, "APP:");
     const char* name = p ? p + 4 : in;
-    // cut at '|' if present
-    char tmp[128];
+    while (*name == ' ' || *name == '\t') ++name;
+
+    // cut at '|' or line end, trim trailing whitespace
     size_t i = 0;
-    while (name[i] && name[i] != '|' && i < sizeof(tmp) - 1) { tmp[i] = name[i]; i++; }
-    tmp[i] = 0;
+    while (name[i] && name[i] != '|' && name[i] != '\r' && name[i] != '\n' && i < outLen - 1) {
+        outName[i] = name[i];
+        i++;
+    }
+    while (i > 0 && (outName[i - 1] == ' ' || outName[i - 1] == '\t')) --i;
+    outName[i] = 0;
 
-    // trim whitespace
-    while (*tmp == ' ' || *tmp == '\t') ++name, --i;
-    // copy up to 31 bytes
-    strncpy(outName32, tmp, 31);
-    outName32[31] = 0;
+    const char* t = strstr(in, "TID:");
+    if (t) {
+        t += 4;
+        while (*t == ' ') ++t;
+        *outTid = (uint32_t)strtoul(t, nullptr, 16);   // accepts optional 0x
+    }
+    return outName[0] != 0;
 }
 
 void Cache_Manager::pollTitleUdp() {
@@ -94,10 +408,10 @@ void Cache_Manager::pollTitleUdp() {
 
     char buf[256];
     if (recv_line_udp(g_appUdp, buf, sizeof(buf))) {
-        char name[32] = {0};
-        parse_app_payload(buf, name);
-        if (name[0]) {
-            setCurrentApp(name);
+        char name[sizeof(g_titleName)];
+        uint32_t tid = 0;
+        if (parse_app_payload(buf, name, sizeof(name), &tid)) {
+            setTitle(name, tid);
         //    Serial.printf("[CacheMgr] Title via UDP: %s\n", name);
         }
     }
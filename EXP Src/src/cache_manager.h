@@ -9,19 +9,81 @@ struct XboxStatus {
     char currentApp[32] = {0};
 };
 
+// Title frame sent on 50504 after the core packet (different size, so older
+// receivers that expect sizeof(XboxStatus) skip it). Carries the full name.
+struct XboxTitlePacket {
+    char     magic[4];      // "TDT1"
+    uint32_t titleId;       // 0 = unknown
+    char     name[64];      // full title, NUL-terminated
+};
+
 struct XboxSMBusStatus; // fwd
 
 namespace Cache_Manager {
+    // Polled signals that go through the filter stage
+    enum class Signal : uint8_t { Fan = 0, CpuTemp, AmbientTemp, Count };
+
+    // Per-signal filter: median-of-N -> EMA -> deadband/hysteresis.
+    // The published value only moves when the smoothed value is at least
+    // `deadband` away from it; reversing direction needs `hysteresis` more.
+    // A rounded smoothed value that holds steady is published regardless,
+    // so a step smaller than the deadband still lands on its level.
+    struct FilterConfig {
+        uint8_t medianN;     // 1 = off, odd values up to 7
+        float   emaAlpha;    // 0 < a <= 1 (1 = off)
+        float   deadband;    // in signal units (°C / %)
+        float   hysteresis;  // extra margin on direction reversal
+    };
+
+    // Fields tracked for freshness
+    enum class Field : uint8_t { Fan = 0, CpuTemp, AmbientTemp, App, Count };
+
+    // Consistent copy of the cache, safe to take from any task or core.
+    struct Snapshot {
+        XboxStatus status;                        // published values
+        uint32_t   titleId;                       // from "APP:..|TID:.."; 0 = unknown
+        char       titleName[64];                 // untruncated title
+        uint32_t   sampledMs[(int)Field::Count];  // millis() of the last sample (0 = never)
+        uint8_t    validMask;                     // bit per Field: sampled and within TTL
+        uint32_t   version;                       // bumps on every published change
+        bool valid(Field f) const { return validMask & (1u << (int)f); }
+    };
+
+    // Called (from the writer's context) whenever a published value changes
+    typedef void (*ChangeCallback)();
+
     void begin();
+    void setChangeCallback(ChangeCallback cb);
     void setFanSpeed(int percent);
     void setCpuTemp(int celsius);
     void setAmbientTemp(int celsius);
     void setCurrentApp(const char *name);
+    // Name (full length kept; currentApp gets the first 31 bytes) + title ID
+    void setTitle(const char *name, uint32_t titleId);
 
     // NOTE: remove 'static' here so we can link the definition in the .cpp
     void pollTitleUdp();
 
+    // Filtered/published values. Live reference: only safe from the writer's
+    // task (loop()); other tasks/cores should use snapshot().
     const XboxStatus& getStatus();
+    // Last accepted raw samples, before filtering (writer's task only)
+    const XboxStatus& getRawStatus();
+
+    // Lock-free consistent read (seqlock). False only if a writer kept the
+    // cache busy for the whole retry budget; `out` is then left untouched.
+    bool snapshot(Snapshot& out);
+    // Monotonic change counter; cheap to diff against a previous snapshot
+    uint32_t version();
+    // Max sample age before a field reads as invalid (0 = never expires)
+    void setTtlMs(Field f, uint32_t ms);
+    uint32_t getTtlMs(Field f);
+    // Smoothed (EMA) value before deadband/rounding; NAN until first sample
+    float getSmoothed(Signal s);
+
+    void setFilterConfig(Signal s, const FilterConfig& cfg);
+    FilterConfig getFilterConfig(Signal s);
+
     void reset();
     void updateFromSmbus(const XboxSMBusStatus& st);
 }
@@ -183,6 +183,41 @@ namespace XboxEEPROM {
   static const int LEN_CHECKSUM  = 0x14;
   static const uint8_t kFactoryLens[2] = { 0x1C, 0x18 };  // try 28 then 24 bytes
 
+  // HDD key from a full EEPROM image: for each revision key, RC4-decrypt the
+  // factory section with HMAC-SHA1(key, stored checksum) and accept the
+  // first length whose HMAC matches the checksum. `hex` gets 32 hex chars.
+  static bool derive_hdd_key(const uint8_t rom[256], char hex[33]) {
+    const uint8_t* chk = &rom[OFF_CHECKSUM];
+    const uint8_t* candidates[3] = { EEPROM_KEY_V10, EEPROM_KEY_V11_14, EEPROM_KEY_V16 };
+    // const char*    cand_name [3] = { "v1.0", "v1.1-1.4", "v1.6/1.6b" };
+
+    for (int k = 0; k < 3; ++k) {
+      uint8_t rc4key[20];
+      if (!hmac_sha1(candidates[k], 16, chk, LEN_CHECKSUM, rc4key)) continue;
+
+      uint8_t fac[LEN_FACTORY];
+      memcpy(fac, &rom[OFF_FACTORY], LEN_FACTORY);
+      rc4_state st; rc4_init(&st, rc4key, sizeof(rc4key));
+
+      // try both lengths
+      for (int li = 0; li < 2; ++li) {
+        const int fac_len = kFactoryLens[li];
+        uint8_t tmp[LEN_FACTORY];
+        memcpy(tmp, fac, LEN_FACTORY);
+        rc4_state st2 = st;           // copy state for fresh decrypt per length
+        rc4_crypt(&st2, tmp, fac_len);
+
+        uint8_t tmpHmac[20];
+        if (!hmac_sha1(candidates[k], 16, tmp, fac_len, tmpHmac)) continue;
+        if (memcmp(tmpHmac, chk, LEN_CHECKSUM) != 0) continue;
+
+        toHexUpper(&tmp[8], 16, hex);
+        return true;
+      }
+    }
+    return false;
+  }
+
   // ---------- one-time ROM + HDD cache for broadcast ----------
   static bool    s_have_rom  = false;
   static uint8_t s_rom[256];
@@ -264,34 +299,7 @@ namespace XboxEEPROM {
         }
 
         // Decrypt HDD key once and cache result (CPU-only; no SMBus)
-        const uint8_t* chk = &s_rom[OFF_CHECKSUM];
-        const uint8_t* candidates[3] = { EEPROM_KEY_V10, EEPROM_KEY_V11_14, EEPROM_KEY_V16 };
-        // const char*    cand_name [3] = { "v1.0", "v1.1-1.4", "v1.6/1.6b" };
-
-        for (int k = 0; k < 3 && !s_have_hdd; ++k) {
-          uint8_t rc4key[20];
-          if (!hmac_sha1(candidates[k], 16, chk, LEN_CHECKSUM, rc4key)) continue;
-
-          uint8_t fac[LEN_FACTORY];
-          memcpy(fac, &s_rom[OFF_FACTORY], LEN_FACTORY);
-          rc4_state st; rc4_init(&st, rc4key, sizeof(rc4key));
-
-          // try both lengths
-          for (int li = 0; li < 2 && !s_have_hdd; ++li) {
-            const int fac_len = kFactoryLens[li];
-            uint8_t tmp[LEN_FACTORY];
-            memcpy(tmp, fac, LEN_FACTORY);
-            rc4_state st2 = st;           // copy state for fresh decrypt per length
-            rc4_crypt(&st2, tmp, fac_len);
-
-            uint8_t tmpHmac[20];
-            if (!hmac_sha1(candidates[k], 16, tmp, fac_len, tmpHmac)) continue;
-            if (memcmp(tmpHmac, chk, LEN_CHECKSUM) != 0) continue;
-
-            toHexUpper(&tmp[8], 16, s_hdd_hex);
-            s_have_hdd = true;
-          }
-        }
+        s_have_hdd = derive_hdd_key(s_rom, s_hdd_hex);
 
         s_have_rom = true; // mark snapshot complete
       }
@@ -319,4 +327,10 @@ namespace XboxEEPROM {
     }
   }
 
+  // -------- next rebroadcast time (for the idle-aware main loop) ------------
+  uint32_t nextDueMs() {
+    if (!s_have_rom) return millis() + 60000UL;
+    return s_last_bcast + EEPROM_REBROADCAST_MS;
+  }
+
 }  // namespace XboxEEPROM
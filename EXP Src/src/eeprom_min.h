@@ -21,4 +21,7 @@ namespace XboxEEPROM {
 
   // Periodic rebroadcast from cached EEPROM/HDD data; call regularly (e.g., from loop()).
   void tick();
+
+  // millis() when tick() next rebroadcasts (far ahead if nothing is cached)
+  uint32_t nextDueMs();
 }
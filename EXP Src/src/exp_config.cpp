@@ -0,0 +1,135 @@
+// exp_config.cpp
+//
+// Runtime pacing parameters backed by NVS.
+// - Values live in a plain array so readers (the SMBus poller, UDPStat, the
+//   main loop) pay one load per use; each is a single aligned 32-bit word,
+//   so a set() from the web/UDP task never tears a read on the other core.
+// - Only values that differ from the compiled default are stored; resetting
+//   a key removes it, so a firmware with new defaults takes effect unless the
+//   user overrode that key.
+
+#include "exp_config.h"
+#include <Preferences.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+struct Param {
+    const char* name;     // also the NVS key (<= 15 chars)
+    uint32_t    def;
+    uint32_t    min;
+    uint32_t    max;
+};
+
+static const Param kParams[(int)ExpConfig::Key::Count] = {
+    { "smbus_tick",   SMBUS_MIN_TICK_MS,       100,  60000   },
+    { "ext_period",   SMBUS_EXT_MIN_PERIOD_MS, 1000, 600000  },
+    { "udp_check",    UDP_CHECK_INTERVAL_MS,   500,  600000  },
+    { "udp_debounce", UDP_DEBOUNCE_MS,         0,    5000    },
+    { "heartbeat",    UDP_HEARTBEAT_MS,        0,    3600000 },
+    { "boot_grace",   XBOX_BOOT_GRACE_MS,      0,    120000  },
+};
+
+static volatile uint32_t s_val[(int)ExpConfig::Key::Count] = {
+    SMBUS_MIN_TICK_MS, SMBUS_EXT_MIN_PERIOD_MS, UDP_CHECK_INTERVAL_MS,
+    UDP_DEBOUNCE_MS, UDP_HEARTBEAT_MS, XBOX_BOOT_GRACE_MS,
+};
+
+static Preferences s_prefs;
+
+static int find_key(const char* name) {
+    for (int i = 0; i < (int)ExpConfig::Key::Count; ++i)
+        if (strcmp(kParams[i].name, name) == 0) return i;
+    return -1;
+}
+
+static void store(int i, uint32_t v) {
+    if (!s_prefs.begin("expcfg", false)) return;
+    if (v == kParams[i].def) s_prefs.remove(kParams[i].name);
+    else                     s_prefs.putUInt(kParams[i].name, v);
+    s_prefs.end();
+}
+
+// ====== Public ======
+void ExpConfig::begin() {
+    if (!s_prefs.begin("expcfg", true)) return;   // namespace not created yet
+    for (int i = 0; i < (int)Key::Count; ++i) {
+        const uint32_t v = s_prefs.getUInt(kParams[i].name, kParams[i].def);
+        s_val[i] = (v >= kParams[i].min && v <= kParams[i].max) ? v : kParams[i].def;
+    }
+    s_prefs.end();
+}
+
+uint32_t ExpConfig::get(Key k) {
+    return s_val[(int)k];
+}
+
+bool ExpConfig::set(Key k, uint32_t v, bool persist) {
+    const int i = (int)k;
+    if (i < 0 || i >= (int)Key::Count) return false;
+    if (v < kParams[i].min || v > kParams[i].max) return false;
+    s_val[i] = v;
+    if (persist) store(i, v);
+    return true;
+}
+
+bool ExpConfig::set(const char* name, const char* value, bool persist) {
+    const int i = find_key(name);
+    if (i < 0 || !value || !*value) return false;
+    char* end = nullptr;
+    const unsigned long v = strtoul(value, &end, 10);
+    if (*end) return false;
+    return set((Key)i, (uint32_t)v, persist);
+}
+
+void ExpConfig::resetDefaults() {
+    for (int i = 0; i < (int)Key::Count; ++i) s_val[i] = kParams[i].def;
+    if (s_prefs.begin("expcfg", false)) {
+        s_prefs.clear();
+        s_prefs.end();
+    }
+}
+
+int ExpConfig::apply(const char* list, char* bad, size_t badCap) {
+    if (bad && badCap) bad[0] = 0;
+    if (!list) return 0;
+    int applied = 0;
+    while (*list) {
+        const size_t n = strcspn(list, ",&");
+        char pair[48];
+        if (n > 0 && n < sizeof(pair)) {
+            memcpy(pair, list, n);
+            pair[n] = 0;
+            char* eq = strchr(pair, '=');
+            if (eq) *eq = 0;
+            if (eq && set(pair, eq + 1)) applied++;
+            else if (bad && badCap && !bad[0]) { if (eq) *eq = '='; snprintf(bad, badCap, "%s", pair); }
+        }
+        list += n;
+        if (*list) list++;
+    }
+    return applied;
+}
+
+const char* ExpConfig::name(Key k) {
+    const int i = (int)k;
+    return (i >= 0 && i < (int)Key::Count) ? kParams[i].name : "";
+}
+
+size_t ExpConfig::toJson(char* buf, size_t cap) {
+    if (!buf || cap < 3) return 0;
+    size_t n = 0;
+    buf[n++] = '{';
+    for (int i = 0; i < (int)Key::Count; ++i) {
+        const int w = snprintf(buf + n, cap - n, "%s\"%s\":{\"v\":%lu,\"def\":%lu,\"min\":%lu,\"max\":%lu}",
+                               i ? "," : "", kParams[i].name, (unsigned long)s_val[i],
+                               (unsigned long)kParams[i].def, (unsigned long)kParams[i].min,
+                               (unsigned long)kParams[i].max);
+        if (w < 0 || (size_t)w >= cap - n) { buf[0] = 0; return 0; }
+        n += w;
+    }
+    if (n + 2 > cap) { buf[0] = 0; return 0; }
+    buf[n++] = '}';
+    buf[n] = 0;
+    return n;
+}
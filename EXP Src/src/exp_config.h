@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+
+// Runtime pacing parameters. The defaults are the compile-time knobs below
+// (still overridable with -D); values set over the config channel are range
+// checked and persisted in NVS ("expcfg"), so they survive reboots and OTA.
+
+// ---------- Defaults ----------
+#ifndef SMBUS_MIN_TICK_MS
+#define SMBUS_MIN_TICK_MS          250    // one RR step every 1s (~4s full cycle)
+#endif
+#ifndef SMBUS_EXT_MIN_PERIOD_MS
+#define SMBUS_EXT_MIN_PERIOD_MS    4000   // steady state cadence (~4s)
+#endif
+#ifndef UDP_CHECK_INTERVAL_MS
+#define UDP_CHECK_INTERVAL_MS      5000   // fallback change check (~5s)
+#endif
+#ifndef UDP_DEBOUNCE_MS
+#define UDP_DEBOUNCE_MS            100    // let a burst of changes settle
+#endif
+#ifndef UDP_HEARTBEAT_MS
+#define UDP_HEARTBEAT_MS           30000  // resend unchanged status (0 = never)
+#endif
+#ifndef XBOX_BOOT_GRACE_MS
+#define XBOX_BOOT_GRACE_MS         8000UL // don't touch SMBus during Xbox boot
+#endif
+
+namespace ExpConfig {
+    enum class Key : uint8_t {
+        SmbusMinTick = 0,   // "smbus_tick"
+        SmbusExtPeriod,     // "ext_period"
+        UdpCheckInterval,   // "udp_check"
+        UdpDebounce,        // "udp_debounce"
+        UdpHeartbeat,       // "heartbeat"
+        BootGrace,          // "boot_grace"
+        Count
+    };
+
+    void begin();                 // load stored overrides from NVS
+    uint32_t get(Key k);          // cheap; safe to call every loop
+
+    // Range-checked set; persist=false changes it until the next reboot only
+    bool set(Key k, uint32_t v, bool persist = true);
+    bool set(const char* name, const char* value, bool persist = true);
+    void resetDefaults();         // also clears NVS
+
+    // "key=value" pairs separated by ',' or '&'. Returns how many were
+    // applied; the first rejected pair is copied to `bad` (if given).
+    int apply(const char* list, char* bad = nullptr, size_t badCap = 0);
+
+    const char* name(Key k);
+    // {"smbus_tick":{"v":250,"def":250,"min":100,"max":60000},...}
+    size_t toJson(char* buf, size_t cap);
+}
@@ -0,0 +1,365 @@
+// exp_remote.cpp
+//
+// Remote configuration and signed OTA for the expansion.
+//
+// Config (values/ranges in exp_config.cpp):
+// - GET  /config                 -> {"smbus_tick":{"v":..,"def":..,"min":..,"max":..},...}
+// - POST /config?k=v&k=v         -> apply (persisted), same JSON back; reset=1 restores defaults
+// - UDP CFG_UDP_PORT: "CFG:GET", "CFG:SET:k=v,k=v", "CFG:RESET" -> "CFG:{json}" to the
+//   sender. A broadcast SET retunes every expansion on the LAN at once.
+//
+// OTA bundle = ExpRemote::OtaHeader (104 bytes) + image, built by script/exp_ota.py.
+// - POST /ota/begin        body = header; same image as the stored session -> resume
+// - POST /ota/chunk?off=N  body = image bytes from N; any other offset -> 409
+// - GET  /ota/status
+// - POST /ota/end          digest + signature check, set boot partition, reboot
+// All replies are {"state":..,"size":..,"next":..,"err":..}; a client always
+// continues from "next".
+//
+// Chunks go straight to the next OTA partition through esp_partition_*, not
+// Update, so a transfer can continue after a power cycle: the session (digest,
+// size, partition) and a committed offset are kept in NVS every
+// OTA_COMMIT_BYTES, and on resume the part already in flash is re-hashed.
+// Nothing can boot until /ota/end has checked the whole image against the
+// signed digest (esp_ota_set_boot_partition also validates the image).
+
+#include "exp_remote.h"
+#include "exp_config.h"
+#include "ota_key.h"
+#include "idle.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPAsyncWebServer.h>
+#include <Preferences.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ecdsa.h"
+#include <string.h>
+
+// ---- exported by xbox_smbus_poll.cpp ----
+extern uint32_t smbus_last_activity_ms();
+
+// ====== Config ======
+#ifndef CFG_UDP_PORT
+#define CFG_UDP_PORT            50508
+#endif
+#ifndef OTA_COMMIT_BYTES
+#define OTA_COMMIT_BYTES        (64u * 1024u)   // NVS progress granularity (sector multiple)
+#endif
+#ifndef OTA_REBOOT_DELAY_MS
+#define OTA_REBOOT_DELAY_MS     1000            // let the /ota/end reply go out
+#endif
+#ifndef SMBUS_QUIET_BEFORE_UDP_MS
+#define SMBUS_QUIET_BEFORE_UDP_MS  6
+#endif
+#define OTA_SECTOR              4096u
+
+// ====== State ======
+enum class OtaState : uint8_t { Idle, Receiving, Done, Error };
+
+static WiFiUDP     s_cfgUdp;
+static bool        s_cfgBound = false;
+static Preferences s_prefs;
+
+static OtaState                 s_state = OtaState::Idle;
+static ExpRemote::OtaHeader     s_hdr;
+static const esp_partition_t*   s_part = nullptr;
+static mbedtls_sha256_context   s_sha;
+static bool                     s_shaLive = false;
+static uint32_t                 s_off = 0;        // next image byte expected
+static uint32_t                 s_erasedTo = 0;   // partition erased up to here
+static uint32_t                 s_committed = 0;  // offset last saved to NVS
+static char                     s_err[48] = "";
+static uint32_t                 s_rebootAt = 0;   // 0 = none
+
+// Per-request body scratch (one OTA client at a time)
+static uint8_t  s_hdrBuf[sizeof(ExpRemote::OtaHeader)];
+static size_t   s_hdrLen = 0;
+static bool     s_chunkOk = false;
+
+static const char* state_name() {
+    switch (s_state) {
+        case OtaState::Receiving: return "receiving";
+        case OtaState::Done:      return "done";
+        case OtaState::Error:     return "error";
+        default:                  return "idle";
+    }
+}
+
+static void fail(const char* why) {
+    snprintf(s_err, sizeof(s_err), "%s", why);
+    s_state = OtaState::Error;
+    Serial.printf("[OTA] %s\n", why);
+}
+
+static void send_status(AsyncWebServerRequest* request, int code) {
+    char body[160];
+    snprintf(body, sizeof(body), "{\"state\":\"%s\",\"size\":%lu,\"next\":%lu,\"err\":\"%s\"}",
+             state_name(), (unsigned long)s_hdr.size, (unsigned long)s_off, s_err);
+    request->send(code, "application/json", body);
+}
+
+// ---- session in NVS ----
+static void session_save() {
+    if (!s_prefs.begin("expota", false)) return;
+    s_prefs.putBytes("hdr", &s_hdr, sizeof(s_hdr));
+    s_prefs.putString("part", s_part ? s_part->label : "");
+    s_prefs.putUInt("off", s_committed);
+    s_prefs.end();
+}
+
+static void session_clear() {
+    if (!s_prefs.begin("expota", false)) return;
+    s_prefs.clear();
+    s_prefs.end();
+}
+
+static bool session_load(ExpRemote::OtaHeader& hdr, String& part, uint32_t& off) {
+    if (!s_prefs.begin("expota", true)) return false;
+    const bool ok = s_prefs.getBytes("hdr", &hdr, sizeof(hdr)) == sizeof(hdr);
+    part = s_prefs.getString("part", "");
+    off  = s_prefs.getUInt("off", 0);
+    s_prefs.end();
+    return ok;
+}
+
+// ---- image writing ----
+static void sha_reset() {
+    if (s_shaLive) mbedtls_sha256_free(&s_sha);
+    mbedtls_sha256_init(&s_sha);
+    mbedtls_sha256_starts(&s_sha, 0);
+    s_shaLive = true;
+}
+
+static bool write_image(const uint8_t* data, size_t len) {
+    while (len) {
+        if (s_off >= s_erasedTo) {
+            if (esp_partition_erase_range(s_part, s_erasedTo, OTA_SECTOR) != ESP_OK) { fail("erase failed"); return false; }
+            s_erasedTo += OTA_SECTOR;
+        }
+        size_t take = s_erasedTo - s_off;
+        if (take > len) take = len;
+        if (esp_partition_write(s_part, s_off, data, take) != ESP_OK) { fail("write failed"); return false; }
+        mbedtls_sha256_update(&s_sha, data, take);
+        s_off += take; data += take; len -= take;
+    }
+    // Progress is only ever committed on a sector boundary, so a resume after
+    // power loss starts on a fresh (re-erased) sector
+    if (s_off - s_committed >= OTA_COMMIT_BYTES) {
+        s_committed = s_off - (s_off % OTA_COMMIT_BYTES);
+        session_save();
+    }
+    return true;
+}
+
+// Rebuild the digest over what a previous boot already wrote
+static bool rehash(uint32_t upTo) {
+    static uint8_t buf[OTA_SECTOR];
+    for (uint32_t pos = 0; pos < upTo; pos += OTA_SECTOR) {
+        const uint32_t n = (upTo - pos) < OTA_SECTOR ? (upTo - pos) : OTA_SECTOR;
+        if (esp_partition_read(s_part, pos, buf, n) != ESP_OK) return false;
+        mbedtls_sha256_update(&s_sha, buf, n);
+    }
+    return true;
+}
+
+static bool sig_ok(const uint8_t hash[32], const uint8_t sig[64]) {
+#if EXP_OTA_KEY_SET
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point q;
+    mbedtls_mpi r, s;
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_point_init(&q);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    const bool ok = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1) == 0 &&
+                    mbedtls_ecp_point_read_binary(&grp, &q, EXP_OTA_PUBKEY, sizeof(EXP_OTA_PUBKEY)) == 0 &&
+                    mbedtls_mpi_read_binary(&r, sig, 32) == 0 &&
+                    mbedtls_mpi_read_binary(&s, sig + 32, 32) == 0 &&
+                    mbedtls_ecdsa_verify(&grp, hash, 32, &q, &r, &s) == 0;
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+    mbedtls_ecp_point_free(&q);
+    mbedtls_ecp_group_free(&grp);
+    return ok;
+#else
+    (void)hash; (void)sig;
+    return false;
+#endif
+}
+
+// Start or resume a session for `hdr`. Returns false (with s_err set) if refused.
+static bool ota_begin(const ExpRemote::OtaHeader& hdr) {
+    s_err[0] = 0;
+    if (!EXP_OTA_KEY_SET) { fail("no signing key in this build"); return false; }
+    if (memcmp(hdr.magic, "TDO1", 4) != 0) { fail("bad header"); return false; }
+    // Check the signature up front so an unsigned image is refused before any erase
+    if (!sig_ok(hdr.sha256, hdr.sig)) { fail("bad signature"); return false; }
+
+    const esp_partition_t* part = esp_ota_get_next_update_partition(nullptr);
+    if (!part) { fail("no OTA partition"); return false; }
+    if (hdr.size == 0 || hdr.size > part->size) { fail("image too large"); return false; }
+
+    const bool same = s_state == OtaState::Receiving && s_part == part &&
+                      memcmp(&hdr, &s_hdr, sizeof(hdr)) == 0;
+    if (same) return true;   // link dropped mid-transfer; carry on from s_off
+
+    s_hdr  = hdr;
+    s_part = part;
+    sha_reset();
+    s_off = s_erasedTo = s_committed = 0;
+
+    ExpRemote::OtaHeader saved;
+    String savedPart;
+    uint32_t savedOff = 0;
+    if (session_load(saved, savedPart, savedOff) && memcmp(&saved, &hdr, sizeof(hdr)) == 0 &&
+        savedPart == part->label && savedOff <= hdr.size && savedOff % OTA_SECTOR == 0) {
+        if (rehash(savedOff)) {
+            s_off = s_erasedTo = s_committed = savedOff;
+            Serial.printf("[OTA] resuming at %lu/%lu\n", (unsigned long)s_off, (unsigned long)hdr.size);
+        } else {
+            sha_reset();
+        }
+    }
+    if (s_off == 0) session_save();
+    s_state = OtaState::Receiving;
+    return true;
+}
+
+static void ota_end(AsyncWebServerRequest* request) {
+    if (s_state != OtaState::Receiving || s_off != s_hdr.size) { send_status(request, 409); return; }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s_sha, digest);
+    mbedtls_sha256_free(&s_sha);
+    s_shaLive = false;
+
+    if (memcmp(digest, s_hdr.sha256, 32) != 0) {
+        fail("digest mismatch");
+        session_clear();
+        s_off = 0;
+    } else if (esp_ota_set_boot_partition(s_part) != ESP_OK) {
+        fail("image rejected");
+        session_clear();
+        s_off = 0;
+    } else {
+        s_state = OtaState::Done;
+        session_clear();
+        s_rebootAt = millis() + OTA_REBOOT_DELAY_MS;
+        Idle::wake();
+        Serial.println("[OTA] image verified, rebooting");
+    }
+    send_status(request, s_state == OtaState::Done ? 200 : 400);
+}
+
+// ---- config ----
+static void send_config(AsyncWebServerRequest* request, int code) {
+    char json[512];
+    if (!ExpConfig::toJson(json, sizeof(json))) { request->send(500, "text/plain", "config too large"); return; }
+    request->send(code, "application/json", json);
+}
+
+static void handle_cfg_udp() {
+    const int n = s_cfgUdp.parsePacket();
+    if (n <= 0) return;
+    char buf[256];
+    const int len = s_cfgUdp.read(buf, sizeof(buf) - 1);
+    if (len <= 0) return;
+    buf[len] = 0;
+    size_t end = strlen(buf);
+    while (end && (buf[end - 1] == '\n' || buf[end - 1] == '\r')) buf[--end] = 0;
+
+    if (strncmp(buf, "CFG:SET:", 8) == 0)   ExpConfig::apply(buf + 8);
+    else if (strcmp(buf, "CFG:RESET") == 0) ExpConfig::resetDefaults();
+    else if (strcmp(buf, "CFG:GET") != 0)   return;
+
+    // Answer when the bus is quiet (same courtesy as the status sender)
+    const uint32_t last = smbus_last_activity_ms();
+    if (last && (millis() - last) < SMBUS_QUIET_BEFORE_UDP_MS) delay(SMBUS_QUIET_BEFORE_UDP_MS);
+
+    char json[512];
+    if (!ExpConfig::toJson(json, sizeof(json))) return;
+    s_cfgUdp.beginPacket(s_cfgUdp.remoteIP(), s_cfgUdp.remotePort());
+    s_cfgUdp.print("CFG:");
+    s_cfgUdp.print(json);
+    s_cfgUdp.endPacket();
+}
+
+// ====== Public ======
+void ExpRemote::begin() {
+    memset(&s_hdr, 0, sizeof(s_hdr));
+    // Confirm the running image so the bootloader keeps it (no-op unless
+    // rollback is enabled in the core's bootloader)
+    esp_ota_mark_app_valid_cancel_rollback();
+}
+
+void ExpRemote::loop() {
+    if (s_rebootAt && (int32_t)(millis() - s_rebootAt) >= 0) ESP.restart();
+
+    if (WiFi.status() != WL_CONNECTED) return;
+    if (!s_cfgBound) {
+        if (!s_cfgUdp.begin(CFG_UDP_PORT)) return;
+        s_cfgBound = true;
+    }
+    handle_cfg_udp();
+}
+
+uint32_t ExpRemote::nextDueMs() {
+    return s_rebootAt ? s_rebootAt : millis() + 60000UL;
+}
+
+void ExpRemote::registerHttp(AsyncWebServer& server) {
+    server.on("/config", HTTP_GET, [](AsyncWebServerRequest* request) {
+        send_config(request, 200);
+    });
+
+    server.on("/config", HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (request->hasParam("reset", true) || request->hasParam("reset")) ExpConfig::resetDefaults();
+        for (size_t i = 0; i < request->params(); ++i) {
+            const AsyncWebParameter* p = request->getParam(i);
+            if (p->name() == "reset") continue;
+            if (!ExpConfig::set(p->name().c_str(), p->value().c_str())) {
+                request->send(400, "text/plain", "Rejected: " + p->name() + "=" + p->value());
+                return;
+            }
+        }
+        send_config(request, 200);
+    });
+
+    server.on("/ota/status", HTTP_GET, [](AsyncWebServerRequest* request) {
+        send_status(request, 200);
+    });
+
+    server.on("/ota/begin", HTTP_POST,
+        [](AsyncWebServerRequest* request) {
+            if (s_hdrLen != sizeof(OtaHeader)) { s_hdrLen = 0; request->send(400, "text/plain", "Header must be 104 bytes"); return; }
+            OtaHeader hdr;
+            memcpy(&hdr, s_hdrBuf, sizeof(hdr));
+            s_hdrLen = 0;
+            send_status(request, ota_begin(hdr) ? 200 : 403);
+        },
+        nullptr,
+        [](AsyncWebServerRequest*, uint8_t* data, size_t len, size_t index, size_t) {
+            if (index == 0) s_hdrLen = 0;
+            if (index != s_hdrLen || s_hdrLen + len > sizeof(s_hdrBuf)) { s_hdrLen = SIZE_MAX; return; }
+            memcpy(s_hdrBuf + s_hdrLen, data, len);
+            s_hdrLen += len;
+        });
+
+    server.on("/ota/chunk", HTTP_POST,
+        [](AsyncWebServerRequest* request) {
+            send_status(request, s_chunkOk ? 200 : 409);
+        },
+        nullptr,
+        [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            if (index == 0) {
+                const uint32_t off = request->hasParam("off") ? strtoul(request->getParam("off")->value().c_str(), nullptr, 10) : 0;
+                s_chunkOk = s_state == OtaState::Receiving && off == s_off && s_off + total <= s_hdr.size;
+            }
+            if (s_chunkOk) s_chunkOk = write_image(data, len);
+        });
+
+    server.on("/ota/end", HTTP_POST, [](AsyncWebServerRequest* request) {
+        ota_end(request);
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <Arduino.h>
+
+class AsyncWebServer;
+
+// Remote configuration (ExpConfig over HTTP and UDP CFG_UDP_PORT) and a
+// signed, chunked, resumable OTA receiver. The display relays both; the
+// host tool script/exp_ota.py speaks the same endpoints directly.
+namespace ExpRemote {
+    // OTA bundle header (104 bytes, little-endian), followed by the image
+    struct OtaHeader {
+        char     magic[4];     // "TDO1"
+        uint32_t size;         // image bytes
+        uint8_t  sha256[32];   // digest of the image
+        uint8_t  sig[64];      // ECDSA P-256 (r || s) over sha256
+    };
+
+    void begin();
+    void loop();              // UDP config requests, deferred reboot
+    uint32_t nextDueMs();     // pending reboot, if any
+
+    // GET/POST /config and /ota/{begin,chunk,status,end}
+    void registerHttp(AsyncWebServer& server);
+}
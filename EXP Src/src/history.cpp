@@ -0,0 +1,487 @@
+// history.cpp
+//
+// Fixed-memory, two-resolution history of the published telemetry so any
+// client (display after a reboot, phone app, PC viewer) can backfill graphs.
+// - Raw ring: one sample per HISTORY_RAW_PERIOD_MS (1 s), one hour kept.
+// - Minute ring: min/max/avg per signal, one day kept.
+// - Flash: LittleFS, fixed-size ring files; only records written since the
+//   last flush are rewritten, every HISTORY_FLUSH_MS (15 min), so a day costs
+//   ~96 small writes. A reboot restores both rings and inserts one gap record.
+// - Chunks: 20-byte header + per-column zigzag-delta varints with zero-run
+//   encoding; a steady console compresses an hour to a few dozen bytes.
+// - Rings are shared with the async HTTP task, so writers and the encoder
+//   take a FreeRTOS mutex; sampling reads Cache_Manager::snapshot().
+//
+// Chunk layout (little-endian):
+//   0  "TDH1"
+//   4  u8  res (0 raw, 1 minute)
+//   5  u8  columns per record (3 raw: fan,cpu,amb / 9 minute: min[3],max[3],avg[3])
+//   6  u16 record count
+//   8  u32 seq of the first record
+//   12 u32 head seq (next seq the device will write; newest = head-1)
+//   16 u32 record period in ms
+//   20 columns, each `count` values: varint(zigzag(v - prev)) with prev
+//      starting at 0; a 0 delta is followed by varint(extra zeros in the run).
+//   Values are int8; -128 = no data.
+//
+// UDP: send "HIST:RAW:<fromSeq>" or "HIST:MIN:<fromSeq>" to HISTORY_UDP_PORT;
+// one chunk comes back to the sender. Ask again from first+count to continue.
+
+#include "history.h"
+#include "cache_manager.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPAsyncWebServer.h>
+#include <LittleFS.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <math.h>
+
+// ---- exported by xbox_smbus_poll.cpp ----
+extern uint32_t smbus_last_activity_ms();
+
+// ====== Config ======
+#ifndef HISTORY_RAW_PERIOD_MS
+#define HISTORY_RAW_PERIOD_MS   1000
+#endif
+#ifndef HISTORY_RAW_SLOTS
+#define HISTORY_RAW_SLOTS       3600          // 1 h at 1 s
+#endif
+#ifndef HISTORY_MIN_SLOTS
+#define HISTORY_MIN_SLOTS       1440          // 24 h at 1 min
+#endif
+#ifndef HISTORY_FLUSH_MS
+#define HISTORY_FLUSH_MS        (15UL * 60UL * 1000UL)
+#endif
+#ifndef HISTORY_UDP_PORT
+#define HISTORY_UDP_PORT        50507
+#endif
+#ifndef HISTORY_UDP_CHUNK
+#define HISTORY_UDP_CHUNK       1200          // stay well under one MTU
+#endif
+#ifndef HISTORY_HTTP_CHUNK
+#define HISTORY_HTTP_CHUNK      16384
+#endif
+#ifndef SMBUS_QUIET_BEFORE_UDP_MS
+#define SMBUS_QUIET_BEFORE_UDP_MS  6
+#endif
+#define HISTORY_DEBUG           0
+
+#define HISTORY_MIN_PERIOD_MS   60000UL
+#define HISTORY_HDR_BYTES       20
+#define HISTORY_DIR             "/hist"
+#define HISTORY_META_MAGIC      0x31484454u   // "TDH1"
+
+static const int8_t NA = INT8_MIN;
+static const uint8_t RAW_W = History::ColumnCount;
+static const uint8_t MIN_W = History::ColumnCount * 3;
+
+// ====== Rings ======
+struct Ring {
+    uint8_t*    data;
+    uint8_t     width;      // bytes (= columns) per record
+    uint32_t    slots;
+    uint32_t    periodMs;
+    uint32_t    head;       // seq of the next record; kept = [head - count, head)
+    uint32_t    count;
+    uint32_t    flushedTo;  // records below this seq are on flash
+    const char* path;
+};
+
+static uint8_t s_rawBuf[HISTORY_RAW_SLOTS * RAW_W];
+static uint8_t s_minBuf[HISTORY_MIN_SLOTS * MIN_W];
+
+static Ring s_rings[2] = {
+    { s_rawBuf, RAW_W, HISTORY_RAW_SLOTS, HISTORY_RAW_PERIOD_MS, 0, 0, 0, HISTORY_DIR "/raw.bin" },
+    { s_minBuf, MIN_W, HISTORY_MIN_SLOTS, HISTORY_MIN_PERIOD_MS, 0, 0, 0, HISTORY_DIR "/min.bin" },
+};
+
+struct Meta {
+    uint32_t magic;
+    uint32_t rawSlots, minSlots;
+    uint32_t rawHead, rawCount;
+    uint32_t minHead, minCount;
+    uint32_t check;
+};
+
+static SemaphoreHandle_t s_lock = nullptr;
+static bool          s_fsOk = false;
+static unsigned long s_nextSampleMs = 0;
+static unsigned long s_nextFlushMs = 0;
+
+// Current minute accumulator
+static int16_t  s_accMin[RAW_W], s_accMax[RAW_W];
+static int32_t  s_accSum[RAW_W];
+static uint16_t s_accN[RAW_W];
+static uint16_t s_accSamples = 0;
+
+// UDP requests
+static WiFiUDP   s_udp;
+static bool      s_udpBound = false;
+static uint8_t   s_udpChunk[HISTORY_UDP_CHUNK];
+static bool      s_reqPending = false;
+static IPAddress s_reqIp;
+static uint16_t  s_reqPort = 0;
+static History::Res s_reqRes = History::Res::Raw;
+static uint32_t  s_reqFrom = 0;
+
+static inline bool lock()   { return s_lock && xSemaphoreTake(s_lock, pdMS_TO_TICKS(50)) == pdTRUE; }
+static inline void unlock() { xSemaphoreGive(s_lock); }
+
+static inline Ring& ring(History::Res r) { return s_rings[(int)r]; }
+
+// Caller holds the lock.
+static void ring_push(Ring& r, const int8_t* rec) {
+    memcpy(r.data + (size_t)(r.head % r.slots) * r.width, rec, r.width);
+    r.head++;
+    if (r.count < r.slots) r.count++;
+}
+
+// ====== Sampling / aggregation ======
+static void acc_reset() {
+    for (int i = 0; i < RAW_W; ++i) {
+        s_accMin[i] = INT16_MAX;
+        s_accMax[i] = INT16_MIN;
+        s_accSum[i] = 0;
+        s_accN[i]   = 0;
+    }
+    s_accSamples = 0;
+}
+
+static int8_t to_i8(bool valid, int v) {
+    if (!valid || v < -127 || v > 127) return NA;
+    return (int8_t)v;
+}
+
+static void take_sample() {
+    using F = Cache_Manager::Field;
+    Cache_Manager::Snapshot snap;
+    int8_t rec[RAW_W] = { NA, NA, NA };
+    if (Cache_Manager::snapshot(snap)) {
+        rec[History::Fan]         = to_i8(snap.valid(F::Fan),         snap.status.fanSpeed);
+        rec[History::CpuTemp]     = to_i8(snap.valid(F::CpuTemp),     snap.status.cpuTemp);
+        rec[History::AmbientTemp] = to_i8(snap.valid(F::AmbientTemp), snap.status.ambientTemp);
+    }
+
+    for (int i = 0; i < RAW_W; ++i) {
+        if (rec[i] == NA) continue;
+        if (rec[i] < s_accMin[i]) s_accMin[i] = rec[i];
+        if (rec[i] > s_accMax[i]) s_accMax[i] = rec[i];
+        s_accSum[i] += rec[i];
+        s_accN[i]++;
+    }
+    s_accSamples++;
+
+    int8_t agg[MIN_W];
+    const bool closeMinute = s_accSamples >= (HISTORY_MIN_PERIOD_MS / HISTORY_RAW_PERIOD_MS);
+    if (closeMinute) {
+        for (int i = 0; i < RAW_W; ++i) {
+            const bool any = s_accN[i] > 0;
+            agg[i]             = any ? (int8_t)s_accMin[i] : NA;
+            agg[RAW_W + i]     = any ? (int8_t)s_accMax[i] : NA;
+            agg[2 * RAW_W + i] = any ? (int8_t)lroundf((float)s_accSum[i] / s_accN[i]) : NA;
+        }
+    }
+
+    if (!lock()) return;   // HTTP encoder stuck; drop this sample
+    ring_push(ring(History::Res::Raw), rec);
+    if (closeMinute) ring_push(ring(History::Res::Minute), agg);
+    unlock();
+    if (closeMinute) acc_reset();
+}
+
+// ====== Flash ======
+static uint32_t meta_check(const Meta& m) {
+    const uint32_t* w = (const uint32_t*)&m;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(Meta, check) / 4; ++i) h = (h ^ w[i]) * 16777619u;
+    return h;
+}
+
+static bool write_full(const Ring& r) {
+    File f = LittleFS.open(r.path, "w");
+    if (!f) return false;
+    const size_t n = f.write(r.data, (size_t)r.slots * r.width);
+    f.close();
+    return n == (size_t)r.slots * r.width;
+}
+
+// Rewrite only the slots for records in [flushedTo, head).
+static bool write_dirty(Ring& r) {
+    if (r.flushedTo >= r.head) return true;
+    uint32_t from = r.flushedTo;
+    if (r.head - from > r.slots) from = r.head - r.slots;
+
+    File f = LittleFS.open(r.path, "r+");
+    if (!f || f.size() != (size_t)r.slots * r.width) {
+        if (f) f.close();
+        return write_full(r);
+    }
+    bool ok = true;
+    while (from < r.head && ok) {
+        const uint32_t idx = from % r.slots;
+        uint32_t n = r.head - from;
+        if (idx + n > r.slots) n = r.slots - idx;   // split at the wrap
+        ok = f.seek((size_t)idx * r.width) &&
+             f.write(r.data + (size_t)idx * r.width, (size_t)n * r.width) == (size_t)n * r.width;
+        from += n;
+    }
+    f.close();
+    return ok;
+}
+
+static void flush_locked() {
+    Ring& rr = ring(History::Res::Raw);
+    Ring& mr = ring(History::Res::Minute);
+    if (!s_fsOk || (rr.flushedTo == rr.head && mr.flushedTo == mr.head)) return;
+
+    const bool ok = write_dirty(rr) && write_dirty(mr);
+    if (!ok) {
+        Serial.println("[History] Flush failed.");
+        return;
+    }
+
+    // Meta last, via rename, so a power cut leaves the previous meta intact
+    Meta m = { HISTORY_META_MAGIC, rr.slots, mr.slots, rr.head, rr.count, mr.head, mr.count, 0 };
+    m.check = meta_check(m);
+    File f = LittleFS.open(HISTORY_DIR "/meta.tmp", "w");
+    if (!f) return;
+    const bool wrote = f.write((const uint8_t*)&m, sizeof(m)) == sizeof(m);
+    f.close();
+    if (!wrote || !LittleFS.rename(HISTORY_DIR "/meta.tmp", HISTORY_DIR "/meta.bin")) return;
+
+    rr.flushedTo = rr.head;
+    mr.flushedTo = mr.head;
+#if HISTORY_DEBUG
+    Serial.printf("[History] Flushed raw=%u min=%u\n", (unsigned)rr.head, (unsigned)mr.head);
+#endif
+}
+
+static bool read_ring(Ring& r, uint32_t head, uint32_t count) {
+    File f = LittleFS.open(r.path, "r");
+    if (!f) return false;
+    const size_t want = (size_t)r.slots * r.width;
+    const bool ok = f.size() == want && f.read(r.data, want) == want;
+    f.close();
+    if (!ok) return false;
+    r.head = r.flushedTo = head;
+    r.count = count > r.slots ? r.slots : count;
+    return true;
+}
+
+static void restore() {
+    File f = LittleFS.open(HISTORY_DIR "/meta.bin", "r");
+    if (!f) return;
+    Meta m;
+    const bool ok = f.read((uint8_t*)&m, sizeof(m)) == sizeof(m);
+    f.close();
+    Ring& rr = ring(History::Res::Raw);
+    Ring& mr = ring(History::Res::Minute);
+    if (!ok || m.magic != HISTORY_META_MAGIC || m.check != meta_check(m) ||
+        m.rawSlots != rr.slots || m.minSlots != mr.slots) {
+        Serial.println("[History] No usable history on flash.");
+        return;
+    }
+    if (!read_ring(rr, m.rawHead, m.rawCount) || !read_ring(mr, m.minHead, m.minCount)) {
+        rr.head = rr.count = rr.flushedTo = 0;
+        mr.head = mr.count = mr.flushedTo = 0;
+        return;
+    }
+    // Mark the reboot so clients don't draw a line across the downtime
+    if (rr.count) {
+        const int8_t gap[RAW_W] = { NA, NA, NA };
+        ring_push(rr, gap);
+    }
+    Serial.printf("[History] Restored %u raw / %u minute records.\n",
+                  (unsigned)rr.count, (unsigned)mr.count);
+}
+
+// ====== Encoding ======
+static inline size_t put_varint(uint8_t* p, size_t pos, size_t cap, uint32_t v) {
+    do {
+        if (pos >= cap) return SIZE_MAX;
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        p[pos++] = v ? (b | 0x80) : b;
+    } while (v);
+    return pos;
+}
+
+static inline void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+// Returns total size, or 0 if `count` records don't fit. Caller holds the lock.
+static size_t encode_records(const Ring& r, uint8_t res, uint32_t first, uint32_t count,
+                             uint8_t* buf, size_t cap) {
+    if (cap < HISTORY_HDR_BYTES) return 0;
+    memcpy(buf, "TDH1", 4);
+    buf[4] = res;
+    buf[5] = r.width;
+    buf[6] = count & 0xFF;
+    buf[7] = count >> 8;
+    put_u32(buf + 8,  first);
+    put_u32(buf + 12, r.head);
+    put_u32(buf + 16, r.periodMs);
+
+    size_t pos = HISTORY_HDR_BYTES;
+    for (uint8_t col = 0; col < r.width; ++col) {
+        int prev = 0;
+        uint32_t i = 0;
+        while (i < count) {
+            const int v = (int8_t)r.data[(size_t)((first + i) % r.slots) * r.width + col];
+            const int d = v - prev;
+            if (d == 0) {
+                uint32_t run = 1;
+                while (i + run < count &&
+                       (int8_t)r.data[(size_t)((first + i + run) % r.slots) * r.width + col] == v) run++;
+                pos = put_varint(buf, pos, cap, 0);
+                if (pos == SIZE_MAX) return 0;
+                pos = put_varint(buf, pos, cap, run - 1);
+                if (pos == SIZE_MAX) return 0;
+                i += run;
+            } else {
+                pos = put_varint(buf, pos, cap, (uint32_t)((d << 1) ^ (d >> 31)));
+                if (pos == SIZE_MAX) return 0;
+                prev = v;
+                i++;
+            }
+        }
+    }
+    return pos;
+}
+
+size_t History::encodeChunk(Res res, uint32_t fromSeq, uint8_t* buf, size_t cap, uint32_t* nextSeq) {
+    if (res != Res::Raw && res != Res::Minute) return 0;
+    if (!lock()) return 0;
+    const Ring& r = ring(res);
+    const uint32_t oldest = r.head - r.count;
+    if (fromSeq < oldest) fromSeq = oldest;
+    if (fromSeq > r.head) fromSeq = r.head;
+
+    uint32_t n = r.head - fromSeq;
+    if (n > 0xFFFF) n = 0xFFFF;
+    size_t len = 0;
+    for (;;) {   // shrink until it fits; encoding an hour takes well under 1 ms
+        len = encode_records(r, (uint8_t)res, fromSeq, n, buf, cap);
+        if (len || n == 0) break;
+        n /= 2;
+    }
+    unlock();
+    if (nextSeq) *nextSeq = fromSeq + n;
+    return len;
+}
+
+// ====== Public ======
+void History::begin() {
+    if (!s_lock) s_lock = xSemaphoreCreateMutex();
+    acc_reset();
+
+    // The expansion does not otherwise use the data partition
+    s_fsOk = LittleFS.begin(true);
+    if (s_fsOk) {
+        LittleFS.mkdir(HISTORY_DIR);
+        restore();
+    } else {
+        Serial.println("[History] LittleFS unavailable; history is RAM-only.");
+    }
+
+    const unsigned long now = millis();
+    s_nextSampleMs = now + HISTORY_RAW_PERIOD_MS;
+    s_nextFlushMs  = now + HISTORY_FLUSH_MS;
+}
+
+void History::flushNow() {
+    if (!lock()) return;
+    flush_locked();
+    unlock();
+}
+
+static bool parse_request(const char* s, History::Res& res, uint32_t& from) {
+    if (strncmp(s, "HIST:", 5) != 0) return false;
+    s += 5;
+    if      (strncmp(s, "RAW:", 4) == 0) res = History::Res::Raw;
+    else if (strncmp(s, "MIN:", 4) == 0) res = History::Res::Minute;
+    else return false;
+    from = strtoul(s + 4, nullptr, 10);
+    return true;
+}
+
+static void poll_udp() {
+    if (!s_udpBound) {
+        if (!s_udp.begin(HISTORY_UDP_PORT)) return;
+        s_udpBound = true;
+    }
+
+    if (!s_reqPending && s_udp.parsePacket() > 0) {
+        char req[48];
+        const int n = s_udp.read(req, sizeof(req) - 1);
+        if (n > 0) {
+            req[n] = 0;
+            if (parse_request(req, s_reqRes, s_reqFrom)) {
+                s_reqIp      = s_udp.remoteIP();
+                s_reqPort    = s_udp.remotePort();
+                s_reqPending = true;
+            }
+        }
+    }
+
+    // Answer once the SMBus is quiet, like the other senders
+    if (s_reqPending) {
+        const uint32_t last = smbus_last_activity_ms();
+        if (last && (millis() - last) < SMBUS_QUIET_BEFORE_UDP_MS) return;
+        s_reqPending = false;
+        uint32_t next = 0;
+        const size_t len = History::encodeChunk(s_reqRes, s_reqFrom, s_udpChunk, sizeof(s_udpChunk), &next);
+        if (!len) return;
+        s_udp.beginPacket(s_reqIp, s_reqPort);
+        s_udp.write(s_udpChunk, len);
+        s_udp.endPacket();
+#if HISTORY_DEBUG
+        Serial.printf("[History] UDP chunk %u bytes, next=%u\n", (unsigned)len, (unsigned)next);
+#endif
+    }
+}
+
+void History::loop() {
+    const unsigned long now = millis();
+
+    if ((long)(now - s_nextSampleMs) >= 0) {
+        take_sample();
+        s_nextSampleMs += HISTORY_RAW_PERIOD_MS;
+        // Don't burst-fill after a long stall; the gap just shows as missing time
+        if ((long)(now - s_nextSampleMs) >= (long)HISTORY_RAW_PERIOD_MS) s_nextSampleMs = now + HISTORY_RAW_PERIOD_MS;
+    }
+
+    if ((long)(now - s_nextFlushMs) >= 0) {
+        s_nextFlushMs = now + HISTORY_FLUSH_MS;
+        flushNow();
+    }
+
+    if (WiFi.status() == WL_CONNECTED) poll_udp();
+}
+
+uint32_t History::nextDueMs() {
+    return (long)(s_nextFlushMs - s_nextSampleMs) < 0 ? s_nextFlushMs : s_nextSampleMs;
+}
+
+void History::registerHttp(AsyncWebServer& server) {
+    server.on("/history", HTTP_GET, [](AsyncWebServerRequest* request) {
+        Res res = Res::Raw;
+        if (request->hasParam("res") && request->getParam("res")->value() == "min") res = Res::Minute;
+        uint32_t from = 0;
+        if (request->hasParam("from")) from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+
+        uint8_t* buf = (uint8_t*)malloc(HISTORY_HTTP_CHUNK);
+        if (!buf) { request->send(503, "text/plain", "Out of memory"); return; }
+        uint32_t next = 0;
+        const size_t len = encodeChunk(res, from, buf, HISTORY_HTTP_CHUNK, &next);
+        if (!len) { free(buf); request->send(503, "text/plain", "History busy"); return; }
+
+        AsyncResponseStream* resp = request->beginResponseStream("application/octet-stream");
+        resp->addHeader("X-Next-Seq", String(next));
+        resp->write(buf, len);
+        free(buf);
+        request->send(resp);
+    });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+class AsyncWebServer;
+
+// On-device telemetry history: fixed-size rings of raw samples (last hour) and
+// 1-minute aggregates (last day), persisted to LittleFS in batches and served
+// as compressed chunks over UDP (HISTORY_UDP_PORT) and HTTP (GET /history).
+namespace History {
+    enum class Res : uint8_t { Raw = 0, Minute = 1 };
+
+    // Signals recorded per sample, in record order
+    enum Column : uint8_t { Fan = 0, CpuTemp, AmbientTemp, ColumnCount };
+
+    void begin();   // mount + restore from flash
+    void loop();    // sample, aggregate, batch-flush, answer UDP requests
+    // millis() of the next sample or flush (UDP requests are polled by loop())
+    uint32_t nextDueMs();
+
+    // Encode records with seq >= fromSeq (clamped to what is kept) into one
+    // self-contained chunk of at most `cap` bytes. Returns the chunk size,
+    // or 0 if even the header does not fit. *nextSeq = seq to ask for next.
+    size_t encodeChunk(Res res, uint32_t fromSeq, uint8_t* buf, size_t cap, uint32_t* nextSeq);
+
+    // Write pending records to flash now (normally batched)
+    void flushNow();
+
+    // Adds GET /history?res=raw|min&from=<seq> to the WiFiMgr server
+    void registerHttp(AsyncWebServer& server);
+}
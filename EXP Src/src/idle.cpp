@@ -0,0 +1,127 @@
+// idle.cpp
+//
+// Sleep/wake for the main loop.
+// - sleepUntil() blocks the loop task on its FreeRTOS notification with the
+//   time left to the earliest module deadline as the timeout. wake() gives
+//   the notification so work queued from another task (WiFi events, web
+//   handlers) runs without waiting for the deadline.
+// - With the loop task blocked, the IDLE task owns the CPU: esp_pm lowers
+//   the clock between ticks and, on a core built with tickless idle, enters
+//   automatic light sleep (WiFi stays associated in modem sleep). Peripherals
+//   in use (I2C transfers, RMT, WiFi) hold their own PM locks.
+// - Every wake is timed: how late a deadline wake actually runs, and how
+//   long a wake() takes to get the loop running again.
+
+#include "idle.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#include "esp_pm.h"
+#define IDLE_HAVE_PM CONFIG_PM_ENABLE
+#else
+#define IDLE_HAVE_PM 0
+#endif
+
+// Power management while idle: 0 = off, 1 = DFS (+ light sleep if available)
+#ifndef IDLE_PM_ENABLE
+#define IDLE_PM_ENABLE 1
+#endif
+// Try automatic light sleep (needs CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+#ifndef IDLE_LIGHT_SLEEP
+#define IDLE_LIGHT_SLEEP 1
+#endif
+#ifndef IDLE_PM_MAX_MHZ
+#define IDLE_PM_MAX_MHZ 240
+#endif
+#ifndef IDLE_PM_MIN_MHZ
+#define IDLE_PM_MIN_MHZ 80      // keeps APB at 80 MHz for I2C/UART timing
+#endif
+
+// ====== State ======
+static TaskHandle_t      s_task = nullptr;
+static volatile uint32_t s_wakeStampUs = 0;
+static const char*       s_pmMode = "off";
+
+static uint32_t s_passes = 0, s_timerWakes = 0, s_notifyWakes = 0;
+static uint64_t s_sleptUs = 0, s_lateSumUs = 0, s_notifySumUs = 0;
+static uint32_t s_lateMaxUs = 0, s_notifyMaxUs = 0;
+static uint32_t s_statsFromMs = 0;
+
+static void pm_setup() {
+#if IDLE_PM_ENABLE && IDLE_HAVE_PM
+    esp_pm_config_t cfg = {};
+    cfg.max_freq_mhz = IDLE_PM_MAX_MHZ;
+    cfg.min_freq_mhz = IDLE_PM_MIN_MHZ;
+#if IDLE_LIGHT_SLEEP && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE) && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    cfg.light_sleep_enable = true;
+    if (esp_pm_configure(&cfg) == ESP_OK) { s_pmMode = "light-sleep"; return; }
+    cfg.light_sleep_enable = false;
+#endif
+    if (esp_pm_configure(&cfg) == ESP_OK) s_pmMode = "dfs";
+#endif
+}
+
+// ====== Public ======
+void Idle::begin() {
+    s_task = xTaskGetCurrentTaskHandle();
+    s_statsFromMs = millis();
+    pm_setup();
+    Serial.printf("[Idle] power management: %s\n", s_pmMode);
+}
+
+void Idle::wake() {
+    if (!s_task) return;
+    if (xTaskGetCurrentTaskHandle() == s_task) return;  // loop re-reads deadlines anyway
+    s_wakeStampUs = micros();
+    xTaskNotifyGive(s_task);
+}
+
+void Idle::sleepUntil(uint32_t dueMs) {
+    s_passes++;
+    const int32_t left = (int32_t)(dueMs - millis());
+    if (left <= 0) { taskYIELD(); return; }
+
+    TickType_t ticks = pdMS_TO_TICKS((uint32_t)left);
+    if (ticks == 0) ticks = 1;
+    const uint32_t t0 = micros();
+    const uint32_t got = ulTaskNotifyTake(pdTRUE, ticks);
+    const uint32_t t1 = micros();
+    s_sleptUs += t1 - t0;
+
+    if (got) {
+        const uint32_t us = t1 - s_wakeStampUs;
+        s_notifyWakes++;
+        s_notifySumUs += us;
+        if (us > s_notifyMaxUs) s_notifyMaxUs = us;
+    } else {
+        // Tick-aligned timeouts can land up to a tick early; count that as 0
+        const uint32_t want = (uint32_t)ticks * portTICK_PERIOD_MS * 1000u;
+        const uint32_t us = (t1 - t0) > want ? (t1 - t0) - want : 0;
+        s_timerWakes++;
+        s_lateSumUs += us;
+        if (us > s_lateMaxUs) s_lateMaxUs = us;
+    }
+}
+
+Idle::Stats Idle::takeStats() {
+    Stats s;
+    const uint32_t now = millis();
+    s.passes      = s_passes;
+    s.timerWakes  = s_timerWakes;
+    s.notifyWakes = s_notifyWakes;
+    s.sleptMs     = (uint32_t)(s_sleptUs / 1000);
+    s.spanMs      = now - s_statsFromMs;
+    s.lateAvgUs   = s_timerWakes ? (uint32_t)(s_lateSumUs / s_timerWakes) : 0;
+    s.lateMaxUs   = s_lateMaxUs;
+    s.notifyAvgUs = s_notifyWakes ? (uint32_t)(s_notifySumUs / s_notifyWakes) : 0;
+    s.notifyMaxUs = s_notifyMaxUs;
+
+    s_passes = s_timerWakes = s_notifyWakes = 0;
+    s_sleptUs = s_lateSumUs = s_notifySumUs = 0;
+    s_lateMaxUs = s_notifyMaxUs = 0;
+    s_statsFromMs = now;
+    return s;
+}
+
+const char* Idle::pmMode() { return s_pmMode; }
@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+// Idle-aware main loop support. Modules publish the millis() at which their
+// loop() next has work (nextDueMs()); the main loop sleeps until the earliest
+// one, or until another task calls wake(). While the loop task is blocked the
+// power manager can drop the CPU clock and, if the core was built with
+// tickless idle, enter automatic light sleep.
+namespace Idle {
+    struct Stats {
+        uint32_t passes;        // loop passes (each ends in one sleepUntil())
+        uint32_t timerWakes;    // woke because the deadline came
+        uint32_t notifyWakes;   // woken early by wake()
+        uint32_t sleptMs;       // time spent blocked
+        uint32_t spanMs;        // wall time covered by these stats
+        uint32_t lateAvgUs;     // deadline -> running, timer wakes
+        uint32_t lateMaxUs;
+        uint32_t notifyAvgUs;   // wake() -> running, notified wakes
+        uint32_t notifyMaxUs;
+    };
+
+    void begin();                    // call from the loop task (setup())
+    void wake();                     // any task; not from an ISR
+    void sleepUntil(uint32_t dueMs); // block until dueMs (millis) or wake()
+    Stats takeStats();               // since the previous call
+    const char* pmMode();            // "light-sleep", "dfs" or "off"
+
+    // Earlier of two millis() deadlines (wrap-safe)
+    inline uint32_t earliest(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0 ? a : b; }
+}
@@ -1,64 +1,238 @@
+// led_stat.cpp
+//
+// Status LED effect engine.
+// - Effects are keyframe tables (time -> colour), stepped or interpolated,
+//   looping or one-shot. The heat-map uses the same table shape keyed by
+//   CPU temperature instead of time.
+// - loop() evaluates the current effect and only writes the LED when the
+//   colour actually changes; a solid colour costs one write per status change.
+// - On core 3.x the WS2812 frame goes out through the RMT peripheral
+//   asynchronously (24 symbols fit in one RMT memory block, so no CPU work or
+//   interrupt masking during the transfer). Older cores fall back to
+//   neopixelWrite().
+
 #include "led_stat.h"
 #include <Arduino.h>
+#include "cache_manager.h"
 
 // --- Pin config ---
 #define RGB_PIN 21
 #define RGB_BRIGHTNESS 50 // Reasonable for status; can tweak
 
-// --- Internal state ---
-static LedStatus currentStatus = LedStatus::Booting;
-static unsigned long lastBlink = 0;
-static bool ledOn = true;
+// Some clone boards take R and G swapped
+#ifndef LED_SWAP_RG
+#define LED_SWAP_RG 0
+#endif
+
+// Connected effect: 0 = solid green, 1 = breathing green, 2 = CPU heat-map
+#ifndef LED_CONNECTED_EFFECT
+#define LED_CONNECTED_EFFECT 0
+#endif
+
+// How long the send overlay runs
+#ifndef LED_SEND_OVERLAY_MS
+#define LED_SEND_OVERLAY_MS 2000
+#endif
 
+// Frame interval while an interpolated effect is running
+#ifndef LED_LERP_FRAME_MS
+#define LED_LERP_FRAME_MS 20
+#endif
+
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define LED_USE_RMT 1
+#else
+#define LED_USE_RMT 0
 extern "C" void neopixelWrite(uint8_t pin, uint8_t r, uint8_t g, uint8_t b);
+#endif
+
+// ====== Keyframe tables ======
+struct Key { uint16_t t; uint8_t r, g, b; };
+
+enum : uint8_t { FX_LOOP = 0x01, FX_LERP = 0x02 };
+
+struct Effect {
+    const Key* keys;
+    uint8_t    count;
+    uint16_t   period;  // loop length (ms); ignored for one keyframe
+    uint8_t    flags;
+};
+
+#define B RGB_BRIGHTNESS
+static const Key K_WHITE[]   = { {0, B, B, B} };
+static const Key K_GREEN[]   = { {0, 0, B, 0} };
+static const Key K_RED[]     = { {0, B, 0, 0} };
+static const Key K_PORTAL[]  = { {0, 16, 0, 16}, {400, 0, 0, 0} };           // blink purple
+static const Key K_SEND[]    = { {0, B, 32, 0}, {150, 0, 0, 0} };            // blink orange
+static const Key K_BREATHE[] = { {0, 0, 4, 0}, {1500, 0, B, 0}, {3000, 0, 4, 0} };
+// Heat-map: t = CPU °C
+static const Key K_HEAT[]    = { {35, 0, 0, B}, {50, 0, B, 0}, {60, B, B / 2, 0}, {70, B, 0, 0} };
+#undef B
+
+#define FX(tab, period, flags) { tab, (uint8_t)(sizeof(tab) / sizeof(tab[0])), period, flags }
+static const Effect E_WHITE   = FX(K_WHITE,   0,    0);
+static const Effect E_GREEN   = FX(K_GREEN,   0,    0);
+static const Effect E_RED     = FX(K_RED,     0,    0);
+static const Effect E_PORTAL  = FX(K_PORTAL,  800,  FX_LOOP);
+static const Effect E_SEND    = FX(K_SEND,    300,  FX_LOOP);
+static const Effect E_BREATHE = FX(K_BREATHE, 3000, FX_LOOP | FX_LERP);
+static const Effect E_HEAT    = FX(K_HEAT,    0,    FX_LERP);
+#undef FX
+
+// ====== State ======
+static LedStatus     currentStatus = LedStatus::Booting;
+static const Effect* s_base = &E_WHITE;
+static unsigned long s_baseStart = 0;
+static unsigned long s_overlayStart = 0;
+static bool          s_overlay = false;
+static uint32_t      s_shown = 0xFFFFFFFF;   // last colour written (0x00RRGGBB)
+static bool          s_retry = false;        // last write was refused (RMT busy)
+
+// Colour at position t (clamped to the table ends)
+static uint32_t sample(const Effect& e, uint32_t t) {
+    const Key* k = e.keys;
+    if (e.count == 1 || t <= k[0].t) return ((uint32_t)k[0].r << 16) | (k[0].g << 8) | k[0].b;
+    for (uint8_t i = 1; i < e.count; ++i) {
+        if (t >= k[i].t) continue;
+        const Key& a = k[i - 1];
+        if (!(e.flags & FX_LERP)) return ((uint32_t)a.r << 16) | (a.g << 8) | a.b;
+        const Key& c = k[i];
+        const uint32_t span = c.t - a.t, off = t - a.t;
+        auto mix = [&](uint8_t x, uint8_t y) { return (uint32_t)(x + ((int)y - x) * (int)off / (int)span) & 0xFF; };
+        return (mix(a.r, c.r) << 16) | (mix(a.g, c.g) << 8) | mix(a.b, c.b);
+    }
+    const Key& z = k[e.count - 1];
+    return ((uint32_t)z.r << 16) | (z.g << 8) | z.b;
+}
+
+static uint32_t effect_time(const Effect& e, unsigned long elapsed) {
+    return (e.flags & FX_LOOP) && e.period ? (uint32_t)(elapsed % e.period) : (uint32_t)elapsed;
+}
+
+// ms until the colour at position t can next change (0xFFFFFFFF = never)
+static uint32_t until_next_key(const Effect& e, uint32_t t) {
+    if (e.count == 1) return 0xFFFFFFFF;
+    if (e.flags & FX_LERP) return LED_LERP_FRAME_MS;
+    for (uint8_t i = 0; i < e.count; ++i)
+        if (e.keys[i].t > t) return e.keys[i].t - t;
+    return (e.flags & FX_LOOP) && e.period > t ? e.period - t : 0xFFFFFFFF;
+}
 
-// Set color using onboard RGB
-static void setLedColor(uint8_t r, uint8_t g, uint8_t b) {
-    neopixelWrite(RGB_PIN, r, g, b); // for some clone boards g, r, b may need to be swapped to r, g ,b
+// ====== Output ======
+#if LED_USE_RMT
+static rmt_data_t s_frame[24];
+static bool       s_rmtOk = false;
+
+static bool led_write(uint32_t rgb) {
+    if (!s_rmtOk) return false;
+    if (!rmtTransmitCompleted(RGB_PIN)) return false;   // previous frame still going; retry next loop
+    uint8_t r = rgb >> 16, g = rgb >> 8, b = rgb;
+#if LED_SWAP_RG
+    const uint8_t t = r; r = g; g = t;
+#endif
+    const uint32_t grb = ((uint32_t)g << 16) | ((uint32_t)r << 8) | b;
+    // WS2812 at a 10 MHz tick: 0 = 0.4 us high / 0.8 us low, 1 = 0.8 / 0.4
+    for (int i = 0; i < 24; ++i) {
+        const bool one = grb & (1u << (23 - i));
+        s_frame[i].level0 = 1; s_frame[i].duration0 = one ? 8 : 4;
+        s_frame[i].level1 = 0; s_frame[i].duration1 = one ? 4 : 8;
+    }
+    return rmtWriteAsync(RGB_PIN, s_frame, 24);
+}
+#else
+static bool led_write(uint32_t rgb) {
+    uint8_t r = rgb >> 16, g = rgb >> 8, b = rgb;
+#if LED_SWAP_RG
+    const uint8_t t = r; r = g; g = t;
+#endif
+    neopixelWrite(RGB_PIN, r, g, b);
+    return true;
 }
+#endif
 
+static void render(unsigned long now) {
+    uint32_t rgb;
+    if (s_overlay && now - s_overlayStart >= LED_SEND_OVERLAY_MS) s_overlay = false;
+
+    if (s_overlay) {
+        rgb = sample(E_SEND, effect_time(E_SEND, now - s_overlayStart));
+    } else if (s_base == &E_HEAT) {
+        Cache_Manager::Snapshot snap;
+        const bool ok = Cache_Manager::snapshot(snap) && snap.valid(Cache_Manager::Field::CpuTemp);
+        rgb = ok ? sample(E_HEAT, (uint32_t)(snap.status.cpuTemp > 0 ? snap.status.cpuTemp : 0)) : sample(E_GREEN, 0);
+    } else {
+        rgb = sample(*s_base, effect_time(*s_base, now - s_baseStart));
+    }
+
+    if (rgb == s_shown) { s_retry = false; return; }
+    s_retry = !led_write(rgb);
+    if (!s_retry) s_shown = rgb;
+}
+
+static const Effect* effect_for(LedStatus status) {
+    switch (status) {
+        case LedStatus::Booting:       return &E_WHITE;
+        case LedStatus::WifiFailed:    return &E_RED;
+        case LedStatus::Portal:        return &E_PORTAL;
+        case LedStatus::UdpTransmit:   return &E_SEND;
+        case LedStatus::WifiConnected:
+#if LED_CONNECTED_EFFECT == 1
+            return &E_BREATHE;
+#elif LED_CONNECTED_EFFECT == 2
+            return &E_HEAT;
+#else
+            return &E_GREEN;
+#endif
+    }
+    return &E_WHITE;
+}
+
+// ====== Public ======
 void LedStat::begin() {
-    setStatus(LedStatus::Booting); // Solid white at boot
+#if LED_USE_RMT
+    s_rmtOk = rmtInit(RGB_PIN, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, 10000000);
+#endif
+    s_shown = 0xFFFFFFFF;
+    currentStatus = LedStatus::Booting;
+    s_base = effect_for(currentStatus);
+    s_baseStart = millis();
+    render(s_baseStart); // Solid white at boot
 }
 
 void LedStat::setStatus(LedStatus status) {
+    if (status == currentStatus) return;
     currentStatus = status;
-    ledOn = true;
-    lastBlink = millis();
-
-    switch (currentStatus) {
-        case LedStatus::Booting:        setLedColor(RGB_BRIGHTNESS, RGB_BRIGHTNESS, RGB_BRIGHTNESS); break; // White
-        case LedStatus::WifiConnected:  setLedColor(0, RGB_BRIGHTNESS, 0); break;   // Green
-        case LedStatus::WifiFailed:     setLedColor(RGB_BRIGHTNESS, 0, 0); break;   // Red
-        case LedStatus::Portal:         setLedColor(16, 0, 16); break;              // Initial purple
-        case LedStatus::UdpTransmit:    setLedColor(RGB_BRIGHTNESS, 40, 0); break;  // Initial orange
-    }
+    s_base = effect_for(status);
+    s_baseStart = millis();
+    render(s_baseStart);   // show the change now; setup() may not reach loop() for a while
+}
+
+void LedStat::sendFlash() {
+    s_overlay = true;
+    s_overlayStart = millis();
+    render(s_overlayStart);
 }
 
 // Call this from your main loop!
 void LedStat::loop() {
-    unsigned long now = millis();
-
-    switch (currentStatus) {
-        case LedStatus::Portal: // Blinking purple
-            if (now - lastBlink > 400) {
-                ledOn = !ledOn;
-                setLedColor(ledOn ? 16 : 0, 0, ledOn ? 16 : 0); // Purple/off
-                lastBlink = now;
-            }
-            break;
-        case LedStatus::UdpTransmit: // Blinking orange
-            if (now - lastBlink > 150) {
-                ledOn = !ledOn;
-                setLedColor(ledOn ? RGB_BRIGHTNESS : 0, ledOn ? 32 : 0, 0);
-                lastBlink = now;
-            }
-            break;
-        case LedStatus::Booting: // Solid white
-        case LedStatus::WifiConnected: // Solid green
-        case LedStatus::WifiFailed: // Solid red
-        default:
-            // Solid colors, nothing to do
-            break;
+    render(millis());
+}
+
+uint32_t LedStat::nextDueMs() {
+    const unsigned long now = millis();
+    if (s_retry) return now + 1;
+
+    uint32_t wait;
+    if (s_overlay) {
+        const long left = (long)LED_SEND_OVERLAY_MS - (long)(now - s_overlayStart);
+        wait = until_next_key(E_SEND, effect_time(E_SEND, now - s_overlayStart));
+        if (left <= 0) wait = 0;
+        else if ((uint32_t)left < wait) wait = (uint32_t)left;
+    } else if (s_base == &E_HEAT) {
+        wait = 1000;   // follows the cache, not the clock
+    } else {
+        wait = until_next_key(*s_base, effect_time(*s_base, now - s_baseStart));
     }
+    if (wait > 60000) wait = 60000;
+    return now + wait;
 }
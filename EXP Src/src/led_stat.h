@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 enum class LedStatus {
     Booting,
@@ -10,6 +11,12 @@ enum class LedStatus {
 
 namespace LedStat {
     void begin();
+    // Selects the base effect; cheap to call every loop (no-op if unchanged)
     void setStatus(LedStatus status);
     void loop(); // Call this in main loop for blinking/timing
+    // millis() when the shown colour next changes (for the idle-aware loop)
+    uint32_t nextDueMs();
+
+    // One-shot "packet sent" overlay on top of the base effect
+    void sendFlash();
 }
@@ -0,0 +1,14 @@
+// ota_key.h
+//
+// Public key that OTA bundles must be signed with (ECDSA P-256, uncompressed
+// point). Replace this file with the one written by
+//   python3 script/exp_ota.py keygen <name>
+// and keep the private key off the device. With EXP_OTA_KEY_SET 0 the signed
+// OTA endpoints refuse every image.
+
+#pragma once
+#include <stdint.h>
+
+#define EXP_OTA_KEY_SET 0
+
+static const uint8_t EXP_OTA_PUBKEY[65] = { 0x04 };
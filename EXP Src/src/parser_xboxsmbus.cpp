@@ -7,9 +7,8 @@ namespace Parser_XboxSMBus {
 
 void parse(const XboxSMBusStatus &status) {
     // You can apply any sanity/range checks here, or just set directly
-    Cache_Manager::setFanSpeed(status.fanSpeed);      // already 0–100%
-    Cache_Manager::setCpuTemp(status.cpuTemp);
-    Cache_Manager::setAmbientTemp(status.boardTemp);  // or status.ambientTemp
+    // Same path as the main loop: only freshly read fields reach the filters
+    Cache_Manager::updateFromSmbus(status);
 
     // TODO: If you ever get app name from polling (not typical), add here:
     // Cache_Manager::setCurrentApp(status.app);
@@ -17,6 +17,7 @@
 //
 
 #include "smbus_ext.h"
+#include "exp_config.h"
 #include <Arduino.h>
 #include <WiFiUdp.h>
 #include <Wire.h>
@@ -52,9 +53,7 @@ extern uint32_t smbus_last_activity_ms(); // (optional pacing hint)
 #ifndef SMBUS_EXT_STARTUP_GRACE_MS
 #define SMBUS_EXT_STARTUP_GRACE_MS 10000
 #endif
-#ifndef SMBUS_EXT_MIN_PERIOD_MS
-#define SMBUS_EXT_MIN_PERIOD_MS     4000   // steady state cadence (~4s)
-#endif
+// SMBUS_EXT_MIN_PERIOD_MS: runtime "ext_period", see exp_config.h
 #ifndef SMBUS_EXT_BACKOFF_MS
 #define SMBUS_EXT_BACKOFF_MS        9000   // slower after errors
 #endif
@@ -447,13 +446,17 @@ void SMBusExt::loop() {
   sendExtStatus();
 }
 
+uint32_t SMBusExt::nextDueMs() {
+  return g_ext_next_allowed_ms;
+}
+
 void SMBusExt::sendExtStatus() {
   const uint32_t now = millis();
 
   // 1) Only one SMBus user at a time
   if (!try_lock_smbus()) {
     // small defer; let the poller keep its cadence
-    g_ext_next_allowed_ms = now + SMBUS_EXT_MIN_PERIOD_MS;
+    g_ext_next_allowed_ms = now + ExpConfig::get(ExpConfig::Key::SmbusExtPeriod);
     return;
   }
 
@@ -542,7 +545,7 @@ void SMBusExt::sendExtStatus() {
 
   // 7) Schedule next tick and release lock
   uint32_t jitter = 150 + ((now & 0xFF) % 250); // 150..399ms
-  g_ext_next_allowed_ms = now + (smcValid ? SMBUS_EXT_MIN_PERIOD_MS
+  g_ext_next_allowed_ms = now + (smcValid ? ExpConfig::get(ExpConfig::Key::SmbusExtPeriod)
                                           : SMBUS_EXT_BACKOFF_MS) + jitter;
   unlock_smbus();
 }
@@ -4,6 +4,7 @@
 namespace SMBusExt {
     void begin();
     void loop();
+    uint32_t nextDueMs();   // millis() when loop() next has work
 
     // Extended status structure (no display/0x3C, just trayState, avPackState, picVer)
     struct Status {
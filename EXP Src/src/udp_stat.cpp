@@ -1,8 +1,26 @@
+// udp_stat.cpp
+//
+// Status broadcaster (port 50504) and ID beacon (port 50502).
+// - Cache_Manager calls notifyChanged() when a published value moves; the
+//   packet goes out once the change has settled for the debounce time and the
+//   SMBus has been quiet for the configured window.
+// - A token bucket caps bursts (e.g. fan ramps), and a slow heartbeat resends
+//   the last state when nothing changes so late listeners catch up.
+// - The old periodic check stays as a slow fallback for missed notifications
+//   and fields expiring in the cache.
+// - Status is read via Cache_Manager::snapshot(); fields past their TTL go out
+//   as the "unknown" sentinels (-1 fan, -1000 temps) so the display can tell
+//   stale from fresh without changing the 50504 packet layout.
+// - Each status send is followed by an XboxTitlePacket (72 bytes) with the
+//   title ID and full name; receivers that only know the 44-byte packet
+//   already discard other sizes.
+
 #include "udp_stat.h"
 #include <WiFiUdp.h>
 #include "cache_manager.h" // For XboxStatus
 #include <WiFi.h>
 #include "led_stat.h"
+#include "exp_config.h"
 #include <string.h>
 #include <Arduino.h>
 
@@ -19,9 +37,15 @@ extern uint32_t smbus_last_activity_ms();
 #define SMBUS_QUIET_BEFORE_UDP_MS  6      // ~6 ms after last SMBus activity
 #endif
 
-// Main data send cadence (check for changes this often)
-#ifndef UDP_CHECK_INTERVAL_MS
-#define UDP_CHECK_INTERVAL_MS      5000   // ~5s
+// Fallback check interval, debounce and heartbeat are runtime settings
+// ("udp_check", "udp_debounce", "heartbeat"); defaults in exp_config.h.
+
+// Token bucket: burst size and refill period (one token per period)
+#ifndef UDP_RATE_BURST
+#define UDP_RATE_BURST             3
+#endif
+#ifndef UDP_RATE_REFILL_MS
+#define UDP_RATE_REFILL_MS         1000   // sustained max ~1 packet/s
 #endif
 
 // Small jitter to avoid phase locking (0..JITTER_MAX_MS added to intervals)
@@ -34,10 +58,6 @@ extern uint32_t smbus_last_activity_ms();
 #define ID_BROADCAST_INTERVAL_MS   1500   // ~1.5s nominal + jitter
 #endif
 
-// Blink timings
-static const unsigned long blinkDuration = 2000; // blink for 2s when we send
-static const unsigned long blinkPeriod   = 150;  // blink on/off cycle
-
 // ====== State ======
 static WiFiUDP udp;
 
@@ -46,14 +66,20 @@ static const uint8_t  STATIC_ID = 6; // Type D device ID
 static unsigned long  nextDataCheck = 0;
 static unsigned long  nextIdBeacon  = 0;
 
-// --- UDP blink state ---
-static bool           udpBlinking = false;
-static unsigned long  udpBlinkStart = 0;
-static unsigned long  lastBlink = 0;
-static bool           blinkState = false;
+// --- change/debounce state ---
+static volatile bool  g_dirty = false;
+static volatile unsigned long g_dirtyAt = 0;   // time of the latest change
+static unsigned long  g_lastSendMs = 0;
+static uint16_t       g_quietMs    = SMBUS_QUIET_BEFORE_UDP_MS;
+
+// --- token bucket ---
+static uint8_t        g_tokens = UDP_RATE_BURST;
+static unsigned long  g_lastRefill = 0;
 
 // Keep last-sent to avoid spamming unchanged data
 static XboxStatus g_last_sent = {0};
+static uint32_t   g_sentVersion = 0;
+static uint8_t    g_sentValid   = 0;
 
 // ====== Helpers ======
 static inline unsigned long jitter_ms(unsigned long maxJ) {
@@ -65,7 +91,15 @@ static inline bool bus_quiet_enough() {
   const uint32_t now  = millis();
   // guard if last==0 (no activity yet) -> treat as quiet
   if (last == 0) return true;
-  return (now - last) >= SMBUS_QUIET_BEFORE_UDP_MS;
+  return (now - last) >= g_quietMs;
+}
+
+static void refill_tokens(unsigned long now) {
+  if (g_tokens >= UDP_RATE_BURST) { g_lastRefill = now; return; }
+  while (g_tokens < UDP_RATE_BURST && (now - g_lastRefill) >= UDP_RATE_REFILL_MS) {
+    g_tokens++;
+    g_lastRefill += UDP_RATE_REFILL_MS;
+  }
 }
 
 static bool status_changed(const XboxStatus& a, const XboxStatus& b) {
@@ -76,17 +110,46 @@ static bool status_changed(const XboxStatus& a, const XboxStatus& b) {
   return false;
 }
 
+// What goes on the wire: invalid (never sampled / expired) fields -> sentinels
+static XboxStatus wire_status(const Cache_Manager::Snapshot& snap) {
+  using F = Cache_Manager::Field;
+  XboxStatus st = snap.status;
+  if (!snap.valid(F::Fan))         st.fanSpeed    = -1;
+  if (!snap.valid(F::CpuTemp))     st.cpuTemp     = -1000;
+  if (!snap.valid(F::AmbientTemp)) st.ambientTemp = -1000;
+  if (!snap.valid(F::App))         memset(st.currentApp, 0, sizeof(st.currentApp));
+  return st;
+}
+
 static bool udpHasData() {
-  const XboxStatus& cur = Cache_Manager::getStatus();
-  return status_changed(cur, g_last_sent);
+  Cache_Manager::Snapshot snap;
+  if (!Cache_Manager::snapshot(snap)) return false;   // writer busy; next pass
+  if (snap.version == g_sentVersion && snap.validMask == g_sentValid) return false;
+  return status_changed(wire_status(snap), g_last_sent);
 }
 
 static void sendUdpPacket() {
-  const XboxStatus& st = Cache_Manager::getStatus();
+  Cache_Manager::Snapshot snap;
+  if (!Cache_Manager::snapshot(snap)) return;
+  const XboxStatus st = wire_status(snap);
   udp.beginPacket("255.255.255.255", UDP_PORT);
   udp.write(reinterpret_cast<const uint8_t*>(&st), sizeof(XboxStatus));
   udp.endPacket();
-  g_last_sent = st; // mark as flushed
+
+  if (snap.valid(Cache_Manager::Field::App)) {
+    XboxTitlePacket tp;
+    memcpy(tp.magic, "TDT1", 4);
+    tp.titleId = snap.titleId;
+    memcpy(tp.name, snap.titleName, sizeof(tp.name));
+    tp.name[sizeof(tp.name) - 1] = 0;
+    udp.beginPacket("255.255.255.255", UDP_PORT);
+    udp.write(reinterpret_cast<const uint8_t*>(&tp), sizeof(tp));
+    udp.endPacket();
+  }
+  g_last_sent   = st; // mark as flushed
+  g_sentVersion = snap.version;
+  g_sentValid   = snap.validMask;
+  g_lastSendMs  = millis();
 #if UDP_STAT_DEBUG
   Serial.println("[UDPStat] Sent status packet.");
 #endif
@@ -98,58 +161,76 @@ void UDPStat::begin() {
   Serial.printf("[UDPStat] UDP sender initialized on port %u\n", UDP_PORT);
 #endif
   const unsigned long now = millis();
-  nextDataCheck = now + UDP_CHECK_INTERVAL_MS + jitter_ms(UDP_JITTER_MAX_MS);
+  nextDataCheck = now + ExpConfig::get(ExpConfig::Key::UdpCheckInterval) + jitter_ms(UDP_JITTER_MAX_MS);
   nextIdBeacon  = now + ID_BROADCAST_INTERVAL_MS + jitter_ms(UDP_JITTER_MAX_MS);
+  g_tokens      = UDP_RATE_BURST;
+  g_lastRefill  = now;
+  g_lastSendMs  = now;
+  g_dirty       = true;   // announce the current state once up
+  g_dirtyAt     = now;
+}
+
+void UDPStat::notifyChanged() {
+  g_dirtyAt = millis();
+  g_dirty   = true;
+}
+
+void UDPStat::setDebounceMs(uint16_t ms)    { ExpConfig::set(ExpConfig::Key::UdpDebounce, ms, false); }
+void UDPStat::setQuietWindowMs(uint16_t ms) { g_quietMs = ms; }
+
+static inline unsigned long sooner(unsigned long a, unsigned long b) {
+  return (long)(a - b) < 0 ? a : b;
+}
+
+uint32_t UDPStat::nextDueMs() {
+  const unsigned long now = millis();
+  unsigned long due = sooner(nextDataCheck, nextIdBeacon);
+  if (WiFi.status() != WL_CONNECTED) return due;
+
+  // Earliest time a status send could pass every gate in loop()
+  const uint32_t heartbeat = ExpConfig::get(ExpConfig::Key::UdpHeartbeat);
+  if (!g_dirty && heartbeat == 0) return due;
+  unsigned long send = g_dirty ? g_dirtyAt + ExpConfig::get(ExpConfig::Key::UdpDebounce)
+                               : g_lastSendMs + heartbeat;
+  if (g_tokens == 0 && (long)(g_lastRefill + UDP_RATE_REFILL_MS - send) > 0) send = g_lastRefill + UDP_RATE_REFILL_MS;
+  const uint32_t last = smbus_last_activity_ms();
+  if (last && (long)(last + g_quietMs - send) > 0) send = last + g_quietMs;
+  if ((long)(send - now) < 0) send = now;
+  return sooner(due, send);
 }
 
 void UDPStat::loop() {
   const unsigned long now = millis();
 
-  // 1) If currently blinking to indicate a recent send, handle LED state.
-  if (udpBlinking) {
-    if (now - udpBlinkStart >= blinkDuration) {
-      udpBlinking = false;
-      // revert to normal status
-      if (WiFi.status() == WL_CONNECTED) {
-        LedStat::setStatus(LedStatus::WifiConnected);
-      } else {
-        LedStat::setStatus(LedStatus::Portal);
-      }
-    } else {
-      if (now - lastBlink > blinkPeriod) {
-        blinkState = !blinkState;
-        LedStat::setStatus(blinkState ? LedStatus::UdpTransmit
-                                      : LedStatus::WifiConnected);
-        lastBlink = now;
-      }
-    }
-    // (we continue so we can also do ID beacons while blinking)
-  }
+  // 1) Status send: debounced after a change, rate-limited, bus-quiet aware
+  refill_tokens(now);
 
-  // 2) Periodic status send (only when it changed AND bus is quiet)
   if (now >= nextDataCheck) {
-    nextDataCheck = now + UDP_CHECK_INTERVAL_MS + jitter_ms(UDP_JITTER_MAX_MS);
+    // Fallback: catch anything that changed without a notification
+    nextDataCheck = now + ExpConfig::get(ExpConfig::Key::UdpCheckInterval) + jitter_ms(UDP_JITTER_MAX_MS);
+    if (!g_dirty && udpHasData()) { g_dirtyAt = now; g_dirty = true; }
+  }
 
-    if (WiFi.status() == WL_CONNECTED && udpHasData()) {
-      if (bus_quiet_enough()) {
+  if (WiFi.status() == WL_CONNECTED) {
+    const uint32_t heartbeat = ExpConfig::get(ExpConfig::Key::UdpHeartbeat);
+    if (g_dirty && (now - g_dirtyAt) >= ExpConfig::get(ExpConfig::Key::UdpDebounce) && g_tokens > 0 && bus_quiet_enough()) {
+      g_dirty = false;
+      if (udpHasData()) {   // may have settled back to what was already sent
+        g_tokens--;
         sendUdpPacket();
-        // Start blink feedback (non-blocking)
-        udpBlinking   = true;
-        udpBlinkStart = now;
-        lastBlink     = now;
-        blinkState    = true;
-        LedStat::setStatus(LedStatus::UdpTransmit);
-      } else {
-        // Defer a little if bus was busy—try again soon (but not immediately)
-        nextDataCheck = now + 150 + jitter_ms(150);
+        LedStat::sendFlash();   // LED engine runs the blink overlay
+      }
+    }
+    else if (heartbeat && !g_dirty && (now - g_lastSendMs) >= heartbeat && g_tokens > 0 && bus_quiet_enough()) {
+      g_tokens--;
+      sendUdpPacket();   // no blink: nothing new to show
 #if UDP_STAT_DEBUG
-        Serial.println("[UDPStat] Deferring data send (SMBus not quiet).");
+      Serial.println("[UDPStat] Heartbeat.");
 #endif
-      }
     }
   }
 
-  // 3) ID beacon (lower duty, also bus-quiet aware)
+  // 2) ID beacon (lower duty, also bus-quiet aware)
   if (now >= nextIdBeacon) {
     nextIdBeacon = now + ID_BROADCAST_INTERVAL_MS + jitter_ms(UDP_JITTER_MAX_MS);
 
@@ -167,12 +248,10 @@ void UDPStat::loop() {
     }
   }
 
-  // 4) Keep LED showing connection status when not blinking
-  if (!udpBlinking) {
-    if (WiFi.status() == WL_CONNECTED) {
-      LedStat::setStatus(LedStatus::WifiConnected);
-    } else {
-      LedStat::setStatus(LedStatus::Portal);
-    }
+  // 3) Keep LED showing connection status (no-op unless it changed)
+  if (WiFi.status() == WL_CONNECTED) {
+    LedStat::setStatus(LedStatus::WifiConnected);
+  } else {
+    LedStat::setStatus(LedStatus::Portal);
   }
 }
@@ -4,4 +4,15 @@
 namespace UDPStat {
     void begin();
     void loop();
+    // millis() when loop() next has something to send (debounce end, token
+    // refill, bus quiet window, heartbeat, beacon or fallback check)
+    uint32_t nextDueMs();
+
+    // Published status changed; send after the debounce window
+    void notifyChanged();
+    // Settle time after the last change before sending (runtime "udp_debounce";
+    // this sets it until reboot without touching NVS)
+    void setDebounceMs(uint16_t ms);
+    // Required SMBus idle time before a send (default SMBUS_QUIET_BEFORE_UDP_MS)
+    void setQuietWindowMs(uint16_t ms);
 }
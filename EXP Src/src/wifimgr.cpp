@@ -4,6 +4,9 @@
 #include <Preferences.h>
 #include <DNSServer.h>
 #include "led_stat.h"
+#include "history.h"
+#include "idle.h"
+#include "exp_remote.h"
 #include <vector>
 #include "esp_wifi.h"
 #include <Update.h> // For OTA
@@ -24,6 +27,11 @@ static const int maxAttempts = 10;
 static unsigned long lastAttempt = 0;
 static unsigned long retryDelay = 3000;
 
+// DNS/connect polling while the portal is up or a join is in progress
+#ifndef WIFI_POLL_MS
+#define WIFI_POLL_MS 20
+#endif
+
 AsyncWebServer& getServer() {
     return server;
 }
@@ -351,6 +359,9 @@ void startPortal() {
     auto cp = [](AsyncWebServerRequest *r){
         r->send(200, "text/html", "<meta http-equiv='refresh' content='0; url=/' />");
     };
+    History::registerHttp(server);
+    ExpRemote::registerHttp(server);   // /config, signed /ota/*
+
     server.on("/generate_204", HTTP_GET, cp);
     server.on("/hotspot-detect.html", HTTP_GET, cp);
     server.on("/redirect", HTTP_GET, cp);
@@ -380,6 +391,8 @@ void tryConnect() {
 }
 
 void begin() {
+    // Link changes come in on the WiFi event task; let the main loop react now
+    WiFi.onEvent([](WiFiEvent_t) { Idle::wake(); });
     LedStat::setStatus(LedStatus::Booting);
     loadCreds();
     startPortal();
@@ -412,6 +425,11 @@ void loop() {
     }
 }
 
+uint32_t nextDueMs() {
+    if (state == State::CONNECTED) return millis() + 60000UL;
+    return millis() + WIFI_POLL_MS;
+}
+
 void restartPortal() {
     startPortal();
 }
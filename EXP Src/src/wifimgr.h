@@ -8,6 +8,7 @@ namespace WiFiMgr {
 
     void begin();
     void loop();
+    uint32_t nextDueMs();   // millis() when loop() next needs to run
     void restartPortal();
     void forgetWiFi();
     bool isConnected();
@@ -20,6 +20,7 @@
 
 #include "xbox_smbus_poll.h"
 #include "parser_xboxsmbus.h"
+#include "exp_config.h"
 #include <Arduino.h>
 #include <Wire.h>
 #include "freertos/FreeRTOS.h"
@@ -36,9 +37,7 @@
 #ifndef SMBUS_STARTUP_GRACE_MS
 #define SMBUS_STARTUP_GRACE_MS    10000   // let the console boot first
 #endif
-#ifndef SMBUS_MIN_TICK_MS
-#define SMBUS_MIN_TICK_MS          250   // one RR step every 1s (~4s full cycle)
-#endif
+// SMBUS_MIN_TICK_MS: runtime "smbus_tick", see exp_config.h
 #ifndef SMBUS_BACKOFF_MS_BASE
 #define SMBUS_BACKOFF_MS_BASE      8000   // backoff base on error; exponential
 #endif
@@ -192,13 +191,18 @@ void XboxSMBusPoll::begin(uint8_t sdaPin, uint8_t sclPin) {
   g_is16_cached     = false;
 }
 
+uint32_t XboxSMBusPoll::nextDueMs() {
+  return g_next_allowed_ms;
+}
+
 bool XboxSMBusPoll::poll(XboxSMBusStatus& status) {
   const uint32_t now = millis();
+  status.fresh = 0;   // set below for whichever field this tick reads
   if (now < g_next_allowed_ms) return true;
 
   // Acquire the SMBus (non-blocking here; next tick will try again)
   if (!try_lock_smbus()) {
-    g_next_allowed_ms = now + SMBUS_MIN_TICK_MS;
+    g_next_allowed_ms = now + ExpConfig::get(ExpConfig::Key::SmbusMinTick);
     return true;
   }
 
@@ -229,6 +233,7 @@ bool XboxSMBusPoll::poll(XboxSMBusStatus& status) {
       case 0: { // CPU temp (C)
         if (readSMBusByteSTOP(SMC_ADDRESS, SMC_CPUTEMP, val) == 0 && val < 120) {
           status.cpuTemp = (int)val;
+          status.fresh |= SMBUS_FRESH_CPU;
         } else {
           ok = false;
         }
@@ -248,6 +253,7 @@ bool XboxSMBusPoll::poll(XboxSMBusStatus& status) {
           } else {
             status.boardTemp = (int)val;
           }
+          status.fresh |= SMBUS_FRESH_BOARD;
         } else {
           ok = false;
         }
@@ -256,6 +262,7 @@ bool XboxSMBusPoll::poll(XboxSMBusStatus& status) {
       case 2: { // Fan speed (raw 0–50 → %)
         if (readSMBusByteSTOP(SMC_ADDRESS, SMC_FANSPEED, val) == 0 && val <= 50) {
           status.fanSpeed = (int)val * 2;
+          status.fresh |= SMBUS_FRESH_FAN;
         } else {
           ok = false;
         }
@@ -278,7 +285,7 @@ bool XboxSMBusPoll::poll(XboxSMBusStatus& status) {
   } else {
     g_err_streak = 0;
     const uint32_t jitter = 100 + ((now & 0xFF) % 200); // 100..299 ms
-    g_next_allowed_ms = now + SMBUS_MIN_TICK_MS + jitter;
+    g_next_allowed_ms = now + ExpConfig::get(ExpConfig::Key::SmbusMinTick) + jitter;
   }
 
   unlock_smbus();
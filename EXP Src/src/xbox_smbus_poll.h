@@ -2,16 +2,23 @@
 
 #include <Arduino.h>
 
+// Bits in XboxSMBusStatus::fresh -- which fields the last poll() actually read
+#define SMBUS_FRESH_CPU    0x01
+#define SMBUS_FRESH_BOARD  0x02
+#define SMBUS_FRESH_FAN    0x04
+
 // Structure to hold polled values (adapt/expand as needed)
 struct XboxSMBusStatus {
     int cpuTemp = -1;
     int boardTemp = -1;
     int fanSpeed = -1;
     char app[16] = {0};
+    uint8_t fresh = 0;   // SMBUS_FRESH_* set by the last poll(); 0 if nothing new
     // Add more fields as needed
 };
 
 namespace XboxSMBusPoll {
     void begin(uint8_t sdaPin = 7, uint8_t sclPin = 6);
     bool poll(XboxSMBusStatus& status); // Returns true if poll successful
+    uint32_t nextDueMs();               // millis() when poll() next touches the bus
 }
@@ -0,0 +1,472 @@
+// tdasset.cpp
+//
+// Prepares gallery and boot content for the display (replaces
+// script/gif_convert.py):
+// - GIFs: resized to the panel, source frame delays kept, one global palette
+//   (a per-frame palette only where the global one loses too much), each
+//   frame cropped to what changed since the previous one, with "keep"
+//   disposal and transparent pixels for what didn't change
+// - JPGs: resized to the panel and written as baseline JPEG, which TJpgDec
+//   can draw (it can't draw progressive files)
+// - JPGs as QOI (.qoi): lossless, decoded in one cheap pass
+//   (../../src/qoi_dec.cpp)
+// - either as raw RGB565 (.565, see ../../src/td565.h): no decoding at all
+// and prints the predicted on-device time to show each file before and after
+// (decode_cost.h).
+
+#include "decode_cost.h"
+#include "gif_dec.h"
+#include "gif_enc.h"
+#include "jpeg_io.h"
+#include "qoi_dec.h"
+#include "qoi_enc.h"
+#include "quantize.h"
+#include "td565.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+static const size_t kPartitionBytes = 0x9E0000;   // the 9.9MB FATFS partition, before FAT overhead
+
+enum Format { F_AUTO, F_GIF, F_JPG, F_QOI, F_565 };
+
+struct Options {
+  int w = 480, h = 480;
+  bool cover = false;         // crop to fill instead of letterboxing
+  Format format = F_AUTO;
+  int quality = 85;
+  bool sub420 = true;
+  bool globalOnly = false;    // never fall back to a frame palette
+  bool force = false;         // re-encode JPGs that already fit
+  bool dryRun = false;
+};
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  out.clear();
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  const bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+static bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+static std::string lower(std::string s) {
+  for (char& c : s) c = (char)tolower((unsigned char)c);
+  return s;
+}
+static std::string kb(size_t bytes) {
+  char b[32];
+  snprintf(b, sizeof(b), bytes >= 1024 * 1024 ? "%.2f MB" : "%.1f KB",
+           bytes >= 1024 * 1024 ? bytes / (1024.0 * 1024.0) : bytes / 1024.0);
+  return b;
+}
+
+static media::Image toCanvas(const media::Image& img, const Options& o) {
+  if (img.w == o.w && img.h == o.h) return img;
+  return o.cover ? media::cover(img, o.w, o.h) : media::fit(img, o.w, o.h);
+}
+
+// ---------- .565 ----------
+struct RawWriter {
+  std::vector<uint8_t> out;
+  size_t frames = 0, last = 0;
+  RawWriter(int w, int h, int loops) {
+    td565::Header hd{};
+    memcpy(hd.magic, td565::kMagic, 4);
+    hd.width = (uint16_t)w;
+    hd.height = (uint16_t)h;
+    hd.loops = (uint16_t)loops;
+    out.resize(sizeof(hd));
+    memcpy(out.data(), &hd, sizeof(hd));
+  }
+  // The (x, y, w, h) rectangle of a canvasW-wide RGB565 canvas
+  void frame(const std::vector<uint16_t>& px, int canvasW, int x, int y, int w, int h, uint32_t delayMs) {
+    const td565::Frame f{ (uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h, delayMs };
+    last = out.size();
+    out.insert(out.end(), (const uint8_t*)&f, (const uint8_t*)&f + sizeof(f));
+    for (int yy = y; yy < y + h; ++yy)
+      for (int xx = x; xx < x + w; ++xx) {
+        const uint16_t c = px[(size_t)yy * canvasW + xx];
+        out.push_back((uint8_t)(c >> 8));
+        out.push_back((uint8_t)c);
+      }
+    frames++;
+  }
+  void addDelay(uint32_t ms) {   // to the last frame
+    if (!frames) return;
+    uint32_t d;
+    memcpy(&d, &out[last + offsetof(td565::Frame, delayMs)], 4);
+    d += ms;
+    memcpy(&out[last + offsetof(td565::Frame, delayMs)], &d, 4);
+  }
+  void finish() {
+    const uint16_t n = (uint16_t)frames;
+    memcpy(&out[offsetof(td565::Header, frames)], &n, 2);
+  }
+};
+
+// Bounding box of the pixels that differ; false if none
+static bool changedRect(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b, int w, int h,
+                        int& x0, int& y0, int& x1, int& y1) {
+  x0 = w; y0 = h; x1 = -1; y1 = -1;
+  for (int y = 0; y < h; ++y) {
+    const uint16_t* pa = &a[(size_t)y * w];
+    const uint16_t* pb = &b[(size_t)y * w];
+    for (int x = 0; x < w; ++x) {
+      if (pa[x] == pb[x]) continue;
+      x0 = std::min(x0, x); x1 = std::max(x1, x);
+      y0 = std::min(y0, y); y1 = std::max(y1, y);
+    }
+  }
+  return x1 >= 0;
+}
+
+// ---------- GIF ----------
+static int convertGif(const std::string& in, const std::vector<uint8_t>& src, const std::string& outPath,
+                      const Options& o, Format fmt) {
+  media::Gif g;
+  std::string err;
+  if (!media::gifDecode(src.data(), src.size(), g, &err)) { fprintf(stderr, "%s: %s\n", in.c_str(), err.c_str()); return 1; }
+  if (fmt == F_JPG || fmt == F_QOI) { fprintf(stderr, "%s: GIF input can only be written as GIF or 565\n", in.c_str()); return 1; }
+  const size_t n = g.frames.size();
+  const int W = o.w, H = o.h;
+  const size_t area = (size_t)W * H;
+
+  // Composites every source frame, at canvas size, in order
+  auto forEachFrame = [&](const std::function<void(size_t, const media::Image&)>& fn) {
+    media::GifPlayer p(g);
+    for (size_t i = 0; i < n; ++i) {
+      p.draw(i);
+      fn(i, toCanvas(p.flatten(0), o));
+    }
+  };
+
+  uint32_t srcLoopMs = 0;
+  media::DecodeCost srcFrames;
+  int srcLate = 0, srcLocal = 0;
+  for (auto& f : g.frames) {
+    const media::DecodeCost c = media::gifFrameCost(f.w, f.h, f.dataBytes);
+    srcFrames += c;
+    srcLoopMs += f.delayCs * 10;
+    if (f.delayCs > 0 && c.total() > f.delayCs * 10) srcLate++;
+    if (f.localPalette) srcLocal++;
+  }
+
+  std::vector<uint16_t> shown(area, 0), next(area);   // what the panel shows (starts black)
+  std::vector<uint8_t> out;
+  std::vector<size_t> frameBytes;
+  size_t outFrames = 0, merged = 0, changedPx = 0, localFrames = 0, paletteSize = 0;
+  bool exact = false;
+  media::DecodeCost outFrameCost;
+  int outLate = 0;
+
+  if (fmt == F_565) {
+    RawWriter raw(W, H, g.loopCount < 0 ? 1 : (g.loopCount == 0 ? 0 : std::min(g.loopCount + 1, 65535)));
+    forEachFrame([&](size_t i, const media::Image& img) {
+      for (size_t k = 0; k < area; ++k) next[k] = media::key565(&img.rgb[k * 3]);
+      const uint32_t delayMs = (uint32_t)g.frames[i].delayCs * 10;
+      int x0 = 0, y0 = 0, x1 = W - 1, y1 = H - 1;
+      if (i > 0 && !changedRect(shown, next, W, H, x0, y0, x1, y1)) { raw.addDelay(delayMs); merged++; return; }
+      raw.frame(next, W, x0, y0, x1 - x0 + 1, y1 - y0 + 1, delayMs);
+      const media::DecodeCost c = media::rawFrameCost(x1 - x0 + 1, y1 - y0 + 1);
+      outFrameCost += c;
+      if (delayMs > 0 && c.total() > delayMs) outLate++;
+      changedPx += (size_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+      shown.swap(next);
+    });
+    raw.finish();
+    out = std::move(raw.out);
+    outFrames = raw.frames;
+  } else {
+    // Pass 1: one palette for the whole animation
+    media::Histogram hist;
+    forEachFrame([&](size_t, const media::Image& img) { hist.add(img); });
+    exact = hist.colours() <= 255;
+    const std::vector<media::Rgb> global = media::buildPalette(hist, 255);
+    paletteSize = global.size();
+    media::PaletteMap gmap(global);
+
+    // Pass 2: map, diff against the panel, crop
+    media::Gif og;
+    og.width = W;
+    og.height = H;
+    og.loopCount = g.loopCount;
+    og.globalPalette = global;
+    og.globalPalette.push_back(media::Rgb{0, 0, 0});   // transparent slot
+    const int trans = (int)global.size();
+    std::vector<uint8_t> idx(area);
+    forEachFrame([&](size_t i, const media::Image& img) {
+      std::vector<media::Rgb> pal = global;
+      media::PaletteMap* map = &gmap;
+      media::PaletteMap lmap(std::vector<media::Rgb>{});
+      bool local = false;
+      if (!exact && !o.globalOnly) {
+        const double ge = gmap.error(img);
+        if (ge > 8.0) {
+          media::Histogram fh;
+          fh.add(img);
+          std::vector<media::Rgb> lp = media::buildPalette(fh, 255);
+          lmap = media::PaletteMap(lp);
+          const double le = lmap.error(img);
+          if (ge > 2.0 * le + 8.0) { pal = lp; map = &lmap; local = true; }
+        }
+      }
+      for (size_t k = 0; k < area; ++k) {
+        idx[k] = map->index(media::key565(&img.rgb[k * 3]));
+        const media::Rgb& c = pal[idx[k]];
+        next[k] = media::rgb565(c.r, c.g, c.b);
+      }
+      const int delayCs = g.frames[i].delayCs;
+      int x0 = 0, y0 = 0, x1 = W - 1, y1 = H - 1;
+      if (i > 0 && !changedRect(shown, next, W, H, x0, y0, x1, y1)) {
+        og.frames.back().delayCs = std::min(65535, og.frames.back().delayCs + delayCs);
+        merged++;
+        return;
+      }
+      media::GifFrame f;
+      f.x = x0; f.y = y0; f.w = x1 - x0 + 1; f.h = y1 - y0 + 1;
+      f.delayCs = delayCs;
+      f.disposal = 1;   // keep: the panel keeps what it shows, and the next frame only patches it
+      f.localPalette = local;
+      if (local) { f.palette = pal; f.palette.push_back(media::Rgb{0, 0, 0}); }
+      const int t = local ? (int)pal.size() : trans;
+      f.pixels.resize((size_t)f.w * f.h);
+      std::vector<uint8_t> holes(f.pixels.size());
+      for (int y = 0; y < f.h; ++y)
+        for (int x = 0; x < f.w; ++x) {
+          const size_t k = (size_t)(y0 + y) * W + x0 + x;
+          f.pixels[(size_t)y * f.w + x] = idx[k];
+          holes[(size_t)y * f.w + x] = next[k] == shown[k] ? (uint8_t)t : idx[k];
+        }
+      // Unchanged pixels as transparent usually compress better, but not
+      // when the changes are scattered (dithered video): keep the smaller
+      f.transparent = -1;
+      if (i > 0) {
+        const int minCode = std::max(2, (int)std::ceil(std::log2((double)t + 1)));
+        if (media::gifLzw(holes, minCode).size() < media::gifLzw(f.pixels, minCode).size()) {
+          f.pixels.swap(holes);
+          f.transparent = t;
+        }
+      }
+      changedPx += f.pixels.size();
+      if (local) localFrames++;
+      og.frames.push_back(std::move(f));
+      shown.swap(next);
+    });
+    if (!media::gifEncode(og, out, &frameBytes)) { fprintf(stderr, "%s: GIF encode failed\n", in.c_str()); return 1; }
+    outFrames = og.frames.size();
+    for (size_t i = 0; i < og.frames.size(); ++i) {
+      const media::GifFrame& f = og.frames[i];
+      const media::DecodeCost c = media::gifFrameCost(f.w, f.h, frameBytes[i]);
+      outFrameCost += c;
+      if (f.delayCs > 0 && c.total() > f.delayCs * 10) outLate++;
+    }
+
+    // Play the output back and check every frame lands as intended
+    media::Gif check;
+    if (!media::gifDecode(out.data(), out.size(), check, &err) || check.frames.size() != outFrames) {
+      fprintf(stderr, "%s: output doesn't decode (%s)\n", in.c_str(), err.c_str());
+      return 1;
+    }
+    media::GifPlayer p(check);
+    for (size_t i = 0; i < outFrames; ++i) p.draw(i);
+    const media::Image last = p.flatten(0);
+    for (size_t k = 0; k < area; ++k)
+      if (media::key565(&last.rgb[k * 3]) != shown[k]) { fprintf(stderr, "%s: output check failed\n", in.c_str()); return 1; }
+  }
+
+  // GIFs are read into PSRAM whole before the first frame; .565 frames are read as they play
+  const double srcOpen = media::fileReadCost(src.size()).total();
+  const double outOpen = fmt == F_565 ? 0.0 : media::fileReadCost(out.size()).total();
+  printf("%s -> %s\n", in.c_str(), o.dryRun ? "(dry run)" : outPath.c_str());
+  printf("  source  %dx%d, %zu frames, %s, %d local palettes, %.2f s per loop\n", g.width, g.height, n,
+         kb(src.size()).c_str(), srcLocal, srcLoopMs / 1000.0);
+  if (fmt == F_565)
+    printf("  output  %dx%d RGB565, %zu frames (%zu unchanged merged), %s\n", W, H, outFrames, merged, kb(out.size()).c_str());
+  else
+    printf("  output  %dx%d, %zu frames (%zu unchanged merged), %s, %zu-colour %s global palette, %zu local\n", W, H,
+           outFrames, merged, kb(out.size()).c_str(), paletteSize, exact ? "exact" : "quantised", localFrames);
+  printf("  frames  %.0f%% of the canvas redrawn per frame on average\n",
+         outFrames ? 100.0 * changedPx / ((double)area * outFrames) : 0.0);
+  printf("  device  open %.0f -> %.0f ms, frame %.1f -> %.1f ms avg, frames slower than their delay %d -> %d\n",
+         srcOpen, outOpen, n ? srcFrames.total() / n : 0.0, outFrames ? outFrameCost.total() / outFrames : 0.0,
+         srcLate, outLate);
+  if (out.size() > kPartitionBytes) printf("  warning: larger than the FATFS partition\n");
+  if (!o.dryRun && !writeFile(outPath, out)) { fprintf(stderr, "can't write %s\n", outPath.c_str()); return 1; }
+  return 0;
+}
+
+// ---------- JPG ----------
+static int convertJpg(const std::string& in, const std::vector<uint8_t>& src, const std::string& outPath,
+                      const Options& o, Format fmt) {
+  media::JpegInfo si;
+  if (!media::jpegProbe(src.data(), src.size(), si)) { fprintf(stderr, "%s: not a JPEG\n", in.c_str()); return 1; }
+  if (fmt == F_GIF) { fprintf(stderr, "%s: JPG input can't be written as GIF\n", in.c_str()); return 1; }
+  const bool drawable = !si.progressive && !si.arithmetic;
+  const media::DecodeCost before = media::jpegCost(si, src.size());
+
+  std::vector<uint8_t> out;
+  std::string what;
+  media::DecodeCost after;
+  if (fmt == F_JPG && drawable && si.w == o.w && si.h == o.h && !o.force) {
+    // already fits: don't lose a generation
+    if (!si.rowRestarts() && media::jpegAddRestarts(src.data(), src.size(), out)) {
+      media::JpegInfo oi;
+      media::jpegProbe(out.data(), out.size(), oi);
+      after = media::jpegCost(oi, out.size());
+      what = "kept, restart markers added";
+    } else {
+      out = src;
+      after = before;
+      what = "kept as is";
+    }
+  } else {
+    const double scale = o.cover ? std::max((double)o.w / si.w, (double)o.h / si.h)
+                                 : std::min((double)o.w / si.w, (double)o.h / si.h);
+    int denom = 1;
+    while (denom < 8 && denom * 2 <= 1.0 / scale) denom *= 2;
+    media::Image img;
+    if (!media::jpegDecode(src.data(), src.size(), img, denom)) { fprintf(stderr, "%s: decode failed\n", in.c_str()); return 1; }
+    const media::Image c = toCanvas(img, o);
+    if (fmt == F_565) {
+      RawWriter raw(c.w, c.h, 1);
+      std::vector<uint16_t> px((size_t)c.w * c.h);
+      for (size_t k = 0; k < px.size(); ++k) px[k] = media::key565(&c.rgb[k * 3]);
+      raw.frame(px, c.w, 0, 0, c.w, c.h, 0);
+      raw.finish();
+      out = std::move(raw.out);
+      after = media::rawFrameCost(c.w, c.h);
+      what = "RGB565";
+    } else if (fmt == F_QOI) {
+      media::qoiEncode(c, out);
+      // Decode it again the way the display will, and compare
+      struct Check { const media::Image* img; bool ok; } chk{ &c, true };
+      std::vector<uint16_t> strip((size_t)c.w * 16);
+      const bool ok = qoi::decode(out.data(), out.size(), strip.data(), 16,
+        [](int y, int rows, const uint16_t* px, void* user) {
+          Check* k = (Check*)user;
+          for (int r = 0; r < rows; ++r)
+            for (int x = 0; x < k->img->w; ++x) {
+              const uint16_t v = media::key565(k->img->px(x, y + r));
+              if (px[(size_t)r * k->img->w + x] != (uint16_t)((v >> 8) | (v << 8))) k->ok = false;
+            }
+        }, &chk);
+      if (!ok || !chk.ok) { fprintf(stderr, "%s: QOI check failed\n", in.c_str()); return 1; }
+      after = media::qoiCost(c.w, c.h, out.size());
+      what = "QOI";
+    } else {
+      if (!media::jpegEncode(c, o.quality, out, o.sub420)) { fprintf(stderr, "%s: encode failed\n", in.c_str()); return 1; }
+      media::JpegInfo oi;
+      media::jpegProbe(out.data(), out.size(), oi);
+      after = media::jpegCost(oi, out.size());
+      what = std::string("baseline q") + std::to_string(o.quality) + (o.sub420 ? " 4:2:0" : " 4:4:4");
+    }
+  }
+
+  printf("%s -> %s\n", in.c_str(), o.dryRun ? "(dry run)" : outPath.c_str());
+  printf("  source  %dx%d%s, %s\n", si.w, si.h, si.progressive ? " progressive" : (si.arithmetic ? " arithmetic" : " baseline"),
+         kb(src.size()).c_str());
+  printf("  output  %dx%d %s, %s\n", o.w, o.h, what.c_str(), kb(out.size()).c_str());
+  if (drawable)
+    printf("  device  %.1f -> %.1f ms (read %.1f, decode %.1f, draw %.1f)\n", before.total(), after.total(),
+           after.readMs, after.decodeMs, after.drawMs);
+  else
+    printf("  device  source can't be drawn (TJpgDec is baseline only) -> %.1f ms\n", after.total());
+  if (!o.dryRun && !writeFile(outPath, out)) { fprintf(stderr, "can't write %s\n", outPath.c_str()); return 1; }
+  return 0;
+}
+
+static std::string outputName(const std::string& in, const std::string& outArg, bool outIsDir, int inputs,
+                               const Options& o, Format fmt) {
+  const char* ext = fmt == F_GIF ? ".gif" : (fmt == F_JPG ? ".jpg" : (fmt == F_QOI ? ".qoi" : ".565"));
+  std::string base = in.substr(in.find_last_of('/') == std::string::npos ? 0 : in.find_last_of('/') + 1);
+  base = base.substr(0, base.find_last_of('.'));
+  if (!outArg.empty() && !outIsDir && inputs == 1) return outArg;
+  if (outIsDir) return outArg + "/" + base + ext;
+  const std::string dir = in.find_last_of('/') == std::string::npos ? "" : in.substr(0, in.find_last_of('/') + 1);
+  return dir + base + "_" + std::to_string(o.w) + "x" + std::to_string(o.h) + ext;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdasset [options] INPUT.gif|.jpg ...\n"
+          "  -o  output file (one input) or existing directory (default <name>_480x480.<ext> beside the input)\n"
+          "  -f  gif, jpg, qoi (JPG input) or 565 (raw RGB565, no decoding on the device);\n"
+          "      default keeps the input type\n"
+          "  -s  canvas size, N or WxH (default 480)\n"
+          "  -c  crop to fill the canvas instead of letterboxing\n"
+          "  -q  JPEG quality (default 85)\n"
+          "  -4  JPEG 4:4:4 (default 4:2:0, about half the IDCT work)\n"
+          "  -F  re-encode JPGs that already fit\n"
+          "  -G  one global palette for every frame, even where it loses detail\n"
+          "  -n  report only, write nothing\n");
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  std::string outArg;
+  int c;
+  while ((c = getopt(argc, argv, "o:f:s:cq:4FGnh")) != -1) {
+    switch (c) {
+      case 'o': outArg = optarg; break;
+      case 'f': {
+        const std::string f = lower(optarg);
+        if (f == "gif") o.format = F_GIF;
+        else if (f == "jpg" || f == "jpeg") o.format = F_JPG;
+        else if (f == "qoi") o.format = F_QOI;
+        else if (f == "565" || f == "rgb565") o.format = F_565;
+        else { usage(); return 2; }
+        break;
+      }
+      case 's': {
+        int w = 0, h = 0;
+        if (sscanf(optarg, "%dx%d", &w, &h) < 2) h = w;
+        if (w <= 0 || h <= 0 || w > 480 || h > 480) { fprintf(stderr, "tdasset: size must be 1..480\n"); return 2; }
+        o.w = w; o.h = h;
+        break;
+      }
+      case 'c': o.cover = true; break;
+      case 'q': o.quality = std::max(1, std::min(100, atoi(optarg))); break;
+      case '4': o.sub420 = false; break;
+      case 'F': o.force = true; break;
+      case 'G': o.globalOnly = true; break;
+      case 'n': o.dryRun = true; break;
+      default: usage(); return 2;
+    }
+  }
+  if (optind >= argc) { usage(); return 2; }
+  struct stat st;
+  const bool outIsDir = !outArg.empty() && stat(outArg.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  const int inputs = argc - optind;
+  if (inputs > 1 && !outArg.empty() && !outIsDir) { fprintf(stderr, "tdasset: -o must be a directory for several inputs\n"); return 2; }
+
+  int rc = 0;
+  for (int i = optind; i < argc; ++i) {
+    const std::string in = argv[i];
+    std::vector<uint8_t> src;
+    if (!readFile(in, src)) { fprintf(stderr, "tdasset: can't read %s\n", in.c_str()); rc = 1; continue; }
+    const bool gif = src.size() >= 6 && memcmp(src.data(), "GIF8", 4) == 0;
+    const Format fmt = o.format != F_AUTO ? o.format : (gif ? F_GIF : F_JPG);
+    const std::string out = outputName(in, outArg, outIsDir, inputs, o, fmt);
+    const int r = gif ? convertGif(in, src, out, o, fmt) : convertJpg(in, src, out, o, fmt);
+    if (r) rc = r;
+  }
+  return rc;
+}
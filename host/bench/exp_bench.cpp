@@ -0,0 +1,77 @@
+// exp_bench.cpp
+//
+// Microbenchmarks for the expansion's HDD-key derivation in
+// "EXP Src/src/eeprom_min.cpp": RC4, HMAC-SHA1 and the whole
+// derive_hdd_key() search over the three EEPROM revisions. Built against the
+// expansion simulator's shims ("EXP Src/sim/shim"), which clash with the
+// display shims, hence a separate executable from td_bench.
+//
+// HMAC-SHA1 here is the simulator's portable SHA-1, not mbedTLS on the
+// ESP32-S3, so compare it across commits, not against the device.
+
+#include <benchmark/benchmark.h>
+#include "eeprom_min.cpp"
+
+volatile bool g_smbus_locked = false;   // xbox_smbus_poll.cpp on the device
+void sim_udp_capture(uint16_t, const uint8_t*, size_t) {}
+
+// An EEPROM image for one revision key, built the way the factory section is
+// laid out (same recipe as sim/smbus_bench.cpp)
+static void make_rom(const uint8_t verKey[16], uint8_t seed, uint8_t rom[256]) {
+  using namespace XboxEEPROM;
+  for (int i = 0; i < 256; ++i) rom[i] = (uint8_t)(i * 7 + seed);
+  uint8_t plain[LEN_FACTORY] = {0};
+  for (int i = 0; i < 24; ++i) plain[i] = (uint8_t)(0x31 * (i + 1) + seed);
+  uint8_t chk[20], rc4key[20];
+  hmac_sha1(verKey, 16, plain, sizeof(plain), chk);
+  hmac_sha1(verKey, 16, chk, sizeof(chk), rc4key);
+  rc4_state st;
+  rc4_init(&st, rc4key, sizeof(rc4key));
+  rc4_crypt(&st, plain, sizeof(plain));
+  memcpy(&rom[OFF_CHECKSUM], chk, LEN_CHECKSUM);
+  memcpy(&rom[OFF_FACTORY], plain, LEN_FACTORY);
+}
+
+static void BM_Rc4(benchmark::State& st) {
+  using namespace XboxEEPROM;
+  uint8_t key[20], buf[LEN_FACTORY];
+  for (int i = 0; i < 20; ++i) key[i] = (uint8_t)(i * 13 + 5);
+  memset(buf, 0xA5, sizeof(buf));
+  for (auto _ : st) {
+    rc4_state s;
+    rc4_init(&s, key, sizeof(key));
+    rc4_crypt(&s, buf, sizeof(buf));
+    benchmark::DoNotOptimize(buf);
+  }
+}
+BENCHMARK(BM_Rc4);
+
+static void BM_HmacSha1(benchmark::State& st) {
+  using namespace XboxEEPROM;
+  uint8_t msg[LEN_FACTORY], out[20];
+  for (int i = 0; i < (int)sizeof(msg); ++i) msg[i] = (uint8_t)i;
+  for (auto _ : st) {
+    hmac_sha1(EEPROM_KEY_V10, 16, msg, sizeof(msg), out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_HmacSha1);
+
+// Arg = revision: the search tries v1.0, v1.1-1.4, v1.6 in turn, so v1.6 is
+// the worst case
+static void BM_DeriveHddKey(benchmark::State& st) {
+  using namespace XboxEEPROM;
+  const uint8_t* keys[3] = { EEPROM_KEY_V10, EEPROM_KEY_V11_14, EEPROM_KEY_V16 };
+  uint8_t rom[256];
+  make_rom(keys[st.range(0)], (uint8_t)(0x11 * (st.range(0) + 1)), rom);
+  char hex[33];
+  for (auto _ : st) {
+    bool ok = derive_hdd_key(rom, hex);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(hex);
+  }
+  if (!derive_hdd_key(rom, hex)) st.SkipWithError("HDD key not recovered");
+}
+BENCHMARK(BM_DeriveHddKey)->ArgName("rev")->Arg(0)->Arg(1)->Arg(2);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,442 @@
+// td_bench.cpp
+//
+// Microbenchmarks for the display firmware's hot paths, compiled from src/
+// against the host shims:
+// - base64_decode, formatResolution and the 50505/50506 parsers in
+//   udp_detect.cpp (included here so the file-local statics are reachable)
+// - the GIF palette line expansion in ImageDisplay::gifDraw()
+// - a Ken Burns frame: the pan-and-zoom resample of a decoded still
+//   (src/kenburns.cpp)
+// - screen-cast reassembly in cast_rx.cpp (also included) with every slot
+//   held by an unfinished frame, which a new frame has to take over cleanly
+// - JPEG decode of the reference images through LGFX drawJpg (TJpgDec), when
+//   LovyanGFX is available (TD_BENCH_JPEG)
+// - the same images as QOI (src/qoi_dec.cpp) and raw RGB565, the gallery's
+//   zero-decode formats, when libjpeg is available to convert them
+//   (TD_BENCH_STILLS); jpeg_dec on them, and its rejection of a corrupt
+//   Huffman table
+//
+// Results use Google Benchmark's reporters, so --benchmark_format=json or
+// --benchmark_out=FILE give machine-readable output for comparing commits.
+
+#include <benchmark/benchmark.h>
+#include "udp_detect.cpp"
+#include "cast_rx.cpp"
+#include "kenburns.h"
+#include <dirent.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// The capture hook in udp_detect.cpp; nothing to record here
+void UDPCapture::record(uint16_t, const IPAddress&, const void*, size_t) {}
+bool UDPCapture::active() { return false; }
+
+// ---------- fixtures ----------
+// A 256-byte EEPROM image, as the expansion sends it
+static std::string eeprom_b64() {
+  static const char* A = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint8_t rom[256];
+  for (int i = 0; i < 256; ++i) rom[i] = (uint8_t)(i * 7 + 0x11);
+  std::string s;
+  for (int i = 0; i < 256; i += 3) {
+    uint32_t b = (uint32_t)rom[i] << 16;
+    if (i + 1 < 256) b |= (uint32_t)rom[i + 1] << 8;
+    if (i + 2 < 256) b |= rom[i + 2];
+    s += A[(b >> 18) & 63];
+    s += A[(b >> 12) & 63];
+    s += (i + 1 < 256) ? A[(b >> 6) & 63] : '=';
+    s += (i + 2 < 256) ? A[b & 63] : '=';
+  }
+  return s;
+}
+
+static const std::string kRaw = eeprom_b64();
+static const std::string kEELabelled =
+  "EE:SN=207384923405|MAC=00:50:F2:12:34:11|REG=NTSC-U|HDD=8A3F1C0D9E6B2A47C5D18F0E3B7A6C92|RAW=" + kRaw;
+static const std::string kEERaw = "EE:RAW=" + kRaw;
+static const char* kApp = "APP:Halo 2|TID:4D530064";
+static const char* kExpAscii = "APP=Dashboard;RES=720x480;ENCODER=0x45;AV=6;PIC=1;XBOXVER=1;TRAY=0";
+
+// ---------- udp_detect.cpp ----------
+static void BM_Base64Decode(benchmark::State& st) {
+  uint8_t out[256];
+  for (auto _ : st) {
+    int n = base64_decode(kRaw.c_str(), out, (int)sizeof(out));
+    benchmark::DoNotOptimize(n);
+    benchmark::DoNotOptimize(out);
+  }
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)kRaw.size());
+}
+BENCHMARK(BM_Base64Decode);
+
+static void BM_FormatResolution(benchmark::State& st) {
+  // 480i composite, 480p component, 576i SCART, 720p, 1080i, fallback
+  static const int modes[][3] = {
+    { 640, 480, 0x06 }, { 720, 480, 0x01 }, { 720, 576, 0x00 },
+    { 1280, 720, 0x01 }, { 1920, 1080, 0x01 }, { 800, 600, 0x02 },
+  };
+  char out[sizeof(lastStatus.resolution)];
+  for (auto _ : st) {
+    for (auto& m : modes) {
+      formatResolution(m[0], m[1], m[2], out, sizeof(out));
+      benchmark::DoNotOptimize(out);
+    }
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * (int64_t)(sizeof(modes) / sizeof(modes[0])));
+}
+BENCHMARK(BM_FormatResolution);
+
+static void BM_ParseExpansionAscii(benchmark::State& st) {
+  const size_t n = strlen(kExpAscii);
+  char buf[256];
+  for (auto _ : st) {
+    memcpy(buf, kExpAscii, n);   // the parser tokenises in place
+    parseExpansionAscii(buf, (int)n);
+    benchmark::DoNotOptimize(lastStatus);
+  }
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)n);
+}
+BENCHMARK(BM_ParseExpansionAscii);
+
+static void BM_ParseExpansionBinary(benchmark::State& st) {
+  const ExpPacket ep = { 0, 0x06, 1, 1, 720, 480, 0x45 };
+  for (auto _ : st) {
+    parseExpansionBinary((const uint8_t*)&ep, (int)sizeof(ep));
+    benchmark::DoNotOptimize(lastStatus);
+  }
+}
+BENCHMARK(BM_ParseExpansionBinary);
+
+static void BM_ParseEE(benchmark::State& st, const std::string& line) {
+  for (auto _ : st) {
+    parseEE_line(line.c_str());
+    benchmark::DoNotOptimize(lastStatus);
+  }
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)line.size());
+}
+BENCHMARK_CAPTURE(BM_ParseEE, labelled, kEELabelled);
+BENCHMARK_CAPTURE(BM_ParseEE, raw, kEERaw);
+BENCHMARK_CAPTURE(BM_ParseEE, app, std::string(kApp));
+
+// ---------- ImageDisplay::gifDraw ----------
+// The per-line loop from gifDraw(): 8-bit indices through the RGB565 palette
+// into the line buffer that goes to pushImage(). Arg = line width.
+static void BM_GifLineExpand(benchmark::State& st) {
+  const int width = (int)st.range(0);
+  uint16_t palette[256];
+  uint8_t pixels[480];
+  static uint16_t lineBuffer[480];
+  for (int i = 0; i < 256; ++i) palette[i] = (uint16_t)(i * 0x0841);
+  uint32_t r = 1;
+  for (int i = 0; i < 480; ++i) { r = r * 1103515245u + 12345u; pixels[i] = (uint8_t)(r >> 16); }
+
+  for (auto _ : st) {
+    for (int x = 0; x < width; x++) {
+      lineBuffer[x] = palette[pixels[x]];
+    }
+    benchmark::DoNotOptimize(lineBuffer);
+    benchmark::ClobberMemory();
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * width);   // pixels
+}
+BENCHMARK(BM_GifLineExpand)->Arg(240)->Arg(480);
+
+// ---------- Ken Burns ----------
+// One 480x480 frame from a 960x720 canvas halfway through a slide, in the
+// STILL_ROWS strips ImageDisplay pushes. Arg = 1 bilinear, 0 nearest.
+static void BM_KenBurnsFrame(benchmark::State& st) {
+  const int w = 960, h = 720;
+  std::vector<uint16_t> canvas((size_t)w * h);
+  uint32_t r = 1;
+  for (auto& p : canvas) { r = r * 1103515245u + 12345u; p = (uint16_t)(r >> 16); }
+  static uint16_t strip[480 * 16];
+  const kb::View v = kb::plan(w, h, 130, 7).at(0.5f, 480);
+
+  for (auto _ : st) {
+    for (int y = 0; y < 480; y += 16) {
+      kb::render(canvas.data(), w, h, v, 480, y, 16, strip, st.range(0) != 0);
+      benchmark::DoNotOptimize(strip);
+    }
+    benchmark::ClobberMemory();
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * 480 * 480);   // pixels
+}
+BENCHMARK(BM_KenBurnsFrame)->Arg(0)->Arg(1);
+
+// ---------- cast_rx.cpp ----------
+// What cast_rx.cpp calls in ImageDisplay; onFragment() is driven directly
+bool ImageDisplay::drawCastFrame(const uint8_t*, size_t) { return true; }
+void ImageDisplay::setPaused(bool) {}
+void ImageDisplay::resume() {}
+
+static void castFragment(uint32_t frame, uint16_t index, uint16_t count, uint32_t size) {
+  uint8_t buf[sizeof(td_wire::CastFragment) + td_wire::kCastPayload];
+  td_wire::CastFragment h = {};
+  memcpy(h.magic, "TDV1", 4);
+  h.frame = frame;
+  h.captureUs = frame * 50000u;
+  h.size = size;
+  h.index = index;
+  h.count = count;
+  memcpy(buf, &h, sizeof(h));
+  const size_t off = (size_t)index * td_wire::kCastPayload;
+  const size_t n = std::min(td_wire::kCastPayload, (size_t)size - off);
+  memset(buf + sizeof(h), (int)(frame & 0xFF), n);   // every byte says which frame it came from
+  CastRx::onFragment(buf, sizeof(h) + n, sockaddr_in{});
+}
+
+// Lossy WiFi: each of CAST_SLOTS frames loses its last fragment, so every
+// slot is Filling when the next frame comes. That frame has to take the
+// oldest slot over with its own size and fragment map, and come out whole
+// and unmixed; it used to inherit the evicted frame's and never complete.
+// Times one such round: CAST_SLOTS incomplete frames and a complete one.
+static void BM_CastRxAllSlotsFilling(benchmark::State& st) {
+  const uint16_t count = 3;
+  const uint32_t size = 3 * td_wire::kCastPayload - 100;
+  for (CastRx::Frame& f : CastRx::s_slots)
+    if (!f.data) f.data = (uint8_t*)malloc(CAST_MAX_FRAME);
+  uint32_t frame = 0;
+  for (auto _ : st) {
+    for (CastRx::Frame& f : CastRx::s_slots) CastRx::freeSlot(f);
+    for (int i = 0; i < CAST_SLOTS; ++i) {
+      ++frame;
+      for (uint16_t k = 0; k + 1 < count; ++k) castFragment(frame, k, count, size);
+    }
+    ++frame;
+    for (uint16_t k = 0; k < count; ++k) castFragment(frame, k, count, size);
+
+    const CastRx::Frame* done = nullptr;
+    for (const CastRx::Frame& f : CastRx::s_slots)
+      if (f.state == CastRx::Slot::Ready) done = &f;
+    if (!done || done->frame != frame || done->size != size) {
+      st.SkipWithError("the new frame did not complete in an evicted slot");
+      return;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+      if (done->data[i] != (uint8_t)(frame & 0xFF)) {
+        st.SkipWithError("the completed frame holds another frame's bytes");
+        return;
+      }
+    }
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * (CAST_SLOTS * (count - 1) + count));   // fragments
+}
+BENCHMARK(BM_CastRxAllSlotsFilling);
+
+// ---------- reference images ----------
+#if defined(TD_BENCH_JPEG) || defined(TD_BENCH_STILLS)
+static std::vector<uint8_t> read_file(const std::string& path) {
+  std::vector<uint8_t> v;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return v;
+  fseek(f, 0, SEEK_END);
+  v.resize((size_t)ftell(f));
+  fseek(f, 0, SEEK_SET);
+  if (fread(v.data(), 1, v.size(), f) != v.size()) v.clear();
+  fclose(f);
+  return v;
+}
+
+// The .jpg files in dir, sorted
+static std::vector<std::string> list_jpgs(const std::string& dir) {
+  std::vector<std::string> names;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return names;
+  while (dirent* e = readdir(d)) {
+    std::string n = e->d_name;
+    if (n.size() > 4 && (n.compare(n.size() - 4, 4, ".jpg") == 0 || n.compare(n.size() - 4, 4, ".JPG") == 0))
+      names.push_back(n);
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+#endif
+
+// ---------- JPEG decode (LGFX drawJpg -> TJpgDec) ----------
+#if defined(TD_BENCH_JPEG)
+#include "disp_cfg.h"
+
+// As in ImageDisplay: the whole file is in RAM, then drawJpg at 0,0
+static void BM_JpegDecode(benchmark::State& st, std::vector<uint8_t> jpg) {
+  static LGFX* tft = nullptr;
+  if (!tft) { tft = new LGFX(); tft->begin(); }
+  for (auto _ : st) {
+    tft->drawJpg(jpg.data(), jpg.size(), 0, 0);
+    benchmark::ClobberMemory();
+  }
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)jpg.size());
+}
+
+static void register_jpegs(const std::string& dir) {
+  const std::string base = dir.substr(dir.find_last_of('/') + 1);
+  for (auto& n : list_jpgs(dir)) {
+    std::vector<uint8_t> jpg = read_file(dir + "/" + n);
+    if (jpg.empty()) continue;
+    benchmark::RegisterBenchmark(("BM_JpegDecode/" + base + "/" + n).c_str(), BM_JpegDecode, jpg);
+  }
+}
+#endif
+
+// ---------- QOI and raw RGB565 stills ----------
+// The reference JPGs converted at their own size, drawn the way ImageDisplay
+// draws .qoi and .565: a 16-row block buffer, copied into a 480x480 RGB565
+// frame where pushImage() would write to the panel.
+#if defined(TD_BENCH_STILLS)
+#include "jpeg_io.h"
+#include "qoi_enc.h"
+#include "qoi_dec.h"
+#include "jpeg_dec.h"
+#include "jpeg_kernels.h"
+#include <thread>
+
+static uint16_t s_frame[480 * 480];
+static uint16_t s_block[480 * 16];
+static uint16_t s_block2[480 * 16];
+
+struct StillPos { int x, y, w; };
+
+static void push_strip(int y, int rows, const uint16_t* px, void* user) {
+  const StillPos* p = static_cast<const StillPos*>(user);
+  for (int r = 0; r < rows; ++r)
+    memcpy(&s_frame[(size_t)(p->y + y + r) * 480 + p->x], px + (size_t)r * p->w, (size_t)p->w * 2);
+}
+
+static void BM_QoiDecode(benchmark::State& st, std::vector<uint8_t> qoi, int w, int h) {
+  StillPos pos{ (480 - w) / 2, (480 - h) / 2, w };
+  for (auto _ : st) {
+    qoi::decode(qoi.data(), qoi.size(), s_block, 480 * 16 / w, push_strip, &pos);
+    benchmark::ClobberMemory();
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * w * h);   // pixels
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)qoi.size());
+}
+
+// raw holds the file's pixel rows; the first copy stands in for File::read()
+static void BM_Raw565(benchmark::State& st, std::vector<uint8_t> raw, int w, int h) {
+  StillPos pos{ (480 - w) / 2, (480 - h) / 2, w };
+  const int rowsPer = 480 * 16 / w;
+  for (auto _ : st) {
+    for (int y = 0; y < h; y += rowsPer) {
+      const int rows = std::min(rowsPer, h - y);
+      memcpy(s_block, &raw[(size_t)y * w * 2], (size_t)rows * w * 2);
+      push_strip(y, rows, s_block, &pos);
+    }
+    benchmark::ClobberMemory();
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * w * h);
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)raw.size());
+}
+
+// jpeg_dec (../../src/jpeg_dec.cpp) on the same file with restart markers
+// added: one band, or two with the second on another thread as the display
+// runs it on its other core. Two bands only gain on a multi-core host. The
+// second argument picks the kernels: 0 scalar reference, 1 fast. The fast
+// run first checks that its frame matches the reference's pixel for pixel.
+static void BM_JpegBands(benchmark::State& st, std::vector<uint8_t> jpg) {
+  jpeg::Image img;
+  if (!img.parse(jpg.data(), jpg.size())) { st.SkipWithError(img.error()); return; }
+  const jpeg::Info& in = img.info();
+  StillPos pos{ 0, 0, in.width };
+  if (st.range(1)) {
+    img.setKernels(jpeg::scalarKernels());
+    img.decodeRows(0, in.mcuRows, s_block, push_strip, &pos);
+    std::vector<uint16_t> ref(s_frame, s_frame + 480 * 480);
+    img.setKernels(jpeg::fastKernels());
+    img.decodeRows(0, in.mcuRows, s_block, push_strip, &pos);
+    if (!std::equal(ref.begin(), ref.end(), s_frame)) { st.SkipWithError("fast kernels differ from scalar"); return; }
+  } else {
+    img.setKernels(jpeg::scalarKernels());
+  }
+  const int split = st.range(0) > 1 ? img.splitRow(1, 2) : 0;
+  for (auto _ : st) {
+    if (split) {
+      std::thread t([&] { img.decodeRows(split, in.mcuRows, s_block2, push_strip, &pos); });
+      img.decodeRows(0, split, s_block, push_strip, &pos);
+      t.join();
+    } else {
+      img.decodeRows(0, in.mcuRows, s_block, push_strip, &pos);
+    }
+    benchmark::ClobberMemory();
+  }
+  st.SetItemsProcessed((int64_t)st.iterations() * in.width * in.height);
+  st.SetBytesProcessed((int64_t)st.iterations() * (int64_t)jpg.size());
+}
+
+// Regression case for a corrupt DHT: every table's codes are moved to length
+// 1, so each is over-subscribed from its third code on. parse() must turn the
+// file down before the Huffman fast table is filled (it used to write past
+// it); build with -fsanitize=address to catch a relapse. Times the rejection.
+static void BM_JpegCorruptDht(benchmark::State& st, std::vector<uint8_t> jpg) {
+  int tables = 0;
+  for (size_t p = 2; p + 4 <= jpg.size() && jpg[p] == 0xFF && jpg[p + 1] != 0xDA;) {
+    const size_t seg = ((size_t)jpg[p + 2] << 8) | jpg[p + 3];
+    if (jpg[p + 1] == 0xC4) {
+      for (size_t q = p + 4; q + 17 <= p + 2 + seg;) {
+        int total = 0;
+        for (int i = 0; i < 16; ++i) total += jpg[q + 1 + i];
+        if (total > 2 && total < 256) {
+          memset(&jpg[q + 1], 0, 16);
+          jpg[q + 1] = (uint8_t)total;
+          tables++;
+        }
+        q += 17 + total;
+      }
+    }
+    p += 2 + seg;
+  }
+  if (!tables) { st.SkipWithError("no DHT to corrupt"); return; }
+  jpeg::Image img;
+  for (auto _ : st) {
+    if (img.parse(jpg.data(), jpg.size())) { st.SkipWithError("corrupt DHT accepted"); return; }
+    benchmark::ClobberMemory();
+  }
+}
+
+static void register_stills(const std::string& dir) {
+  const std::string base = dir.substr(dir.find_last_of('/') + 1);
+  for (auto& n : list_jpgs(dir)) {
+    std::vector<uint8_t> jpg = read_file(dir + "/" + n);
+    media::Image img;
+    if (jpg.empty() || !media::jpegDecode(jpg.data(), jpg.size(), img) || img.w > 480 || img.h > 480) continue;
+    std::vector<uint8_t> qoi, raw;
+    media::qoiEncode(img, qoi);
+    for (size_t i = 0; i < (size_t)img.w * img.h; ++i) {
+      const uint16_t c = media::rgb565(img.rgb[i * 3], img.rgb[i * 3 + 1], img.rgb[i * 3 + 2]);
+      raw.push_back((uint8_t)(c >> 8));
+      raw.push_back((uint8_t)c);
+    }
+    benchmark::RegisterBenchmark(("BM_QoiDecode/" + base + "/" + n).c_str(), BM_QoiDecode, qoi, img.w, img.h);
+    benchmark::RegisterBenchmark(("BM_Raw565/" + base + "/" + n).c_str(), BM_Raw565, raw, img.w, img.h);
+    std::vector<uint8_t> rst;
+    if (media::jpegAddRestarts(jpg.data(), jpg.size(), rst))
+      benchmark::RegisterBenchmark(("BM_JpegBands/" + base + "/" + n).c_str(), BM_JpegBands, rst)
+          ->ArgsProduct({ { 1, 2 }, { 0, 1 } });
+    benchmark::RegisterBenchmark(("BM_JpegCorruptDht/" + base + "/" + n).c_str(), BM_JpegCorruptDht, jpg);
+  }
+}
+#endif
+
+int main(int argc, char** argv) {
+  Serial.enabled = false;   // the parsers log every frame; measure the parse only
+#if defined(TD_BENCH_JPEG) || defined(TD_BENCH_STILLS)
+  // Reference images: the gallery samples and the overlay icons
+  const char* root = getenv("TD_BENCH_FFAT");
+  const std::string ffat = root ? root : TD_BENCH_FFAT_DEFAULT;
+#endif
+#if defined(TD_BENCH_JPEG)
+  register_jpegs(ffat + "/jpg");
+  register_jpegs(ffat + "/resource");
+#endif
+#if defined(TD_BENCH_STILLS)
+  register_stills(ffat + "/jpg");
+  register_stills(ffat + "/resource");
+#endif
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
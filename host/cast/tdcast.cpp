@@ -0,0 +1,356 @@
+// tdcast.cpp
+//
+// Screen-cast sender for the display (../../src/cast_rx.h). Sends JPEG
+// frames over UDP (td_wire.h CastFragment) at a fixed rate and reports what
+// the display says it showed.
+// - Frames come from an MJPEG file (JPEGs back to back, as ffmpeg -f mjpeg
+//   writes them), from JPEG files, or with -x from the X11 screen.
+// - A frame that isn't a baseline JPEG of at most 480x480 is decoded, fitted
+//   to 480x480 and encoded again at -q quality, lower if it won't fit a
+//   display frame slot (-m).
+// - Fragments are spaced -G us apart: a whole frame at once overflows the
+//   ESP32's UDP receive queue.
+// - The display acks every frame it draws. Capture to ack is the end-to-end
+//   latency, plus the ack's trip back (about a millisecond on a LAN). It is
+//   printed every second and sent on in later frames for /diag.
+
+#include "image.h"
+#include "jpeg_io.h"
+#include "td_wire.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#ifdef TDCAST_X11
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#endif
+
+#define CAST_PANEL 480
+
+using Bytes = std::vector<uint8_t>;
+
+struct Options {
+  double fps = 15;
+  int quality = 75;
+  size_t maxBytes = 96 * 1024;   // CAST_MAX_FRAME on the display
+  int gapUs = 150;
+  bool loop = false;
+  bool x11 = false;
+  int gx = 0, gy = 0, gw = 0, gh = 0;   // capture area, 0x0 = whole screen
+  uint16_t port = td_wire::kPortCast;
+};
+
+static volatile sig_atomic_t s_stop = 0;
+static void on_signal(int) { s_stop = 1; }
+
+static int64_t now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool readFile(const std::string& path, Bytes& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  out.clear();
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  const bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+// Length of the JPEG at p (SOI to EOI), 0 if there isn't a whole one. Walks
+// the marker segments so a thumbnail's EOI inside APP1 doesn't end it.
+static size_t jpegLength(const uint8_t* p, size_t n) {
+  if (n < 4 || p[0] != 0xFF || p[1] != 0xD8) return 0;
+  size_t i = 2;
+  while (i + 1 < n) {
+    if (p[i] != 0xFF) return 0;
+    const uint8_t m = p[i + 1];
+    if (m == 0xFF) { i++; continue; }   // fill byte
+    if (m == 0xD9) return i + 2;
+    if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) { i += 2; continue; }
+    if (i + 3 >= n) return 0;
+    i += 2 + ((p[i + 2] << 8) | p[i + 3]);
+    if (m != 0xDA) continue;
+    // Entropy-coded data runs to the next marker that isn't stuffing or RSTn
+    while (i + 1 < n && !(p[i] == 0xFF && p[i + 1] != 0 && !(p[i + 1] >= 0xD0 && p[i + 1] <= 0xD7))) i++;
+  }
+  return 0;
+}
+
+static bool encodeFit(const media::Image& img, const Options& o, Bytes& out) {
+  const media::Image fitted = media::fit(img, CAST_PANEL, CAST_PANEL);
+  for (int q = o.quality; q >= 20; q -= 10) {
+    if (!media::jpegEncode(fitted, q, out)) return false;
+    if (out.size() <= o.maxBytes) return true;
+  }
+  return false;
+}
+
+// Passes a JPEG the display can draw as it is; anything else is re-encoded
+static bool prepare(const uint8_t* data, size_t len, const Options& o, Bytes& out) {
+  media::JpegInfo info;
+  if (media::jpegProbe(data, len, info) && !info.progressive && !info.arithmetic &&
+      info.w <= CAST_PANEL && info.h <= CAST_PANEL && len <= o.maxBytes) {
+    out.assign(data, data + len);
+    return true;
+  }
+  media::Image img;
+  return media::jpegDecode(data, len, img) && encodeFit(img, o, out);
+}
+
+static bool loadFrames(const std::string& path, const Options& o, std::vector<Bytes>& frames) {
+  Bytes file;
+  if (!readFile(path, file)) {
+    fprintf(stderr, "[tdcast] %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  size_t off = 0, found = 0;
+  while (off < file.size()) {
+    const size_t len = jpegLength(file.data() + off, file.size() - off);
+    if (!len) break;
+    Bytes f;
+    if (prepare(file.data() + off, len, o, f)) frames.push_back(std::move(f));
+    else fprintf(stderr, "[tdcast] %s: frame %zu unusable, skipped\n", path.c_str(), found);
+    off += len;
+    found++;
+    while (off < file.size() && file[off] != 0xFF) off++;   // junk between frames
+  }
+  if (!found) fprintf(stderr, "[tdcast] %s: no JPEG frames\n", path.c_str());
+  return found > 0;
+}
+
+#ifdef TDCAST_X11
+struct X11Grab {
+  Display* dpy = nullptr;
+  Window root = 0;
+  int x = 0, y = 0, w = 0, h = 0;
+
+  bool open(const Options& o) {
+    dpy = XOpenDisplay(nullptr);
+    if (!dpy) return false;
+    root = DefaultRootWindow(dpy);
+    XWindowAttributes a;
+    XGetWindowAttributes(dpy, root, &a);
+    x = o.gx;
+    y = o.gy;
+    w = o.gw ? o.gw : a.width - x;
+    h = o.gh ? o.gh : a.height - y;
+    return w > 0 && h > 0;
+  }
+
+  static int shiftOf(unsigned long mask) {
+    int s = 0;
+    while (mask && !(mask & 1)) { mask >>= 1; s++; }
+    return s;
+  }
+
+  bool grab(media::Image& out) {
+    XImage* xi = XGetImage(dpy, root, x, y, w, h, AllPlanes, ZPixmap);
+    if (!xi) return false;
+    const bool ok = xi->bits_per_pixel == 32;
+    if (ok) {
+      out = media::Image(w, h);
+      const int rs = shiftOf(xi->red_mask), gs = shiftOf(xi->green_mask), bs = shiftOf(xi->blue_mask);
+      for (int j = 0; j < h; ++j) {
+        const uint32_t* row = (const uint32_t*)(xi->data + (size_t)j * xi->bytes_per_line);
+        for (int i = 0; i < w; ++i) {
+          uint8_t* px = out.px(i, j);
+          px[0] = (uint8_t)((row[i] & xi->red_mask) >> rs);
+          px[1] = (uint8_t)((row[i] & xi->green_mask) >> gs);
+          px[2] = (uint8_t)((row[i] & xi->blue_mask) >> bs);
+        }
+      }
+    }
+    XDestroyImage(xi);
+    return ok;
+  }
+};
+#endif
+
+struct Counters {
+  uint32_t sent = 0, acked = 0;
+  uint64_t bytes = 0, e2eTotal = 0, displayTotal = 0;
+  uint32_t e2eMax = 0;
+};
+
+static void sendFrame(int fd, const sockaddr_in& to, uint32_t frame, uint32_t captureUs, uint32_t e2eUs,
+                      const Bytes& jpg, int gapUs) {
+  td_wire::CastFragment h;
+  memcpy(h.magic, "TDV1", 4);
+  h.frame = frame;
+  h.captureUs = captureUs;
+  h.size = (uint32_t)jpg.size();
+  h.count = (uint16_t)((jpg.size() + td_wire::kCastPayload - 1) / td_wire::kCastPayload);
+  h.e2eUs = e2eUs;
+  uint8_t pkt[sizeof(h) + td_wire::kCastPayload];
+  for (uint16_t i = 0; i < h.count; ++i) {
+    h.index = i;
+    const size_t off = (size_t)i * td_wire::kCastPayload;
+    const size_t n = std::min(td_wire::kCastPayload, jpg.size() - off);
+    memcpy(pkt, &h, sizeof(h));
+    memcpy(pkt + sizeof(h), jpg.data() + off, n);
+    sendto(fd, pkt, sizeof(h) + n, 0, (const sockaddr*)&to, sizeof(to));
+    if (gapUs && i + 1 < h.count) usleep(gapUs);
+  }
+}
+
+// Reads acks until `until` (monotonic us)
+static void readAcks(int fd, int64_t until, Counters& c, uint32_t& lastE2e) {
+  for (;;) {
+    const int64_t wait = until - now_us();
+    struct pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, wait > 0 ? (int)((wait + 999) / 1000) : 0) <= 0) return;
+    td_wire::CastAck a;
+    const ssize_t n = recv(fd, &a, sizeof(a), MSG_DONTWAIT);
+    if (n != (ssize_t)sizeof(a) || memcmp(a.magic, "TDVA", 4) != 0) continue;
+    const uint32_t e2e = (uint32_t)now_us() - a.captureUs;
+    lastE2e = e2e;
+    c.acked++;
+    c.e2eTotal += e2e;
+    c.displayTotal += a.displayUs;
+    if (e2e > c.e2eMax) c.e2eMax = e2e;
+  }
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdcast [-r FPS] [-q QUALITY] [-m MAX_KB] [-G GAP_US] [-l] [-p PORT] DISPLAY_IP FILE...\n"
+#ifdef TDCAST_X11
+          "       tdcast -x [-g WxH+X+Y] [-r FPS] [-q QUALITY] ... DISPLAY_IP\n"
+#endif
+          "  FILE  MJPEG stream or JPEG files, sent in order\n"
+          "  -r  frames per second (default 15)\n"
+          "  -q  JPEG quality for frames that need encoding (default 75)\n"
+          "  -m  largest frame the display takes, KB (default 96)\n"
+          "  -G  gap between fragments, us (default 150)\n"
+          "  -l  loop the files until interrupted\n"
+#ifdef TDCAST_X11
+          "  -x  capture the X11 screen ($DISPLAY); -g picks an area\n"
+#endif
+          "  -p  display's cast port (default %u)\n", td_wire::kPortCast);
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:q:m:G:lxg:p:h")) != -1) {
+    switch (opt) {
+      case 'r': o.fps = atof(optarg) > 0 ? atof(optarg) : 1; break;
+      case 'q': o.quality = atoi(optarg); break;
+      case 'm': o.maxBytes = (size_t)atoi(optarg) * 1024; break;
+      case 'G': o.gapUs = atoi(optarg); break;
+      case 'l': o.loop = true; break;
+      case 'x': o.x11 = true; break;
+      case 'g':
+        if (sscanf(optarg, "%dx%d+%d+%d", &o.gw, &o.gh, &o.gx, &o.gy) < 2) { usage(); return 2; }
+        break;
+      case 'p': o.port = (uint16_t)atoi(optarg); break;
+      default: usage(); return 2;
+    }
+  }
+  if (optind >= argc || (!o.x11 && optind + 1 >= argc)) { usage(); return 2; }
+
+  sockaddr_in to {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(o.port);
+  if (inet_pton(AF_INET, argv[optind], &to.sin_addr) != 1) {
+    fprintf(stderr, "[tdcast] bad address %s\n", argv[optind]);
+    return 2;
+  }
+
+  std::vector<Bytes> frames;
+#ifdef TDCAST_X11
+  X11Grab x11;
+  if (o.x11 && !x11.open(o)) {
+    fprintf(stderr, "[tdcast] cannot open the X11 display\n");
+    return 1;
+  }
+#else
+  if (o.x11) {
+    fprintf(stderr, "[tdcast] built without X11\n");
+    return 2;
+  }
+#endif
+  if (!o.x11) {
+    for (int i = optind + 1; i < argc; ++i) loadFrames(argv[i], o, frames);
+    if (frames.empty()) return 1;
+  }
+
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    fprintf(stderr, "[tdcast] socket: %s\n", strerror(errno));
+    return 1;
+  }
+  struct sigaction sa {};
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  printf("[tdcast] casting %s to %s:%u at %.1f fps\n",
+         o.x11 ? "the screen" : (std::to_string(frames.size()) + " frames").c_str(), argv[optind], o.port, o.fps);
+  fflush(stdout);
+
+  const int64_t interval = (int64_t)(1e6 / o.fps);
+  int64_t next = now_us(), reportAt = next + 1000000;
+  uint32_t frameNo = 0, lastE2e = 0;
+  size_t pos = 0;
+  Counters c, all;
+  Bytes jpg;
+  while (!s_stop) {
+    const uint32_t captureUs = (uint32_t)now_us();
+#ifdef TDCAST_X11
+    if (o.x11) {
+      media::Image img;
+      if (!x11.grab(img) || !encodeFit(img, o, jpg)) {
+        fprintf(stderr, "[tdcast] capture failed (needs a 24/32-bit X11 screen)\n");
+        break;
+      }
+    }
+#endif
+    const Bytes& f = o.x11 ? jpg : frames[pos];
+    sendFrame(fd, to, frameNo++, captureUs, lastE2e, f, o.gapUs);
+    c.sent++;
+    c.bytes += f.size();
+
+    next += interval;
+    if (next < now_us()) next = now_us();   // can't keep up; don't burst to catch up
+    readAcks(fd, next, c, lastE2e);
+
+    if (now_us() >= reportAt) {
+      printf("[tdcast] sent %u fps (%.0f KB/s), shown %u fps, end to end %.1f ms avg / %.1f ms worst, on display %.1f ms\n",
+             c.sent, c.bytes / 1024.0, c.acked, c.acked ? c.e2eTotal / 1000.0 / c.acked : 0.0, c.e2eMax / 1000.0,
+             c.acked ? c.displayTotal / 1000.0 / c.acked : 0.0);
+      fflush(stdout);
+      all.sent += c.sent;
+      all.acked += c.acked;
+      c = Counters();
+      reportAt += 1000000;
+    }
+
+    if (!o.x11 && ++pos == frames.size()) {
+      if (!o.loop) break;
+      pos = 0;
+    }
+  }
+  readAcks(fd, now_us() + 500000, c, lastE2e);   // stragglers
+  all.sent += c.sent;
+  all.acked += c.acked;
+  printf("[tdcast] %u frames sent, %u shown\n", all.sent, all.acked);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// tcap.cpp
+#include "tcap.h"
+#include <string.h>
+
+namespace tcap {
+
+bool Writer::open(const std::string& path, uint8_t source, uint64_t startUnixMs) {
+  close();
+  f_ = fopen(path.c_str(), "a+b");
+  if (!f_) return false;
+  fseek(f_, 0, SEEK_END);
+  if (ftell(f_) == 0) {
+    td_wire::CaptureHeader h = {};
+    memcpy(h.magic, "TDC1", 4);
+    h.version = 1;
+    h.source = source;
+    h.startUnixMs = startUnixMs;
+    if (fwrite(&h, sizeof(h), 1, f_) != 1) { close(); return false; }
+    startMs_ = startUnixMs;
+  } else {
+    // Appending: keep the existing time base
+    td_wire::CaptureHeader h;
+    fseek(f_, 0, SEEK_SET);
+    if (fread(&h, sizeof(h), 1, f_) != 1 || memcmp(h.magic, "TDC1", 4) != 0) { close(); return false; }
+    startMs_ = h.startUnixMs;
+    fseek(f_, 0, SEEK_END);
+  }
+  return true;
+}
+
+bool Writer::write(uint64_t tUs, uint16_t port, const uint8_t src[4], const uint8_t* data, size_t len) {
+  if (!f_ || len > 0xFFFF) return false;
+  td_wire::CaptureRecord r;
+  r.tUs = tUs;
+  r.port = port;
+  r.len = (uint16_t)len;
+  memcpy(r.src, src, 4);
+  return fwrite(&r, sizeof(r), 1, f_) == 1 && fwrite(data, 1, len, f_) == len;
+}
+
+void Writer::close() {
+  if (f_) fclose(f_);
+  f_ = nullptr;
+}
+
+bool load(const std::string& path, td_wire::CaptureHeader& hdr, std::vector<Datagram>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, "TDC1", 4) != 0) {
+    fclose(f);
+    return false;
+  }
+  td_wire::CaptureRecord r;
+  while (fread(&r, sizeof(r), 1, f) == 1) {
+    Datagram d;
+    d.tUs = r.tUs;
+    d.port = r.port;
+    memcpy(d.src, r.src, 4);
+    d.data.resize(r.len);
+    if (r.len && fread(d.data.data(), 1, r.len, f) != r.len) break;
+    out.push_back(std::move(d));
+  }
+  fclose(f);
+  return true;
+}
+
+} // namespace tcap
@@ -0,0 +1,42 @@
+// tcap.h
+//
+// Capture files (.tdc): raw datagrams with receive time, port and sender, in
+// the layout of td_wire::CaptureHeader / CaptureRecord. Written by the display
+// (/capture) and by tdrecord -w; read by tdreplay.
+#pragma once
+#include "td_wire.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace tcap {
+
+struct Datagram {
+  uint64_t             tUs = 0;
+  uint16_t             port = 0;
+  uint8_t              src[4] = {0, 0, 0, 0};
+  std::vector<uint8_t> data;
+};
+
+class Writer {
+public:
+  ~Writer() { close(); }
+  // Appends to `path`; writes the header if the file is new
+  bool open(const std::string& path, uint8_t source, uint64_t startUnixMs);
+  bool write(uint64_t tUs, uint16_t port, const uint8_t src[4], const uint8_t* data, size_t len);
+  void flush() { if (f_) fflush(f_); }
+  void close();
+  bool isOpen() const { return f_ != nullptr; }
+  uint64_t startUnixMs() const { return startMs_; }
+
+private:
+  FILE*    f_ = nullptr;
+  uint64_t startMs_ = 0;
+};
+
+// Loads a whole capture. A torn last record is dropped. False if the file
+// is missing or not a capture.
+bool load(const std::string& path, td_wire::CaptureHeader& hdr, std::vector<Datagram>& out);
+
+} // namespace tcap
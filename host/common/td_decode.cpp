@@ -0,0 +1,171 @@
+// td_decode.cpp
+#include "td_decode.h"
+#include "td_wire.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+namespace td {
+
+static const char* const kNumNames[kNumCount] = {
+  "kind", "fan", "cpu", "amb", "tray", "av", "pic", "xboxver", "width", "height", "enc", "tid",
+};
+static const char* const kStrNames[kStrCount] = {
+  "app", "title", "serial", "mac", "region", "hdd",
+};
+
+const char* numName(uint8_t i) { return i < kNumCount ? kNumNames[i] : "?"; }
+const char* strName(uint8_t i) { return i < kStrCount ? kStrNames[i] : "?"; }
+
+const char* frameName(Frame f) {
+  switch (f) {
+    case Frame::Core:    return "core";
+    case Frame::Title:   return "title";
+    case Frame::ExpBin:  return "exp";
+    case Frame::ExpText: return "exp_txt";
+    case Frame::EE:      return "ee";
+    case Frame::AppTid:  return "app";
+    default:             return "?";
+  }
+}
+
+void State::reset() {
+  for (auto& v : num) v = -1;
+  num[Kind] = 0;
+  num[Cpu] = num[Amb] = -1000;
+  num[TitleId] = 0;
+  for (auto& s : str) s.clear();
+}
+
+// ---------- helpers ----------
+static std::string cstr(const char* p, size_t cap) {
+  return std::string(p, strnlen(p, cap));
+}
+
+static std::string text(const uint8_t* d, size_t n) {
+  std::string s((const char*)d, n);
+  while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == 0)) s.pop_back();
+  return s;
+}
+
+static std::string trim(std::string s) {
+  size_t a = 0, b = s.size();
+  while (a < b && isspace((unsigned char)s[a])) ++a;
+  while (b > a && isspace((unsigned char)s[b - 1])) --b;
+  return s.substr(a, b - a);
+}
+
+// ---------- decoders ----------
+static bool m_core(const uint8_t*, size_t n)    { return n == sizeof(td_wire::CorePacket); }
+static bool m_title(const uint8_t* d, size_t n) { return td_wire::isTitle(d, n); }
+static bool m_expbin(const uint8_t*, size_t n)  { return n == sizeof(td_wire::ExpPacket); }
+static bool m_exptxt(const uint8_t* d, size_t n) { return n > 0 && memchr(d, '=', n) != nullptr; }
+static bool m_ee(const uint8_t* d, size_t n)    { return n > 3 && !memcmp(d, "EE:", 3); }
+static bool m_app(const uint8_t* d, size_t n)   { return n > 4 && !memcmp(d, "APP:", 4); }
+
+static void a_core(const uint8_t* d, size_t, State& st) {
+  td_wire::CorePacket cp;
+  memcpy(&cp, d, sizeof(cp));
+  st.num[Fan] = cp.fanSpeed;
+  st.num[Cpu] = cp.cpuTemp;
+  st.num[Amb] = cp.ambientTemp;
+  st.str[App] = cstr(cp.currentApp, sizeof(cp.currentApp));
+}
+
+static void a_title(const uint8_t* d, size_t, State& st) {
+  td_wire::TitlePacket tp;
+  memcpy(&tp, d, sizeof(tp));
+  st.num[TitleId] = tp.titleId;
+  st.str[Title] = cstr(tp.name, sizeof(tp.name));
+}
+
+static void a_expbin(const uint8_t* d, size_t, State& st) {
+  td_wire::ExpPacket ep;
+  memcpy(&ep, d, sizeof(ep));
+  st.num[Tray]    = ep.trayState;
+  st.num[Av]      = ep.avPackState;
+  st.num[Pic]     = ep.picVersion;
+  st.num[XboxVer] = ep.xboxVersion;
+  st.num[Width]   = ep.videoWidth;
+  st.num[Height]  = ep.videoHeight;
+  st.num[Enc]     = ep.encoderType;
+}
+
+// Legacy "KEY=val;KEY=val" on 50505 (same keys UDPDetect accepts)
+static void a_exptxt(const uint8_t* d, size_t n, State& st) {
+  const std::string s = text(d, n);
+  size_t pos = 0;
+  while (pos <= s.size()) {
+    size_t end = s.find(';', pos);
+    if (end == std::string::npos) end = s.size();
+    const std::string tok = s.substr(pos, end - pos);
+    pos = end + 1;
+    const size_t eq = tok.find('=');
+    if (eq == std::string::npos) continue;
+    std::string key = trim(tok.substr(0, eq));
+    const std::string val = trim(tok.substr(eq + 1));
+    for (auto& c : key) c = (char)toupper((unsigned char)c);
+    const long v = strtol(val.c_str(), nullptr, 0);
+    if      (key == "APP") st.str[App] = val;
+    else if (key == "RES") { int w = 0, h = 0; if (sscanf(val.c_str(), "%dx%d", &w, &h) == 2) { st.num[Width] = w; st.num[Height] = h; } }
+    else if (key == "WIDTH")  st.num[Width] = v;
+    else if (key == "HEIGHT") st.num[Height] = v;
+    else if (key == "ENCODER") st.num[Enc] = v;
+    else if (key == "AV" || key == "AVPACK" || key == "AVSTATE") st.num[Av] = v;
+    else if (key == "PIC") st.num[Pic] = v;
+    else if (key == "XBOXVER" || key == "XBOXVERSION") st.num[XboxVer] = v;
+    else if (key == "TRAY") st.num[Tray] = v;
+  }
+}
+
+// EE:SN=..|MAC=..|REG=..|HDD=..|RAW=.. or EE:HDD=.. (EE:RAW= alone carries nothing we keep)
+static void a_ee(const uint8_t* d, size_t n, State& st) {
+  const std::string s = text(d, n);
+  char v[96];
+  if (td_wire::field(s.c_str(), "SN=",  v, sizeof(v))) st.str[Serial] = trim(v);
+  if (td_wire::field(s.c_str(), "MAC=", v, sizeof(v))) st.str[Mac]    = trim(v);
+  if (td_wire::field(s.c_str(), "REG=", v, sizeof(v))) st.str[Region] = trim(v);
+  if (td_wire::field(s.c_str(), "HDD=", v, sizeof(v))) st.str[HddKey] = trim(v);
+}
+
+// APP:<name>|TID:<hex> from the XBMC4Gamers service
+static void a_app(const uint8_t* d, size_t n, State& st) {
+  const std::string s = text(d, n);
+  const size_t bar = s.find('|');
+  const std::string name = trim(s.substr(4, bar == std::string::npos ? bar : bar - 4));
+  if (name.empty()) return;
+  st.str[Title] = name;
+  st.str[App] = name.substr(0, 31);
+  char v[16];
+  st.num[TitleId] = td_wire::field(s.c_str(), "TID:", v, sizeof(v)) ? (int64_t)strtoul(v, nullptr, 16) : 0;
+}
+
+struct Decoder {
+  uint16_t port;
+  Frame    frame;
+  bool   (*match)(const uint8_t*, size_t);
+  void   (*apply)(const uint8_t*, size_t, State&);
+};
+
+// First match wins, so binary sizes go before the text fallbacks
+static const Decoder kDecoders[] = {
+  { td_wire::kPortCore, Frame::Core,    m_core,   a_core   },
+  { td_wire::kPortCore, Frame::Title,   m_title,  a_title  },
+  { td_wire::kPortExp,  Frame::ExpBin,  m_expbin, a_expbin },
+  { td_wire::kPortExp,  Frame::ExpText, m_exptxt, a_exptxt },
+  { td_wire::kPortEE,   Frame::AppTid,  m_app,    a_app    },
+  { td_wire::kPortEE,   Frame::EE,      m_ee,     a_ee     },
+};
+
+Frame decode(uint16_t port, const uint8_t* data, size_t len, State& st) {
+  for (const Decoder& d : kDecoders) {
+    if (d.port != port || !d.match(data, len)) continue;
+    d.apply(data, len, st);
+    st.num[Kind] = (int64_t)d.frame;
+    return d.frame;
+  }
+  return Frame::Unknown;
+}
+
+} // namespace td
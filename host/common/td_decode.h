@@ -0,0 +1,46 @@
+// td_decode.h
+//
+// Host-side decode of the Type D telemetry datagrams into one flat state per
+// console. Layouts come from src/td_wire.h, the same header the display
+// parses with. Each datagram is matched against a table of decoders
+// {port, match, apply}; a new frame type (e.g. an aggregated frame) is one
+// more table entry and, if it carries new fields, one more column in State.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace td {
+
+// Numeric fields, in column order. Kind is the decoder that produced the row.
+enum Num : uint8_t {
+  Kind, Fan, Cpu, Amb, Tray, Av, Pic, XboxVer, Width, Height, Enc, TitleId,
+  kNumCount
+};
+
+// Text fields
+enum Str : uint8_t {
+  App, Title, Serial, Mac, Region, HddKey,
+  kStrCount
+};
+
+enum class Frame : uint8_t {
+  Unknown = 0, Core = 1, Title = 2, ExpBin = 3, ExpText = 4, EE = 5, AppTid = 6,
+};
+
+struct State {
+  int64_t     num[kNumCount];
+  std::string str[kStrCount];
+  State() { reset(); }
+  void reset();   // same sentinels as XboxStatus: -1, temps -1000, title 0
+};
+
+const char* numName(uint8_t i);
+const char* strName(uint8_t i);
+const char* frameName(Frame f);
+
+// Applies one datagram. Returns the frame type, Unknown if nothing matched
+// (state untouched).
+Frame decode(uint16_t port, const uint8_t* data, size_t len, State& st);
+
+} // namespace td
@@ -0,0 +1,221 @@
+// tlog.cpp
+#include "tlog.h"
+#include <string.h>
+
+namespace tlog {
+
+// ---------- primitives ----------
+uint32_t crc32(const uint8_t* p, size_t n) {
+  static uint32_t table[256];
+  if (!table[1]) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  }
+  uint32_t c = 0xFFFFFFFFu;
+  while (n--) c = table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+static void put_varint(std::vector<uint8_t>& o, uint64_t v) {
+  do {
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    o.push_back(v ? (b | 0x80) : b);
+  } while (v);
+}
+
+static void put_le(std::vector<uint8_t>& o, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; ++i) o.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static uint64_t get_le(const uint8_t* p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; ++i) v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+static inline uint64_t zigzag(int64_t d)   { return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63); }
+static inline int64_t  unzigzag(uint64_t z) { return (int64_t)(z >> 1) ^ -(int64_t)(z & 1); }
+
+struct Cursor {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok = true;
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (p >= end) break;
+      const uint8_t b = *p++;
+      v |= (uint64_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) return v;
+    }
+    ok = false;
+    return 0;
+  }
+};
+
+// Encodes `count` values from `get(i)`; the same zero-run delta scheme as History
+template <typename Get>
+static void put_column(std::vector<uint8_t>& o, size_t count, Get get) {
+  int64_t prev = 0;
+  size_t i = 0;
+  while (i < count) {
+    const int64_t v = get(i);
+    if (v == prev) {
+      size_t run = 1;
+      while (i + run < count && get(i + run) == v) run++;
+      put_varint(o, 0);
+      put_varint(o, run - 1);
+      i += run;
+    } else {
+      put_varint(o, zigzag(v - prev));
+      prev = v;
+      i++;
+    }
+  }
+}
+
+template <typename Set>
+static void get_column(Cursor& c, size_t count, Set set) {
+  int64_t prev = 0;
+  size_t i = 0;
+  while (i < count && c.ok) {
+    const uint64_t z = c.varint();
+    if (z == 0) {
+      const uint64_t extra = c.varint();
+      for (uint64_t k = 0; k <= extra && i < count; ++k) set(i++, prev);
+    } else {
+      prev += unzigzag(z);
+      set(i++, prev);
+    }
+  }
+}
+
+// ---------- writer ----------
+void BlockWriter::add(int64_t unixMs, const td::State& st) {
+  if (!rows_.empty() && unixMs < rows_.back().unixMs) unixMs = rows_.back().unixMs;   // clock stepped back
+  rows_.push_back(Row{unixMs, st});
+}
+
+void BlockWriter::encode(std::vector<uint8_t>& out) {
+  if (rows_.empty()) return;
+  const size_t n = rows_.size() > 0xFFFF ? 0xFFFF : rows_.size();
+
+  std::vector<uint8_t> body;
+  for (size_t i = 0; i < n; ++i)
+    put_varint(body, (uint64_t)(i ? rows_[i].unixMs - rows_[i - 1].unixMs : 0));
+  for (uint8_t col = 0; col < td::kNumCount; ++col)
+    put_column(body, n, [&](size_t i) { return rows_[i].st.num[col]; });
+
+  std::vector<uint8_t> changes;
+  size_t nChanges = 0;
+  for (size_t i = 0; i < n; ++i) {
+    for (uint8_t f = 0; f < td::kStrCount; ++f) {
+      const std::string& s = rows_[i].st.str[f];
+      if (i == 0 ? s.empty() : s == rows_[i - 1].st.str[f]) continue;
+      put_varint(changes, i);
+      changes.push_back(f);
+      put_varint(changes, s.size());
+      changes.insert(changes.end(), s.begin(), s.end());
+      nChanges++;
+    }
+  }
+  put_varint(body, nChanges);
+  body.insert(body.end(), changes.begin(), changes.end());
+
+  out.insert(out.end(), {'T', 'D', 'B', '1'});
+  put_le(out, n, 2);
+  out.push_back(td::kNumCount);
+  out.push_back(td::kStrCount);
+  put_le(out, (uint64_t)rows_.front().unixMs, 8);
+  put_le(out, body.size(), 4);
+  put_le(out, crc32(body.data(), body.size()), 4);
+  out.insert(out.end(), body.begin(), body.end());
+
+  rows_.erase(rows_.begin(), rows_.begin() + n);
+}
+
+bool writeFileHeader(FILE* f) {
+  if (fseek(f, 0, SEEK_END) != 0) return false;
+  if (ftell(f) > 0) return true;
+  static const uint8_t hdr[kFileHdrBytes] = {'T', 'D', 'L', '1', 1, 0, 0, 0};
+  return fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr);
+}
+
+// ---------- reader ----------
+static bool decode_block(const uint8_t* hdr, const uint8_t* body, size_t bodyLen,
+                         const std::function<bool(const Row&)>& fn, bool& stop) {
+  const size_t rows = get_le(hdr + 4, 2);
+  const uint8_t nNum = hdr[6];
+  const int64_t base = (int64_t)get_le(hdr + 8, 8);
+
+  std::vector<Row> out(rows);
+  Cursor c{body, body + bodyLen};
+  int64_t t = base;
+  for (size_t i = 0; i < rows && c.ok; ++i) {
+    t += (int64_t)c.varint();
+    out[i].unixMs = t;
+  }
+  for (uint8_t col = 0; col < nNum && c.ok; ++col) {
+    get_column(c, rows, [&](size_t i, int64_t v) {
+      if (col < td::kNumCount) out[i].st.num[col] = v;
+    });
+  }
+
+  // String changes, carried forward row to row
+  std::vector<std::vector<std::pair<uint8_t, std::string>>> at(rows);
+  const uint64_t nChanges = c.varint();
+  for (uint64_t k = 0; k < nChanges && c.ok; ++k) {
+    const uint64_t row = c.varint();
+    if (c.p >= c.end) { c.ok = false; break; }
+    const uint8_t field = *c.p++;
+    const uint64_t len = c.varint();
+    if (!c.ok || (uint64_t)(c.end - c.p) < len || row >= rows) { c.ok = false; break; }
+    if (field < td::kStrCount) at[row].emplace_back(field, std::string((const char*)c.p, len));
+    c.p += len;
+  }
+  if (!c.ok) return false;
+
+  for (size_t i = 0; i < rows; ++i) {
+    if (i) for (uint8_t f = 0; f < td::kStrCount; ++f) out[i].st.str[f] = out[i - 1].st.str[f];
+    for (auto& ch : at[i]) out[i].st.str[ch.first] = ch.second;
+    if (!fn(out[i])) { stop = true; break; }
+  }
+  return true;
+}
+
+bool readFile(const std::string& path, const std::function<bool(const Row&)>& fn, size_t* badBlocks) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  std::vector<uint8_t> data;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(f);
+  if (data.size() < kFileHdrBytes || memcmp(data.data(), "TDL1", 4) != 0) return false;
+
+  // A torn block (the recorder died mid-write, then appended again) is
+  // skipped by scanning for the next block magic.
+  size_t pos = kFileHdrBytes;
+  bool stop = false;
+  while (!stop && pos + kBlockHdrBytes <= data.size()) {
+    const uint8_t* hdr = data.data() + pos;
+    const size_t len = get_le(hdr + 16, 4);
+    const bool ok = memcmp(hdr, "TDB1", 4) == 0 && len <= data.size() - pos - kBlockHdrBytes &&
+                    crc32(hdr + kBlockHdrBytes, len) == (uint32_t)get_le(hdr + 20, 4) &&
+                    decode_block(hdr, hdr + kBlockHdrBytes, len, fn, stop);
+    if (ok) { pos += kBlockHdrBytes + len; continue; }
+    if (badBlocks) (*badBlocks)++;
+    const uint8_t* next = nullptr;
+    for (size_t i = pos + 1; i + 4 <= data.size() && !next; ++i)
+      if (!memcmp(data.data() + i, "TDB1", 4)) next = data.data() + i;
+    if (!next) break;
+    pos = (size_t)(next - data.data());
+  }
+  return true;
+}
+
+} // namespace tlog
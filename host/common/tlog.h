@@ -0,0 +1,66 @@
+// tlog.h
+//
+// Columnar telemetry log (.tdl). Append-only blocks, each self-contained and
+// CRC-checked, so a crash or power cut loses at most the block being built;
+// a reader skips a torn block and carries on at the next block magic.
+//
+// File: "TDL1" u8 version(1) u8 reserved[3], then blocks.
+// Block (little-endian):
+//   0  "TDB1"
+//   4  u16 rows
+//   6  u8  numeric columns (td::kNumCount; a reader skips extra ones it does not know)
+//   7  u8  string fields  (td::kStrCount)
+//   8  u64 unix ms of the first row
+//   16 u32 payload bytes
+//   20 u32 CRC-32 of the payload
+//   24 payload:
+//      time column: varint(ms since the previous row), first row 0
+//      numeric columns, each `rows` values: varint(zigzag(v - prev)), prev
+//        starting at 0; a 0 delta is followed by varint(extra zeros in the
+//        run) -- the same coding as the expansion's history chunks
+//      string changes: varint count, then per change varint(row) u8 field
+//        varint(len) bytes. Row 0 carries every non-empty string so a
+//        block decodes without its predecessors.
+#pragma once
+#include "td_decode.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace tlog {
+
+static constexpr size_t kFileHdrBytes  = 8;
+static constexpr size_t kBlockHdrBytes = 24;
+
+struct Row {
+  int64_t   unixMs = 0;
+  td::State st;
+};
+
+// Collects rows and encodes them as one block
+class BlockWriter {
+public:
+  void add(int64_t unixMs, const td::State& st);
+  size_t rows() const { return rows_.size(); }
+  int64_t firstMs() const { return rows_.empty() ? 0 : rows_.front().unixMs; }
+  // Appends the encoded block to `out` and clears the rows
+  void encode(std::vector<uint8_t>& out);
+
+private:
+  std::vector<Row> rows_;
+};
+
+// Writes the file header if the file is empty. False on I/O error.
+bool writeFileHeader(FILE* f);
+
+// Calls `fn` for every row in the file, oldest first, until it returns
+// false. Returns false if the file is not a .tdl file; damaged blocks are
+// skipped and counted in `badBlocks` when given.
+bool readFile(const std::string& path, const std::function<bool(const Row&)>& fn,
+              size_t* badBlocks = nullptr);
+
+uint32_t crc32(const uint8_t* p, size_t n);
+
+} // namespace tlog
@@ -0,0 +1,541 @@
+// fat_image.cpp
+//
+// Volume layout (FatFs f_mkfs for FAT12/16, as ESP-IDF's FFat.format() makes
+// it): boot sector, FATs, fixed root directory, data clusters from 2. One
+// sector per cluster.
+//
+// Wear levelling (components/wear_levelling, version 2): the partition ends
+// with two copies of wl_state_t (each state_size bytes, followed by one
+// 16-byte record per move of the dummy sector) and one wl_config_t sector. A
+// fresh state has pos = 0, so the dummy sector is physical sector 0 and FAT
+// sector N is physical sector N + 1.
+
+#include "fat_image.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <set>
+
+namespace fatimg {
+
+uint32_t crc32(const uint8_t* d, size_t n, uint32_t crc) {
+  static uint32_t table[256];
+  if (!table[1]) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) crc = table[(crc ^ d[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+namespace {
+
+static inline void wr16(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void wr32(uint8_t* p, uint32_t v) { wr16(p, v); wr16(p + 2, v >> 16); }
+
+// ---------- names ----------
+struct ShortName {
+  char name[11];
+  uint8_t ntRes = 0;     // 0x08 lower-case base, 0x10 lower-case extension
+  bool needsLfn = false;
+};
+
+static bool sfnChar(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || strchr("!#$%&'()-@^_`{}~", c);
+}
+
+static std::u16string utf16(const std::string& s) {
+  std::u16string out;
+  for (size_t i = 0; i < s.size();) {
+    const unsigned char c = (unsigned char)s[i];
+    uint32_t cp;
+    int n;
+    if (c < 0x80)       { cp = c; n = 1; }
+    else if (c >> 5 == 6) { cp = c & 0x1F; n = 2; }
+    else if (c >> 4 == 14) { cp = c & 0x0F; n = 3; }
+    else                { cp = c & 0x07; n = 4; }
+    for (int k = 1; k < n && i + k < s.size(); ++k) cp = (cp << 6) | ((unsigned char)s[i + k] & 0x3F);
+    i += n;
+    if (cp >= 0x10000) {
+      cp -= 0x10000;
+      out += (char16_t)(0xD800 + (cp >> 10));
+      out += (char16_t)(0xDC00 + (cp & 0x3FF));
+    } else {
+      out += (char16_t)cp;
+    }
+  }
+  return out;
+}
+
+// Case-only differences from 8.3 use the NT flags, as FatFs does; anything
+// else gets a long name and a ~N alias unique in the directory.
+static ShortName shortName(const std::string& lfn, std::set<std::string>& used) {
+  ShortName sn;
+  const size_t dot = lfn.find_last_of('.');
+  const std::string base = (dot == std::string::npos || dot == 0) ? lfn : lfn.substr(0, dot);
+  const std::string ext = (dot == std::string::npos || dot == 0) ? "" : lfn.substr(dot + 1);
+
+  auto plain = [](const std::string& part, size_t max, bool& lower) {
+    if (part.size() > max) return false;
+    bool hasLower = false, hasUpper = false;
+    for (unsigned char c : part) {
+      if (c >= 'a' && c <= 'z') { hasLower = true; c = (unsigned char)(c - 32); }
+      else if (c >= 'A' && c <= 'Z') hasUpper = true;
+      if (!sfnChar(c)) return false;
+    }
+    lower = hasLower;
+    return !(hasLower && hasUpper);
+  };
+  bool lowerBase = false, lowerExt = false;
+  const bool is83 = !base.empty() && plain(base, 8, lowerBase) && plain(ext, 3, lowerExt);
+
+  auto fill = [&](const std::string& b, const std::string& e) {
+    memset(sn.name, ' ', 11);
+    for (size_t i = 0; i < b.size() && i < 8; ++i) sn.name[i] = b[i];
+    for (size_t i = 0; i < e.size() && i < 3; ++i) sn.name[8 + i] = e[i];
+    if ((unsigned char)sn.name[0] == 0xE5) sn.name[0] = 0x05;
+  };
+  auto upper = [](const std::string& s, size_t max) {
+    std::string o;
+    for (unsigned char c : s) {
+      if (o.size() >= max) break;
+      if (c == ' ' || c == '.') continue;
+      if (c >= 'a' && c <= 'z') c = (unsigned char)(c - 32);
+      o += sfnChar(c) ? (char)c : '_';
+    }
+    return o;
+  };
+
+  if (is83) {
+    const std::string b = upper(base, 8), e = upper(ext, 3);
+    fill(b, e);
+    const std::string key(sn.name, 11);
+    if (!used.count(key)) {
+      used.insert(key);
+      sn.ntRes = (lowerBase ? 0x08 : 0) | (lowerExt ? 0x10 : 0);
+      return sn;
+    }
+  }
+  sn.needsLfn = true;
+  std::string b = upper(base, 8), e = upper(ext, 3);
+  if (b.empty()) b = "_";
+  for (int n = 1;; ++n) {
+    const std::string tail = "~" + std::to_string(n);
+    fill(b.substr(0, 8 - tail.size()) + tail, e);
+    const std::string key(sn.name, 11);
+    if (!used.count(key)) { used.insert(key); return sn; }
+  }
+}
+
+static uint8_t sfnChecksum(const char name[11]) {
+  uint8_t sum = 0;
+  for (int i = 0; i < 11; ++i) sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)name[i]);
+  return sum;
+}
+
+// ---------- directories ----------
+struct Dir {
+  const Node* node;
+  std::string path;          // "" for root
+  int parent;                // index into dirs, -1 for root
+  uint32_t cluster = 0;      // 0 for root
+  uint32_t clusters = 0;
+  std::vector<ShortName> names;   // per child
+  uint32_t entries = 0;           // incl. LFN entries and . / ..
+};
+
+struct File {
+  const Node* node;
+  std::string path;
+  uint32_t cluster = 0, clusters = 0;
+};
+
+static void fatTime(uint32_t unixTime, uint16_t& date, uint16_t& tm) {
+  time_t t = (time_t)unixTime;
+  struct tm g;
+  gmtime_r(&t, &g);
+  if (g.tm_year < 80) { date = (0 << 9) | (1 << 5) | 1; tm = 0; return; }
+  date = (uint16_t)(((g.tm_year - 80) << 9) | ((g.tm_mon + 1) << 5) | g.tm_mday);
+  tm = (uint16_t)((g.tm_hour << 11) | (g.tm_min << 5) | (g.tm_sec / 2));
+}
+
+static void dirEntry(uint8_t* e, const char name[11], uint8_t attr, uint8_t ntRes, uint32_t cluster, uint32_t size,
+                     uint16_t date, uint16_t tm) {
+  memset(e, 0, 32);
+  memcpy(e, name, 11);
+  e[11] = attr;
+  e[12] = ntRes;
+  wr16(e + 14, tm);  wr16(e + 16, date);   // created
+  wr16(e + 18, date);                       // accessed
+  wr16(e + 22, tm);  wr16(e + 24, date);   // written
+  wr16(e + 26, cluster);
+  wr32(e + 28, size);
+}
+
+} // namespace
+
+bool build(const Node& root, const Options& opt, Result& out, std::string& err) {
+  out = Result();
+  const uint32_t ss = opt.sectorBytes;
+  if (ss < 512 || (ss & (ss - 1)) || opt.partitionBytes % ss) { err = "partition size must be a multiple of the sector size"; return false; }
+
+  // ---------- wear-levelling geometry ----------
+  uint32_t stateSize = ss, cfgSize = ss, fsBytes = opt.partitionBytes;
+  if (opt.wearLevelling) {
+    const uint32_t need = 64 + (opt.partitionBytes / ss) * 16;
+    if (stateSize < need) stateSize = (need + ss - 1) / ss * ss;
+    if (opt.partitionBytes < 2 * stateSize + cfgSize + 2 * ss) { err = "partition too small for wear levelling"; return false; }
+    fsBytes = ((opt.partitionBytes - 2 * stateSize - cfgSize) / ss - 1) * ss;   // -1: dummy sector
+  }
+
+  // ---------- FAT geometry (f_mkfs) ----------
+  const uint32_t vol = fsBytes / ss;
+  const uint32_t rsv = 1, dirSectors = (opt.rootEntries * 32u + ss - 1) / ss;
+  bool fat16 = false;
+  uint32_t fatSectors = 0, nClst = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    const uint32_t est = vol;   // one sector per cluster
+    const uint32_t n = fat16 ? est * 2 + 4 : (est * 3 + 1) / 2 + 3;
+    fatSectors = (n + ss - 1) / ss;
+    if (vol <= rsv + fatSectors * opt.fats + dirSectors) { err = "partition too small"; return false; }
+    nClst = vol - rsv - fatSectors * opt.fats - dirSectors;
+    if (!fat16 && nClst > 0xFF5) { fat16 = true; continue; }
+    break;
+  }
+  if (nClst > 0xFFF5) { err = "volume too large for FAT16"; return false; }
+  const uint32_t fatStart = rsv, rootStart = rsv + fatSectors * opt.fats, dataStart = rootStart + dirSectors;
+  out.fatType = fat16 ? "FAT16" : "FAT12";
+  out.fsSectors = vol;
+  out.clusters = nClst;
+
+  // ---------- names and directory sizes ----------
+  std::vector<Dir> dirs;
+  std::vector<File> files;
+  dirs.push_back(Dir{ &root, "", -1, 0, 0, {} });
+  for (size_t di = 0; di < dirs.size(); ++di) {
+    std::set<std::string> used;
+    uint32_t entries = dirs[di].parent < 0 ? 0 : 2;
+    const Node* node = dirs[di].node;
+    const std::string path = dirs[di].path;
+    std::vector<ShortName> names;
+    std::set<std::u16string> longNames;   // FAT names are case-insensitive
+    for (const Node& c : node->children) {
+      ShortName sn = shortName(c.name, used);
+      std::u16string folded = utf16(c.name);
+      const size_t units = folded.size();
+      if (units == 0 || units > 255) { err = "bad name: " + path + "/" + c.name; return false; }
+      for (char16_t& u : folded) if (u < 128) u = (char16_t)toupper(u);
+      if (!longNames.insert(folded).second) { err = "duplicate name: " + path + "/" + c.name; return false; }
+      entries += 1 + (sn.needsLfn ? (uint32_t)((units + 12) / 13) : 0);
+      names.push_back(sn);
+      if (c.dir) dirs.push_back(Dir{ &c, path + "/" + c.name, (int)di, 0, 0, {} });
+      else files.push_back(File{ &c, path + "/" + c.name });
+    }
+    dirs[di].names = names;
+    dirs[di].entries = entries;
+    if (dirs[di].parent < 0) {
+      if (entries > opt.rootEntries) { err = "too many entries in the root directory"; return false; }
+    } else {
+      dirs[di].clusters = std::max<uint32_t>(1, (entries * 32 + ss - 1) / ss);
+    }
+  }
+
+  // ---------- allocation: directories, then files by (rank, path) ----------
+  uint32_t next = 2;
+  for (Dir& d : dirs) {
+    if (d.parent < 0) continue;
+    d.cluster = next;
+    next += d.clusters;
+    out.placed.push_back(Placed{ d.path + "/", d.cluster, d.clusters, d.entries * 32, -1 });
+  }
+  std::stable_sort(files.begin(), files.end(), [](const File& a, const File& b) {
+    return a.node->rank != b.node->rank ? a.node->rank < b.node->rank : a.path < b.path;
+  });
+  for (File& f : files) {
+    f.clusters = (uint32_t)((f.node->data.size() + ss - 1) / ss);
+    if (!f.clusters) continue;
+    f.cluster = next;
+    next += f.clusters;
+    out.placed.push_back(Placed{ f.path, f.cluster, f.clusters, (uint32_t)f.node->data.size(), f.node->rank });
+  }
+  out.usedClusters = next - 2;
+  if (next - 2 > nClst) {
+    err = "does not fit: needs " + std::to_string(next - 2) + " clusters, volume has " + std::to_string(nClst);
+    return false;
+  }
+
+  // ---------- volume ----------
+  std::vector<uint8_t> fs((size_t)vol * ss, 0);
+  auto clusterPtr = [&](uint32_t c) { return &fs[((size_t)dataStart + (c - 2)) * ss]; };
+  for (uint32_t c = next; c < nClst + 2; ++c) memset(clusterPtr(c), 0xFF, ss);   // free = erased flash
+
+  // Boot sector
+  uint8_t* bs = fs.data();
+  const uint8_t jmp[3] = { 0xEB, 0xFE, 0x90 };
+  memcpy(bs, jmp, 3);
+  memcpy(bs + 3, "MSDOS5.0", 8);
+  wr16(bs + 11, ss);
+  bs[13] = 1;                               // sectors per cluster
+  wr16(bs + 14, rsv);
+  bs[16] = opt.fats;
+  wr16(bs + 17, opt.rootEntries);
+  if (vol < 0x10000) wr16(bs + 19, vol); else wr32(bs + 32, vol);
+  bs[21] = 0xF8;
+  wr16(bs + 22, fatSectors);
+  wr16(bs + 24, 63);                        // sectors per track
+  wr16(bs + 26, 255);                       // heads
+  bs[36] = 0x80;
+  bs[38] = 0x29;
+  wr32(bs + 39, opt.serial);
+  memcpy(bs + 43, "NO NAME    ", 11);
+  memcpy(bs + 54, "FAT     ", 8);
+  bs[510] = 0x55; bs[511] = 0xAA;
+
+  // FAT
+  std::vector<uint16_t> fat(nClst + 2, 0);
+  fat[0] = fat16 ? 0xFFF8 : 0xFF8;
+  fat[1] = fat16 ? 0xFFFF : 0xFFF;
+  const uint16_t eoc = fat16 ? 0xFFFF : 0xFFF;
+  auto chain = [&](uint32_t first, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) fat[first + i] = (uint16_t)(i + 1 < n ? first + i + 1 : eoc);
+  };
+  for (const Dir& d : dirs) if (d.parent >= 0) chain(d.cluster, d.clusters);
+  for (const File& f : files) if (f.clusters) chain(f.cluster, f.clusters);
+  for (uint32_t k = 0; k < opt.fats; ++k) {
+    uint8_t* t = &fs[((size_t)fatStart + k * fatSectors) * ss];
+    for (uint32_t c = 0; c < nClst + 2; ++c) {
+      if (fat16) { wr16(t + c * 2, fat[c]); continue; }
+      uint8_t* p = t + c * 3 / 2;
+      if (c & 1) { p[0] = (uint8_t)((p[0] & 0x0F) | ((fat[c] << 4) & 0xF0)); p[1] = (uint8_t)(fat[c] >> 4); }
+      else       { p[0] = (uint8_t)fat[c]; p[1] = (uint8_t)((p[1] & 0xF0) | ((fat[c] >> 8) & 0x0F)); }
+    }
+  }
+
+  // Directories
+  uint16_t date, tm;
+  fatTime(opt.timestamp, date, tm);
+  std::map<const Node*, uint32_t> firstCluster;
+  for (const Dir& d : dirs) firstCluster[d.node] = d.cluster;
+  for (const File& f : files) firstCluster[f.node] = f.cluster;
+
+  for (const Dir& d : dirs) {
+    uint8_t* e = d.parent < 0 ? &fs[(size_t)rootStart * ss] : clusterPtr(d.cluster);
+    if (d.parent >= 0) {
+      char dotName[11], dotdotName[11];
+      memset(dotName, ' ', 11); dotName[0] = '.';
+      memset(dotdotName, ' ', 11); dotdotName[0] = dotdotName[1] = '.';
+      dirEntry(e, dotName, 0x10, 0, d.cluster, 0, date, tm); e += 32;
+      dirEntry(e, dotdotName, 0x10, 0, dirs[d.parent].cluster, 0, date, tm); e += 32;
+    }
+    for (size_t i = 0; i < d.node->children.size(); ++i) {
+      const Node& c = d.node->children[i];
+      const ShortName& sn = d.names[i];
+      if (sn.needsLfn) {
+        const std::u16string u = utf16(c.name);
+        const int n = (int)((u.size() + 12) / 13);
+        const uint8_t sum = sfnChecksum(sn.name);
+        static const int at[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+        for (int k = n; k >= 1; --k, e += 32) {
+          memset(e, 0, 32);
+          e[0] = (uint8_t)(k | (k == n ? 0x40 : 0));
+          e[11] = 0x0F;
+          e[13] = sum;
+          for (int j = 0; j < 13; ++j) {
+            const size_t idx = (size_t)(k - 1) * 13 + j;
+            const uint16_t ch = idx < u.size() ? (uint16_t)u[idx] : (idx == u.size() ? 0x0000 : 0xFFFF);
+            wr16(e + at[j], ch);
+          }
+        }
+      }
+      dirEntry(e, sn.name, c.dir ? 0x10 : 0x20, sn.ntRes, firstCluster[&c], c.dir ? 0 : (uint32_t)c.data.size(), date, tm);
+      e += 32;
+    }
+  }
+
+  // File data
+  for (const File& f : files)
+    if (f.clusters) memcpy(clusterPtr(f.cluster), f.node->data.data(), f.node->data.size());
+
+  if (!opt.wearLevelling) {
+    out.image = std::move(fs);
+    return true;
+  }
+
+  // ---------- wear-levelling wrapper ----------
+  out.image.assign(opt.partitionBytes, 0xFF);
+  memcpy(&out.image[ss], fs.data(), fs.size());   // physical 0 is the dummy sector
+
+  uint8_t state[64] = {0};
+  wr32(state + 0, 0);                        // pos
+  wr32(state + 4, 1 + fsBytes / ss);         // max_pos
+  wr32(state + 8, 0);                        // move_count
+  wr32(state + 12, 0);                       // access_count
+  wr32(state + 16, 16);                      // max_count = updaterate
+  wr32(state + 20, ss);                      // block_size
+  wr32(state + 24, 2);                       // version
+  wr32(state + 28, opt.serial ^ 0x574C3032u);   // device_id ("WL02")
+  wr32(state + 60, crc32(state, 60, 0xFFFFFFFFu));
+  const uint32_t state1 = opt.partitionBytes - 2 * stateSize - cfgSize;
+  memcpy(&out.image[state1], state, sizeof(state));
+  memcpy(&out.image[state1 + stateSize], state, sizeof(state));
+
+  uint8_t cfg[36] = {0};
+  wr32(cfg + 0, 0);                          // start_addr
+  wr32(cfg + 4, opt.partitionBytes);         // full_mem_size
+  wr32(cfg + 8, ss);                         // page_size
+  wr32(cfg + 12, ss);                        // sector_size
+  wr32(cfg + 16, 16);                        // updaterate
+  wr32(cfg + 20, 16);                        // wr_size
+  wr32(cfg + 24, 2);                         // version
+  wr32(cfg + 28, 32);                        // temp_buff_size
+  wr32(cfg + 32, crc32(cfg, 32, 0xFFFFFFFFu));
+  memcpy(&out.image[opt.partitionBytes - cfgSize], cfg, sizeof(cfg));
+  return true;
+}
+
+// ---------- reading ----------
+namespace {
+
+static inline uint32_t rd16(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+static inline uint32_t rd32(const uint8_t* p) { return rd16(p) | (rd16(p + 2) << 16); }
+
+// Logical volume out of a wear-levelled partition, or false if it isn't one
+static bool unwrap(const std::vector<uint8_t>& img, std::vector<uint8_t>& vol) {
+  for (uint32_t ss : { 4096u, 512u }) {
+    if (img.size() < 4 * ss || img.size() % ss) continue;
+    const uint8_t* cfg = &img[img.size() - ss];
+    if (rd32(cfg + 4) != img.size() || rd32(cfg + 8) != ss || rd32(cfg + 32) != crc32(cfg, 32, 0xFFFFFFFFu)) continue;
+
+    const uint32_t full = (uint32_t)img.size(), wrSize = rd32(cfg + 20);
+    uint32_t stateSize = ss;
+    const uint32_t need = 64 + (full / ss) * wrSize;
+    if (stateSize < need) stateSize = (need + ss - 1) / ss * ss;
+    const uint32_t flashSize = ((full - 2 * stateSize - ss) / ss - 1) * ss;
+    const uint8_t* st = &img[full - 2 * stateSize - ss];
+    if (rd32(st + 60) != crc32(st, 60, 0xFFFFFFFFu)) return false;
+
+    // pos = leading records that hold the expected pattern for their index
+    const uint32_t maxPos = rd32(st + 4), moves = rd32(st + 8), dev = rd32(st + 28);
+    uint32_t pos = 0;
+    for (; pos < maxPos && 64 + (pos + 1) * wrSize <= stateSize; ++pos) {
+      uint8_t ok[16];
+      for (uint32_t k = 0; k < 4; ++k) {
+        uint8_t v[4];
+        wr32(v, dev + pos * 4 + k);
+        wr32(ok + k * 4, crc32(v, 4, 0xFFFFFFFFu));
+      }
+      if (memcmp(st + 64 + pos * wrSize, ok, std::min<uint32_t>(wrSize, 16)) != 0) break;
+    }
+    vol.assign(flashSize, 0);
+    for (uint32_t a = 0; a < flashSize; a += ss) {
+      uint32_t phys = (uint32_t)(((uint64_t)flashSize - (uint64_t)moves * ss % flashSize + a) % flashSize);
+      if (phys >= pos * ss) phys += ss;
+      memcpy(&vol[a], &img[phys], ss);
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+bool read(const std::vector<uint8_t>& image, std::vector<Listed>& out, std::string& err, bool* wearLevelled) {
+  out.clear();
+  std::vector<uint8_t> unwrapped;
+  const bool wl = unwrap(image, unwrapped);
+  if (wearLevelled) *wearLevelled = wl;
+  const std::vector<uint8_t>& v = wl ? unwrapped : image;
+  if (v.size() < 512 || v[510] != 0x55 || v[511] != 0xAA) { err = "no FAT boot sector"; return false; }
+
+  const uint32_t ss = rd16(&v[11]), spc = v[13], rsv = rd16(&v[14]), nFats = v[16], rootEnt = rd16(&v[17]);
+  const uint32_t total = rd16(&v[19]) ? rd16(&v[19]) : rd32(&v[32]);
+  const uint32_t fatSz = rd16(&v[22]);
+  if (!ss || !spc || !fatSz || (uint64_t)total * ss > v.size()) { err = "unsupported boot sector (FAT32?)"; return false; }
+  const uint32_t rootStart = rsv + nFats * fatSz, dirSectors = (rootEnt * 32 + ss - 1) / ss;
+  const uint32_t dataStart = rootStart + dirSectors, nClst = (total - dataStart) / spc;
+  const bool fat16 = nClst > 0xFF5;
+  const uint32_t cs = ss * spc;
+  const uint8_t* fat = &v[(size_t)rsv * ss];
+
+  auto nextOf = [&](uint32_t c) -> uint32_t {
+    if (fat16) return rd16(fat + c * 2);
+    const uint32_t w = rd16(fat + c * 3 / 2);
+    return (c & 1) ? w >> 4 : w & 0xFFF;
+  };
+  const uint32_t eocMin = fat16 ? 0xFFF8 : 0xFF8;
+  auto chainOf = [&](uint32_t c) {
+    std::vector<uint32_t> ch;
+    while (c >= 2 && c < nClst + 2 && ch.size() <= nClst) { ch.push_back(c); const uint32_t n = nextOf(c); if (n >= eocMin) break; c = n; }
+    return ch;
+  };
+  auto clusterData = [&](uint32_t c) { return &v[((size_t)dataStart + (size_t)(c - 2) * spc) * ss]; };
+
+  struct Pending { std::string path; std::vector<uint8_t> raw; };
+  std::vector<Pending> todo;
+  todo.push_back(Pending{ "", std::vector<uint8_t>(&v[(size_t)rootStart * ss], &v[(size_t)rootStart * ss] + rootEnt * 32) });
+  while (!todo.empty()) {
+    Pending d = std::move(todo.back());
+    todo.pop_back();
+    std::u16string lfn;
+    for (size_t o = 0; o + 32 <= d.raw.size(); o += 32) {
+      const uint8_t* e = &d.raw[o];
+      if (e[0] == 0) break;
+      if (e[0] == 0xE5) { lfn.clear(); continue; }
+      if (e[11] == 0x0F) {
+        static const int at[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+        std::u16string part;
+        for (int j = 0; j < 13; ++j) { const uint16_t ch = (uint16_t)rd16(e + at[j]); if (!ch || ch == 0xFFFF) break; part += (char16_t)ch; }
+        lfn = (e[0] & 0x40) ? part : part + lfn;
+        continue;
+      }
+      if (e[11] & 0x08) { lfn.clear(); continue; }   // volume label
+      std::string name;
+      if (!lfn.empty()) {
+        for (char16_t ch : lfn) {   // BMP only; enough for listings
+          if (ch < 0x80) name += (char)ch;
+          else if (ch < 0x800) { name += (char)(0xC0 | (ch >> 6)); name += (char)(0x80 | (ch & 0x3F)); }
+          else { name += (char)(0xE0 | (ch >> 12)); name += (char)(0x80 | ((ch >> 6) & 0x3F)); name += (char)(0x80 | (ch & 0x3F)); }
+        }
+      } else {
+        std::string b(reinterpret_cast<const char*>(e), 8), x(reinterpret_cast<const char*>(e + 8), 3);
+        b.erase(b.find_last_not_of(' ') + 1);
+        x.erase(x.find_last_not_of(' ') + 1);
+        if (b[0] == 0x05) b[0] = (char)0xE5;
+        if (e[12] & 0x08) for (char& ch : b) ch = (char)tolower((unsigned char)ch);
+        if (e[12] & 0x10) for (char& ch : x) ch = (char)tolower((unsigned char)ch);
+        name = x.empty() ? b : b + "." + x;
+      }
+      lfn.clear();
+      if (name == "." || name == "..") continue;
+
+      Listed l;
+      l.path = d.path + "/" + name;
+      l.dir = e[11] & 0x10;
+      l.firstCluster = rd16(e + 26) | (rd16(e + 20) << 16);
+      const std::vector<uint32_t> ch = chainOf(l.firstCluster);
+      l.clusters = (uint32_t)ch.size();
+      l.fragments = ch.empty() ? 0 : 1;
+      for (size_t i = 1; i < ch.size(); ++i) if (ch[i] != ch[i - 1] + 1) l.fragments++;
+      std::vector<uint8_t> bytes;
+      for (uint32_t c : ch) bytes.insert(bytes.end(), clusterData(c), clusterData(c) + cs);
+      if (l.dir) {
+        l.bytes = 0;
+        todo.push_back(Pending{ l.path, std::move(bytes) });
+      } else {
+        l.bytes = rd32(e + 28);
+        bytes.resize(std::min<size_t>(bytes.size(), l.bytes));
+        l.data = std::move(bytes);
+      }
+      out.push_back(std::move(l));
+    }
+  }
+  return true;
+}
+
+} // namespace fatimg
@@ -0,0 +1,65 @@
+// fat_image.h
+//
+// Builds the display's FFat partition the way ESP-IDF formats it (FatFs
+// mkfs with 4096-byte sectors and clusters, two FATs, 512 root entries,
+// inside the wear-levelling layer), but with every file in one contiguous
+// cluster run, placed in the order the caller gives.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fatimg {
+
+struct Node {
+  std::string name;                // long name, UTF-8
+  bool dir = false;
+  std::vector<uint8_t> data;       // files
+  std::vector<Node> children;      // directories, in directory-entry order
+  int rank = 0;                    // files: placement group, lower first
+};
+
+struct Options {
+  uint32_t partitionBytes = 0x9E0000;   // "16MB Flash (3MB APP/9.9MB FATFS)"
+  uint32_t sectorBytes = 4096;          // CONFIG_WL_SECTOR_SIZE
+  uint16_t rootEntries = 512;
+  uint8_t  fats = 2;
+  bool     wearLevelling = true;        // false: plain FAT volume
+  uint32_t timestamp = 0;               // unix time for every entry
+  uint32_t serial = 0;                  // volume ID; also seeds the WL device id
+};
+
+struct Placed {
+  std::string path;
+  uint32_t firstCluster, clusters, bytes;
+  int rank;
+};
+
+struct Result {
+  std::vector<uint8_t> image;
+  std::vector<Placed> placed;           // directories then files, in cluster order
+  const char* fatType = "";
+  uint32_t fsSectors = 0, clusters = 0, usedClusters = 0;
+};
+
+// Files are placed by (rank, path); directories come first. False (and err)
+// if the tree doesn't fit.
+bool build(const Node& root, const Options& opt, Result& out, std::string& err);
+
+// ---------- reading ----------
+struct Listed {
+  std::string path;
+  bool dir;
+  uint32_t bytes, firstCluster, clusters;
+  uint32_t fragments;                   // separate cluster runs
+  std::vector<uint8_t> data;            // files
+};
+
+// Reads a partition dump or a plain volume (wear levelling is detected from
+// its config sector; the dummy-sector position is recovered as the device
+// does). Lists every entry in directory order.
+bool read(const std::vector<uint8_t>& image, std::vector<Listed>& out, std::string& err, bool* wearLevelled = nullptr);
+
+uint32_t crc32(const uint8_t* d, size_t n, uint32_t crc = 0);
+
+} // namespace fatimg
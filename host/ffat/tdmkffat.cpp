@@ -0,0 +1,455 @@
+// tdmkffat.cpp
+//
+// Builds the display's FFat partition image from a directory laid out like
+// "FATFS Setup" (/boot, /resource, /jpg, /gif, titles.bin, ...):
+// - every file in one contiguous cluster run, in the order the display reads
+//   them: boot animation, root files (title DB, gallery index), resources,
+//   gallery sidecars, gallery media, then the web-only thumbnails
+// - /gallery.idx, a <file>.tdm sidecar per gallery file and /thumb/<dir>/
+//   <file>[.jpg] previews, so a freshly flashed unit lists its gallery without
+//   a directory walk (formats in ../../src/gallery_index.cpp)
+// - the same input, options and timestamp always give the same bytes
+//
+// Also lists (-l) or extracts (-x) an existing image, e.g. a flash dump, and
+// reports how fragmented each file is.
+
+#include "fat_image.h"
+#include "gif_dec.h"
+#include "jpeg_io.h"
+#include "png_dec.h"
+#include "qoi_dec.h"
+#include "quantize.h"
+#include "td565.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define THUMB_PX        96
+#define THUMB_QUALITY   80
+#define DEFAULT_EPOCH   1735689600u   // 2025-01-01 00:00:00 UTC
+
+// As src/gallery_index.h
+enum : uint16_t { F_GIF = 1 << 0, F_PROGRESSIVE = 1 << 1, F_THUMB = 1 << 2 };
+struct Meta { uint32_t size; uint16_t width, height, frames, flags; uint32_t durationMs; };
+static_assert(sizeof(Meta) == 16, "sidecar layout");
+
+enum Rank { R_BOOT = 1, R_ROOT = 2, R_RESOURCE = 3, R_SIDECAR = 4, R_GALLERY = 5, R_THUMB = 6, R_OTHER = 7 };
+static const char* kRankName[] = { "dir", "boot", "root", "resource", "sidecar", "gallery", "thumb", "other" };
+
+static bool g_quiet = false;
+
+static std::string lower(std::string s) {
+  for (char& c : s) c = (char)tolower((unsigned char)c);
+  return s;
+}
+static bool endsWith(const std::string& s, const char* suf) {
+  const size_t n = strlen(suf);
+  return s.size() >= n && s.compare(s.size() - n, n, suf) == 0;
+}
+static bool isJpg(const std::string& name) { const std::string l = lower(name); return endsWith(l, ".jpg") || endsWith(l, ".jpeg"); }
+static bool isQoi(const std::string& name) { return endsWith(lower(name), ".qoi"); }
+static bool isRaw(const std::string& name) { return endsWith(lower(name), ".565"); }
+static bool isPng(const std::string& name) { return endsWith(lower(name), ".png"); }
+static bool isStill(const std::string& name) { return isJpg(name) || isPng(name) || isQoi(name) || isRaw(name); }
+static bool isGif(const std::string& name) { return endsWith(lower(name), ".gif"); }
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  out.clear();
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  const bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+static bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+// ---------- source tree ----------
+// Generated entries are dropped from the input and made again
+static bool generated(const std::string& rel, bool dir) {
+  if (rel == "/gallery.idx" || rel == "/gallery.tmp") return true;
+  if (dir && rel == "/thumb") return true;
+  return !dir && endsWith(lower(rel), ".tdm") && (rel.rfind("/jpg/", 0) == 0 || rel.rfind("/gif/", 0) == 0);
+}
+
+static int rankOf(const std::string& rel) {
+  const size_t slash = rel.find('/', 1);
+  if (slash == std::string::npos) return R_ROOT;
+  const std::string top = lower(rel.substr(1, slash - 1));
+  if (top == "boot") return R_BOOT;
+  if (top == "resource") return R_RESOURCE;
+  if (top == "jpg" || top == "gif") return R_GALLERY;
+  if (top == "thumb") return R_THUMB;
+  return R_OTHER;
+}
+
+static bool loadTree(const std::string& dir, const std::string& rel, fatimg::Node& node, int& skipped) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) { fprintf(stderr, "tdmkffat: can't open %s\n", dir.c_str()); return false; }
+  std::vector<std::string> names;
+  while (dirent* e = readdir(d)) if (e->d_name[0] != '.') names.push_back(e->d_name);
+  closedir(d);
+  std::sort(names.begin(), names.end());
+
+  for (const std::string& n : names) {
+    const std::string full = dir + "/" + n, r = rel + "/" + n;
+    struct stat st;
+    if (stat(full.c_str(), &st) != 0) continue;
+    const bool isDir = S_ISDIR(st.st_mode);
+    if (generated(r, isDir)) { skipped++; continue; }
+    fatimg::Node c;
+    c.name = n;
+    c.dir = isDir;
+    if (isDir) {
+      if (!loadTree(full, r, c, skipped)) return false;
+    } else if (S_ISREG(st.st_mode)) {
+      if (!readFile(full, c.data)) { fprintf(stderr, "tdmkffat: can't read %s\n", full.c_str()); return false; }
+      c.rank = rankOf(r);
+    } else {
+      continue;
+    }
+    node.children.push_back(std::move(c));
+  }
+  return true;
+}
+
+static fatimg::Node* child(fatimg::Node& n, const std::string& name, bool dir) {
+  for (auto& c : n.children) if (c.name == name && c.dir == dir) return &c;
+  fatimg::Node c;
+  c.name = name;
+  c.dir = dir;
+  n.children.push_back(std::move(c));
+  return &n.children.back();
+}
+
+// ---------- gallery metadata ----------
+struct GalleryFile { std::string path; Meta meta; };
+
+static media::Image from565be(const uint8_t* p, int w, int h) {
+  media::Image img(w, h);
+  for (size_t i = 0; i < (size_t)w * h; ++i) {
+    const media::Rgb c = media::expand565((uint16_t)((p[i * 2] << 8) | p[i * 2 + 1]));
+    img.rgb[i * 3] = c.r; img.rgb[i * 3 + 1] = c.g; img.rgb[i * 3 + 2] = c.b;
+  }
+  return img;
+}
+
+// As the display decodes it (../../src/qoi_dec.cpp)
+static bool qoiStill(const std::vector<uint8_t>& data, Meta& m, bool thumbs, media::Image& first) {
+  qoi::Info info;
+  if (!qoi::parseHeader(data.data(), data.size(), info)) return false;
+  m.width = (uint16_t)info.width;
+  m.height = (uint16_t)info.height;
+  if (!thumbs) return true;
+  struct Out { std::vector<uint8_t> be; int w; } out{ std::vector<uint8_t>((size_t)info.width * info.height * 2), (int)info.width };
+  std::vector<uint16_t> strip(info.width * 16);
+  qoi::decode(data.data(), data.size(), strip.data(), 16, [](int y, int rows, const uint16_t* px, void* user) {
+    Out* o = (Out*)user;
+    memcpy(&o->be[(size_t)y * o->w * 2], px, (size_t)rows * o->w * 2);   // already big-endian in memory order
+  }, &out);
+  first = from565be(out.be.data(), (int)info.width, (int)info.height);
+  return true;
+}
+
+// Streamed as the display does (../../src/png_dec.cpp), over its default
+// black backdrop
+static bool pngStill(const std::vector<uint8_t>& data, Meta& m, bool thumbs, media::Image& first) {
+  struct In { const std::vector<uint8_t>* d; size_t pos; } in{ &data, 0 };
+  png::Decoder dec;
+  if (!dec.begin([](uint8_t* buf, size_t len, void* user) -> size_t {
+        In* i = (In*)user;
+        const size_t n = std::min(len, i->d->size() - i->pos);
+        memcpy(buf, i->d->data() + i->pos, n);
+        i->pos += n;
+        return n;
+      }, &in)) return false;
+  m.width = (uint16_t)dec.info().width;
+  m.height = (uint16_t)dec.info().height;
+  if (!thumbs) return true;
+  struct Out { std::vector<uint8_t> be; int w; } out{ std::vector<uint8_t>((size_t)m.width * m.height * 2), m.width };
+  dec.decode([](int y, const uint8_t* rgba, void* user) {
+    Out* o = (Out*)user;
+    png::blend565(rgba, o->w, (uint16_t*)&o->be[(size_t)y * o->w * 2]);
+  }, &out);
+  first = from565be(out.be.data(), m.width, m.height);
+  return true;
+}
+
+// Header, and the first frame if it covers the canvas
+static bool rawStill(const std::vector<uint8_t>& data, Meta& m, bool thumbs, media::Image& first) {
+  td565::Header h;
+  if (data.size() < sizeof(h)) return false;
+  memcpy(&h, data.data(), sizeof(h));
+  if (memcmp(h.magic, td565::kMagic, 4) != 0) return false;
+  m.width = h.width;
+  m.height = h.height;
+  m.frames = h.frames;
+  td565::Frame f;
+  size_t p = sizeof(h);
+  for (uint16_t i = 0; i < h.frames && p + sizeof(f) <= data.size(); ++i) {
+    memcpy(&f, &data[p], sizeof(f));
+    m.durationMs += h.frames > 1 ? f.delayMs : 0;
+    p += sizeof(f) + (size_t)f.w * f.h * 2;
+    if (i == 0 && thumbs && f.w == h.width && f.h == h.height && p <= data.size())
+      first = from565be(&data[sizeof(h) + sizeof(f)], f.w, f.h);
+  }
+  return true;
+}
+
+static bool analyse(const std::string& path, const std::vector<uint8_t>& data, bool thumbs, Meta& m,
+                    std::vector<uint8_t>& thumb) {
+  m = Meta{ (uint32_t)data.size(), 0, 0, 1, 0, 0 };
+  thumb.clear();
+  media::Image first;
+  if (isGif(path)) {
+    m.flags |= F_GIF;
+    m.frames = 0;
+    media::Gif g;
+    std::string err;
+    if (!media::gifDecode(data.data(), data.size(), g, &err)) {
+      fprintf(stderr, "tdmkffat: %s: %s; no metadata\n", path.c_str(), err.c_str());
+      return false;
+    }
+    m.width = (uint16_t)g.width;
+    m.height = (uint16_t)g.height;
+    m.frames = (uint16_t)std::min<size_t>(g.frames.size(), 0xFFFF);
+    for (auto& f : g.frames) m.durationMs += (uint32_t)f.delayCs * 10;
+    if (thumbs) {
+      media::GifPlayer p(g);
+      p.draw(0);
+      first = p.flatten();
+    }
+  } else if (isPng(path) || isQoi(path) || isRaw(path)) {
+    const bool ok = isPng(path) ? pngStill(data, m, thumbs, first)
+                  : isQoi(path) ? qoiStill(data, m, thumbs, first) : rawStill(data, m, thumbs, first);
+    if (!ok) {
+      fprintf(stderr, "tdmkffat: %s: bad header; no metadata\n", path.c_str());
+      return false;
+    }
+  } else {
+    media::JpegInfo info;
+    if (!media::jpegProbe(data.data(), data.size(), info)) {
+      fprintf(stderr, "tdmkffat: %s: not a JPEG; no metadata\n", path.c_str());
+      return false;
+    }
+    m.width = (uint16_t)info.w;
+    m.height = (uint16_t)info.h;
+    // TJpgDec decodes baseline Huffman only
+    if (info.progressive || info.arithmetic) {
+      m.flags |= F_PROGRESSIVE;
+      fprintf(stderr, "tdmkffat: %s: progressive/arithmetic JPEG, the slideshow will skip it\n", path.c_str());
+    }
+    if (thumbs) {
+      int denom = 1;
+      while (denom < 8 && std::min(info.w, info.h) / (denom * 2) >= THUMB_PX) denom *= 2;
+      if (!media::jpegDecode(data.data(), data.size(), first, denom)) first = media::Image();
+    }
+  }
+  if (thumbs && first.w > 0 && media::jpegEncode(media::fit(first, THUMB_PX, THUMB_PX), THUMB_QUALITY, thumb))
+    m.flags |= F_THUMB;
+  return true;
+}
+
+static std::vector<uint8_t> sidecar(const Meta& m) {
+  std::vector<uint8_t> v(4 + sizeof(Meta));
+  memcpy(v.data(), "TDM1", 4);
+  memcpy(v.data() + 4, &m, sizeof(m));   // little-endian host, as the device
+  return v;
+}
+
+static std::vector<uint8_t> indexFile(const std::vector<GalleryFile>& files) {
+  std::vector<uint8_t> v(12 + files.size() * 20);
+  memcpy(v.data(), "TDG1", 4);
+  const uint32_t n = (uint32_t)files.size(), pathsOff = (uint32_t)v.size();
+  memcpy(&v[4], &n, 4);
+  memcpy(&v[8], &pathsOff, 4);
+  uint32_t off = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    memcpy(&v[12 + i * 20], &off, 4);
+    memcpy(&v[12 + i * 20 + 4], &files[i].meta, sizeof(Meta));
+    off += (uint32_t)files[i].path.size() + 1;
+  }
+  for (auto& f : files) v.insert(v.end(), f.path.c_str(), f.path.c_str() + f.path.size() + 1);
+  return v;
+}
+
+// Sidecars, thumbnails and the index for /jpg and /gif
+static size_t addGalleryArtifacts(fatimg::Node& root, bool thumbs, size_t& thumbCount) {
+  std::vector<GalleryFile> gallery;
+  std::vector<std::pair<std::string, std::vector<uint8_t>>> previews;
+  for (auto& top : root.children) {
+    if (!top.dir || (top.name != "jpg" && top.name != "gif")) continue;
+    const bool gifDir = top.name == "gif";
+    std::vector<fatimg::Node> side;
+    for (auto& c : top.children) {
+      if (c.dir || !(gifDir ? isGif(c.name) : isStill(c.name))) continue;
+      const std::string path = "/" + top.name + "/" + c.name;
+      Meta m;
+      std::vector<uint8_t> thumb;
+      analyse(path, c.data, thumbs, m, thumb);
+      gallery.push_back(GalleryFile{ path, m });
+      fatimg::Node s;
+      s.name = c.name + ".tdm";
+      s.data = sidecar(m);
+      s.rank = R_SIDECAR;
+      side.push_back(std::move(s));
+      if (!thumb.empty()) {
+        // As GalleryIndex::thumbPath()
+        const std::string name = endsWith(lower(c.name), ".jpg") ? c.name : c.name + ".jpg";
+        previews.push_back({ top.name + "/" + name, std::move(thumb) });
+      }
+    }
+    for (auto& s : side) top.children.push_back(std::move(s));
+  }
+  std::sort(gallery.begin(), gallery.end(), [](const GalleryFile& a, const GalleryFile& b) { return a.path < b.path; });
+
+  fatimg::Node idx;
+  idx.name = "gallery.idx";
+  idx.data = indexFile(gallery);
+  idx.rank = R_ROOT;
+  root.children.push_back(std::move(idx));
+
+  thumbCount = previews.size();
+  if (!previews.empty()) {
+    fatimg::Node* t = child(root, "thumb", true);
+    for (auto& p : previews) {
+      const size_t slash = p.first.find('/');
+      fatimg::Node* sub = child(*t, p.first.substr(0, slash), true);
+      fatimg::Node f;
+      f.name = p.first.substr(slash + 1);
+      f.data = std::move(p.second);
+      f.rank = R_THUMB;
+      sub->children.push_back(std::move(f));
+    }
+  }
+  return gallery.size();
+}
+
+// Volume ID from the content, so equal inputs give equal images
+static uint32_t treeHash(const fatimg::Node& n, uint32_t h) {
+  for (auto& c : n.children) {
+    h = fatimg::crc32((const uint8_t*)c.name.data(), c.name.size(), h);
+    h = c.dir ? treeHash(c, h) : fatimg::crc32(c.data.data(), c.data.size(), h);
+  }
+  return h;
+}
+
+// ---------- list / extract ----------
+static int listImage(const std::string& path, const std::string& extractTo) {
+  std::vector<uint8_t> img;
+  if (!readFile(path, img)) { fprintf(stderr, "tdmkffat: can't read %s\n", path.c_str()); return 1; }
+  std::vector<fatimg::Listed> entries;
+  std::string err;
+  bool wl = false;
+  if (!fatimg::read(img, entries, err, &wl)) { fprintf(stderr, "tdmkffat: %s: %s\n", path.c_str(), err.c_str()); return 1; }
+
+  uint32_t files = 0, fragmented = 0, extraRuns = 0;
+  uint64_t bytes = 0;
+  for (auto& e : entries) {
+    if (extractTo.empty()) {
+      printf("%-44s %9s %6u %5u %s\n", e.path.c_str(), e.dir ? "<dir>" : std::to_string(e.bytes).c_str(),
+             e.firstCluster, e.clusters, e.fragments > 1 ? ("x" + std::to_string(e.fragments)).c_str() : "");
+    } else {
+      const std::string out = extractTo + e.path;
+      if (e.dir) mkdir(out.c_str(), 0755);
+      else if (!writeFile(out, e.data)) { fprintf(stderr, "tdmkffat: can't write %s\n", out.c_str()); return 1; }
+    }
+    if (!e.dir) {
+      files++;
+      bytes += e.bytes;
+      if (e.fragments > 1) { fragmented++; extraRuns += e.fragments - 1; }
+    }
+  }
+  fprintf(stderr, "%s: %s, %u files, %llu bytes, %u fragmented (%u extra runs)\n", path.c_str(),
+          wl ? "wear-levelled" : "plain FAT", files, (unsigned long long)bytes, fragmented, extraRuns);
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdmkffat [options] SRC_DIR OUT.bin\n"
+          "       tdmkffat -l IMAGE            list (path, bytes, first cluster, clusters, fragments)\n"
+          "       tdmkffat -x IMAGE DIR        extract\n"
+          "  -s  partition size in bytes (default 0x9E0000, the 9.9MB FATFS partition)\n"
+          "  -r  plain FAT volume, without the wear-levelling layer\n"
+          "  -t  timestamp for every entry, unix seconds (default $SOURCE_DATE_EPOCH or 2025-01-01)\n"
+          "  -T  no thumbnails\n"
+          "  -I  no gallery index, sidecars or thumbnails\n"
+          "  -v  print the placement of every file\n"
+          "  -q  errors only\n");
+}
+
+int main(int argc, char** argv) {
+  fatimg::Options opt;
+  bool thumbs = true, index = true, verbose = false;
+  std::string listPath, extractPath;
+  const char* sde = getenv("SOURCE_DATE_EPOCH");
+  opt.timestamp = sde ? (uint32_t)strtoul(sde, nullptr, 10) : DEFAULT_EPOCH;
+
+  int o;
+  while ((o = getopt(argc, argv, "s:rt:TIvql:x:h")) != -1) {
+    switch (o) {
+      case 's': opt.partitionBytes = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'r': opt.wearLevelling = false; break;
+      case 't': opt.timestamp = (uint32_t)strtoul(optarg, nullptr, 10); break;
+      case 'T': thumbs = false; break;
+      case 'I': index = false; break;
+      case 'v': verbose = true; break;
+      case 'q': g_quiet = true; break;
+      case 'l': listPath = optarg; break;
+      case 'x': extractPath = optarg; break;
+      default: usage(); return 2;
+    }
+  }
+  if (!listPath.empty()) return listImage(listPath, "");
+  if (!extractPath.empty()) {
+    if (optind >= argc) { usage(); return 2; }
+    mkdir(argv[optind], 0755);
+    return listImage(extractPath, argv[optind]);
+  }
+  if (optind + 2 != argc) { usage(); return 2; }
+
+  fatimg::Node root;
+  root.dir = true;
+  int skipped = 0;
+  if (!loadTree(argv[optind], "", root, skipped)) return 1;
+  if (skipped && !g_quiet) fprintf(stderr, "tdmkffat: %d generated entries in the source ignored (rebuilt)\n", skipped);
+
+  size_t galleryCount = 0, thumbCount = 0;
+  if (index) galleryCount = addGalleryArtifacts(root, thumbs, thumbCount);
+  opt.serial = treeHash(root, 0) ^ opt.timestamp;
+
+  fatimg::Result res;
+  std::string err;
+  if (!fatimg::build(root, opt, res, err)) { fprintf(stderr, "tdmkffat: %s\n", err.c_str()); return 1; }
+  if (!writeFile(argv[optind + 1], res.image)) { fprintf(stderr, "tdmkffat: can't write %s\n", argv[optind + 1]); return 1; }
+
+  if (verbose) {
+    for (auto& p : res.placed)
+      printf("%6u %5u  %-8s %s\n", p.firstCluster, p.clusters, kRankName[p.rank < 0 ? 0 : p.rank], p.path.c_str());
+  }
+  if (!g_quiet) {
+    uint64_t bytes = 0;
+    size_t files = 0;
+    for (auto& p : res.placed) if (p.rank >= 0) { bytes += p.bytes; files++; }
+    fprintf(stderr, "%s: %s%s, %u clusters of %u used (%.1f%%), %zu files, %llu bytes, 0 fragmented\n",
+            argv[optind + 1], res.fatType, opt.wearLevelling ? " + wear levelling" : "", res.usedClusters,
+            res.clusters, 100.0 * res.usedClusters / res.clusters, files, (unsigned long long)bytes);
+    if (index) fprintf(stderr, "gallery: %zu files indexed, %zu thumbnails\n", galleryCount, thumbCount);
+  }
+  return 0;
+}
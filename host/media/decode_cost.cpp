@@ -0,0 +1,61 @@
+// decode_cost.cpp
+
+#include "decode_cost.h"
+
+namespace media {
+
+namespace {
+const double kReadMsPerMB      = 250.0;   // FFat, ~4 MB/s
+const double kHuffUsPerByte    = 0.25;    // TJpgDec bit-by-bit Huffman
+const double kIdctUsPerBlock   = 7.0;     // dequantise + IDCT, one 8x8 block
+const double kYccUsPerPixel    = 0.05;    // YCbCr -> RGB565
+const double kLzwUsPerPixel    = 0.10;    // AnimatedGIF, per output index
+const double kLzwUsPerByte     = 0.05;    // code unpacking
+const double kPaletteUsPerPixel = 0.02;   // gifDraw() line expansion
+const double kPushUsPerPixel   = 0.03;    // into the panel frame buffer
+const double kQoiUsPerPixel    = 0.08;    // op dispatch, cache, RGB565
+const double kQoiUsPerByte     = 0.02;
+const double kTwoCoreShare     = 0.55;    // decode time left with a band per core
+} // namespace
+
+DecodeCost fileReadCost(size_t fileBytes) {
+  DecodeCost c;
+  c.readMs = fileBytes * kReadMsPerMB / (1024.0 * 1024.0);
+  return c;
+}
+
+DecodeCost jpegCost(const JpegInfo& info, size_t fileBytes) {
+  DecodeCost c = fileReadCost(fileBytes);
+  const int mcuW = 8 * info.hSamp, mcuH = 8 * info.vSamp;
+  const long mcus = (long)((info.w + mcuW - 1) / mcuW) * ((info.h + mcuH - 1) / mcuH);
+  const int blocksPerMcu = info.components >= 3 ? info.hSamp * info.vSamp + 2 : info.hSamp * info.vSamp;
+  const double pixels = (double)info.w * info.h;
+  c.decodeMs = (fileBytes * kHuffUsPerByte + mcus * blocksPerMcu * kIdctUsPerBlock + pixels * kYccUsPerPixel) / 1000.0;
+  if (info.rowRestarts()) c.decodeMs *= kTwoCoreShare;
+  c.drawMs = pixels * kPushUsPerPixel / 1000.0;
+  return c;
+}
+
+DecodeCost qoiCost(int w, int h, size_t fileBytes) {
+  DecodeCost c = fileReadCost(fileBytes);
+  const double pixels = (double)w * h;
+  c.decodeMs = (pixels * kQoiUsPerPixel + fileBytes * kQoiUsPerByte) / 1000.0;
+  c.drawMs = pixels * kPushUsPerPixel / 1000.0;
+  return c;
+}
+
+DecodeCost gifFrameCost(int w, int h, size_t lzwBytes) {
+  DecodeCost c;
+  const double pixels = (double)w * h;
+  c.decodeMs = (pixels * kLzwUsPerPixel + lzwBytes * kLzwUsPerByte) / 1000.0;
+  c.drawMs = pixels * (kPaletteUsPerPixel + kPushUsPerPixel) / 1000.0;
+  return c;
+}
+
+DecodeCost rawFrameCost(int w, int h) {
+  DecodeCost c = fileReadCost((size_t)w * h * 2);
+  c.drawMs = (double)w * h * kPushUsPerPixel / 1000.0;
+  return c;
+}
+
+} // namespace media
@@ -0,0 +1,35 @@
+// decode_cost.h
+//
+// Predicted time for the display to put an image on screen. The model is
+// simple: FFat read throughput; TJpgDec's Huffman decode per compressed byte
+// and IDCT per 8x8 block; AnimatedGIF's LZW and the QOI decoder per pixel;
+// and the copy of each pixel into the RGB panel's PSRAM frame buffer. The
+// constants are rough ESP32-S3 (240 MHz, QIO flash) figures. Use the numbers to compare versions
+// of the same content, not as a stopwatch.
+#pragma once
+#include "jpeg_io.h"
+#include <cstddef>
+
+namespace media {
+
+struct DecodeCost {
+  double readMs = 0, decodeMs = 0, drawMs = 0;
+  double total() const { return readMs + decodeMs + drawMs; }
+  DecodeCost& operator+=(const DecodeCost& o) { readMs += o.readMs; decodeMs += o.decodeMs; drawMs += o.drawMs; return *this; }
+};
+
+// A whole JPEG file (the display reads it into PSRAM, then drawJpg(), or
+// decodes it on both cores when it has restart markers at MCU rows).
+DecodeCost jpegCost(const JpegInfo& info, size_t fileBytes);
+
+// A whole QOI file (read into PSRAM, then decoded a strip at a time).
+DecodeCost qoiCost(int w, int h, size_t fileBytes);
+
+// Reading a GIF into PSRAM before the first frame.
+DecodeCost fileReadCost(size_t fileBytes);
+// One GIF frame of w x h pixels from lzwBytes of data.
+DecodeCost gifFrameCost(int w, int h, size_t lzwBytes);
+// One raw RGB565 frame (.565), read straight from the file.
+DecodeCost rawFrameCost(int w, int h);
+
+} // namespace media
@@ -0,0 +1,202 @@
+// gif_dec.cpp
+
+#include "gif_dec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace media {
+
+namespace {
+
+struct Reader {
+  const uint8_t* d;
+  size_t n, p = 0;
+  bool ok = true;
+  Reader(const uint8_t* d_, size_t n_) : d(d_), n(n_) {}
+  uint8_t u8() { if (p >= n) { ok = false; return 0; } return d[p++]; }
+  int u16() { const int lo = u8(); return lo | (u8() << 8); }
+  void skip(size_t k) { if (p + k > n) { ok = false; p = n; } else p += k; }
+  // Concatenates a chain of data sub-blocks
+  std::vector<uint8_t> blocks() {
+    std::vector<uint8_t> v;
+    for (;;) {
+      const uint8_t k = u8();
+      if (!ok || k == 0) break;
+      if (p + k > n) { ok = false; break; }
+      v.insert(v.end(), d + p, d + p + k);
+      p += k;
+    }
+    return v;
+  }
+};
+
+static std::vector<Rgb> readPalette(Reader& r, int entries) {
+  std::vector<Rgb> pal((size_t)entries);
+  for (auto& c : pal) { c.r = r.u8(); c.g = r.u8(); c.b = r.u8(); }
+  return pal;
+}
+
+// Variable-width LZW, codes LSB first. Short streams leave the tail at index 0.
+static bool lzw(const std::vector<uint8_t>& in, int minCode, std::vector<uint8_t>& out, size_t want) {
+  if (minCode < 2 || minCode > 11) return false;
+  const int clear = 1 << minCode, eoi = clear + 1;
+  uint16_t prefix[4096];
+  uint8_t suffix[4096], first[4096], stack[4097];
+  for (int i = 0; i < clear; ++i) { prefix[i] = 0xFFFF; suffix[i] = first[i] = (uint8_t)i; }
+
+  int size = minCode + 1, next = eoi + 1, prev = -1;
+  uint32_t acc = 0;
+  int bits = 0;
+  size_t bp = 0;
+  out.clear();
+  out.reserve(want);
+  while (out.size() < want) {
+    while (bits < size && bp < in.size()) { acc |= (uint32_t)in[bp++] << bits; bits += 8; }
+    if (bits < size) break;
+    int code = (int)(acc & ((1u << size) - 1));
+    acc >>= size;
+    bits -= size;
+
+    if (code == clear) { size = minCode + 1; next = eoi + 1; prev = -1; continue; }
+    if (code == eoi) break;
+    if (prev < 0) {
+      if (code >= clear) return false;
+      out.push_back((uint8_t)code);
+      prev = code;
+      continue;
+    }
+    int sp = 0, c = code;
+    uint8_t firstCh;
+    if (code < next) {
+      firstCh = first[code];
+    } else if (code == next) {         // KwKwK
+      firstCh = first[prev];
+      stack[sp++] = firstCh;
+      c = prev;
+    } else {
+      return false;
+    }
+    while (c >= clear) { stack[sp++] = suffix[c]; c = prefix[c]; }
+    stack[sp++] = (uint8_t)c;
+    while (sp > 0 && out.size() < want) out.push_back(stack[--sp]);
+
+    if (next < 4096) {
+      prefix[next] = (uint16_t)prev;
+      suffix[next] = firstCh;
+      first[next] = first[prev];
+      ++next;
+      if (next == (1 << size) && size < 12) ++size;
+    }
+    prev = code;
+  }
+  out.resize(want, 0);
+  return true;
+}
+
+} // namespace
+
+bool gifDecode(const uint8_t* data, size_t len, Gif& g, std::string* err) {
+  auto fail = [&](const char* why) { if (err) *err = why; return false; };
+  g = Gif();
+  Reader r(data, len);
+  if (len < 13 || (memcmp(data, "GIF87a", 6) != 0 && memcmp(data, "GIF89a", 6) != 0)) return fail("not a GIF");
+  r.skip(6);
+  g.width = r.u16();
+  g.height = r.u16();
+  const uint8_t flags = r.u8();
+  g.background = r.u8();
+  r.u8();   // aspect
+  if (flags & 0x80) g.globalPalette = readPalette(r, 2 << (flags & 7));
+
+  int delay = 0, disposal = 0, transparent = -1;
+  while (r.ok) {
+    const uint8_t b = r.u8();
+    if (!r.ok || b == 0x3B) break;   // trailer (or truncated: keep what we have)
+    if (b == 0x21) {
+      const uint8_t label = r.u8();
+      std::vector<uint8_t> v = r.blocks();
+      if (label == 0xF9 && v.size() >= 4) {
+        disposal = (v[0] >> 2) & 7;
+        delay = v[1] | (v[2] << 8);
+        transparent = (v[0] & 1) ? v[3] : -1;
+      } else if (label == 0xFF && v.size() >= 14 && memcmp(v.data(), "NETSCAPE2.0", 11) == 0 && v[11] == 1) {
+        g.loopCount = v[12] | (v[13] << 8);
+      }
+    } else if (b == 0x2C) {
+      GifFrame f;
+      f.x = r.u16(); f.y = r.u16(); f.w = r.u16(); f.h = r.u16();
+      const uint8_t ff = r.u8();
+      f.localPalette = ff & 0x80;
+      const bool interlaced = ff & 0x40;
+      f.palette = f.localPalette ? readPalette(r, 2 << (ff & 7)) : g.globalPalette;
+      const int minCode = r.u8();
+      std::vector<uint8_t> lz = r.blocks();
+      if (!r.ok && lz.empty()) break;
+      if (f.w <= 0 || f.h <= 0) continue;
+      std::vector<uint8_t> px;
+      if (!lzw(lz, minCode, px, (size_t)f.w * f.h)) return fail("bad LZW data");
+      if (interlaced) {
+        f.pixels.resize(px.size());
+        static const int start[4] = {0, 4, 2, 1}, step[4] = {8, 8, 4, 2};
+        int row = 0;
+        for (int pass = 0; pass < 4; ++pass)
+          for (int y = start[pass]; y < f.h; y += step[pass], ++row)
+            memcpy(&f.pixels[(size_t)y * f.w], &px[(size_t)row * f.w], (size_t)f.w);
+      } else {
+        f.pixels = std::move(px);
+      }
+      f.dataBytes = lz.size();
+      f.delayCs = delay;
+      f.disposal = disposal;
+      f.transparent = transparent;
+      g.frames.push_back(std::move(f));
+      delay = 0; disposal = 0; transparent = -1;   // a GCE applies to one image
+    } else {
+      break;   // unknown block: stop, keep the frames so far
+    }
+  }
+  if (g.frames.empty()) return fail("no frames");
+  return true;
+}
+
+GifPlayer::GifPlayer(const Gif& g) : g_(g), canvas_((size_t)g.width * g.height * 4, 0) {}
+
+void GifPlayer::draw(size_t i) {
+  if (i >= g_.frames.size()) return;
+  if (last_) {
+    if (lastDisposal_ == 2) {
+      for (int y = std::max(0, last_->y); y < std::min(g_.height, last_->y + last_->h); ++y)
+        for (int x = std::max(0, last_->x); x < std::min(g_.width, last_->x + last_->w); ++x)
+          memset(&canvas_[((size_t)y * g_.width + x) * 4], 0, 4);
+    } else if (lastDisposal_ == 3 && !saved_.empty()) {
+      canvas_ = saved_;
+    }
+  }
+  const GifFrame& f = g_.frames[i];
+  if (f.disposal == 3) saved_ = canvas_;
+  for (int y = 0; y < f.h; ++y) {
+    const int cy = f.y + y;
+    if (cy < 0 || cy >= g_.height) continue;
+    for (int x = 0; x < f.w; ++x) {
+      const int cx = f.x + x;
+      if (cx < 0 || cx >= g_.width) continue;
+      const uint8_t idx = f.pixels[(size_t)y * f.w + x];
+      if ((int)idx == f.transparent || idx >= f.palette.size()) continue;
+      uint8_t* o = &canvas_[((size_t)cy * g_.width + cx) * 4];
+      o[0] = f.palette[idx].r; o[1] = f.palette[idx].g; o[2] = f.palette[idx].b; o[3] = 255;
+    }
+  }
+  last_ = &f;
+  lastDisposal_ = f.disposal;
+}
+
+Image GifPlayer::flatten(uint8_t bg) const {
+  Image out(g_.width, g_.height);
+  for (size_t i = 0; i < (size_t)g_.width * g_.height; ++i) {
+    const uint8_t* c = &canvas_[i * 4];
+    for (int k = 0; k < 3; ++k) out.rgb[i * 3 + k] = c[3] ? c[k] : bg;
+  }
+  return out;
+}
+
+} // namespace media
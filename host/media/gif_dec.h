@@ -0,0 +1,53 @@
+// gif_dec.h
+//
+// GIF87a/89a decoder for the host media tools. Frames come out as palette
+// indices with their own rectangle, delay and disposal, as stored; Player
+// composites them onto a full canvas the way AnimatedGIF plays them on the
+// display.
+#pragma once
+#include "image.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace media {
+
+struct GifFrame {
+  int x = 0, y = 0, w = 0, h = 0;
+  int delayCs = 0;            // 1/100 s, as stored (0 = "as fast as possible")
+  int disposal = 0;           // 0/1 keep, 2 restore background, 3 restore previous
+  int transparent = -1;       // palette index, or -1
+  bool localPalette = false;
+  std::vector<Rgb> palette;   // the local table, or a copy of the global one
+  std::vector<uint8_t> pixels; // w * h indices, de-interlaced
+  size_t dataBytes = 0;        // LZW data as stored
+};
+
+struct Gif {
+  int width = 0, height = 0;
+  int background = 0;
+  int loopCount = -1;         // -1 = no NETSCAPE2.0 block (play once), 0 = forever
+  std::vector<Rgb> globalPalette;
+  std::vector<GifFrame> frames;
+};
+
+bool gifDecode(const uint8_t* data, size_t len, Gif& out, std::string* err = nullptr);
+
+// Canvas RGBA (alpha 0 = nothing drawn yet), advanced one frame at a time.
+class GifPlayer {
+ public:
+  explicit GifPlayer(const Gif& g);
+  // Applies the previous frame's disposal, then draws frame i (in order).
+  void draw(size_t i);
+  const std::vector<uint8_t>& rgba() const { return canvas_; }
+  Image flatten(uint8_t bg = 0) const;   // alpha 0 -> bg
+
+ private:
+  const Gif& g_;
+  std::vector<uint8_t> canvas_, saved_;
+  int lastDisposal_ = 0;
+  const GifFrame* last_ = nullptr;
+};
+
+} // namespace media
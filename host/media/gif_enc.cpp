@@ -0,0 +1,153 @@
+// gif_enc.cpp
+
+#include "gif_enc.h"
+#include <cstring>
+
+namespace media {
+
+namespace {
+
+struct BitWriter {
+  std::vector<uint8_t> bytes;
+  uint32_t acc = 0;
+  int bits = 0;
+  void put(int code, int size) {
+    acc |= (uint32_t)code << bits;
+    bits += size;
+    while (bits >= 8) { bytes.push_back((uint8_t)acc); acc >>= 8; bits -= 8; }
+  }
+  void flush() { if (bits > 0) bytes.push_back((uint8_t)acc); acc = 0; bits = 0; }
+};
+
+// (prefix code, next index) -> code, open addressing; a generation stamp
+// empties it on every clear code without touching the memory.
+class Dict {
+ public:
+  Dict() : key_(kSize), val_(kSize), gen_(kSize, 0) {}
+  void clear() { ++cur_; }
+  int find(uint32_t k, size_t& slot) const {
+    slot = (k * 2654435761u) >> (32 - kBits);
+    while (gen_[slot] == cur_) {
+      if (key_[slot] == k) return val_[slot];
+      slot = (slot + 1) & (kSize - 1);
+    }
+    return -1;
+  }
+  void put(size_t slot, uint32_t k, int v) { key_[slot] = k; val_[slot] = (uint16_t)v; gen_[slot] = cur_; }
+
+ private:
+  static constexpr int kBits = 14;
+  static constexpr size_t kSize = 1u << kBits;
+  std::vector<uint32_t> key_;
+  std::vector<uint16_t> val_;
+  std::vector<uint32_t> gen_;
+  uint32_t cur_ = 1;
+};
+
+static std::vector<uint8_t> lzw(const std::vector<uint8_t>& px, int minCode) {
+  const int clear = 1 << minCode, eoi = clear + 1;
+  int size = minCode + 1, next = eoi + 1;
+  BitWriter w;
+  Dict dict;
+  w.put(clear, size);
+  int cur = -1;
+  for (uint8_t c : px) {
+    if (cur < 0) { cur = c; continue; }
+    const uint32_t k = ((uint32_t)cur << 8) | c;
+    size_t slot;
+    const int hit = dict.find(k, slot);
+    if (hit >= 0) { cur = hit; continue; }
+    w.put(cur, size);
+    if (next < 4096) {
+      dict.put(slot, k, next);
+      // The decoder builds each entry one code later, so it widens here too
+      if (next++ == (1 << size) && size < 12) size++;
+    } else {
+      w.put(clear, size);
+      dict.clear();
+      size = minCode + 1;
+      next = eoi + 1;
+    }
+    cur = c;
+  }
+  if (cur >= 0) w.put(cur, size);
+  w.put(eoi, size);
+  w.flush();
+  return std::move(w.bytes);
+}
+
+static int tableBits(size_t n) {
+  int b = 1;
+  while ((1u << b) < n) b++;
+  return b;
+}
+
+static void putPalette(std::vector<uint8_t>& o, const std::vector<Rgb>& pal, int bits) {
+  for (size_t i = 0; i < (1u << bits); ++i) {
+    const Rgb c = i < pal.size() ? pal[i] : Rgb{0, 0, 0};
+    o.push_back(c.r); o.push_back(c.g); o.push_back(c.b);
+  }
+}
+
+static void put16(std::vector<uint8_t>& o, int v) { o.push_back((uint8_t)v); o.push_back((uint8_t)(v >> 8)); }
+
+} // namespace
+
+std::vector<uint8_t> gifLzw(const std::vector<uint8_t>& pixels, int minCode) {
+  return lzw(pixels, minCode);
+}
+
+bool gifEncode(const Gif& g, std::vector<uint8_t>& out, std::vector<size_t>* frameBytes) {
+  out.clear();
+  if (frameBytes) frameBytes->clear();
+  if (g.width <= 0 || g.height <= 0 || g.width > 65535 || g.height > 65535) return false;
+  const char sig[] = "GIF89a";
+  out.insert(out.end(), sig, sig + 6);
+  put16(out, g.width);
+  put16(out, g.height);
+  const bool global = !g.globalPalette.empty() && g.globalPalette.size() <= 256;
+  const int gBits = global ? tableBits(g.globalPalette.size()) : 1;
+  out.push_back(global ? (uint8_t)(0x80 | ((gBits - 1) << 4) | (gBits - 1)) : 0);
+  out.push_back((uint8_t)g.background);
+  out.push_back(0);
+  if (global) putPalette(out, g.globalPalette, gBits);
+
+  if (g.loopCount >= 0) {
+    const uint8_t app[] = { 0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1 };
+    out.insert(out.end(), app, app + sizeof(app));
+    put16(out, g.loopCount);
+    out.push_back(0);
+  }
+
+  for (const GifFrame& f : g.frames) {
+    const std::vector<Rgb>& pal = f.localPalette ? f.palette : g.globalPalette;
+    if (pal.empty() || pal.size() > 256 || f.w <= 0 || f.h <= 0 || f.pixels.size() != (size_t)f.w * f.h) return false;
+    const int bits = tableBits(pal.size());
+
+    out.push_back(0x21); out.push_back(0xF9); out.push_back(4);
+    out.push_back((uint8_t)(((f.disposal & 7) << 2) | (f.transparent >= 0 ? 1 : 0)));
+    put16(out, f.delayCs);
+    out.push_back(f.transparent >= 0 ? (uint8_t)f.transparent : 0);
+    out.push_back(0);
+
+    out.push_back(0x2C);
+    put16(out, f.x); put16(out, f.y); put16(out, f.w); put16(out, f.h);
+    out.push_back(f.localPalette ? (uint8_t)(0x80 | (bits - 1)) : 0);
+    if (f.localPalette) putPalette(out, f.palette, bits);
+
+    const int minCode = bits < 2 ? 2 : bits;
+    const std::vector<uint8_t> lz = lzw(f.pixels, minCode);
+    out.push_back((uint8_t)minCode);
+    for (size_t p = 0; p < lz.size(); p += 255) {
+      const size_t k = lz.size() - p < 255 ? lz.size() - p : 255;
+      out.push_back((uint8_t)k);
+      out.insert(out.end(), lz.begin() + p, lz.begin() + p + k);
+    }
+    out.push_back(0);
+    if (frameBytes) frameBytes->push_back(lz.size());
+  }
+  out.push_back(0x3B);
+  return true;
+}
+
+} // namespace media
@@ -0,0 +1,19 @@
+// gif_enc.h
+//
+// GIF89a writer, the inverse of gif_dec.h: frames are written as given
+// (rectangle, delay, disposal, transparency, local or global palette).
+#pragma once
+#include "gif_dec.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+// One frame's LZW data, without the sub-block framing
+std::vector<uint8_t> gifLzw(const std::vector<uint8_t>& pixels, int minCode);
+
+// frameBytes, if given, gets the LZW data size of each frame.
+bool gifEncode(const Gif& g, std::vector<uint8_t>& out, std::vector<size_t>* frameBytes = nullptr);
+
+} // namespace media
@@ -0,0 +1,62 @@
+// image.cpp
+
+#include "image.h"
+#include <algorithm>
+
+namespace media {
+
+Image resize(const Image& src, int w, int h) {
+  Image out(w, h);
+  if (src.w <= 0 || src.h <= 0 || w <= 0 || h <= 0) return out;
+  const double sx = (double)src.w / w, sy = (double)src.h / h;
+  for (int y = 0; y < h; ++y) {
+    const double y0 = y * sy, y1 = y0 + sy;
+    for (int x = 0; x < w; ++x) {
+      const double x0 = x * sx, x1 = x0 + sx;
+      double acc[3] = {0, 0, 0}, area = 0;
+      for (int yy = (int)y0; yy < std::min((double)src.h, y1); ++yy) {
+        const double wy = std::min<double>(yy + 1, y1) - std::max<double>(yy, y0);
+        if (wy <= 0) continue;
+        for (int xx = (int)x0; xx < std::min((double)src.w, x1); ++xx) {
+          const double wx = std::min<double>(xx + 1, x1) - std::max<double>(xx, x0);
+          if (wx <= 0) continue;
+          const uint8_t* p = src.px(xx, yy);
+          const double a = wx * wy;
+          acc[0] += p[0] * a; acc[1] += p[1] * a; acc[2] += p[2] * a;
+          area += a;
+        }
+      }
+      uint8_t* o = out.px(x, y);
+      for (int c = 0; c < 3; ++c) o[c] = (uint8_t)std::min(255.0, acc[c] / (area > 0 ? area : 1) + 0.5);
+    }
+  }
+  return out;
+}
+
+Image fit(const Image& src, int boxW, int boxH, uint8_t bg) {
+  Image out(boxW, boxH, bg);
+  if (src.w <= 0 || src.h <= 0) return out;
+  int w = boxW, h = (int)((int64_t)src.h * boxW / src.w);
+  if (h > boxH) { h = boxH; w = (int)((int64_t)src.w * boxH / src.h); }
+  w = std::max(1, w);
+  h = std::max(1, h);
+  const Image s = (w == src.w && h == src.h) ? src : resize(src, w, h);
+  const int ox = (boxW - w) / 2, oy = (boxH - h) / 2;
+  for (int y = 0; y < h; ++y)
+    std::copy(s.px(0, y), s.px(0, y) + (size_t)w * 3, out.px(ox, oy + y));
+  return out;
+}
+
+Image cover(const Image& src, int boxW, int boxH) {
+  if (src.w <= 0 || src.h <= 0) return Image(boxW, boxH);
+  int w = boxW, h = (int)(((int64_t)src.h * boxW + src.w - 1) / src.w);
+  if (h < boxH) { h = boxH; w = (int)(((int64_t)src.w * boxH + src.h - 1) / src.h); }
+  const Image s = (w == src.w && h == src.h) ? src : resize(src, w, h);
+  Image out(boxW, boxH);
+  const int ox = (w - boxW) / 2, oy = (h - boxH) / 2;
+  for (int y = 0; y < boxH; ++y)
+    std::copy(s.px(ox, oy + y), s.px(ox, oy + y) + (size_t)boxW * 3, out.px(0, y));
+  return out;
+}
+
+} // namespace media
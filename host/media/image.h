@@ -0,0 +1,38 @@
+// image.h
+//
+// RGB888 frames for the host media tools, and the resampling they share.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+struct Rgb { uint8_t r, g, b; };
+
+struct Image {
+  int w = 0, h = 0;
+  std::vector<uint8_t> rgb;   // w * h * 3, top row first
+  Image() = default;
+  Image(int w_, int h_, uint8_t fill = 0) : w(w_), h(h_), rgb((size_t)w_ * h_ * 3, fill) {}
+  uint8_t* px(int x, int y) { return &rgb[((size_t)y * w + x) * 3]; }
+  const uint8_t* px(int x, int y) const { return &rgb[((size_t)y * w + x) * 3]; }
+};
+
+// Area-average resize (every source pixel contributes by overlap), so
+// downscaling by large factors doesn't alias.
+Image resize(const Image& src, int w, int h);
+
+// Scales to fit inside boxW x boxH keeping the aspect ratio and centres the
+// result on a `bg` background.
+Image fit(const Image& src, int boxW, int boxH, uint8_t bg = 0);
+
+// Scales to cover boxW x boxH keeping the aspect ratio and crops the centre.
+Image cover(const Image& src, int boxW, int boxH);
+
+// RGB565 as the panel takes it (pushImage byte order is handled by LGFX).
+inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+} // namespace media
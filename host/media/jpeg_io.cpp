@@ -0,0 +1,149 @@
+// jpeg_io.cpp
+
+#include "jpeg_io.h"
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+
+namespace media {
+
+bool jpegProbe(const uint8_t* d, size_t len, JpegInfo& out) {
+  out = JpegInfo();
+  if (len < 4 || d[0] != 0xFF || d[1] != 0xD8) return false;
+  size_t p = 2;
+  while (p + 4 <= len) {
+    if (d[p] != 0xFF) return false;
+    const uint8_t m = d[p + 1];
+    if (m == 0xFF) { ++p; continue; }                 // fill byte
+    if (m == 0xD8 || (m >= 0xD0 && m <= 0xD7) || m == 0x01) { p += 2; continue; }
+    if (m == 0xD9 || m == 0xDA) return out.w > 0 && out.h > 0;   // SOF seen?
+    const size_t segLen = ((size_t)d[p + 2] << 8) | d[p + 3];
+    if (segLen < 2 || p + 2 + segLen > len) return false;
+    const uint8_t* s = d + p + 4;
+    if (m == 0xDD) {
+      out.restart = true;
+      out.restartMcus = (s[0] << 8) | s[1];
+    }
+    const bool sof = m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+    if (sof) {
+      if (segLen < 8) return false;
+      out.h = (s[1] << 8) | s[2];
+      out.w = (s[3] << 8) | s[4];
+      out.components = s[5];
+      if (out.components > 0 && segLen >= 8 + 3) {
+        out.hSamp = s[7] >> 4;
+        out.vSamp = s[7] & 0x0F;
+      }
+      out.progressive = (m == 0xC2 || m == 0xC6 || m == 0xCA || m == 0xCE);
+      out.arithmetic = m >= 0xC9;
+      if (out.w <= 0 || out.h <= 0) return false;
+    }
+    p += 2 + segLen;
+  }
+  return false;
+}
+
+// libjpeg reports fatal errors through error_exit; jump back instead of exit()
+struct ErrMgr {
+  jpeg_error_mgr pub;
+  jmp_buf jb;
+};
+static void onError(j_common_ptr c) { longjmp(((ErrMgr*)c->err)->jb, 1); }
+static void onMessage(j_common_ptr) {}
+
+bool jpegDecode(const uint8_t* data, size_t len, Image& out, int scaleDenom) {
+  jpeg_decompress_struct c;
+  ErrMgr err;
+  c.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onError;
+  err.pub.output_message = onMessage;
+  if (setjmp(err.jb)) { jpeg_destroy_decompress(&c); return false; }
+  jpeg_create_decompress(&c);
+  jpeg_mem_src(&c, const_cast<unsigned char*>(data), (unsigned long)len);
+  if (jpeg_read_header(&c, TRUE) != JPEG_HEADER_OK) { jpeg_destroy_decompress(&c); return false; }
+  c.out_color_space = JCS_RGB;
+  c.scale_num = 1;
+  c.scale_denom = (unsigned)scaleDenom;
+  jpeg_start_decompress(&c);
+  out = Image((int)c.output_width, (int)c.output_height);
+  while (c.output_scanline < c.output_height) {
+    JSAMPROW row = out.px(0, (int)c.output_scanline);
+    jpeg_read_scanlines(&c, &row, 1);
+  }
+  jpeg_finish_decompress(&c);
+  jpeg_destroy_decompress(&c);
+  return true;
+}
+
+bool jpegEncode(const Image& img, int quality, std::vector<uint8_t>& out, bool sub420) {
+  jpeg_compress_struct c;
+  ErrMgr err;
+  unsigned char* buf = nullptr;
+  unsigned long size = 0;
+  c.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onError;
+  err.pub.output_message = onMessage;
+  if (setjmp(err.jb)) { jpeg_destroy_compress(&c); free(buf); return false; }
+  jpeg_create_compress(&c);
+  jpeg_mem_dest(&c, &buf, &size);
+  c.image_width = (JDIMENSION)img.w;
+  c.image_height = (JDIMENSION)img.h;
+  c.input_components = 3;
+  c.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&c);
+  jpeg_set_quality(&c, quality, TRUE);
+  c.optimize_coding = TRUE;
+  c.comp_info[0].h_samp_factor = c.comp_info[0].v_samp_factor = sub420 ? 2 : 1;
+  c.restart_in_rows = 1;
+  jpeg_start_compress(&c, TRUE);
+  while (c.next_scanline < c.image_height) {
+    JSAMPROW row = const_cast<uint8_t*>(img.px(0, (int)c.next_scanline));
+    jpeg_write_scanlines(&c, &row, 1);
+  }
+  jpeg_finish_compress(&c);
+  out.assign(buf, buf + size);
+  jpeg_destroy_compress(&c);
+  free(buf);
+  return true;
+}
+
+bool jpegAddRestarts(const uint8_t* data, size_t len, std::vector<uint8_t>& out) {
+  jpeg_decompress_struct d;
+  jpeg_compress_struct c;
+  ErrMgr err;   // one manager serves both objects
+  unsigned char* buf = nullptr;
+  unsigned long size = 0;
+  d.err = c.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = onError;
+  err.pub.output_message = onMessage;
+  jpeg_create_decompress(&d);
+  jpeg_create_compress(&c);
+  if (setjmp(err.jb)) {
+    jpeg_destroy_compress(&c);
+    jpeg_destroy_decompress(&d);
+    free(buf);
+    return false;
+  }
+  jpeg_mem_src(&d, const_cast<unsigned char*>(data), (unsigned long)len);
+  if (jpeg_read_header(&d, TRUE) != JPEG_HEADER_OK || jpeg_has_multiple_scans(&d)) {
+    jpeg_destroy_compress(&c);
+    jpeg_destroy_decompress(&d);
+    return false;
+  }
+  jvirt_barray_ptr* coefs = jpeg_read_coefficients(&d);
+  jpeg_copy_critical_parameters(&d, &c);
+  c.optimize_coding = TRUE;
+  c.restart_in_rows = 1;
+  jpeg_mem_dest(&c, &buf, &size);
+  jpeg_write_coefficients(&c, coefs);
+  jpeg_finish_compress(&c);
+  jpeg_finish_decompress(&d);
+  out.assign(buf, buf + size);
+  jpeg_destroy_compress(&c);
+  jpeg_destroy_decompress(&d);
+  free(buf);
+  return true;
+}
+
+} // namespace media
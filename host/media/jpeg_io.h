@@ -0,0 +1,45 @@
+// jpeg_io.h
+//
+// JPEG for the host media tools: a header probe that needs no library, and
+// decode/encode through libjpeg.
+#pragma once
+#include "image.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+struct JpegInfo {
+  int w = 0, h = 0;
+  int components = 0;
+  int hSamp = 1, vSamp = 1;   // of the first component: 2x2 = 4:2:0
+  bool progressive = false;   // SOF2; TJpgDec only draws baseline (SOF0/SOF1)
+  bool arithmetic = false;    // SOF9+
+  bool restart = false;       // has a DRI marker
+  int restartMcus = 0;        // its interval
+
+  // A restart marker begins every MCU row (or every few): the display can
+  // decode the image as two bands, one per core (../../src/jpeg_dec.h).
+  bool rowRestarts() const {
+    const int mcuW = components >= 3 ? 8 * hSamp : 8;
+    return restartMcus > 0 && ((w + mcuW - 1) / mcuW) % restartMcus == 0;
+  }
+};
+
+// Walks the markers up to the first scan. False if it isn't a JPEG.
+bool jpegProbe(const uint8_t* data, size_t len, JpegInfo& out);
+
+// scaleDenom 1, 2, 4 or 8: libjpeg's DCT scaling, far cheaper than resizing
+// a full decode for thumbnails.
+bool jpegDecode(const uint8_t* data, size_t len, Image& out, int scaleDenom = 1);
+
+// Baseline, 4:2:0 (sub420) or 4:4:4, optimised Huffman tables, a restart
+// marker at every MCU row.
+bool jpegEncode(const Image& img, int quality, std::vector<uint8_t>& out, bool sub420 = true);
+
+// Rewrites the entropy-coded data with a restart marker at every MCU row.
+// Lossless: the DCT coefficients are copied, not decoded to pixels.
+bool jpegAddRestarts(const uint8_t* data, size_t len, std::vector<uint8_t>& out);
+
+} // namespace media
@@ -0,0 +1,68 @@
+// qoi_enc.cpp
+
+#include "qoi_enc.h"
+#include "quantize.h"
+#include <cstring>
+
+namespace media {
+
+namespace {
+struct Px { uint8_t r, g, b; };
+inline bool operator==(Px a, Px b) { return a.r == b.r && a.g == b.g && a.b == b.b; }
+inline int hash(Px p) { return (p.r * 3 + p.g * 5 + p.b * 7 + 255 * 11) & 63; }
+void put32be(std::vector<uint8_t>& o, uint32_t v) {
+  for (int s = 24; s >= 0; s -= 8) o.push_back((uint8_t)(v >> s));
+}
+} // namespace
+
+void qoiEncode(const Image& img, std::vector<uint8_t>& out, bool to565) {
+  out.clear();
+  out.insert(out.end(), {'q', 'o', 'i', 'f'});
+  put32be(out, (uint32_t)img.w);
+  put32be(out, (uint32_t)img.h);
+  out.push_back(3);   // RGB
+  out.push_back(0);   // sRGB
+
+  Px cache[64];
+  bool used[64] = {};
+  Px prev = {0, 0, 0};
+  int run = 0;
+  const size_t n = (size_t)img.w * img.h;
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t* s = &img.rgb[i * 3];
+    Px px = {s[0], s[1], s[2]};
+    if (to565) {
+      const Rgb e = expand565(key565(s));
+      px = {e.r, e.g, e.b};
+    }
+    if (px == prev) {
+      if (++run == 62 || i + 1 == n) { out.push_back((uint8_t)(0xC0 | (run - 1))); run = 0; }
+      continue;
+    }
+    if (run) { out.push_back((uint8_t)(0xC0 | (run - 1))); run = 0; }
+    const int h = hash(px);
+    // A slot that was never written holds (0,0,0,0), which no opaque pixel matches
+    if (used[h] && cache[h] == px) {
+      out.push_back((uint8_t)h);
+    } else {
+      cache[h] = px;
+      used[h] = true;
+      const int dr = (int8_t)(px.r - prev.r), dg = (int8_t)(px.g - prev.g), db = (int8_t)(px.b - prev.b);
+      const int drg = dr - dg, dbg = db - dg;
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+        out.push_back((uint8_t)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+      } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+        out.push_back((uint8_t)(0x80 | (dg + 32)));
+        out.push_back((uint8_t)(((drg + 8) << 4) | (dbg + 8)));
+      } else {
+        out.push_back(0xFE);
+        out.push_back(px.r); out.push_back(px.g); out.push_back(px.b);
+      }
+    }
+    prev = px;
+  }
+  static const uint8_t pad[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  out.insert(out.end(), pad, pad + 8);
+}
+
+} // namespace media
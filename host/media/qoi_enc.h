@@ -0,0 +1,16 @@
+// qoi_enc.h
+//
+// QOI writer for the host media tools (the display's decoder is
+// ../../src/qoi_dec.cpp). RGB, no alpha: the slideshow draws on black.
+#pragma once
+#include "image.h"
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+// Pixels are snapped to RGB565 first when to565 is set: the panel can't
+// show the difference, and the runs and cache hits get longer.
+void qoiEncode(const Image& img, std::vector<uint8_t>& out, bool to565 = true);
+
+} // namespace media
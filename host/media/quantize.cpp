@@ -0,0 +1,118 @@
+// quantize.cpp
+
+#include "quantize.h"
+#include <algorithm>
+
+namespace media {
+
+Rgb expand565(uint16_t c) {
+  const uint8_t r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+  return Rgb{ (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2)) };
+}
+
+void Histogram::add(const Image& img) {
+  for (size_t i = 0; i < img.rgb.size(); i += 3) n[key565(&img.rgb[i])]++;
+}
+
+size_t Histogram::colours() const {
+  return (size_t)std::count_if(n.begin(), n.end(), [](uint32_t v) { return v != 0; });
+}
+
+namespace {
+
+struct Entry { uint16_t c; uint32_t n; };
+
+struct Box {
+  size_t begin, end;    // into the entry list
+  uint64_t pixels;
+  int range[3];         // 8-bit span per channel
+  int widest() const { return range[0] >= range[1] && range[0] >= range[2] ? 0 : (range[1] >= range[2] ? 1 : 2); }
+  uint64_t score() const { return end - begin > 1 ? pixels * (uint64_t)range[widest()] : 0; }
+};
+
+static uint8_t channel(uint16_t c, int k) {
+  const Rgb v = expand565(c);
+  return k == 0 ? v.r : (k == 1 ? v.g : v.b);
+}
+
+static Box makeBox(const std::vector<Entry>& e, size_t b, size_t end) {
+  Box box{ b, end, 0, {0, 0, 0} };
+  int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+  for (size_t i = b; i < end; ++i) {
+    box.pixels += e[i].n;
+    for (int k = 0; k < 3; ++k) {
+      const int v = channel(e[i].c, k);
+      lo[k] = std::min(lo[k], v);
+      hi[k] = std::max(hi[k], v);
+    }
+  }
+  for (int k = 0; k < 3; ++k) box.range[k] = hi[k] - lo[k];
+  return box;
+}
+
+} // namespace
+
+std::vector<Rgb> buildPalette(const Histogram& h, int maxColours) {
+  std::vector<Entry> e;
+  for (uint32_t c = 0; c < 65536; ++c) if (h.n[c]) e.push_back(Entry{ (uint16_t)c, h.n[c] });
+  std::vector<Rgb> pal;
+  if ((int)e.size() <= maxColours) {
+    for (auto& x : e) pal.push_back(expand565(x.c));
+    return pal;
+  }
+
+  // Split the box with the most pixels times spread at its weighted median
+  std::vector<Box> boxes{ makeBox(e, 0, e.size()) };
+  while ((int)boxes.size() < maxColours) {
+    auto it = std::max_element(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) { return a.score() < b.score(); });
+    if (it->score() == 0) break;
+    const Box box = *it;
+    const int k = box.widest();
+    std::sort(e.begin() + box.begin, e.begin() + box.end,
+              [k](const Entry& a, const Entry& b) { return channel(a.c, k) < channel(b.c, k); });
+    uint64_t acc = 0;
+    size_t mid = box.begin;
+    while (mid < box.end - 1 && acc + e[mid].n <= box.pixels / 2) acc += e[mid++].n;
+    if (mid == box.begin) mid++;
+    *it = makeBox(e, box.begin, mid);
+    boxes.push_back(makeBox(e, mid, box.end));
+  }
+
+  // Weighted mean per box, snapped to RGB565 so the device shows it exactly
+  for (auto& box : boxes) {
+    uint64_t s[3] = {0, 0, 0};
+    for (size_t i = box.begin; i < box.end; ++i)
+      for (int k = 0; k < 3; ++k) s[k] += (uint64_t)channel(e[i].c, k) * e[i].n;
+    uint8_t m[3];
+    for (int k = 0; k < 3; ++k) m[k] = (uint8_t)((s[k] + box.pixels / 2) / box.pixels);
+    pal.push_back(expand565(key565(m)));
+  }
+  return pal;
+}
+
+PaletteMap::PaletteMap(const std::vector<Rgb>& pal) : pal_(pal), cache_(65536, -1) {}
+
+uint8_t PaletteMap::index(uint16_t c) {
+  if (cache_[c] >= 0) return (uint8_t)cache_[c];
+  const Rgb v = expand565(c);
+  int best = 0, bestD = 1 << 30;
+  for (size_t i = 0; i < pal_.size(); ++i) {
+    const int dr = v.r - pal_[i].r, dg = v.g - pal_[i].g, db = v.b - pal_[i].b;
+    const int d = dr * dr * 3 + dg * dg * 4 + db * db * 2;   // rough perceptual weights
+    if (d < bestD) { bestD = d; best = (int)i; }
+  }
+  cache_[c] = (int16_t)best;
+  return (uint8_t)best;
+}
+
+double PaletteMap::error(const Image& img) {
+  double sum = 0;
+  for (size_t i = 0; i < img.rgb.size(); i += 3) {
+    const Rgb& p = pal_[index(key565(&img.rgb[i]))];
+    const int dr = img.rgb[i] - p.r, dg = img.rgb[i + 1] - p.g, db = img.rgb[i + 2] - p.b;
+    sum += dr * dr + dg * dg + db * db;
+  }
+  return img.rgb.empty() ? 0 : sum / (double)img.rgb.size();
+}
+
+} // namespace media
@@ -0,0 +1,40 @@
+// quantize.h
+//
+// Palettes for GIF output. The panel shows RGB565, so colours are counted
+// and matched at that precision: anything finer is invisible on the display
+// and only costs palette entries.
+#pragma once
+#include "image.h"
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+inline uint16_t key565(const uint8_t* p) { return rgb565(p[0], p[1], p[2]); }
+Rgb expand565(uint16_t c);
+
+// Pixel counts per RGB565 colour (65536 entries)
+struct Histogram {
+  std::vector<uint32_t> n = std::vector<uint32_t>(65536, 0);
+  void add(const Image& img);
+  size_t colours() const;
+};
+
+// The histogram's colours if there are at most maxColours, else a median
+// cut down to maxColours. Entries are RGB565-exact.
+std::vector<Rgb> buildPalette(const Histogram& h, int maxColours);
+
+// Nearest palette entry per RGB565 colour, cached.
+class PaletteMap {
+ public:
+  explicit PaletteMap(const std::vector<Rgb>& pal);
+  uint8_t index(uint16_t c);
+  // Mean squared error (per channel, 8-bit units) of mapping img
+  double error(const Image& img);
+
+ private:
+  std::vector<Rgb> pal_;
+  std::vector<int16_t> cache_;
+};
+
+} // namespace media
@@ -0,0 +1,161 @@
+// tdquery.cpp
+//
+// Reads .tdl files written by tdrecord and exports a time range as CSV, or
+// prints a per-file summary (-s). Files can be given directly or as a
+// directory; the console is taken from the file name (td-<ip>-YYYYMMDD.tdl).
+//
+//   tdquery -f "2025-06-01 18:00" -t "2025-06-01 23:00" logs/ > evening.csv
+//   tdquery -c 192.168.1.50 -k exp logs/        # only 50505 status rows
+//   tdquery -s logs/                            # rows, bytes, bytes/row
+//   tdquery -x logs/                            # only rows where something changed
+
+#include "td_decode.h"
+#include "tlog.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// "YYYY-MM-DD[ HH:MM[:SS]]" local time, or unix seconds. -1 if unparsable.
+static int64_t parse_time(const char* s) {
+  struct tm tm {};
+  int n = sscanf(s, "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                 &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+  if (n >= 3) {
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    return (int64_t)mktime(&tm) * 1000;
+  }
+  char* end = nullptr;
+  const long long v = strtoll(s, &end, 10);
+  return (end && *end == 0 && end != s) ? v * 1000 : -1;
+}
+
+static std::string console_of(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  const std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+  const size_t a = base.find("td-"), b = base.rfind('-');
+  return (a == 0 && b != std::string::npos && b > 3) ? base.substr(3, b - 3) : base;
+}
+
+static void csv_str(const std::string& s) {
+  if (s.find_first_of(",\"\n\r") == std::string::npos) { fputs(s.c_str(), stdout); return; }
+  putchar('"');
+  for (char c : s) { if (c == '"') putchar('"'); putchar(c); }
+  putchar('"');
+}
+
+static void collect(const std::string& path, std::vector<std::string>& files) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) { fprintf(stderr, "tdquery: %s not found\n", path.c_str()); return; }
+  if (!S_ISDIR(st.st_mode)) { files.push_back(path); return; }
+  DIR* d = opendir(path.c_str());
+  if (!d) return;
+  while (struct dirent* e = readdir(d)) {
+    const std::string n = e->d_name;
+    if (n.size() > 4 && n.compare(n.size() - 4, 4, ".tdl") == 0) files.push_back(path + "/" + n);
+  }
+  closedir(d);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdquery [-f FROM] [-t TO] [-c CONSOLE] [-k KIND] [-x] [-s] FILE|DIR...\n"
+          "  -f/-t  range, \"YYYY-MM-DD[ HH:MM[:SS]]\" local or unix seconds (TO exclusive)\n"
+          "  -c     console address (from the file name)\n"
+          "  -k     frame kind: core, title, exp, exp_txt, ee, app\n"
+          "  -x     only rows whose decoded state differs from the previous row\n"
+          "  -s     summary per file instead of CSV\n");
+}
+
+int main(int argc, char** argv) {
+  int64_t from = INT64_MIN, to = INT64_MAX;
+  std::string console, kind;
+  bool summary = false, changesOnly = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "f:t:c:k:xsh")) != -1) {
+    switch (opt) {
+      case 'f': from = parse_time(optarg); break;
+      case 't': to = parse_time(optarg); break;
+      case 'c': console = optarg; break;
+      case 'k': kind = optarg; break;
+      case 'x': changesOnly = true; break;
+      case 's': summary = true; break;
+      default: usage(); return 2;
+    }
+  }
+  if (from == -1 || to == -1 || optind >= argc) { usage(); return 2; }
+
+  std::vector<std::string> files;
+  for (int i = optind; i < argc; ++i) collect(argv[i], files);
+  std::sort(files.begin(), files.end());   // per console, then by day
+
+  if (!summary) {
+    printf("time,unix_ms,console");
+    for (uint8_t i = 0; i < td::kNumCount; ++i) printf(",%s", td::numName(i));
+    for (uint8_t i = 0; i < td::kStrCount; ++i) printf(",%s", td::strName(i));
+    putchar('\n');
+  }
+
+  int rc = 0;
+  for (const std::string& path : files) {
+    const std::string who = console_of(path);
+    if (!console.empty() && who != console) continue;
+
+    size_t rows = 0, bad = 0;
+    int64_t first = 0, last = 0;
+    td::State prev;
+    bool havePrev = false;
+    const bool ok = tlog::readFile(path, [&](const tlog::Row& r) {
+      if (r.unixMs >= to) return false;   // rows are in time order within a file
+      if (r.unixMs < from) return true;
+      if (!kind.empty() && kind != td::frameName((td::Frame)r.st.num[td::Kind])) return true;
+      if (changesOnly && havePrev) {
+        bool same = true;
+        for (uint8_t i = 1; i < td::kNumCount && same; ++i) same = r.st.num[i] == prev.num[i];
+        for (uint8_t i = 0; i < td::kStrCount && same; ++i) same = r.st.str[i] == prev.str[i];
+        if (same) return true;
+      }
+      prev = r.st;
+      havePrev = true;
+      if (!rows) first = r.unixMs;
+      last = r.unixMs;
+      rows++;
+      if (summary) return true;
+
+      const time_t t = (time_t)(r.unixMs / 1000);
+      struct tm tm;
+      localtime_r(&t, &tm);
+      char ts[32];
+      strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm);
+      printf("%s.%03d,%lld,%s", ts, (int)(r.unixMs % 1000), (long long)r.unixMs, who.c_str());
+      for (uint8_t i = 0; i < td::kNumCount; ++i) {
+        if (i == td::Kind) printf(",%s", td::frameName((td::Frame)r.st.num[i]));
+        else if (i == td::TitleId) printf(",%08llX", (unsigned long long)r.st.num[i]);
+        else printf(",%lld", (long long)r.st.num[i]);
+      }
+      for (uint8_t i = 0; i < td::kStrCount; ++i) { putchar(','); csv_str(r.st.str[i]); }
+      putchar('\n');
+      return true;
+    }, &bad);
+
+    if (!ok) { fprintf(stderr, "tdquery: %s is not a .tdl file\n", path.c_str()); rc = 1; continue; }
+    if (bad) fprintf(stderr, "tdquery: %s: skipped %zu damaged block(s)\n", path.c_str(), bad);
+    if (summary) {
+      struct stat st {};
+      stat(path.c_str(), &st);
+      printf("%s  %s  %zu rows  %lld bytes  %.2f B/row  %.1f h\n", path.c_str(), who.c_str(), rows,
+             (long long)st.st_size, rows ? (double)st.st_size / rows : 0.0,
+             rows ? (last - first) / 3600000.0 : 0.0);
+    }
+  }
+  return rc;
+}
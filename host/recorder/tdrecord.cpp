@@ -0,0 +1,252 @@
+// tdrecord.cpp
+//
+// Headless Type D telemetry recorder for Linux. Listens on the telemetry
+// ports (50504-50506 by default), decodes every datagram with the shared
+// decoders and appends one row per datagram to a columnar log per console
+// and day: <dir>/td-<source ip>-YYYYMMDD.tdl (local date).
+//
+// - A row is the console's whole decoded state after the datagram, so a
+//   steady console costs a few bytes per block (zero runs) and a reader never
+//   needs earlier rows to know the current state.
+// - Rows are buffered per console and written as one block every -F seconds
+//   (default 60) or every 256 rows, whichever is first; fflush after each.
+// - SIGHUP writes everything out and reopens the files (logrotate friendly);
+//   SIGINT/SIGTERM write everything out and exit.
+// - Sockets use SO_REUSEADDR/SO_REUSEPORT, so broadcasts still reach a
+//   display or PC viewer running on the same machine.
+// - -w also keeps the raw datagrams (every console, unknown frames too) in
+//   <dir>/td-YYYYMMDD.tdc for replay with host/replay/tdreplay.
+
+#include "td_decode.h"
+#include "tlog.h"
+#include "tcap.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define REC_FLUSH_S      60
+#define REC_BLOCK_ROWS   256
+#define REC_MAX_DGRAM    1500
+
+struct Console {
+  td::State         st;
+  tlog::BlockWriter block;
+  std::string       day;       // YYYYMMDD of the open file
+  FILE*             file = nullptr;
+  uint64_t          rows = 0, bytes = 0;
+};
+
+static volatile sig_atomic_t s_stop = 0, s_reopen = 0;
+static std::map<std::string, Console> s_consoles;
+static std::string s_dir = ".";
+static bool s_verbose = false;
+static bool s_capture = false;
+static tcap::Writer s_cap;
+static std::string s_capDay;
+
+static void on_signal(int sig) {
+  if (sig == SIGHUP) s_reopen = 1;
+  else s_stop = 1;
+}
+
+static int64_t now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t now_ms() { return now_us() / 1000; }
+
+static std::string local_day(int64_t unixMs) {
+  const time_t t = (time_t)(unixMs / 1000);
+  struct tm tm;
+  localtime_r(&t, &tm);
+  char buf[16];
+  strftime(buf, sizeof(buf), "%Y%m%d", &tm);
+  return buf;
+}
+
+static void close_file(Console& c) {
+  if (c.file) fclose(c.file);
+  c.file = nullptr;
+}
+
+// Writes the pending block to the file for the block's first day
+static void flush_console(const std::string& ip, Console& c) {
+  if (!c.block.rows()) return;
+  const std::string day = local_day(c.block.firstMs());
+  if (c.file && day != c.day) close_file(c);
+  if (!c.file) {
+    const std::string path = s_dir + "/td-" + ip + "-" + day + ".tdl";
+    c.file = fopen(path.c_str(), "ab");
+    if (!c.file || !tlog::writeFileHeader(c.file)) {
+      fprintf(stderr, "[tdrecord] %s: %s\n", path.c_str(), strerror(errno));
+      close_file(c);
+      return;   // rows stay buffered; retried next flush
+    }
+    c.day = day;
+  }
+  std::vector<uint8_t> out;
+  const size_t rows = c.block.rows();
+  c.block.encode(out);
+  if (fwrite(out.data(), 1, out.size(), c.file) != out.size() || fflush(c.file) != 0)
+    fprintf(stderr, "[tdrecord] write failed for %s: %s\n", ip.c_str(), strerror(errno));
+  c.bytes += out.size();
+  if (s_verbose)
+    printf("[tdrecord] %s: %zu rows -> %zu bytes (%.1f B/row)\n", ip.c_str(), rows, out.size(),
+           (double)out.size() / rows);
+}
+
+static void capture(int64_t tUs, uint16_t port, const struct in_addr& src, const uint8_t* data, size_t len) {
+  const int64_t t = tUs / 1000;
+  const std::string day = local_day(t);
+  if (s_cap.isOpen() && day != s_capDay) s_cap.close();
+  if (!s_cap.isOpen()) {
+    const std::string path = s_dir + "/td-" + day + ".tdc";
+    if (!s_cap.open(path, 1, (uint64_t)t)) {
+      fprintf(stderr, "[tdrecord] %s: %s\n", path.c_str(), strerror(errno));
+      return;
+    }
+    s_capDay = day;
+  }
+  uint8_t ip[4];
+  memcpy(ip, &src.s_addr, 4);
+  s_cap.write((uint64_t)(tUs - (int64_t)s_cap.startUnixMs() * 1000), port, ip, data, len);
+}
+
+static void flush_all(bool close) {
+  for (auto& kv : s_consoles) {
+    flush_console(kv.first, kv.second);
+    if (close) close_file(kv.second);
+  }
+  s_cap.flush();
+  if (close) s_cap.close();
+}
+
+static int open_socket(const char* bindAddr, uint16_t port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) return -1;
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  struct sockaddr_in sa {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = bindAddr ? inet_addr(bindAddr) : htonl(INADDR_ANY);
+  if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdrecord [-d DIR] [-b BINDADDR] [-p PORT,...] [-F FLUSH_S] [-w] [-v]\n"
+          "  -d  output directory (default .)\n"
+          "  -b  local address to bind (default any)\n"
+          "  -p  ports (default 50504,50505,50506)\n"
+          "  -F  seconds between block writes (default %d)\n"
+          "  -w  also write raw captures (td-YYYYMMDD.tdc) for tdreplay\n"
+          "  -v  print each block written\n", REC_FLUSH_S);
+}
+
+int main(int argc, char** argv) {
+  const char* bindAddr = nullptr;
+  std::vector<uint16_t> ports = {50504, 50505, 50506};
+  int flushS = REC_FLUSH_S;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:b:p:F:wvh")) != -1) {
+    switch (opt) {
+      case 'd': s_dir = optarg; break;
+      case 'b': bindAddr = optarg; break;
+      case 'p':
+        ports.clear();
+        for (char* t = strtok(optarg, ","); t; t = strtok(nullptr, ",")) ports.push_back((uint16_t)atoi(t));
+        break;
+      case 'F': flushS = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+      case 'w': s_capture = true; break;
+      case 'v': s_verbose = true; break;
+      default: usage(); return 2;
+    }
+  }
+  mkdir(s_dir.c_str(), 0755);
+
+  std::vector<struct pollfd> fds;
+  for (uint16_t p : ports) {
+    const int fd = open_socket(bindAddr, p);
+    if (fd < 0) {
+      fprintf(stderr, "[tdrecord] bind %u: %s\n", p, strerror(errno));
+      return 1;
+    }
+    fds.push_back({fd, POLLIN, 0});
+  }
+
+  struct sigaction sa {};
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  sigaction(SIGHUP, &sa, nullptr);
+
+  printf("[tdrecord] recording to %s, %zu ports, block every %d s\n", s_dir.c_str(), ports.size(), flushS);
+  fflush(stdout);
+
+  int64_t nextFlush = now_ms() + flushS * 1000LL;
+  uint8_t buf[REC_MAX_DGRAM];
+  while (!s_stop) {
+    const int64_t wait = nextFlush - now_ms();
+    const int r = poll(fds.data(), fds.size(), wait > 0 ? (int)wait : 0);
+    if (r < 0 && errno != EINTR) break;
+
+    for (size_t i = 0; r > 0 && i < fds.size(); ++i) {
+      if (!(fds[i].revents & POLLIN)) continue;
+      struct sockaddr_in from {};
+      socklen_t fl = sizeof(from);
+      const ssize_t n = recvfrom(fds[i].fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr*)&from, &fl);
+      if (n <= 0) continue;
+
+      const int64_t tUs = now_us();
+      const int64_t t = tUs / 1000;
+      if (s_capture) capture(tUs, ports[i], from.sin_addr, buf, (size_t)n);
+
+      char ip[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+      Console& c = s_consoles[ip];
+      if (td::decode(ports[i], buf, (size_t)n, c.st) == td::Frame::Unknown) continue;
+
+      if (c.block.rows() && local_day(t) != local_day(c.block.firstMs())) flush_console(ip, c);
+      c.block.add(t, c.st);
+      c.rows++;
+      if (c.block.rows() >= REC_BLOCK_ROWS) flush_console(ip, c);
+    }
+
+    if (s_reopen) {
+      s_reopen = 0;
+      flush_all(true);
+    }
+    if (now_ms() >= nextFlush) {
+      flush_all(false);
+      nextFlush = now_ms() + flushS * 1000LL;
+    }
+  }
+
+  flush_all(true);
+  for (auto& kv : s_consoles)
+    printf("[tdrecord] %s: %llu rows, %llu bytes\n", kv.first.c_str(),
+           (unsigned long long)kv.second.rows, (unsigned long long)kv.second.bytes);
+  for (auto& p : fds) close(p.fd);
+  return 0;
+}
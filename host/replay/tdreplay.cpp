@@ -0,0 +1,246 @@
+// tdreplay.cpp
+//
+// Replays a capture (.tdc) into the display's UDPDetect, compiled unchanged
+// from src/udp_detect.cpp against the host shims, and reports what the
+// display would have done:
+// - every field change in UDPDetect::getLatest(), with capture time
+// - every status overlay the main loop would show, and which fields had
+//   changed since the previous one ("no change" = the overlay was triggered
+//   by a repeat packet)
+// - CPU time spent in UDPDetect::loop() per port
+//
+// The main loop is modelled at a fixed period (-l, default 5 ms): each pass
+// queues the datagrams that have arrived, calls UDPDetect::loop() (one
+// datagram per port per pass, as on the device) and runs the overlay logic
+// from Type_D_XL.ino with the slideshow idle (ImageDisplay::isDone()).
+// millis() is the capture clock, so timing is identical at any speed.
+//
+// Transitions and overlays go to stdout and are deterministic, so two builds
+// can be compared with diff. Timing goes to stderr.
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "udp_detect.h"
+#include "udp_capture.h"
+#include "tcap.h"
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define REPLAY_LOOP_MS     5
+#define REPLAY_OVERLAY_MS  2000    // Type_D_XL.ino: overlay times out after 2 s
+
+// The capture hook in udp_detect.cpp; nothing to record here
+void UDPCapture::record(uint16_t, const IPAddress&, const void*, size_t) {}
+bool UDPCapture::active() { return false; }
+
+// ---------- status fields ----------
+struct Field {
+  const char* name;
+  std::string (*get)(const XboxStatus&);
+};
+
+#define F_INT(n, m)  { n, [](const XboxStatus& s) { return std::to_string(s.m); } }
+#define F_STR(n, m)  { n, [](const XboxStatus& s) { return "'" + std::string(s.m) + "'"; } }
+static const Field kFields[] = {
+  F_INT("fan", fanSpeed),        F_INT("cpu", cpuTemp),          F_INT("amb", ambientTemp),
+  F_STR("app", currentApp),
+  { "tid", [](const XboxStatus& s) { char b[12]; snprintf(b, sizeof(b), "%08X", (unsigned)s.titleId); return std::string(b); } },
+  F_STR("title", titleName),
+  F_INT("tray", trayState),      F_INT("av", avPackState),       F_INT("pic", picVersion),
+  F_INT("xboxver", xboxVersion), F_INT("enc", encoderType),
+  F_INT("width", videoWidth),    F_INT("height", videoHeight),   F_STR("resolution", resolution),
+  F_INT("ee_raw_len", eeRawLen), F_STR("hdd", eeHddHex),         F_STR("serial", eeSerial),
+  F_STR("mac", eeMac),           F_STR("region", eeRegion),
+};
+static constexpr size_t kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+
+struct Snapshot { std::string v[kFieldCount]; };
+
+static Snapshot snap(const XboxStatus& s) {
+  Snapshot o;
+  for (size_t i = 0; i < kFieldCount; ++i) o.v[i] = kFields[i].get(s);
+  return o;
+}
+
+// ---------- CPU stats ----------
+struct Cpu {
+  uint64_t calls = 0;
+  double   totalUs = 0, maxUs = 0;
+  std::vector<double> samples;
+  void add(double us) { calls++; totalUs += us; maxUs = std::max(maxUs, us); samples.push_back(us); }
+  double pct(double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))];
+  }
+};
+
+static void fmt_time(uint64_t us, char* out, size_t cap) {
+  snprintf(out, cap, "%8.3f", us / 1e6);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: tdreplay [-s SPEED] [-l LOOP_MS] [-c SRC_IP] [-q] [-v] CAPTURE.tdc\n"
+          "  -s  0 = as fast as possible (default), 1 = real time, N = N x real time\n"
+          "  -l  modelled main loop period in ms (default %d)\n"
+          "  -c  only datagrams from this sender\n"
+          "  -q  summary only (no per-event lines)\n"
+          "  -v  show UDPDetect's serial log\n", REPLAY_LOOP_MS);
+}
+
+int main(int argc, char** argv) {
+  double speed = 0;
+  uint32_t loopMs = REPLAY_LOOP_MS;
+  std::string only;
+  bool quiet = false, verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:l:c:qvh")) != -1) {
+    switch (opt) {
+      case 's': speed = atof(optarg); break;
+      case 'l': loopMs = std::max(1, atoi(optarg)); break;
+      case 'c': only = optarg; break;
+      case 'q': quiet = true; break;
+      case 'v': verbose = true; break;
+      default: usage(); return 2;
+    }
+  }
+  if (optind >= argc) { usage(); return 2; }
+
+  td_wire::CaptureHeader hdr;
+  std::vector<tcap::Datagram> cap;
+  if (!tcap::load(argv[optind], hdr, cap)) {
+    fprintf(stderr, "tdreplay: %s is not a capture\n", argv[optind]);
+    return 1;
+  }
+  if (!only.empty()) {
+    cap.erase(std::remove_if(cap.begin(), cap.end(), [&](const tcap::Datagram& d) {
+      return IPAddress(d.src).toString() != only.c_str();
+    }), cap.end());
+  }
+  std::stable_sort(cap.begin(), cap.end(), [](const tcap::Datagram& a, const tcap::Datagram& b) { return a.tUs < b.tUs; });
+  if (cap.empty()) { fprintf(stderr, "tdreplay: nothing to replay\n"); return 1; }
+
+  Serial.enabled = verbose;
+  hostSetTimeUs(0);
+  UDPDetect::begin();
+
+  Snapshot prev = snap(UDPDetect::getLatest());
+  Snapshot atOverlay = prev;
+  std::map<uint16_t, uint64_t> perPort;
+  std::map<uint16_t, Cpu> cpu;
+  Cpu cpuMixed;
+  std::vector<uint64_t> fieldChanges(kFieldCount, 0);
+  uint64_t overlays = 0, repeatOverlays = 0, transitions = 0, passes = 0;
+  uint64_t overlayWindowStart = 0, overlaysInWindow = 0, maxPerMinute = 0;
+
+  // Overlay state, as in Type_D_XL.ino
+  bool overlayPending = false, showing = false;
+  uint64_t shownAtUs = 0;
+
+  const uint64_t loopUs = (uint64_t)loopMs * 1000;
+  const auto wall0 = std::chrono::steady_clock::now();
+  size_t next = 0;
+  uint64_t now = cap.front().tUs - cap.front().tUs % loopUs;
+  char ts[16];
+
+  while (true) {
+    // Idle: jump to the next arrival, staying on the loop grid
+    bool queued = false;
+    for (uint16_t p : {td_wire::kPortCore, td_wire::kPortExp, td_wire::kPortEE})
+      queued = queued || HostNet::pending(p) > 0;
+    if (!queued && !overlayPending && !showing) {
+      if (next >= cap.size()) break;
+      if (cap[next].tUs > now) now = cap[next].tUs + (loopUs - cap[next].tUs % loopUs) % loopUs;
+    }
+    hostSetTimeUs(now);
+
+    if (speed > 0) {
+      const auto due = wall0 + std::chrono::microseconds((int64_t)((now - cap.front().tUs) / speed));
+      std::this_thread::sleep_until(due);
+    }
+
+    std::map<uint16_t, size_t> before;
+    while (next < cap.size() && cap[next].tUs <= now) {
+      const tcap::Datagram& d = cap[next++];
+      HostNet::inject(d.port, IPAddress(d.src), d.data.data(), d.data.size());
+      perPort[d.port]++;
+    }
+    for (uint16_t p : {td_wire::kPortCore, td_wire::kPortExp, td_wire::kPortEE}) before[p] = HostNet::pending(p);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    UDPDetect::loop();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    passes++;
+
+    uint16_t consumedPort = 0;
+    int consumed = 0;
+    for (auto& kv : before)
+      if (HostNet::pending(kv.first) < kv.second) { consumed++; consumedPort = kv.first; }
+    if (consumed == 1) cpu[consumedPort].add(us);
+    else if (consumed > 1) cpuMixed.add(us);
+
+    // Field transitions
+    const Snapshot cur = snap(UDPDetect::getLatest());
+    fmt_time(now - cap.front().tUs, ts, sizeof(ts));
+    for (size_t i = 0; i < kFieldCount; ++i) {
+      if (cur.v[i] == prev.v[i]) continue;
+      fieldChanges[i]++;
+      transitions++;
+      if (!quiet) printf("%s  %-10s %s -> %s\n", ts, kFields[i].name, prev.v[i].c_str(), cur.v[i].c_str());
+    }
+    prev = cur;
+
+    // Overlay logic
+    if (UDPDetect::hasPacket() && !overlayPending && !showing) {
+      overlayPending = true;
+      UDPDetect::acknowledge();
+    }
+    if (overlayPending) {
+      std::string why;
+      for (size_t i = 0; i < kFieldCount; ++i)
+        if (cur.v[i] != atOverlay.v[i]) why += (why.empty() ? "" : ",") + std::string(kFields[i].name);
+      if (why.empty()) { why = "no change"; repeatOverlays++; }
+      atOverlay = cur;
+      overlays++;
+      if (now - overlayWindowStart >= 60000000ull) { overlayWindowStart = now; overlaysInWindow = 0; }
+      maxPerMinute = std::max(maxPerMinute, ++overlaysInWindow);
+      if (!quiet) printf("%s  OVERLAY    %s\n", ts, why.c_str());
+      showing = true;
+      shownAtUs = now;
+      overlayPending = false;
+    } else if (showing && now - shownAtUs > REPLAY_OVERLAY_MS * 1000ull) {
+      showing = false;
+    }
+
+    now += loopUs;
+  }
+
+  const double spanS = (cap.back().tUs - cap.front().tUs) / 1e6;
+  printf("---\n");
+  printf("capture   %s (%s), %zu datagrams over %.1f s\n", argv[optind], hdr.source ? "host recorder" : "display",
+         cap.size(), spanS);
+  for (auto& kv : perPort) printf("port %u   %llu datagrams\n", kv.first, (unsigned long long)kv.second);
+  printf("changes   %llu", (unsigned long long)transitions);
+  for (size_t i = 0; i < kFieldCount; ++i)
+    if (fieldChanges[i]) printf("  %s=%llu", kFields[i].name, (unsigned long long)fieldChanges[i]);
+  printf("\noverlays  %llu (%llu with no change), max %llu in a minute\n", (unsigned long long)overlays,
+         (unsigned long long)repeatOverlays, (unsigned long long)maxPerMinute);
+
+  fprintf(stderr, "cpu       %llu loop passes, %.2f s wall\n", (unsigned long long)passes,
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count());
+  for (auto& kv : cpu)
+    fprintf(stderr, "cpu %u  %llu parses  mean %.2f us  p99 %.2f us  max %.2f us  total %.3f ms\n", kv.first,
+            (unsigned long long)kv.second.calls, kv.second.totalUs / kv.second.calls, kv.second.pct(0.99),
+            kv.second.maxUs, kv.second.totalUs / 1000);
+  if (cpuMixed.calls)
+    fprintf(stderr, "cpu mixed  %llu passes with several ports, mean %.2f us\n",
+            (unsigned long long)cpuMixed.calls, cpuMixed.totalUs / cpuMixed.calls);
+  return 0;
+}
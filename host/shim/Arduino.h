@@ -0,0 +1,167 @@
+// Arduino.h (host shim)
+//
+// Just enough of the ESP32 Arduino core for display modules to compile
+// unchanged on Linux (see host/readme.md). millis()/micros() follow the
+// host clock, which a harness can drive itself (hostSetTimeUs) to run a
+// capture faster or slower than real time.
+//
+// String converts to const char* so LovyanGFX's host build (which has no
+// Arduino String overloads) accepts it in drawString()/print()/textWidth().
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+
+#define IRAM_ATTR
+
+using std::max;
+using std::min;
+
+inline bool isDigit(int c)        { return c >= '0' && c <= '9'; }
+inline bool isAlpha(int c)        { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+inline bool isAlphaNumeric(int c) { return isDigit(c) || isAlpha(c); }
+inline bool isSpace(int c)        { return c == ' ' || (c >= '\t' && c <= '\r'); }
+inline bool isHexadecimalDigit(int c) { return isDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f'); }
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define HEX 16
+#define DEC 10
+
+// ---- clock ----
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+
+// Virtual time for harnesses; until the first call the clock is real (monotonic)
+void hostSetTimeUs(uint64_t us);
+
+// ---- GPIO (no-ops) ----
+inline void pinMode(uint8_t, uint8_t) {}
+inline int  digitalRead(uint8_t) { return LOW; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+// ---- String (subset) ----
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%d", v);
+    s_ = buf;
+  }
+  String(unsigned v, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%u", v);
+    s_ = buf;
+  }
+  String(long v) : String((int)v) {}
+  String(unsigned long v) : String((unsigned)v) {}
+  String(uint8_t v, int base = DEC) : String((unsigned)v, base) {}
+
+  size_t length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  const char* c_str() const { return s_.c_str(); }
+  operator const char*() const { return s_.c_str(); }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  int indexOf(const char* t, size_t from = 0) const {
+    const size_t i = s_.find(t, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  int indexOf(char c, size_t from = 0) const {
+    const size_t i = s_.find(c, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  int lastIndexOf(char c) const {
+    const size_t i = s_.rfind(c);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(size_t from, size_t to = std::string::npos) const {
+    if (from >= s_.size()) return String();
+    return String(s_.substr(from, to == std::string::npos ? to : to - from));
+  }
+  bool startsWith(const char* p) const { return s_.compare(0, strlen(p), p) == 0; }
+  bool endsWith(const char* p) const {
+    const size_t n = strlen(p);
+    return s_.size() >= n && s_.compare(s_.size() - n, n, p) == 0;
+  }
+  char operator[](size_t i) const { return i < s_.size() ? s_[i] : 0; }
+  char charAt(size_t i) const { return (*this)[i]; }
+  void remove(size_t index, size_t count = std::string::npos) {
+    if (index < s_.size()) s_.erase(index, count);
+  }
+  void toLowerCase() { std::transform(s_.begin(), s_.end(), s_.begin(), ::tolower); }
+  void toUpperCase() { std::transform(s_.begin(), s_.end(), s_.begin(), ::toupper); }
+  void trim() {
+    const size_t a = s_.find_first_not_of(" \t\r\n");
+    const size_t b = s_.find_last_not_of(" \t\r\n");
+    s_ = a == std::string::npos ? std::string() : s_.substr(a, b - a + 1);
+  }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o ? o : ""; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String& a, const char* b) { return String(a.s_ + (b ? b : "")); }
+  friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.s_); }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+
+private:
+  std::string s_;
+};
+
+// ---- Serial (stdout, can be muted by a harness) ----
+class HostSerial {
+public:
+  bool enabled = true;
+  void begin(unsigned long) {}
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* s)    { return enabled ? (fputs(s, stdout), strlen(s)) : 0; }
+  size_t print(const String& s)  { return print(s.c_str()); }
+  size_t print(int v)            { return (size_t)this->printf("%d", v); }
+  size_t println()               { return print("\n"); }
+  size_t println(const char* s)  { return print(s) + println(); }
+  size_t println(const String& s){ return println(s.c_str()); }
+  size_t println(int v)          { return print(v) + println(); }
+};
+extern HostSerial Serial;
+
+// ---- IPAddress ----
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { o_[0]=a; o_[1]=b; o_[2]=c; o_[3]=d; }
+  explicit IPAddress(const uint8_t o[4]) { memcpy(o_, o, 4); }
+  uint8_t operator[](int i) const { return o_[i & 3]; }
+  bool operator==(const IPAddress& r) const { return memcmp(o_, r.o_, 4) == 0; }
+  bool operator!=(const IPAddress& r) const { return !(*this == r); }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", o_[0], o_[1], o_[2], o_[3]);
+    return String(buf);
+  }
+private:
+  uint8_t o_[4] = {0, 0, 0, 0};
+};
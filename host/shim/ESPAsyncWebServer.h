@@ -0,0 +1,140 @@
+// ESPAsyncWebServer.h (host shim)
+//
+// No sockets: on() records the route, and a harness calls a page directly
+// with HostWeb::call() to get its status and body. That is enough to run
+// and profile the page builders (FileMan, Diag, ...) without a browser.
+// Upload handlers get the body in one final chunk.
+
+#pragma once
+#include "Arduino.h"
+#include "FS.h"
+#include <functional>
+#include <map>
+#include <vector>
+
+typedef enum {
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+  HTTP_DELETE  = 0b00000100,
+  HTTP_PUT     = 0b00001000,
+  HTTP_PATCH   = 0b00010000,
+  HTTP_HEAD    = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+
+class AsyncWebServerResponse {
+public:
+  int    code = 200;
+  String contentType;
+  String body;
+  std::vector<std::pair<String, String>> headers;
+  void addHeader(const String& name, const String& value) { headers.emplace_back(name, value); }
+};
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& n, const String& v, bool post) : name_(n), value_(v), post_(post) {}
+  const String& name() const { return name_; }
+  const String& value() const { return value_; }
+  bool isPost() const { return post_; }
+  bool isFile() const { return false; }
+private:
+  String name_, value_;
+  bool   post_;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, String, size_t, uint8_t*, size_t, bool)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(WebRequestMethod m, const String& url) : method_(m), url_(url) {}
+  ~AsyncWebServerRequest() { delete response_; }
+
+  const String& url() const { return url_; }
+  WebRequestMethod method() const { return method_; }
+  IPAddress clientIP() const { return IPAddress(127, 0, 0, 1); }
+
+  bool hasArg(const char* name) const;
+  String arg(const char* name) const;
+  String arg(const String& name) const { return arg(name.c_str()); }
+  bool hasParam(const char* name, bool post = false) const;
+  const AsyncWebParameter* getParam(const char* name, bool post = false) const;
+  size_t params() const { return params_.size(); }
+  const AsyncWebParameter* getParam(size_t i) const { return i < params_.size() ? &params_[i] : nullptr; }
+
+  AsyncWebServerResponse* beginResponse(int code, const String& type = String(), const String& body = String());
+  AsyncWebServerResponse* beginResponse(File f, const String& type, bool download = false);
+  AsyncWebServerResponse* beginResponse(FS& fs, const String& path, const String& type = String(), bool download = false);
+  void send(AsyncWebServerResponse* r);
+  void send(int code, const String& type = String(), const String& body = String());
+  void send(File f, const String& type, bool download = false) { send(beginResponse(f, type, download)); }
+  void send(FS& fs, const String& path, const String& type = String(), bool download = false) {
+    send(beginResponse(fs, path, type, download));
+  }
+  void redirect(const String& url);
+
+  // Harness side
+  void addParam(const String& name, const String& value, bool post) { params_.emplace_back(name, value, post); }
+  const AsyncWebServerResponse* response() const { return response_; }
+
+private:
+  WebRequestMethod               method_;
+  String                         url_;
+  std::vector<AsyncWebParameter> params_;
+  AsyncWebServerResponse*        response_ = nullptr;
+};
+
+class AsyncStaticWebHandler {
+public:
+  AsyncStaticWebHandler& setDefaultFile(const char*) { return *this; }
+  AsyncStaticWebHandler& setCacheControl(const char*) { return *this; }
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port) : port_(port) {}
+  void begin() {}
+  void end() {}
+
+  AsyncWebServer& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+  AsyncWebServer& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                     ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+  AsyncStaticWebHandler& serveStatic(const char* uri, FS& fs, const char* path, const char* cache = nullptr);
+  void onNotFound(ArRequestHandlerFunction fn) { notFound_ = fn; }
+
+  struct Route {
+    String                    uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction  onRequest;
+    ArUploadHandlerFunction   onUpload;
+    ArBodyHandlerFunction     onBody;
+  };
+  const std::vector<Route>& routes() const { return routes_; }
+  uint16_t port() const { return port_; }
+  ArRequestHandlerFunction notFound() const { return notFound_; }
+
+private:
+  uint16_t                 port_;
+  std::vector<Route>       routes_;
+  AsyncStaticWebHandler    static_;
+  ArRequestHandlerFunction notFound_;
+};
+
+namespace HostWeb {
+  struct Reply {
+    int    code = 404;
+    String contentType;
+    String body;
+    String location;    // set by redirect()
+  };
+  // "GET", "/", {{"file","a.jpg"}}; an upload is passed as (filename, data)
+  Reply call(AsyncWebServer& server, WebRequestMethod method, const String& url,
+             const std::vector<std::pair<String, String>>& args = {},
+             const String& uploadName = String(), const std::vector<uint8_t>& upload = {});
+}
@@ -0,0 +1,26 @@
+// FFat.h (host shim)
+//
+// The FATFS partition as a host directory: FFat.setHostRoot(dir) before
+// begin(), or $TD_FFAT_ROOT. totalBytes() is the partition size of the
+// 16MB "3MB APP/9.9MB FATFS" scheme the firmware is built with;
+// usedBytes() sums the files under the root.
+
+#pragma once
+#include "FS.h"
+
+namespace fs {
+
+class F_Fat : public FS {
+public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/ffat", uint8_t maxOpenFiles = 10,
+             const char* partitionLabel = nullptr);
+  bool format(bool full = false, char* partitionLabel = nullptr);
+  void end() {}
+  size_t totalBytes();
+  size_t usedBytes();
+  size_t freeBytes() { const size_t t = totalBytes(), u = usedBytes(); return t > u ? t - u : 0; }
+};
+
+} // namespace fs
+
+extern fs::F_Fat FFat;
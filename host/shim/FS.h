@@ -0,0 +1,79 @@
+// FS.h (host shim)
+//
+// fs::File / fs::FS over a host directory. Paths are the device paths
+// ("/jpg/a.jpg") relative to the root the harness mounts, so a copy of the
+// FATFS contents on disk behaves like the partition. As in the ESP32 core,
+// File::name() is the base name and File::path() the full device path.
+
+#pragma once
+#include "Arduino.h"
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace fs {
+
+struct HostFileImpl;
+
+class File {
+public:
+  File() {}
+  explicit File(std::shared_ptr<HostFileImpl> p) : p_(std::move(p)) {}
+
+  explicit operator bool() const;
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len);
+  size_t print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+  size_t print(const String& s) { return print(s.c_str()); }
+  int available();
+  int read();
+  size_t read(uint8_t* buf, size_t len);
+  size_t readBytes(char* buf, size_t len) { return read(reinterpret_cast<uint8_t*>(buf), len); }
+  int peek();
+  void flush();
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  const char* name() const;
+  const char* path() const;
+  bool isDirectory() const;
+  File openNextFile(const char* mode = FILE_READ);
+  void rewindDirectory();
+
+private:
+  std::shared_ptr<HostFileImpl> p_;
+};
+
+class FS {
+public:
+  File open(const char* path, const char* mode = FILE_READ, bool create = false);
+  File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+    return open(path.c_str(), mode, create);
+  }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+  bool mkdir(const String& path) { return mkdir(path.c_str()); }
+  bool rmdir(const char* path);
+
+  // Host side: where "/" lives. Empty until a harness mounts one.
+  void setHostRoot(const std::string& dir) { root_ = dir; }
+  const std::string& hostRoot() const { return root_; }
+  std::string hostPath(const char* path) const;
+
+protected:
+  std::string root_;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,27 @@
+// Preferences.h (host shim) -- NVS as an in-process map, lost at exit
+#pragma once
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char* ns, bool readOnly = false) { ns_ = ns ? ns : ""; ro_ = readOnly; return true; }
+  void end() { ns_.clear(); }
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  uint32_t getUInt(const char* key, uint32_t def = 0);
+  size_t   putUInt(const char* key, uint32_t v);
+  int32_t  getInt(const char* key, int32_t def = 0) { return (int32_t)getUInt(key, (uint32_t)def); }
+  size_t   putInt(const char* key, int32_t v) { return putUInt(key, (uint32_t)v); }
+  bool     getBool(const char* key, bool def = false) { return getUInt(key, def) != 0; }
+  size_t   putBool(const char* key, bool v) { return putUInt(key, v); }
+  uint8_t  getUChar(const char* key, uint8_t def = 0) { return (uint8_t)getUInt(key, def); }
+  size_t   putUChar(const char* key, uint8_t v) { return putUInt(key, v); }
+  String   getString(const char* key, const String& def = String());
+  size_t   putString(const char* key, const String& v);
+
+private:
+  std::string ns_;
+  bool        ro_ = false;
+};
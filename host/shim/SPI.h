@@ -0,0 +1,2 @@
+// SPI.h (host shim) -- nothing on the host uses the bus
+#pragma once
@@ -0,0 +1,24 @@
+// WiFi.h (host shim)
+//
+// Station state only. The harness fills in what the UI shows (SSID, IP);
+// the sockets themselves live in WiFiUdp.h.
+
+#pragma once
+#include "Arduino.h"
+
+#define WL_CONNECTED    3
+#define WL_DISCONNECTED 6
+
+class HostWiFi {
+public:
+  String    ssid = "host";
+  IPAddress ip   = IPAddress(127, 0, 0, 1);
+  bool      connected = true;
+
+  String SSID() const { return ssid; }
+  IPAddress localIP() const { return ip; }
+  int status() const { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+  int RSSI() const { return connected ? -50 : 0; }
+  bool isConnected() const { return connected; }
+};
+extern HostWiFi WiFi;
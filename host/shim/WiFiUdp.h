@@ -0,0 +1,57 @@
+// WiFiUdp.h (host shim)
+//
+// WiFiUDP over an in-process datagram queue per port. A harness pushes
+// received datagrams with HostNet::inject(); parsePacket()/read() hand them
+// to the module exactly as the ESP32 core would (one datagram at a time, the
+// rest of an unread datagram is dropped by the next parsePacket()).
+//
+// With HostNet::useSockets(true) (the simulator) begin() also binds a real
+// non-blocking UDP socket, shared with other listeners (SO_REUSEPORT), and
+// parsePacket() takes injected datagrams first, then the socket. Sent
+// packets then go out for real too.
+
+#pragma once
+#include "Arduino.h"
+#include <vector>
+
+namespace HostNet {
+  void inject(uint16_t port, const IPAddress& src, const uint8_t* data, size_t len);
+  size_t pending(uint16_t port);
+  void clear();
+  void useSockets(bool on);
+}
+
+class WiFiUDP {
+public:
+  ~WiFiUDP() { stop(); }
+  uint8_t begin(uint16_t port);
+  void stop();
+
+  int parsePacket();
+  int available() const { return (int)(cur_.size() - pos_); }
+  int read(uint8_t* buf, size_t len);
+  int read(char* buf, size_t len) { return read(reinterpret_cast<uint8_t*>(buf), len); }
+  int read() { uint8_t b; return read(&b, 1) == 1 ? b : -1; }
+  IPAddress remoteIP() const { return from_; }
+  uint16_t remotePort() const { return fromPort_; }
+
+  // Sending is discarded unless sockets are on
+  int beginPacket(const IPAddress& ip, uint16_t port) { out_.clear(); to_ = ip; toPort_ = port; return 1; }
+  size_t write(const uint8_t* buf, size_t len) { out_.insert(out_.end(), buf, buf + len); return len; }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+  size_t print(const String& s) { return print(s.c_str()); }
+  int endPacket();
+
+private:
+  uint16_t             port_ = 0;
+  bool                 bound_ = false;
+  std::vector<uint8_t> cur_;
+  size_t               pos_ = 0;
+  IPAddress            from_;
+  uint16_t             fromPort_ = 0;
+  int                  fd_ = -1;
+  std::vector<uint8_t> out_;
+  IPAddress            to_;
+  uint16_t             toPort_ = 0;
+};
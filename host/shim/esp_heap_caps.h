@@ -0,0 +1,15 @@
+// esp_heap_caps.h (host shim) -- capability allocations are plain malloc
+#pragma once
+#include <stdlib.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+
+inline void* heap_caps_malloc(size_t size, unsigned) { return malloc(size); }
+inline void* heap_caps_calloc(size_t n, size_t size, unsigned) { return calloc(n, size); }
+inline void  heap_caps_free(void* p) { free(p); }
+inline size_t heap_caps_get_free_size(unsigned) { return 8u << 20; }
+inline size_t heap_caps_get_largest_free_block(unsigned) { return 4u << 20; }
@@ -0,0 +1,8 @@
+// esp_system.h (host shim)
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+// Seeded by the harness (srand) so a scripted run can be repeated exactly
+inline uint32_t esp_random() { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+inline void esp_restart() { exit(0); }
@@ -0,0 +1,25 @@
+// freertos/FreeRTOS.h (host shim) -- tasks are std::threads, semaphores a
+// mutex and condition variable. Priorities, stack sizes and cores are ignored.
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Critical sections are a spinlock, as on a dual-core ESP32
+struct portMUX_TYPE { std::atomic_flag locked = ATOMIC_FLAG_INIT; };
+#define portMUX_INITIALIZER_UNLOCKED {}
+inline void portENTER_CRITICAL(portMUX_TYPE* m) { while (m->locked.test_and_set(std::memory_order_acquire)) {} }
+inline void portEXIT_CRITICAL(portMUX_TYPE* m) { m->locked.clear(std::memory_order_release); }
+#define portENTER_CRITICAL_ISR portENTER_CRITICAL
+#define portEXIT_CRITICAL_ISR portEXIT_CRITICAL
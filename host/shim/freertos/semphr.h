@@ -0,0 +1,34 @@
+// freertos/semphr.h (host shim) -- mutexes and binary semaphores
+#pragma once
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+struct HostSemaphore {
+  std::mutex m;
+  std::condition_variable cv;
+  unsigned count;
+};
+typedef HostSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore{ {}, {}, 1 }; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore{ {}, {}, 0 }; }
+inline void vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(s->m);
+  auto ready = [s] { return s->count > 0; };
+  if (ticks == portMAX_DELAY) s->cv.wait(lock, ready);
+  else if (!s->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) return pdFALSE;
+  s->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->count > 0) return pdFALSE;
+  s->count = 1;
+  s->cv.notify_one();
+  return pdTRUE;
+}
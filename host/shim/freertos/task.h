@@ -0,0 +1,17 @@
+// freertos/task.h (host shim)
+#pragma once
+#include "FreeRTOS.h"
+#include <chrono>
+#include <thread>
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct HostTask* TaskHandle_t;
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t,
+                                          TaskHandle_t* handle, BaseType_t) {
+  std::thread(fn, arg).detach();
+  if (handle) *handle = nullptr;
+  return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
@@ -0,0 +1,193 @@
+// host_arduino.cpp -- clock, Serial, WiFi/WiFiUDP and Preferences for the host shims
+#include "Arduino.h"
+#include "WiFi.h"
+#include "WiFiUdp.h"
+#include "Wire.h"
+#include "Preferences.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+HostSerial Serial;
+HostWiFi   WiFi;
+TwoWire    Wire;
+
+// ---------- clock ----------
+static bool     s_virtual = false;
+static uint64_t s_virtualUs = 0;
+
+static uint64_t now_us() {
+  if (s_virtual) return s_virtualUs;
+  static const auto t0 = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - t0).count();
+}
+
+void hostSetTimeUs(uint64_t us) {
+  s_virtual = true;
+  s_virtualUs = us;
+}
+
+unsigned long millis() { return (unsigned long)(now_us() / 1000); }
+unsigned long micros() { return (unsigned long)now_us(); }
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000u); }
+
+void delayMicroseconds(uint32_t us) {
+  if (s_virtual) s_virtualUs += us;
+  else std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+int HostSerial::printf(const char* fmt, ...) {
+  if (!enabled) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vprintf(fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+// ---------- UDP ----------
+struct Datagram {
+  IPAddress            src;
+  std::vector<uint8_t> data;
+};
+static std::map<uint16_t, std::deque<Datagram>> s_queues;
+
+void HostNet::inject(uint16_t port, const IPAddress& src, const uint8_t* data, size_t len) {
+  s_queues[port].push_back(Datagram{src, std::vector<uint8_t>(data, data + len)});
+}
+
+size_t HostNet::pending(uint16_t port) {
+  auto it = s_queues.find(port);
+  return it == s_queues.end() ? 0 : it->second.size();
+}
+
+void HostNet::clear() { s_queues.clear(); }
+
+static bool s_sockets = false;
+void HostNet::useSockets(bool on) { s_sockets = on; }
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  port_ = port;
+  bound_ = true;
+  if (!s_sockets) return 1;
+
+  fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd_ < 0) return 0;
+  const int one = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  setsockopt(fd_, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd_, (sockaddr*)&a, sizeof(a)) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  bound_ = false;
+}
+
+int WiFiUDP::parsePacket() {
+  cur_.clear();
+  pos_ = 0;
+  if (!bound_) return 0;
+  auto it = s_queues.find(port_);
+  if (it != s_queues.end() && !it->second.empty()) {
+    Datagram d = std::move(it->second.front());
+    it->second.pop_front();
+    cur_ = std::move(d.data);
+    from_ = d.src;
+    fromPort_ = 0;
+    return (int)cur_.size();
+  }
+  if (fd_ < 0) return 0;
+
+  uint8_t buf[1500];
+  sockaddr_in from = {};
+  socklen_t flen = sizeof(from);
+  const ssize_t n = recvfrom(fd_, buf, sizeof(buf), 0, (sockaddr*)&from, &flen);
+  if (n <= 0) return 0;
+  cur_.assign(buf, buf + n);
+  from_ = IPAddress(reinterpret_cast<const uint8_t*>(&from.sin_addr.s_addr));
+  fromPort_ = ntohs(from.sin_port);
+  return (int)n;
+}
+
+int WiFiUDP::endPacket() {
+  if (!s_sockets || out_.empty()) return 1;
+  const int fd = fd_ >= 0 ? fd_ : socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) return 0;
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(toPort_);
+  const uint8_t ip[4] = {to_[0], to_[1], to_[2], to_[3]};
+  memcpy(&a.sin_addr.s_addr, ip, 4);
+  const ssize_t n = sendto(fd, out_.data(), out_.size(), 0, (sockaddr*)&a, sizeof(a));
+  if (fd != fd_) ::close(fd);
+  out_.clear();
+  return n >= 0;
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t len) {
+  const size_t n = std::min(len, cur_.size() - pos_);
+  if (n) memcpy(buf, cur_.data() + pos_, n);
+  pos_ += n;
+  return (int)n;
+}
+
+// ---------- Preferences ----------
+static std::map<std::string, std::string> s_prefs;   // "ns/key" -> value
+
+static std::string pref_key(const std::string& ns, const char* key) { return ns + "/" + (key ? key : ""); }
+
+bool Preferences::clear() {
+  if (ro_) return false;
+  const std::string pre = ns_ + "/";
+  for (auto it = s_prefs.begin(); it != s_prefs.end();)
+    it = it->first.compare(0, pre.size(), pre) == 0 ? s_prefs.erase(it) : std::next(it);
+  return true;
+}
+
+bool Preferences::remove(const char* key) { return !ro_ && s_prefs.erase(pref_key(ns_, key)) > 0; }
+bool Preferences::isKey(const char* key) { return s_prefs.count(pref_key(ns_, key)) > 0; }
+
+uint32_t Preferences::getUInt(const char* key, uint32_t def) {
+  auto it = s_prefs.find(pref_key(ns_, key));
+  return it == s_prefs.end() ? def : (uint32_t)strtoul(it->second.c_str(), nullptr, 10);
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t v) {
+  if (ro_ || ns_.empty()) return 0;
+  s_prefs[pref_key(ns_, key)] = std::to_string(v);
+  return sizeof(v);
+}
+
+String Preferences::getString(const char* key, const String& def) {
+  auto it = s_prefs.find(pref_key(ns_, key));
+  return it == s_prefs.end() ? def : String(it->second);
+}
+
+size_t Preferences::putString(const char* key, const String& v) {
+  if (ro_ || ns_.empty()) return 0;
+  s_prefs[pref_key(ns_, key)] = v.c_str();
+  return v.length();
+}
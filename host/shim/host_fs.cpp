@@ -0,0 +1,201 @@
+// host_fs.cpp -- fs::File / FFat over a host directory (see FS.h)
+#include "FS.h"
+#include "FFat.h"
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ftw.h>
+
+fs::F_Fat FFat;
+
+#define HOST_FFAT_SIZE (0x9E0000)   // 9.9MB FATFS partition
+
+namespace fs {
+
+struct HostFileImpl {
+  std::string path;        // device path
+  std::string base;        // name()
+  std::string host;        // host path
+  FILE*       fp = nullptr;
+  DIR*        dir = nullptr;
+  bool        isDir = false;
+  size_t      size = 0;
+
+  ~HostFileImpl() { close(); }
+  void close() {
+    if (fp) { fclose(fp); fp = nullptr; }
+    if (dir) { closedir(dir); dir = nullptr; }
+  }
+  bool valid() const { return fp || dir; }
+};
+
+static std::string join(const std::string& dir, const char* name) {
+  if (dir.empty() || dir.back() != '/') return dir + "/" + name;
+  return dir + name;
+}
+
+std::string FS::hostPath(const char* path) const {
+  std::string p = path ? path : "";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  // No escaping the root through ".."
+  if (p.find("/../") != std::string::npos || (p.size() >= 3 && p.compare(p.size() - 3, 3, "/..") == 0)) return "";
+  return (root_.empty() ? std::string(".") : root_) + p;
+}
+
+static std::shared_ptr<HostFileImpl> openHost(const std::string& devPath, const std::string& host, const char* mode) {
+  auto impl = std::make_shared<HostFileImpl>();
+  impl->path = devPath;
+  const size_t slash = devPath.find_last_of('/');
+  impl->base = slash == std::string::npos ? devPath : devPath.substr(slash + 1);
+  impl->host = host;
+
+  struct stat st;
+  const bool exists = stat(host.c_str(), &st) == 0;
+  if (exists && S_ISDIR(st.st_mode)) {
+    impl->isDir = true;
+    impl->dir = opendir(host.c_str());
+    return impl->dir ? impl : nullptr;
+  }
+  const char* m = !strcmp(mode, FILE_WRITE) ? "wb" : !strcmp(mode, FILE_APPEND) ? "ab" : "rb";
+  impl->fp = fopen(host.c_str(), m);
+  if (!impl->fp) return nullptr;
+  if (exists) impl->size = (size_t)st.st_size;
+  return impl;
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+  const std::string host = hostPath(path);
+  if (host.empty()) return File();
+  std::string dev = path ? path : "/";
+  if (dev.empty() || dev[0] != '/') dev = "/" + dev;
+  return File(openHost(dev, host, mode ? mode : FILE_READ));
+}
+
+bool FS::exists(const char* path) {
+  const std::string host = hostPath(path);
+  struct stat st;
+  return !host.empty() && stat(host.c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+  const std::string host = hostPath(path);
+  return !host.empty() && unlink(host.c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  const std::string a = hostPath(from), b = hostPath(to);
+  return !a.empty() && !b.empty() && ::rename(a.c_str(), b.c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  const std::string host = hostPath(path);
+  return !host.empty() && (::mkdir(host.c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char* path) {
+  const std::string host = hostPath(path);
+  return !host.empty() && ::rmdir(host.c_str()) == 0;
+}
+
+// ---------- File ----------
+File::operator bool() const { return p_ && p_->valid(); }
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!p_ || !p_->fp) return 0;
+  const size_t n = fwrite(buf, 1, len, p_->fp);
+  const long pos = ftell(p_->fp);
+  if (pos > 0 && (size_t)pos > p_->size) p_->size = (size_t)pos;
+  return n;
+}
+
+int File::available() {
+  if (!p_ || !p_->fp) return 0;
+  const long pos = ftell(p_->fp);
+  return pos < 0 || (size_t)pos >= p_->size ? 0 : (int)(p_->size - pos);
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (!p_ || !p_->fp) return 0;
+  return fread(buf, 1, len, p_->fp);
+}
+
+int File::peek() {
+  if (!p_ || !p_->fp) return -1;
+  const int c = fgetc(p_->fp);
+  if (c != EOF) ungetc(c, p_->fp);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+  if (p_ && p_->fp) fflush(p_->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!p_ || !p_->fp) return false;
+  const int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+  return fseek(p_->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!p_ || !p_->fp) return 0;
+  const long pos = ftell(p_->fp);
+  return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const { return p_ ? p_->size : 0; }
+
+void File::close() {
+  if (p_) p_->close();
+}
+
+const char* File::name() const { return p_ ? p_->base.c_str() : ""; }
+const char* File::path() const { return p_ ? p_->path.c_str() : ""; }
+bool File::isDirectory() const { return p_ && p_->isDir; }
+
+File File::openNextFile(const char* mode) {
+  if (!p_ || !p_->dir) return File();
+  while (struct dirent* e = readdir(p_->dir)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    const std::string dev = p_->path == "/" ? "/" + std::string(e->d_name) : p_->path + "/" + e->d_name;
+    if (auto impl = openHost(dev, join(p_->host, e->d_name), mode)) return File(impl);
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (p_ && p_->dir) rewinddir(p_->dir);
+}
+
+// ---------- FFat ----------
+bool F_Fat::begin(bool, const char*, uint8_t, const char*) {
+  if (root_.empty()) {
+    const char* env = getenv("TD_FFAT_ROOT");
+    root_ = env && *env ? env : ".";
+  }
+  struct stat st;
+  return stat(root_.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool F_Fat::format(bool, char*) { return false; }   // never wipe a host directory
+
+size_t F_Fat::totalBytes() { return HOST_FFAT_SIZE; }
+
+static size_t s_used;
+static int sum_file(const char*, const struct stat* st, int type, struct FTW*) {
+  if (type == FTW_F) s_used += (size_t)st->st_size;
+  return 0;
+}
+
+size_t F_Fat::usedBytes() {
+  s_used = 0;
+  nftw(root_.empty() ? "." : root_.c_str(), sum_file, 16, FTW_PHYS);
+  return s_used;
+}
+
+} // namespace fs
@@ -0,0 +1,106 @@
+// host_web.cpp -- AsyncWebServer route table and HostWeb::call() (see ESPAsyncWebServer.h)
+#include "ESPAsyncWebServer.h"
+
+bool AsyncWebServerRequest::hasArg(const char* name) const {
+  for (auto& p : params_)
+    if (p.name() == name) return true;
+  return false;
+}
+
+String AsyncWebServerRequest::arg(const char* name) const {
+  for (auto& p : params_)
+    if (p.name() == name) return p.value();
+  return String();
+}
+
+bool AsyncWebServerRequest::hasParam(const char* name, bool post) const { return getParam(name, post) != nullptr; }
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name, bool post) const {
+  for (auto& p : params_)
+    if (p.name() == name && p.isPost() == post) return &p;
+  return nullptr;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& type, const String& body) {
+  auto* r = new AsyncWebServerResponse();
+  r->code = code;
+  r->contentType = type;
+  r->body = body;
+  return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(File f, const String& type, bool download) {
+  std::string data;
+  if (f) {
+    data.resize(f.size());
+    data.resize(f.read(reinterpret_cast<uint8_t*>(&data[0]), data.size()));
+  }
+  auto* r = beginResponse(f ? 200 : 404, type, String(data));
+  if (download && f) r->addHeader("Content-Disposition", String("attachment; filename=\"") + f.name() + "\"");
+  return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(FS& fs, const String& path, const String& type,
+                                                             bool download) {
+  return beginResponse(fs.open(path, FILE_READ), type, download);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* r) {
+  delete response_;
+  response_ = r;
+}
+
+void AsyncWebServerRequest::send(int code, const String& type, const String& body) {
+  send(beginResponse(code, type, body));
+}
+
+void AsyncWebServerRequest::redirect(const String& url) {
+  auto* r = beginResponse(302);
+  r->addHeader("Location", url);
+  send(r);
+}
+
+AsyncWebServer& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                   ArRequestHandlerFunction onRequest) {
+  return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncWebServer& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                   ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload,
+                                   ArBodyHandlerFunction onBody) {
+  routes_.push_back(Route{uri, method, onRequest, onUpload, onBody});
+  return *this;
+}
+
+AsyncStaticWebHandler& AsyncWebServer::serveStatic(const char*, FS&, const char*, const char*) { return static_; }
+
+HostWeb::Reply HostWeb::call(AsyncWebServer& server, WebRequestMethod method, const String& url,
+                             const std::vector<std::pair<String, String>>& args, const String& uploadName,
+                             const std::vector<uint8_t>& upload) {
+  AsyncWebServerRequest req(method, url);
+  for (auto& a : args) req.addParam(a.first, a.second, method == HTTP_POST);
+
+  const AsyncWebServer::Route* route = nullptr;
+  for (auto& r : server.routes())
+    if (r.uri == url && (r.method & method)) { route = &r; break; }
+
+  if (route) {
+    if (route->onUpload && !uploadName.isEmpty()) {
+      std::vector<uint8_t> body(upload);
+      route->onUpload(&req, uploadName, 0, body.data(), body.size(), true);
+    }
+    if (route->onRequest) route->onRequest(&req);
+  } else if (server.notFound()) {
+    server.notFound()(&req);
+  }
+
+  Reply out;
+  if (const AsyncWebServerResponse* r = req.response()) {
+    out.code = r->code;
+    out.contentType = r->contentType;
+    out.body = r->body;
+    for (auto& h : r->headers)
+      if (h.first == "Location") out.location = h.second;
+  }
+  return out;
+}
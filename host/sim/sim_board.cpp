@@ -0,0 +1,81 @@
+// sim_board.cpp -- the board around the display for the host simulator
+//
+// Replaces the drivers the simulator does not compile (Touch_CST820.cpp,
+// TCA9554PWR.cpp, I2C_Driver.cpp) and the network-side modules the UI only
+// calls into (WiFiMgr, UDPCapture). The EXIO expander keeps its pin state
+// so the buzzer (EXIO8) can be counted.
+
+#include <Arduino.h>
+#include "Touch_CST820.h"
+#include "TCA9554PWR.h"
+#include "I2C_Driver.h"
+#include "wifimgr.h"
+#include "udp_capture.h"
+#include "sim_touch.h"
+
+// ---------- CST820 ----------
+uint8_t Touch_interrupts = 0;
+struct CST820_Touch touch_data = {0};
+
+uint8_t Touch_Init() { return true; }
+uint8_t CST820_Touch_Reset(void) { return true; }
+void CST820_AutoSleep(bool) {}
+uint16_t CST820_Read_cfg(void) { return true; }
+void Touch_CST820_ISR(void) { Touch_interrupts = true; }
+
+uint8_t Touch_Read_Data(void) {
+  return SimTouch::read(touch_data);
+}
+
+String Touch_GestureName(void) {
+  switch (touch_data.gesture) {
+    case SWIPE_UP:     return "SWIPE UP";
+    case SWIPE_DOWN:   return "SWIPE DOWN";
+    case SWIPE_LEFT:   return "SWIPE LEFT";
+    case SWIPE_RIGHT:  return "SWIPE RIGHT";
+    case SINGLE_CLICK: return "SINGLE CLICK";
+    case DOUBLE_CLICK: return "DOUBLE CLICK";
+    case LONG_PRESS:   return "LONG PRESS";
+    default:           return "NONE";
+  }
+}
+
+// ---------- I2C / TCA9554 ----------
+static uint8_t s_exio = 0;
+uint32_t simBuzzerOn = 0;   // EXIO8 rising edges (beeps)
+
+void I2C_Init(void) {}
+bool I2C_Read(uint8_t, uint8_t, uint8_t*, uint32_t) { return false; }
+bool I2C_Write(uint8_t, uint8_t, const uint8_t*, uint32_t) { return false; }
+
+uint8_t I2C_Read_EXIO(uint8_t) { return s_exio; }
+uint8_t I2C_Write_EXIO(uint8_t REG, uint8_t Data) {
+  if (REG == TCA9554_OUTPUT_REG) s_exio = Data;
+  return 0;
+}
+void Mode_EXIO(uint8_t, uint8_t) {}
+void Mode_EXIOS(uint8_t) {}
+uint8_t Read_EXIO(uint8_t Pin) { return (s_exio >> (Pin - 1)) & 1; }
+uint8_t Read_EXIOS(uint8_t) { return s_exio; }
+void Set_EXIO(uint8_t Pin, uint8_t State) {
+  const uint8_t bit = 1u << (Pin - 1);
+  if (Pin == EXIO_PIN8 && State && !(s_exio & bit)) simBuzzerOn++;
+  s_exio = State ? (s_exio | bit) : (s_exio & ~bit);
+}
+void Set_EXIOS(uint8_t PinState) { s_exio = PinState; }
+void Set_Toggle(uint8_t Pin) { Set_EXIO(Pin, !Read_EXIO(Pin)); }
+void TCA9554PWR_Init(uint8_t) { s_exio = 0; }
+
+// ---------- WiFiMgr (the portal is not simulated) ----------
+void WiFiMgr::begin() {}
+void WiFiMgr::loop() {}
+void WiFiMgr::restartPortal() { Serial.println("[sim] WiFiMgr::restartPortal"); }
+void WiFiMgr::forgetWiFi() { Serial.println("[sim] WiFiMgr::forgetWiFi"); }
+bool WiFiMgr::isConnected() { return true; }
+String WiFiMgr::getStatus() { return "Connected (simulated)"; }
+
+// ---------- UDPCapture (records to FFat on the device; nothing here) ----------
+void UDPCapture::begin(AsyncWebServer&) {}
+void UDPCapture::loop() {}
+void UDPCapture::record(uint16_t, const IPAddress&, const void*, size_t) {}
+bool UDPCapture::active() { return false; }
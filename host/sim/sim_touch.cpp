@@ -0,0 +1,69 @@
+// sim_touch.cpp -- contact samples to CST820 gestures (see sim_touch.h)
+#include "sim_touch.h"
+#include <deque>
+#include <stdlib.h>
+
+namespace {
+struct Pending { GESTURE g; int x, y; };
+std::deque<Pending> s_queue;
+uint32_t s_count = 0;
+
+bool     s_down = false, s_longSent = false;
+int      s_x0 = 0, s_y0 = 0, s_x = 0, s_y = 0;
+uint32_t s_t0 = 0;
+}
+
+// touch_data/Touch_interrupts live in sim_board.cpp, as in Touch_CST820.cpp
+extern uint8_t Touch_interrupts;
+
+void SimTouch::post(GESTURE g, int x, int y) {
+  s_queue.push_back(Pending{g, x, y});
+  s_count++;
+  Touch_interrupts = true;   // what the INT line does on the device
+}
+
+void SimTouch::sample(bool down, int x, int y, uint32_t nowMs) {
+  if (down && !s_down) {
+    s_down = true;
+    s_longSent = false;
+    s_x0 = s_x = x;
+    s_y0 = s_y = y;
+    s_t0 = nowMs;
+    return;
+  }
+  if (down) {
+    s_x = x;
+    s_y = y;
+    const bool still = abs(s_x - s_x0) < SIM_SWIPE_PX && abs(s_y - s_y0) < SIM_SWIPE_PX;
+    if (!s_longSent && still && nowMs - s_t0 >= SIM_LONG_PRESS_MS) {
+      post(LONG_PRESS, s_x0, s_y0);
+      s_longSent = true;
+    }
+    return;
+  }
+  if (!s_down) return;
+  s_down = false;
+  if (s_longSent) return;
+
+  const int dx = s_x - s_x0, dy = s_y - s_y0;
+  if (abs(dx) >= SIM_SWIPE_PX || abs(dy) >= SIM_SWIPE_PX) {
+    if (abs(dy) >= abs(dx)) post(dy < 0 ? SWIPE_UP : SWIPE_DOWN, s_x, s_y);
+    else                    post(dx < 0 ? SWIPE_LEFT : SWIPE_RIGHT, s_x, s_y);
+  } else {
+    post(SINGLE_CLICK, s_x, s_y);
+  }
+}
+
+bool SimTouch::read(CST820_Touch& out) {
+  if (s_queue.empty()) return false;
+  const Pending p = s_queue.front();
+  s_queue.pop_front();
+  out.points = 1;
+  out.gesture = p.g;
+  out.x = (uint16_t)p.x;
+  out.y = (uint16_t)p.y;
+  if (!s_queue.empty()) Touch_interrupts = true;
+  return true;
+}
+
+uint32_t SimTouch::gestures() { return s_count; }
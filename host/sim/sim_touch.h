@@ -0,0 +1,26 @@
+// sim_touch.h -- CST820 stand-in for the host simulator
+//
+// The CST820 reports finished gestures, not raw contacts, and the UI only
+// ever looks at touch_data.gesture/x/y. The simulator turns mouse (or
+// scripted) contact samples into the same gestures:
+// - held still for SIM_LONG_PRESS_MS -> LONG_PRESS while still held
+// - released after moving >= SIM_SWIPE_PX -> SWIPE_* on the dominant axis
+// - otherwise, released -> SINGLE_CLICK where it was released
+// A script can also post a gesture directly.
+
+#pragma once
+#include <stdint.h>
+#include "Touch_CST820.h"
+
+#define SIM_LONG_PRESS_MS  800
+#define SIM_SWIPE_PX       40
+
+namespace SimTouch {
+  // One contact sample per main loop pass
+  void sample(bool down, int x, int y, uint32_t nowMs);
+  // Queue a finished gesture (scripts)
+  void post(GESTURE g, int x, int y);
+  // Called from Touch_Read_Data(): moves the next gesture into touch_data
+  bool read(CST820_Touch& out);
+  uint32_t gestures();
+}
@@ -0,0 +1,488 @@
+// td_sim.cpp
+//
+// The display firmware on a PC. ImageDisplay, the boot screen, the status
+// overlay, the touch UI, UDPDetect, the alerts and FileMan's pages are compiled
+// unchanged from src/ against LovyanGFX's SDL panel (td_sim, a 480x480
+// window, mouse = finger) or an in-memory panel (td_sim_headless). FFat is
+// a directory, the UDP ports are real sockets (-n) and/or datagrams from a
+// capture (-c), and a script (-s) can tap, swipe, inject telemetry, fetch
+// pages and take screenshots at set times.
+//
+// setup()/loop() follow Type_D_XL.ino with the WiFi portal, device
+// detection, the expansion link and the serial console left out.
+//
+// The headless build runs on a virtual clock by default: every loop pass
+// advances millis() by -l ms and delay() returns at once, so a script gives
+// the same frames on every run and the run is as fast as the host allows
+// (perf / valgrind). -r uses the real clock instead. On exit a profile of
+// where the loop spent its time goes to stderr.
+
+#include <Arduino.h>
+#include <FFat.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPAsyncWebServer.h>
+#include "disp_cfg.h"
+#include "boot.h"
+#include "fileman.h"
+#include "imagedisplay.h"
+#include "xbox_status.h"
+#include "ui.h"
+#include "ui_set.h"
+#include "ui_bright.h"
+#include "ui_about.h"
+#include "ui_winfo.h"
+#include "udp_detect.h"
+#include "alerts.h"
+#include "beep.h"
+#include "title_db.h"
+#include "td_wire.h"
+#include "Touch_CST820.h"
+#include "sim_touch.h"
+#include "tcap.h"
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define SIM_LOOP_MS 5
+#define BRIGHTNESS_PREF_KEY "brightness"
+#define BRIGHTNESS_PREF_NS "type_d"
+
+LGFX tft;
+AsyncWebServer server8080(8080);
+
+extern uint32_t simBuzzerOn;   // sim_board.cpp
+
+// ---------- options ----------
+struct Options {
+  std::string root, script, capture;
+  bool        sockets = false;
+  bool        realTime = false;
+  bool        quiet = false;
+  uint32_t    loopMs = SIM_LOOP_MS;
+  uint32_t    seed = 1;
+  double      stopAfterS = 0;
+};
+static Options opt;
+
+// ---------- profile ----------
+enum Phase { P_TOUCH, P_UI, P_UDP, P_OVERLAY, P_IMAGE, P_SCRIPT, kPhases };
+static const char* kPhaseName[kPhases] = {"touch", "ui", "udp", "overlay", "image", "script"};
+static double   s_phaseUs[kPhases];
+static uint64_t s_phaseCalls[kPhases];
+static uint64_t s_passes = 0, s_overlays = 0;
+static double   s_maxPassUs = 0;
+
+struct Timed {
+  Phase p;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  explicit Timed(Phase ph) : p(ph) {}
+  ~Timed() {
+    s_phaseUs[p] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    s_phaseCalls[p]++;
+  }
+};
+
+// ---------- script ----------
+// One event per line, "<ms> <event> [args]", ms from the end of setup():
+//   tap X Y | long X Y | swipe up|down|left|right
+//   udp PORT TEXT...      datagram with the rest of the line as payload
+//   udphex PORT HEX       datagram from hex bytes
+//   get URL[?k=v&..] [OUT] | post URL[?k=v&..] [OUT]
+//   shot FILE.ppm | quit
+struct Event {
+  uint32_t                 ms;
+  std::string              op;
+  std::vector<std::string> args;
+  std::string              rest;   // text after "udp PORT"
+};
+static std::vector<Event> s_events;
+static size_t s_nextEvent = 0;
+
+static bool load_script(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream ls(line);
+    Event e;
+    if (!(ls >> e.ms >> e.op)) continue;
+    std::string a;
+    if (e.op == "udp") {
+      if (!(ls >> a)) continue;
+      e.args.push_back(a);
+      std::getline(ls >> std::ws, e.rest);
+    } else {
+      while (ls >> a) e.args.push_back(a);
+    }
+    s_events.push_back(e);
+  }
+  std::stable_sort(s_events.begin(), s_events.end(), [](const Event& a, const Event& b) { return a.ms < b.ms; });
+  return true;
+}
+
+static bool save_ppm(const std::string& path) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const int w = tft.width(), h = tft.height();
+  fprintf(f, "P6\n%d %d\n255\n", w, h);
+  std::vector<lgfx::rgb888_t> line(w);
+  std::vector<uint8_t> out(w * 3);
+  for (int y = 0; y < h; ++y) {
+    tft.readRect(0, y, w, 1, line.data());
+    for (int x = 0; x < w; ++x) {
+      out[x * 3 + 0] = line[x].r;
+      out[x * 3 + 1] = line[x].g;
+      out[x * 3 + 2] = line[x].b;
+    }
+    fwrite(out.data(), 1, out.size(), f);
+  }
+  fclose(f);
+  return true;
+}
+
+static std::vector<std::pair<String, String>> parse_args(const std::string& q) {
+  std::vector<std::pair<String, String>> out;
+  std::istringstream s(q);
+  std::string kv;
+  while (std::getline(s, kv, '&')) {
+    const size_t eq = kv.find('=');
+    out.emplace_back(String(kv.substr(0, eq)), String(eq == std::string::npos ? "" : kv.substr(eq + 1)));
+  }
+  return out;
+}
+
+static std::vector<uint8_t> parse_hex(const std::string& hex) {
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) out.push_back((uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+  return out;
+}
+
+static bool s_quit = false;
+
+static void run_event(const Event& e) {
+  auto arg = [&](size_t i) { return i < e.args.size() ? e.args[i] : std::string(); };
+  auto num = [&](size_t i) { return atoi(arg(i).c_str()); };
+  const IPAddress scriptSrc(127, 0, 0, 1);
+
+  if (e.op == "tap")        SimTouch::post(SINGLE_CLICK, num(0), num(1));
+  else if (e.op == "long")  SimTouch::post(LONG_PRESS, num(0), num(1));
+  else if (e.op == "swipe") {
+    const std::string d = arg(0);
+    SimTouch::post(d == "up" ? SWIPE_UP : d == "down" ? SWIPE_DOWN : d == "left" ? SWIPE_LEFT : SWIPE_RIGHT, 240, 240);
+  } else if (e.op == "udp") {
+    HostNet::inject((uint16_t)num(0), scriptSrc, reinterpret_cast<const uint8_t*>(e.rest.data()), e.rest.size());
+  } else if (e.op == "udphex") {
+    const std::vector<uint8_t> b = parse_hex(arg(1));
+    HostNet::inject((uint16_t)num(0), scriptSrc, b.data(), b.size());
+  } else if (e.op == "get" || e.op == "post") {
+    const std::string url = arg(0);
+    const size_t q = url.find('?');
+    const HostWeb::Reply r = HostWeb::call(server8080, e.op == "get" ? HTTP_GET : HTTP_POST, String(url.substr(0, q)),
+                                           parse_args(q == std::string::npos ? "" : url.substr(q + 1)));
+    fprintf(stderr, "[sim] %s %s -> %d%s%s, %u bytes\n", e.op.c_str(), url.c_str(), r.code,
+            r.location.isEmpty() ? "" : " ", r.location.c_str(), (unsigned)r.body.length());
+    if (!arg(1).empty()) {
+      if (FILE* f = fopen(arg(1).c_str(), "wb")) { fwrite(r.body.c_str(), 1, r.body.length(), f); fclose(f); }
+    }
+  } else if (e.op == "shot") {
+    if (!save_ppm(arg(0))) fprintf(stderr, "[sim] cannot write %s\n", arg(0).c_str());
+  } else if (e.op == "quit") {
+    s_quit = true;
+  } else {
+    fprintf(stderr, "[sim] unknown script event '%s'\n", e.op.c_str());
+  }
+}
+
+// ---------- capture feed ----------
+static std::vector<tcap::Datagram> s_capture;
+static size_t s_nextDatagram = 0;
+static uint32_t s_startMs = 0;   // end of setup(); script and capture times count from here
+
+static void feed(uint32_t nowMs) {
+  Timed t(P_SCRIPT);
+  const uint32_t rel = nowMs - s_startMs;
+  while (s_nextEvent < s_events.size() && s_events[s_nextEvent].ms <= rel) run_event(s_events[s_nextEvent++]);
+  while (s_nextDatagram < s_capture.size()) {
+    const tcap::Datagram& d = s_capture[s_nextDatagram];
+    if ((d.tUs - s_capture.front().tUs) / 1000 > rel) break;
+    HostNet::inject(d.port, IPAddress(d.src), d.data.data(), d.data.size());
+    s_nextDatagram++;
+  }
+}
+
+// ---------- firmware (as in Type_D_XL.ino) ----------
+static bool overlayPending = false;
+static bool showingXboxStatus = false;
+static unsigned long lastStatusDisplay = 0;
+static bool alertShown = false;
+XboxStatus lastXboxStatus;
+
+// The alert ring is held back while a menu or the status overlay is up
+static bool ringFree() {
+    return !ui_about_isActive() && !ui_bright_isVisible() && !UISet::isMenuVisible() &&
+           !ui_winfo_isVisible() && !UI::isMenuVisible() && !showingXboxStatus;
+}
+
+static bool alertFrameHook() {
+    UDPDetect::loop();
+    Alerts::loop(ringFree());
+    Beep::update();
+    return Alerts::preempting();
+}
+
+static void restoreAfterAlert() {
+    if      (ui_about_isActive())    ui_about_open();
+    else if (ui_bright_isVisible())  ui_bright_open();
+    else if (UISet::isMenuVisible()) UISet::begin(&tft);
+    else if (ui_winfo_isVisible())   ui_winfo_open();
+    else if (UI::isMenuVisible())    UI::drawMenu();
+    else {
+        showingXboxStatus = false;
+        ImageDisplay::resume();
+    }
+}
+
+void apply_saved_brightness() {
+    Preferences prefs;
+    prefs.begin(BRIGHTNESS_PREF_NS, true);
+    int percent = prefs.getUInt(BRIGHTNESS_PREF_KEY, 100);
+    prefs.end();
+
+    if (percent < 5) percent = 5;
+    if (percent > 100) percent = 100;
+    tft.setBrightness((percent * 255) / 100);
+}
+
+void setup() {
+    Serial.println("[Type D XL] Booting (host simulator)...");
+    if (!FFat.begin()) {
+        fprintf(stderr, "[sim] FFat root %s is not a directory\n", FFat.hostRoot().c_str());
+        exit(1);
+    }
+    TitleDB::begin();
+
+    tft.begin();
+    apply_saved_brightness();
+
+    bootShowScreen();
+    ImageDisplay::begin(&tft);
+
+    tft.fillScreen(TFT_BLACK);
+    tft.setTextDatum(middle_center);
+    tft.setTextColor(TFT_GREEN, TFT_BLACK);
+    tft.setTextSize(6);
+    tft.drawString("Type D XL", tft.width() / 2, tft.height() / 2 - 48);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setTextSize(4);
+    tft.drawString(VERSION_TEXT, tft.width() / 2, tft.height() / 2 + 40);
+    delay(1500);
+
+    Touch_Init();
+    UDPDetect::begin();
+    server8080.begin();
+    FileMan::begin(server8080);
+    UI::begin(&tft);
+    Alerts::begin(server8080, &tft);
+    ImageDisplay::setFrameHook(alertFrameHook);
+
+    ImageDisplay::displayRandomImage();
+    s_startMs = millis();
+}
+
+void loop() {
+    feed(millis());
+
+#if !defined(TD_HOST_HEADLESS)
+    {
+        Timed t(P_TOUCH);
+        int32_t x = 0, y = 0;
+        const bool down = tft.getTouch(&x, &y) > 0;
+        SimTouch::sample(down, x, y, millis());
+    }
+#endif
+
+    if (Touch_interrupts) {
+        Touch_interrupts = false;
+        Touch_Read_Data();
+    }
+
+    {
+        Timed t(P_UDP);
+        UDPDetect::loop();
+        Alerts::loop(ringFree());
+        Beep::update();
+    }
+    if (Alerts::show(false)) { alertShown = true; return; }
+    if (alertShown) { alertShown = false; restoreAfterAlert(); }
+
+    {
+        Timed t(P_UI);
+        if      (ui_about_isActive())    { ui_about_update(); return; }
+        else if (ui_bright_isVisible())  { ui_bright_update(); return; }
+        else if (UISet::isMenuVisible()) { UISet::update(); return; }
+        else if (ui_winfo_isVisible())   { ui_winfo_update(); return; }
+        else if (UI::isMenuVisible())    { UI::update(); return; }
+        UI::update();
+    }
+
+    bool anyUiActive = ui_about_isActive() || ui_bright_isVisible() || UISet::isMenuVisible() || UI::isMenuVisible();
+
+    if (Alerts::show(ImageDisplay::isDone() && !overlayPending && !showingXboxStatus && !anyUiActive)) {
+        alertShown = true;
+        return;
+    }
+
+    if (ImageDisplay::isDone() && UDPDetect::hasPacket() && !overlayPending && !showingXboxStatus && !anyUiActive) {
+        lastXboxStatus = UDPDetect::getLatest();
+        overlayPending = true;
+        UDPDetect::acknowledge();
+    }
+
+    if (overlayPending && !anyUiActive) {
+        Timed t(P_OVERLAY);
+        xbox_status::show(&tft, lastXboxStatus);
+        lastStatusDisplay = millis();
+        showingXboxStatus = true;
+        overlayPending = false;
+        s_overlays++;
+        return;
+    }
+
+    if (showingXboxStatus && !anyUiActive) {
+        if (millis() - lastStatusDisplay > 2000) {
+            Timed t(P_IMAGE);
+            showingXboxStatus = false;
+            ImageDisplay::resume();
+        }
+        return;
+    }
+
+    if (!UI::isMenuVisible()) {
+        Timed t(P_IMAGE);
+        ImageDisplay::update();
+    }
+}
+
+// ---------- harness ----------
+static void pass() {
+  const auto t0 = std::chrono::steady_clock::now();
+  loop();
+  const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+  s_maxPassUs = std::max(s_maxPassUs, us);
+  s_passes++;
+}
+
+static bool finished(bool whenFedOut) {
+  if (s_quit) return true;
+  if (opt.stopAfterS > 0 && millis() - s_startMs >= opt.stopAfterS * 1000) return true;
+  // Headless with a script or capture and no time limit: stop once both are used up
+  if (whenFedOut && opt.stopAfterS <= 0 && (!s_events.empty() || !s_capture.empty()))
+    return s_nextEvent >= s_events.size() && s_nextDatagram >= s_capture.size();
+  return false;
+}
+
+static void report(double wallS) {
+  fprintf(stderr, "---\n");
+  fprintf(stderr, "sim       %.1f s simulated, %.2f s wall, %llu loop passes, max pass %.1f ms\n",
+          (millis() - s_startMs) / 1000.0, wallS, (unsigned long long)s_passes, s_maxPassUs / 1000);
+  fprintf(stderr, "events    %llu overlays, %u gestures, %u beeps\n", (unsigned long long)s_overlays,
+          SimTouch::gestures(), simBuzzerOn);
+  const Alerts::Stats as = Alerts::stats();
+  fprintf(stderr, "alerts    %u raised, %u cleared, %u preempts, eval %u us avg %u max, latency %.1f ms avg %.1f max\n",
+          as.raised, as.cleared, as.preempts, as.evalAvgUs, as.evalMaxUs, as.latencyAvgUs / 1000.0,
+          as.latencyMaxUs / 1000.0);
+  for (int p = 0; p < kPhases; ++p)
+    if (s_phaseCalls[p])
+      fprintf(stderr, "phase %-8s %8llu calls  total %9.1f ms  mean %8.1f us\n", kPhaseName[p],
+              (unsigned long long)s_phaseCalls[p], s_phaseUs[p] / 1000, s_phaseUs[p] / s_phaseCalls[p]);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: td_sim [-f FFAT_DIR] [-s SCRIPT] [-c CAPTURE.tdc] [-n] [-t SECONDS] [-l LOOP_MS] [-r] [-S SEED] [-q]\n"
+          "  -f  directory with the FATFS contents (default $TD_FFAT_ROOT or .)\n"
+          "  -s  script of timed touches, datagrams, page fetches and screenshots\n"
+          "  -c  feed a capture's datagrams at their recorded times\n"
+          "  -n  also listen on the real UDP ports 50504-50506\n"
+          "  -t  stop after this much simulated time\n"
+          "  -l  loop period on the virtual clock (headless, default %d ms)\n"
+          "  -r  real clock (headless; the window always uses it)\n"
+          "  -S  random seed for the slideshow (default 1)\n"
+          "  -q  no serial log\n", SIM_LOOP_MS);
+}
+
+static bool parse_options(int argc, char** argv) {
+  int c;
+  while ((c = getopt(argc, argv, "f:s:c:nt:l:rS:qh")) != -1) {
+    switch (c) {
+      case 'f': opt.root = optarg; break;
+      case 's': opt.script = optarg; break;
+      case 'c': opt.capture = optarg; break;
+      case 'n': opt.sockets = true; break;
+      case 't': opt.stopAfterS = atof(optarg); break;
+      case 'l': opt.loopMs = std::max(1, atoi(optarg)); break;
+      case 'r': opt.realTime = true; break;
+      case 'S': opt.seed = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'q': opt.quiet = true; break;
+      default: usage(); return false;
+    }
+  }
+  if (!opt.root.empty()) FFat.setHostRoot(opt.root);
+  if (!opt.script.empty() && !load_script(opt.script)) {
+    fprintf(stderr, "td_sim: cannot read script %s\n", opt.script.c_str());
+    return false;
+  }
+  if (!opt.capture.empty()) {
+    td_wire::CaptureHeader hdr;
+    if (!tcap::load(opt.capture, hdr, s_capture) || s_capture.empty()) {
+      fprintf(stderr, "td_sim: %s is not a capture\n", opt.capture.c_str());
+      return false;
+    }
+    std::stable_sort(s_capture.begin(), s_capture.end(),
+                     [](const tcap::Datagram& a, const tcap::Datagram& b) { return a.tUs < b.tUs; });
+  }
+  srand(opt.seed);
+  Serial.enabled = !opt.quiet;
+  HostNet::useSockets(opt.sockets);
+  return true;
+}
+
+#if defined(TD_HOST_HEADLESS)
+int main(int argc, char** argv) {
+  if (!parse_options(argc, argv)) return 2;
+  if (!opt.realTime) hostSetTimeUs(0);
+  if (opt.script.empty() && opt.capture.empty() && opt.stopAfterS <= 0) opt.stopAfterS = 60;
+
+  const auto wall0 = std::chrono::steady_clock::now();
+  setup();
+  while (!finished(true)) {
+    pass();
+    if (!opt.realTime) hostSetTimeUs((uint64_t)micros() + opt.loopMs * 1000ull);
+  }
+  report(std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count());
+  return 0;
+}
+#else
+static std::chrono::steady_clock::time_point s_wall0;
+
+// Runs on LovyanGFX's worker thread; the SDL window is serviced on main()
+static int user_func(bool* running) {
+  setup();
+  while (*running && !finished(false)) pass();
+  report(std::chrono::duration<double>(std::chrono::steady_clock::now() - s_wall0).count());
+  exit(0);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (!parse_options(argc, argv)) return 2;
+  s_wall0 = std::chrono::steady_clock::now();
+  return lgfx::Panel_sdl::main(user_func);
+}
+#endif
@@ -0,0 +1,151 @@
+import sys
+import os
+import json
+import socket
+import struct
+import hashlib
+import time
+import urllib.request
+import urllib.error
+
+# Type D EXP remote config and signed OTA.
+#   keygen NAME               NAME.pem (private, keep safe) + NAME_ota_key.h (copy over EXP Src/src/ota_key.h)
+#   sign FW.bin KEY.pem [OUT] signed bundle (default FW.tdo): 104-byte header + image
+#   push BUNDLE HOST          chunked upload with resume (or upload the bundle on the display's /exp page)
+#   config HOST [k=v ...]     show / set pacing over HTTP
+#   config --all [k=v ...]    broadcast over UDP 50508; every expansion on the LAN answers
+#
+# Bundle header (little-endian): "TDO1", u32 image size, sha256[32], ECDSA P-256 r||s[64] over the sha256.
+
+CFG_PORT = 50508
+CHUNK = 8192
+RETRIES = 8
+
+
+def need_crypto():
+    try:
+        from cryptography.hazmat.primitives.asymmetric import ec, utils
+        from cryptography.hazmat.primitives import hashes, serialization
+    except ImportError:
+        sys.exit("keygen/sign need the 'cryptography' package: pip install cryptography")
+    return ec, utils, hashes, serialization
+
+
+def keygen(name):
+    ec, _, _, serialization = need_crypto()
+    key = ec.generate_private_key(ec.SECP256R1())
+    pem = key.private_bytes(serialization.Encoding.PEM, serialization.PrivateFormat.PKCS8,
+                            serialization.NoEncryption())
+    pub = key.public_key().public_bytes(serialization.Encoding.X962,
+                                        serialization.PublicFormat.UncompressedPoint)
+    with open(name + ".pem", "wb") as f:
+        f.write(pem)
+    rows = ",\n    ".join(", ".join(f"0x{b:02X}" for b in pub[i:i + 13]) for i in range(0, len(pub), 13))
+    with open(name + "_ota_key.h", "w") as f:
+        f.write("// ota_key.h -- generated by script/exp_ota.py keygen\n"
+                "#pragma once\n#include <stdint.h>\n\n#define EXP_OTA_KEY_SET 1\n\n"
+                f"static const uint8_t EXP_OTA_PUBKEY[65] = {{\n    {rows}\n}};\n")
+    print(f"wrote {name}.pem (private) and {name}_ota_key.h")
+
+
+def sign(fw_path, key_path, out_path=None):
+    ec, utils, hashes, serialization = need_crypto()
+    with open(key_path, "rb") as f:
+        key = serialization.load_pem_private_key(f.read(), password=None)
+    with open(fw_path, "rb") as f:
+        image = f.read()
+    digest = hashlib.sha256(image).digest()
+    der = key.sign(digest, ec.ECDSA(utils.Prehashed(hashes.SHA256())))
+    r, s = utils.decode_dss_signature(der)
+    header = b"TDO1" + struct.pack("<I", len(image)) + digest + r.to_bytes(32, "big") + s.to_bytes(32, "big")
+    out_path = out_path or os.path.splitext(fw_path)[0] + ".tdo"
+    with open(out_path, "wb") as f:
+        f.write(header + image)
+    print(f"{out_path}: {len(image)} bytes, sha256 {digest.hex()}")
+
+
+def http(method, url, body=None, timeout=15):
+    req = urllib.request.Request(url, data=body, method=method,
+                                 headers={"Content-Type": "application/octet-stream"})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as r:
+            return r.status, r.read().decode(errors="replace")
+    except urllib.error.HTTPError as e:
+        return e.code, e.read().decode(errors="replace")
+
+
+def push(bundle_path, host):
+    with open(bundle_path, "rb") as f:
+        data = f.read()
+    header, image = data[:104], data[104:]
+    if header[:4] != b"TDO1" or struct.unpack("<I", header[4:8])[0] != len(image):
+        sys.exit("not a signed bundle (use: exp_ota.py sign)")
+    base = f"http://{host}"
+    retries = 0
+    while retries <= RETRIES:
+        try:
+            code, reply = http("POST", base + "/ota/begin", header)
+            if code != 200:
+                sys.exit(f"refused ({code}): {reply}")
+            nxt = json.loads(reply)["next"]
+            if nxt:
+                print(f"resuming at {nxt}/{len(image)}")
+            while nxt < len(image):
+                code, reply = http("POST", f"{base}/ota/chunk?off={nxt}", image[nxt:nxt + CHUNK])
+                st = json.loads(reply)
+                if st["state"] != "receiving":
+                    raise IOError(st.get("err") or st["state"])
+                nxt = st["next"]
+                print(f"\r{nxt}/{len(image)} bytes", end="", flush=True)
+            print()
+            code, reply = http("POST", base + "/ota/end", b"", timeout=60)
+            print(reply)
+            sys.exit(0 if code == 200 else 1)
+        except (OSError, ValueError, KeyError) as e:
+            retries += 1
+            print(f"\nlink problem ({e}); retry {retries}/{RETRIES}")
+            time.sleep(min(30, 2 ** retries))
+    sys.exit("gave up")
+
+
+def config(target, pairs):
+    if target == "--all":
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        s.settimeout(1.0)
+        msg = "CFG:SET:" + ",".join(pairs) if pairs else "CFG:GET"
+        s.sendto(msg.encode(), ("255.255.255.255", CFG_PORT))
+        try:
+            while True:
+                data, addr = s.recvfrom(1024)
+                print(addr[0], data.decode(errors="replace")[4:])
+        except socket.timeout:
+            pass
+        return
+    if pairs:
+        code, reply = http("POST", f"http://{target}/config?" + "&".join(pairs))
+    else:
+        code, reply = http("GET", f"http://{target}/config")
+    if code != 200:
+        sys.exit(f"{code}: {reply}")
+    for k, v in json.loads(reply).items():
+        print(f"{k:13} {v['v']:>8}   (default {v['def']}, {v['min']}..{v['max']})")
+
+
+def main():
+    a = sys.argv[1:]
+    if len(a) >= 2 and a[0] == "keygen":
+        keygen(a[1])
+    elif len(a) >= 3 and a[0] == "sign":
+        sign(a[1], a[2], a[3] if len(a) > 3 else None)
+    elif len(a) == 3 and a[0] == "push":
+        push(a[1], a[2])
+    elif len(a) >= 2 and a[0] == "config":
+        config(a[1], a[2:])
+    else:
+        print("usage: exp_ota.py keygen NAME | sign FW.bin KEY.pem [OUT] | push BUNDLE HOST | config HOST|--all [k=v ...]")
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()
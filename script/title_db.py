@@ -0,0 +1,116 @@
+import sys
+import os
+import csv
+import struct
+import io
+
+# Builds the Type D XL title database from a CSV of "title_id,name[,cover_image]".
+#   titles.bin    sorted ID index + name pool (always)
+#   titleart.bin  sorted ID index + 64x64 baseline JPG covers (only if any row has an image)
+# Copy both to the root of the FATFS partition.
+
+ART_SIZE = 64
+ART_QUALITY = 80
+
+
+def parse_tid(text):
+    text = text.strip()
+    if text.lower().startswith("0x"):
+        text = text[2:]
+    return int(text, 16)
+
+
+def load_rows(csv_path):
+    rows = {}
+    base = os.path.dirname(os.path.abspath(csv_path))
+    with open(csv_path, newline="", encoding="utf-8") as f:
+        for lineno, row in enumerate(csv.reader(f), 1):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            if len(row) < 2:
+                print(f"line {lineno}: expected title_id,name[,image]; skipped")
+                continue
+            try:
+                tid = parse_tid(row[0])
+            except ValueError:
+                if lineno == 1:
+                    continue  # header
+                print(f"line {lineno}: bad title id '{row[0]}'; skipped")
+                continue
+            name = row[1].strip()
+            image = row[2].strip() if len(row) > 2 and row[2].strip() else None
+            if image and not os.path.isabs(image):
+                image = os.path.join(base, image)
+            if tid in rows:
+                print(f"line {lineno}: duplicate {tid:08X}; keeping the later entry")
+            rows[tid] = (name, image)
+    return rows
+
+
+def build_names(rows):
+    ids = sorted(rows)
+    pool = bytearray()
+    index = bytearray()
+    for tid in ids:
+        index += struct.pack("<II", tid, len(pool))
+        pool += rows[tid][0].encode("utf-8") + b"\0"
+    names_off = 12 + len(index)
+    return b"TDB1" + struct.pack("<II", len(ids), names_off) + bytes(index) + bytes(pool)
+
+
+def build_art(rows):
+    if not any(image for _, image in rows.values()):
+        return None
+    from PIL import Image  # only needed when covers are given
+
+    covers = []
+    for tid in sorted(rows):
+        image = rows[tid][1]
+        if not image:
+            continue
+        with Image.open(image) as im:
+            im = im.convert("RGB")
+            # centre-crop to square, then scale
+            side = min(im.size)
+            left = (im.width - side) // 2
+            top = (im.height - side) // 2
+            im = im.crop((left, top, left + side, top + side)).resize((ART_SIZE, ART_SIZE), Image.LANCZOS)
+            buf = io.BytesIO()
+            im.save(buf, "JPEG", quality=ART_QUALITY, progressive=False, optimize=True)
+            covers.append((tid, buf.getvalue()))
+    if not covers:
+        return None
+
+    offset = 8 + 12 * len(covers)
+    index = bytearray()
+    data = bytearray()
+    for tid, jpg in covers:
+        index += struct.pack("<III", tid, offset + len(data), len(jpg))
+        data += jpg
+    return b"TDA1" + struct.pack("<I", len(covers)) + bytes(index) + bytes(data)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: python title_db.py titles.csv [output_dir]")
+        return
+
+    csv_path = sys.argv[1]
+    out_dir = sys.argv[2] if len(sys.argv) > 2 else "."
+    os.makedirs(out_dir, exist_ok=True)
+
+    rows = load_rows(csv_path)
+    names = build_names(rows)
+    with open(os.path.join(out_dir, "titles.bin"), "wb") as f:
+        f.write(names)
+    print(f"Saved: titles.bin ({len(rows)} titles, {len(names)} bytes)")
+
+    art = build_art(rows)
+    if art:
+        with open(os.path.join(out_dir, "titleart.bin"), "wb") as f:
+            f.write(art)
+        print(f"Saved: titleart.bin ({len(art)} bytes)")
+
+
+if __name__ == "__main__":
+    main()
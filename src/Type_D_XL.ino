@@ -17,6 +17,14 @@
 #include "cmd.h"
 #include "diag.h"
 #include "udp_detect.h"
+#include "title_db.h"
+#include "exp_link.h"
+#include "udp_capture.h"
+#include "show_api.h"
+#include "cast_rx.h"
+#include "alerts.h"
+#include "beep.h"
+#include "panel_clock.h"
 #include "Touch_CST820.h"
 #include "TCA9554PWR.h"
 #include "I2C_Driver.h"
@@ -45,6 +53,7 @@ bool portalInfoShown = false;
 static bool overlayPending = false;
 static bool showingXboxStatus = false;
 static unsigned long lastStatusDisplay = 0;
+static bool alertShown = false;
 
 XboxStatus lastXboxStatus;
 
@@ -81,6 +90,36 @@ void displayPortalInfo() {
     tft.drawString("Connect below to setup.", tft.width()/2, tft.height()/2 + 80);
 }
 
+// The alert ring is held back while a menu or the status overlay is up
+static bool ringFree() {
+    return !ui_about_isActive() && !ui_bright_isVisible() && !UISet::isMenuVisible() &&
+           !ui_winfo_isVisible() && !UI::isMenuVisible() && !showingXboxStatus;
+}
+
+// Runs between the frames of a GIF or .565 and the strips of a streamed or
+// Ken Burns decode, which each run in one call: keeps telemetry and alerts
+// going, and stops the draw for a high-priority alert
+static bool alertFrameHook() {
+    UDPDetect::loop();
+    Alerts::loop(ringFree());
+    Beep::update();
+    return Alerts::preempting();
+}
+
+// What was under an alert overlay once it goes: the open menu, else the slideshow
+static void restoreAfterAlert() {
+    if      (ui_about_isActive())    ui_about_open();
+    else if (ui_bright_isVisible())  ui_bright_open();
+    else if (UISet::isMenuVisible()) UISet::begin(&tft);
+    else if (ui_winfo_isVisible())   ui_winfo_open();
+    else if (UI::isMenuVisible())    UI::drawMenu();
+    else {
+        showingXboxStatus = false;
+        if (ShowApi::holding()) tft.fillScreen(TFT_BLACK);
+        else ImageDisplay::resume();
+    }
+}
+
 void setup() {
   Serial.begin(115200);
   delay(100);
@@ -99,6 +138,7 @@ void setup() {
     } else {
         Serial.println("[Type D XL] FFat Mounted OK.");
     }
+    TitleDB::begin();
     server80.serveStatic("/resource/", FFat, "/resource/");
     server8080.serveStatic("/resource/", FFat, "/resource/");
 
@@ -119,6 +159,7 @@ void setup() {
   delay(50);
 
   tft.begin();
+  PanelClock::begin();
   apply_saved_brightness();
     
   bootShowScreen();
@@ -150,8 +191,14 @@ void setup() {
   server8080.begin();
   FileMan::begin(server8080);
   Diag::begin(server8080);
+  ExpLink::begin(server8080);
+  UDPCapture::begin(server8080);
+  ShowApi::begin(server8080);
+  CastRx::begin();
   cmd_init(&server8080, &tft);
   UI::begin(&tft);
+  Alerts::begin(server8080, &tft);
+  ImageDisplay::setFrameHook(alertFrameHook);
 
   Serial.printf("[Type D XL] Device ID: %d\n", Detect::getId());
 
@@ -161,10 +208,19 @@ void setup() {
 void loop() {
         if (Touch_interrupts) {
         Touch_interrupts = false;
+        PanelClock::activity();   // menus redraw on touch
         Touch_Read_Data();
     }
 
     WiFiMgr::loop();
+    PanelClock::loop();
+
+    // 1. Telemetry and alerts run ahead of the menus; a high-priority alert overlay preempts them
+    UDPDetect::loop();
+    Alerts::loop(ringFree());
+    Beep::update();
+    if (Alerts::show(false)) { alertShown = true; ShowApi::abort(); return; }
+    if (alertShown) { alertShown = false; restoreAfterAlert(); }
 
     // UI/Menu updates etc.
 if      (ui_about_isActive())    { ui_about_update(); return; }
@@ -174,14 +230,27 @@ else if (ui_winfo_isVisible())   { ui_winfo_update(); return; }
 else if (UI::isMenuVisible())    { UI::update(); return; }
     UI::update();
 
-    // 2. Run detection and UDP polling
+    // 2. Run detection and the other network modules
     Detect::loop();
-    UDPDetect::loop();
+    UDPCapture::loop();
+    ExpLink::loop();
+    Diag::handle();
+    ShowApi::loop();
+    CastRx::loop();
 
     // 3. Status overlay logic -- only show between images and if no UI/menu overlay is active
     bool anyUiActive = ui_about_isActive() || ui_bright_isVisible() || UISet::isMenuVisible() || UI::isMenuVisible();
 
-    if (ImageDisplay::isDone() && UDPDetect::hasPacket() && !overlayPending && !showingXboxStatus && !anyUiActive) {
+    // Lower-priority alert overlays wait for the screen like the status overlay
+    if (Alerts::show(ImageDisplay::isDone() && !overlayPending && !showingXboxStatus && !anyUiActive &&
+                     !ShowApi::holding() && !CastRx::active())) {
+        alertShown = true;
+        return;
+    }
+
+    // An image posted to /api/show keeps the screen until its hold ends, a screen cast until it stops
+    if (ImageDisplay::isDone() && UDPDetect::hasPacket() && !overlayPending && !showingXboxStatus && !anyUiActive &&
+        !ShowApi::holding() && !CastRx::active()) {
         lastXboxStatus = UDPDetect::getLatest(); // latch latest
         overlayPending = true;
         UDPDetect::acknowledge();
@@ -199,7 +268,7 @@ else if (UI::isMenuVisible())    { UI::update(); return; }
     if (showingXboxStatus && !anyUiActive) {
         if (millis() - lastStatusDisplay > 2000) {
             showingXboxStatus = false;
-            ImageDisplay::displayRandomImage();
+            ImageDisplay::resume();
         }
         return; // Block image update while overlay active
     }
@@ -0,0 +1,561 @@
+// alerts.cpp
+//
+// The rules live in a fixed table with a chain per metric. loop() compares
+// UDPDetect's latest values with the ones it last saw and walks only the
+// chains of the metrics that moved; ring, buzzer and backlight are driven
+// from the raised set afterwards, outside the timed evaluation.
+//
+// The web handlers run on the async_tcp task. A save is parsed there, so a
+// bad line goes back to the form, and handed to the main loop, which swaps
+// the table in and writes the file.
+
+#include "alerts.h"
+#include "udp_detect.h"
+#include "beep.h"
+#include "panel_clock.h"
+#include "disp_cfg.h"
+#include "Touch_CST820.h"
+#include <Arduino.h>
+#include <FFat.h>
+#include <ESPAsyncWebServer.h>
+#include <string.h>
+
+#define ALERTS_PATH     "/alerts.txt"
+#define ALERTS_MAX_TEXT 2048
+
+static_assert(ALERT_MAX_RULES <= 32, "raised rules are tracked in a 32-bit mask");
+
+namespace Alerts {
+
+enum Metric : uint8_t { M_CPU, M_AMBIENT, M_FAN, M_TRAY, kMetrics };
+enum Op : uint8_t { OP_GT, OP_GE, OP_LT, OP_LE, OP_EQ, OP_NE, kOps };
+enum : uint8_t { ACT_OVERLAY = 1, ACT_BAND = 2, ACT_BEEP = 4, ACT_PULSE = 8 };
+
+static const struct { const char* key; const char* label; const char* unit; } kMetric[kMetrics] = {
+    {"cpu", "CPU", "C"}, {"ambient", "Ambient", "C"}, {"fan", "Fan", "%"}, {"tray", "Tray", ""},
+};
+static const struct { const char* sym; const char* words; } kOp[kOps] = {
+    {">", "above"}, {">=", "at or above"}, {"<", "below"}, {"<=", "at or below"}, {"==", "is"}, {"!=", "is not"},
+};
+static const struct { const char* name; uint16_t rgb565; } kColour[] = {
+    {"red", 0xF800}, {"amber", 0xFD20}, {"yellow", 0xFFE0}, {"green", 0x07E0}, {"blue", 0x041F}, {"white", 0xFFFF},
+};
+
+struct Rule {
+    uint8_t  metric, op, prio, actions;
+    int16_t  threshold, hyst;
+    uint16_t colour;
+    char     beep[16];
+};
+
+struct Table {
+    Rule    rule[ALERT_MAX_RULES];
+    uint8_t count;
+};
+
+// Per rule; cleared when the table changes
+struct State {
+    bool     raised, silenced;
+    int      value;          // metric value when last checked
+    uint32_t raisedUs;       // nonzero until its first pixels (or beep) are out
+    uint32_t beepMs;
+};
+
+static const char* kDefaultRules =
+    "# metric op threshold [hyst N] [prio N] [overlay] [band[=colour]] [beep[=pattern]] [pulse]\n"
+    "cpu >= 75 hyst 5 prio 8 overlay band=red beep=..._..._... pulse\n"
+    "cpu >= 65 hyst 3 prio 2 band=amber\n"
+    "ambient >= 40 hyst 2 prio 1 band=yellow\n";
+
+static const uint8_t kNone = 0xFF;
+
+static LGFX*    s_tft = nullptr;
+static Table    s_table;
+static State    s_state[ALERT_MAX_RULES];
+static uint8_t  s_first[kMetrics];          // first rule on each metric, chained through s_next
+static uint8_t  s_next[ALERT_MAX_RULES];
+static int      s_seen[kMetrics];
+static bool     s_seenValid[kMetrics];
+static char     s_text[ALERTS_MAX_TEXT];    // the rules as written, comments and all
+
+static uint8_t  s_shown = kNone;            // rule whose overlay is on screen
+static bool     s_dirty = false;            // its value changed
+static uint32_t s_bandMs = 0;
+static bool     s_bandNow = false;
+static bool     s_pulsing = false;
+static uint8_t  s_baseBrightness = 255, s_lastBrightness = 0;
+
+// From the web task
+static volatile bool s_reqApply = false, s_reqAck = false;
+static Table    s_pendingTable;
+static char     s_pendingText[ALERTS_MAX_TEXT];
+
+static Stats    s_stats = {};
+static uint64_t s_evalSumUs = 0, s_latencySumUs = 0;
+static uint32_t s_latencyCount = 0;
+
+// ---------- rules ----------
+// false while the sender has no sample for it
+static bool readMetric(const XboxStatus& st, uint8_t m, int& v) {
+    switch (m) {
+        case M_CPU:     v = st.cpuTemp;     return v > -100;
+        case M_AMBIENT: v = st.ambientTemp; return v > -100;
+        case M_FAN:     v = st.fanSpeed;    return v >= 0;
+        default:        v = st.trayState;   return v >= 0;
+    }
+}
+
+static bool holds(uint8_t op, int v, int t) {
+    switch (op) {
+        case OP_GT: return v > t;
+        case OP_GE: return v >= t;
+        case OP_LT: return v < t;
+        case OP_LE: return v <= t;
+        case OP_EQ: return v == t;
+        default:    return v != t;
+    }
+}
+
+// A raised rule stays raised until the value is hyst past the threshold
+static bool check(const Rule& r, bool raised, int v) {
+    if (!raised || r.op >= OP_EQ) return holds(r.op, v, r.threshold);
+    return holds(r.op, v, r.op <= OP_GE ? r.threshold - r.hyst : r.threshold + r.hyst);
+}
+
+static bool parseInt(const char* s, int lo, int hi, int& out) {
+    if (!s) return false;
+    char* end = nullptr;
+    const long v = strtol(s, &end, 10);
+    if (end == s || *end || v < lo || v > hi) return false;
+    out = (int)v;
+    return true;
+}
+
+static bool parseColour(const char* s, uint16_t& out) {
+    for (const auto& c : kColour)
+        if (!strcasecmp(s, c.name)) { out = c.rgb565; return true; }
+    if (s[0] != '#' || strlen(s) != 7) return false;
+    char* end = nullptr;
+    const uint32_t rgb = strtoul(s + 1, &end, 16);
+    if (*end) return false;
+    out = (uint16_t)(((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F));
+    return true;
+}
+
+// One rule from a line with the comment cut off; false with err set if it is not one
+static bool parseRule(char* line, Rule& r, char* err, size_t errLen) {
+    char* save = nullptr;
+    const char* metric = strtok_r(line, " \t\r", &save);
+    const char* op = strtok_r(nullptr, " \t\r", &save);
+    const char* thr = strtok_r(nullptr, " \t\r", &save);
+
+    memset(&r, 0, sizeof(r));
+    r.metric = kMetrics;
+    for (uint8_t m = 0; m < kMetrics; ++m)
+        if (!strcasecmp(metric, kMetric[m].key)) r.metric = m;
+    if (!strcasecmp(metric, "amb")) r.metric = M_AMBIENT;
+    if (r.metric == kMetrics) { snprintf(err, errLen, "unknown metric '%s'", metric); return false; }
+
+    r.op = kOps;
+    for (uint8_t o = 0; op && o < kOps; ++o)
+        if (!strcmp(op, kOp[o].sym)) r.op = o;
+    if (r.op == kOps) { snprintf(err, errLen, "expected > >= < <= == or != after %s", metric); return false; }
+
+    int v;
+    if (!parseInt(thr, -999, 9999, v)) { snprintf(err, errLen, "bad threshold"); return false; }
+    r.threshold = (int16_t)v;
+    r.prio = 1;
+    bool colourSet = false;
+    strcpy(r.beep, "...");
+
+    for (char* w = strtok_r(nullptr, " \t\r", &save); w; w = strtok_r(nullptr, " \t\r", &save)) {
+        char* val = strchr(w, '=');
+        if (val) *val++ = 0;
+        if (!strcasecmp(w, "hyst")) {
+            if (!parseInt(strtok_r(nullptr, " \t\r", &save), 0, 999, v)) { snprintf(err, errLen, "bad hyst"); return false; }
+            r.hyst = (int16_t)v;
+        } else if (!strcasecmp(w, "prio")) {
+            if (!parseInt(strtok_r(nullptr, " \t\r", &save), 0, 9, v)) { snprintf(err, errLen, "prio is 0-9"); return false; }
+            r.prio = (uint8_t)v;
+        } else if (!strcasecmp(w, "overlay")) {
+            r.actions |= ACT_OVERLAY;
+        } else if (!strcasecmp(w, "band")) {
+            r.actions |= ACT_BAND;
+            if (val && !parseColour(val, r.colour)) { snprintf(err, errLen, "unknown colour '%s'", val); return false; }
+            colourSet = val != nullptr;
+        } else if (!strcasecmp(w, "beep")) {
+            r.actions |= ACT_BEEP;
+            if (val) {
+                if (!*val || strlen(val) >= sizeof(r.beep) || strspn(val, ".-_") != strlen(val)) {
+                    snprintf(err, errLen, "beep pattern is up to %u of . - _", (unsigned)sizeof(r.beep) - 1);
+                    return false;
+                }
+                strcpy(r.beep, val);
+            }
+        } else if (!strcasecmp(w, "pulse")) {
+            r.actions |= ACT_PULSE;
+        } else {
+            snprintf(err, errLen, "unknown word '%s'", w);
+            return false;
+        }
+    }
+    if (!r.actions) { snprintf(err, errLen, "no action (overlay, band, beep or pulse)"); return false; }
+    if (!colourSet) r.colour = r.prio >= ALERT_PREEMPT_PRIO ? 0xF800 : 0xFD20;
+    return true;
+}
+
+static bool parseRules(const char* text, Table& t, char* err, size_t errLen) {
+    t.count = 0;
+    int lineNo = 0;
+    for (const char* p = text; *p;) {
+        const char* nl = strchr(p, '\n');
+        const size_t n = nl ? (size_t)(nl - p) : strlen(p);
+        char line[128];
+        ++lineNo;
+        if (n >= sizeof(line)) { snprintf(err, errLen, "line %d: too long", lineNo); return false; }
+        memcpy(line, p, n);
+        line[n] = 0;
+        p += n + (nl ? 1 : 0);
+
+        if (char* hash = strchr(line, '#')) *hash = 0;
+        if (line[strspn(line, " \t\r")] == 0) continue;
+        if (t.count >= ALERT_MAX_RULES) { snprintf(err, errLen, "more than %d rules", ALERT_MAX_RULES); return false; }
+        char why[64];
+        if (!parseRule(line, t.rule[t.count], why, sizeof(why))) {
+            snprintf(err, errLen, "line %d: %s", lineNo, why);
+            return false;
+        }
+        t.count++;
+    }
+    return true;
+}
+
+static void install(const Table& t) {
+    s_table = t;
+    memset(s_first, kNone, sizeof(s_first));
+    for (int i = s_table.count - 1; i >= 0; --i) {
+        const uint8_t m = s_table.rule[i].metric;
+        s_next[i] = s_first[m];
+        s_first[m] = (uint8_t)i;
+    }
+    memset(s_state, 0, sizeof(s_state));
+    memset(s_seenValid, 0, sizeof(s_seenValid));   // every rule is checked against the current values
+    s_shown = kNone;
+    s_stats.rules = s_table.count;
+    s_stats.raisedNow = 0;
+    Beep::stop();
+}
+
+// ---------- outputs ----------
+// First output of a raise: pixels for a rule that draws, else the buzzer or backlight
+static void delivered(uint8_t i) {
+    State& s = s_state[i];
+    if (!s.raisedUs) return;
+    const uint32_t us = micros() - s.raisedUs;
+    s.raisedUs = 0;
+    s_latencySumUs += us;
+    s_latencyCount++;
+    s_stats.latencyLastUs = us;
+    if (us > s_stats.latencyMaxUs) s_stats.latencyMaxUs = us;
+    s_stats.latencyAvgUs = (uint32_t)(s_latencySumUs / s_latencyCount);
+}
+
+static void drawRing(uint16_t colour) {
+    const int cx = s_tft->width() / 2, cy = s_tft->height() / 2;
+    const int r = (s_tft->width() < s_tft->height() ? s_tft->width() : s_tft->height()) / 2;
+    s_tft->fillArc(cx, cy, r - 1, r - ALERT_BAND_PX, 0, 360, colour);
+}
+
+static void drawOverlay(uint8_t i) {
+    const Rule& r = s_table.rule[i];
+    const char* unit = kMetric[r.metric].unit;
+    const int cx = s_tft->width() / 2, cy = s_tft->height() / 2;
+    char buf[40];
+
+    PanelClock::activity();
+    s_tft->setRotation(0);
+    s_tft->fillScreen(TFT_BLACK);
+    drawRing(r.colour);
+    s_tft->setTextDatum(middle_center);
+    s_tft->setTextFont(1);
+
+    s_tft->setTextColor(r.colour, TFT_BLACK);
+    s_tft->setTextSize(4);
+    s_tft->drawString(kMetric[r.metric].label, cx, cy - 110);
+    snprintf(buf, sizeof(buf), "%d%s", s_state[i].value, unit);
+    s_tft->setTextSize(10);
+    s_tft->drawString(buf, cx, cy - 20);
+
+    snprintf(buf, sizeof(buf), "%s %d%s", kOp[r.op].words, r.threshold, unit);
+    s_tft->setTextColor(TFT_WHITE, TFT_BLACK);
+    s_tft->setTextSize(3);
+    s_tft->drawString(buf, cx, cy + 70);
+    s_tft->setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    s_tft->setTextSize(2);
+    s_tft->drawString("Tap to silence", cx, cy + 140);
+}
+
+// Backlight dips to a quarter and back once a period; restored when no rule pulses
+static void pulse(bool on) {
+    if (!on) {
+        if (s_pulsing) s_tft->setBrightness(s_baseBrightness);
+        s_pulsing = false;
+        return;
+    }
+    if (!s_pulsing) {
+        s_baseBrightness = s_lastBrightness = s_tft->getBrightness();
+        s_pulsing = true;
+    }
+    const uint32_t ph = millis() % ALERT_PULSE_MS;
+    const uint32_t tri = ph < ALERT_PULSE_MS / 2 ? ph : ALERT_PULSE_MS - ph;
+    const uint8_t b = (uint8_t)(s_baseBrightness - (uint32_t)s_baseBrightness * 3 * tri / (2 * ALERT_PULSE_MS));
+    if (b != s_lastBrightness) {
+        s_tft->setBrightness(b);
+        s_lastBrightness = b;
+    }
+}
+
+// Highest-priority raised overlay that is not silenced; kNone if none
+static uint8_t topOverlay() {
+    uint8_t best = kNone;
+    for (uint8_t i = 0; i < s_table.count; ++i) {
+        if (!s_state[i].raised || s_state[i].silenced || !(s_table.rule[i].actions & ACT_OVERLAY)) continue;
+        if (best == kNone || s_table.rule[i].prio > s_table.rule[best].prio) best = i;
+    }
+    return best;
+}
+
+static void silence() {
+    for (uint8_t i = 0; i < s_table.count; ++i)
+        if (s_state[i].raised) s_state[i].silenced = true;
+    Beep::stop();
+    Serial.println("[Alerts] Silenced");
+}
+
+static void saveText() {
+    File f = FFat.open(ALERTS_PATH, "w");
+    if (!f) { Serial.println("[Alerts] Cannot write " ALERTS_PATH); return; }
+    f.print(s_text);
+    f.close();
+}
+
+// ---------- public ----------
+void loop(bool ringFree) {
+    if (s_reqApply) {
+        install(s_pendingTable);
+        memcpy(s_text, s_pendingText, sizeof(s_text));
+        s_reqApply = false;
+        saveText();
+        Serial.printf("[Alerts] %u rules applied\n", s_table.count);
+    }
+    if (s_reqAck) {
+        s_reqAck = false;
+        silence();
+    }
+
+    // Evaluate the rules on the metrics that changed. A raise is timed from
+    // the datagram that brought it, not from this pass.
+    const XboxStatus& st = UDPDetect::getLatest();
+    const uint32_t rxUs = UDPDetect::receivedUs();
+    uint32_t t0 = 0, changed = 0;
+    bool any = false;
+    for (uint8_t m = 0; m < kMetrics; ++m) {
+        int v;
+        if (!readMetric(st, m, v) || (s_seenValid[m] && v == s_seen[m])) continue;
+        if (!any) { any = true; t0 = micros(); }
+        s_seen[m] = v;
+        s_seenValid[m] = true;
+        for (uint8_t i = s_first[m]; i != kNone; i = s_next[i]) {
+            State& s = s_state[i];
+            s.value = v;
+            s_stats.evaluations++;
+            const bool raised = check(s_table.rule[i], s.raised, v);
+            if (raised == s.raised) {
+                if (raised && i == s_shown) s_dirty = true;
+                continue;
+            }
+            s.raised = raised;
+            s.silenced = false;
+            s.raisedUs = raised ? (rxUs ? rxUs : (t0 ? t0 : 1)) : 0;
+            s.beepMs = millis() - ALERT_BEEP_EVERY_MS;
+            changed |= 1u << i;
+        }
+    }
+    if (any) {
+        const uint32_t us = micros() - t0;
+        s_stats.updates++;
+        s_evalSumUs += us;
+        if (us > s_stats.evalMaxUs) s_stats.evalMaxUs = us;
+        s_stats.evalAvgUs = (uint32_t)(s_evalSumUs / s_stats.updates);
+    }
+
+    for (uint8_t i = 0; changed; ++i, changed >>= 1) {
+        if (!(changed & 1)) continue;
+        const Rule& r = s_table.rule[i];
+        const bool raised = s_state[i].raised;
+        if (raised) { s_stats.raised++; s_stats.raisedNow++; }
+        else        { s_stats.cleared++; s_stats.raisedNow--; }
+        if (r.actions & ACT_BAND) s_bandNow = true;
+        Serial.printf("[Alerts] %s %d%s %s %s %d: %s (prio %u)\n", kMetric[r.metric].label, s_state[i].value,
+                      kMetric[r.metric].unit, raised ? "is" : "no longer", kOp[r.op].sym, r.threshold,
+                      raised ? "raised" : "cleared", r.prio);
+    }
+
+    if (!s_stats.raisedNow && !s_pulsing) return;
+
+    // Drive the outputs of the raised rules; ring and buzzer follow the highest priority
+    uint8_t band = kNone, beep = kNone;
+    bool anyPulse = false;
+    for (uint8_t i = 0; i < s_table.count; ++i) {
+        const State& s = s_state[i];
+        const Rule& r = s_table.rule[i];
+        if (!s.raised) continue;
+        if ((r.actions & ACT_BAND) && (band == kNone || r.prio > s_table.rule[band].prio)) band = i;
+        if (s.silenced) continue;
+        if ((r.actions & ACT_BEEP) && (beep == kNone || r.prio > s_table.rule[beep].prio)) beep = i;
+        if (r.actions & ACT_PULSE) {
+            anyPulse = true;
+            if (!(r.actions & (ACT_OVERLAY | ACT_BAND))) delivered(i);   // nothing to draw
+        }
+    }
+    pulse(anyPulse);
+
+    if (beep != kNone && millis() - s_state[beep].beepMs >= ALERT_BEEP_EVERY_MS && !Beep::busy()) {
+        Beep::play(s_table.rule[beep].beep);
+        s_state[beep].beepMs = millis();
+        if (!(s_table.rule[beep].actions & (ACT_OVERLAY | ACT_BAND))) delivered(beep);
+    }
+
+    // The ring goes over the slideshow, a held image or a cast; not over a
+    // menu or the status overlay, nor when an alert overlay has the screen
+    if (band != kNone && ringFree && s_shown == kNone && !preempting() &&
+        (s_bandNow || millis() - s_bandMs >= ALERT_BAND_MS)) {
+        drawRing(s_table.rule[band].colour);
+        s_bandMs = millis();
+        s_bandNow = false;
+        for (uint8_t i = 0; i < s_table.count; ++i)
+            if (s_state[i].raised && (s_table.rule[i].actions & ACT_BAND)) delivered(i);
+    }
+}
+
+bool preempting() {
+    const uint8_t top = topOverlay();
+    return top != kNone && (s_shown != kNone || s_table.rule[top].prio >= ALERT_PREEMPT_PRIO);
+}
+
+bool show(bool screenFree) {
+    if (s_shown != kNone && (touch_data.gesture == SINGLE_CLICK || touch_data.gesture == LONG_PRESS)) {
+        touch_data.gesture = NONE;
+        silence();
+    }
+    const uint8_t top = topOverlay();
+    if (top == kNone) {
+        s_shown = kNone;
+        return false;
+    }
+    const bool preempt = s_table.rule[top].prio >= ALERT_PREEMPT_PRIO;
+    if (s_shown == kNone && !screenFree && !preempt) return false;
+    if (s_shown != top || s_dirty) {
+        if (s_shown == kNone && !screenFree) s_stats.preempts++;
+        s_shown = top;
+        s_dirty = false;
+        drawOverlay(top);
+        delivered(top);
+    }
+    return true;
+}
+
+// As of the last loop(); the web handlers call this from their own task
+Stats stats() { return s_stats; }
+
+// ---------- HTTP ----------
+static String escapeHtml(const char* s) {
+    String out;
+    for (; *s; ++s) {
+        if (*s == '<') out += "&lt;";
+        else if (*s == '&') out += "&amp;";
+        else out += *s;
+    }
+    return out;
+}
+
+static void handlePage(AsyncWebServerRequest* request) {
+    if (request->hasParam("ack")) {
+        s_reqAck = true;
+        request->redirect("/alerts");
+        return;
+    }
+
+    String html = R"(<!DOCTYPE html><html><head><title>Alerts</title>
+<meta name='viewport' content='width=device-width,initial-scale=1'>
+<style>body{background:#111;color:#eee;font-family:sans-serif;margin:20px}
+.section{background:#222;padding:14px;border-radius:8px;margin-bottom:14px}
+textarea{width:100%;max-width:720px;background:#111;color:#eee;font-family:monospace}
+.qbtn{background:#299a2c;color:#fff;border:0;padding:6px 12px;border-radius:5px;text-decoration:none}</style></head><body>
+<h2>Alerts</h2><div class='section'>)";
+    char line[160];
+    bool any = false;
+    for (uint8_t i = 0; i < s_table.count; ++i) {
+        const Rule& r = s_table.rule[i];
+        if (!s_state[i].raised) continue;
+        snprintf(line, sizeof(line), "<b>%s %d%s</b> %s %d%s, prio %u%s<br>", kMetric[r.metric].label,
+                 s_state[i].value, kMetric[r.metric].unit, kOp[r.op].words, r.threshold, kMetric[r.metric].unit,
+                 r.prio, s_state[i].silenced ? " (silenced)" : "");
+        html += line;
+        any = true;
+    }
+    html += any ? "<br><a class='qbtn' href='/alerts?ack=1'>Silence</a>" : "Nothing raised";
+    html += "</div><div class='section'><form method='POST' action='/alerts'><textarea name='rules' rows='12'>";
+    html += escapeHtml(s_text);
+    html += R"(</textarea><br><button class='qbtn' type='submit'>Save</button></form>
+<p style='color:#aaa'>One rule per line: <code>metric op threshold [hyst N] [prio N] [overlay] [band[=colour]] [beep[=pattern]] [pulse]</code><br>
+metric: cpu, ambient, fan, tray &middot; op: &gt; &gt;= &lt; &lt;= == != &middot; colour: red, amber, yellow, green, blue, white or #RRGGBB
+&middot; pattern: . short, - long, _ pause<br>)";
+    snprintf(line, sizeof(line), "An overlay with prio %d or more takes the screen at once. Up to %d rules.</p></div>",
+             ALERT_PREEMPT_PRIO, ALERT_MAX_RULES);
+    html += line;
+    html += "<a href='/diag' style='color:#8cf'>Back to Diagnostics</a></body></html>";
+    request->send(200, "text/html", html);
+}
+
+static void handleSave(AsyncWebServerRequest* request) {
+    if (!request->hasParam("rules", true)) { request->send(400, "text/plain", "Missing rules"); return; }
+    if (s_reqApply) { request->send(409, "text/plain", "Still applying the last change"); return; }
+    const String& text = request->getParam("rules", true)->value();
+    if (text.length() >= ALERTS_MAX_TEXT) { request->send(413, "text/plain", "Rules too long"); return; }
+    char err[96];
+    if (!parseRules(text.c_str(), s_pendingTable, err, sizeof(err))) { request->send(400, "text/plain", err); return; }
+    memcpy(s_pendingText, text.c_str(), text.length() + 1);
+    s_reqApply = true;
+    request->redirect("/alerts");
+}
+
+void begin(AsyncWebServer& server, LGFX* tft) {
+    s_tft = tft;
+    size_t n = 0;
+    if (FFat.exists(ALERTS_PATH)) {
+        File f = FFat.open(ALERTS_PATH, "r");
+        if (f) {
+            n = f.read((uint8_t*)s_text, sizeof(s_text) - 1);
+            f.close();
+        }
+    }
+    s_text[n] = 0;
+
+    Table t;
+    char err[96];
+    if (!n) {
+        strcpy(s_text, kDefaultRules);
+    } else if (!parseRules(s_text, t, err, sizeof(err))) {
+        Serial.printf("[Alerts] " ALERTS_PATH " %s, using the defaults\n", err);
+        strcpy(s_text, kDefaultRules);
+    }
+    parseRules(s_text, t, err, sizeof(err));
+    install(t);
+    Serial.printf("[Alerts] %u rules\n", s_table.count);
+
+    server.on("/alerts", HTTP_GET, handlePage);
+    server.on("/alerts", HTTP_POST, handleSave);
+}
+
+} // namespace Alerts
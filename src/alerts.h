@@ -0,0 +1,67 @@
+// alerts.h
+#pragma once
+#include <stdint.h>
+
+class AsyncWebServer;
+class LGFX;
+
+// Threshold alerts on the Xbox telemetry. A rules table (/alerts.txt on
+// FFat, edited at /alerts) is checked as UDPDetect's values change: only
+// the rules on a metric that changed are looked at, so a telemetry update
+// costs at most ALERT_MAX_RULES compares and nothing at all in between.
+//
+// One rule per line:
+//   <metric> <op> <threshold> [hyst N] [prio N] [overlay] [band[=colour]] [beep[=pattern]] [pulse]
+// metric: cpu, ambient, fan, tray; op: > >= < <= == !=. A rule raises when
+// the comparison holds and clears when it no longer holds N past the
+// threshold (hyst). Actions: a full-screen overlay, a coloured ring round
+// the panel edge, a buzzer pattern ('.' short, '-' long, '_' pause) and a
+// backlight pulse. A tap on the overlay, or /alerts?ack=1, silences what is
+// raised until it clears.
+//
+// An overlay with prio >= ALERT_PREEMPT_PRIO takes the screen from whatever
+// is on it (menus, a GIF between two frames, a /api/show hold, a cast)
+// within a loop pass; lower ones wait for the screen the way the status
+// overlay does. Raise-to-pixels latency and evaluation cost are on /diag.
+#ifndef ALERT_MAX_RULES
+#define ALERT_MAX_RULES 16
+#endif
+#ifndef ALERT_PREEMPT_PRIO
+#define ALERT_PREEMPT_PRIO 5
+#endif
+#ifndef ALERT_BAND_PX
+#define ALERT_BAND_PX 12               // ring width at the panel edge
+#endif
+#ifndef ALERT_BAND_MS
+#define ALERT_BAND_MS 250              // ring redrawn this often over the slideshow
+#endif
+#ifndef ALERT_BEEP_EVERY_MS
+#define ALERT_BEEP_EVERY_MS 5000       // pattern repeats until silenced
+#endif
+#ifndef ALERT_PULSE_MS
+#define ALERT_PULSE_MS 1200            // backlight pulse period
+#endif
+
+namespace Alerts {
+
+// Since boot
+struct Stats {
+    uint8_t  rules;
+    uint8_t  raisedNow;             // rules currently raised
+    uint32_t updates;               // telemetry changes looked at
+    uint32_t evaluations;           // rule checks they cost
+    uint32_t raised, cleared;
+    uint32_t preempts;              // overlays that took the screen from something else
+    uint32_t evalAvgUs, evalMaxUs;  // per telemetry change
+    uint32_t latencyAvgUs, latencyMaxUs, latencyLastUs;   // datagram in to pixels (or buzzer) out
+};
+
+void begin(AsyncWebServer& server, LGFX* tft);   // loads the rules; GET/POST /alerts
+// After UDPDetect::loop(): evaluates, drives ring, buzzer and pulse. The ring
+// is drawn only when ringFree, i.e. no menu or status overlay is on screen.
+void loop(bool ringFree);
+bool preempting();          // a high-priority overlay wants the screen now
+bool show(bool screenFree); // draws the overlay; true while it owns the screen
+Stats stats();
+
+}
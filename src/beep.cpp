@@ -1,8 +1,21 @@
 #include "beep.h"
 #include "TCA9554PWR.h"
+#include <string.h>
 
 static int _buzzerPin = -1;
 
+static const int DOT = 120;
+static const int DASH = 360;
+static const int PAUSE = 120;
+static const int LTR_PAUSE = 400;
+static const int WORD_PAUSE = 1000;
+
+// Pattern being played by update()
+static char     s_pattern[24];
+static uint8_t  s_pos = 0;
+static bool     s_on = false;
+static uint32_t s_nextMs = 0;
+
 // Helper: ensure buzzer off
 static void exio8_noTone() {
     Set_EXIO(8, 0);
@@ -25,12 +38,6 @@ void begin(int pin) {
 void playMorseXBOX() {
     if (_buzzerPin < 0) return;
 
-    const int DOT = 120;
-    const int DASH = 360;
-    const int PAUSE = 120;
-    const int LTR_PAUSE = 400;
-    const int WORD_PAUSE = 1000;
-
     // X: –··–
     exio8_beep(DASH);   delay(PAUSE);
     exio8_beep(DOT);    delay(PAUSE);
@@ -57,7 +64,42 @@ void playMorseXBOX() {
     exio8_noTone();
 }
 
-// Placeholder for interface; does nothing for Morse
-void update() {}
+void play(const char* pattern) {
+    if (_buzzerPin < 0 || !pattern) return;
+    strncpy(s_pattern, pattern, sizeof(s_pattern) - 1);
+    s_pattern[sizeof(s_pattern) - 1] = 0;
+    s_pos = 0;
+    if (s_on) exio8_noTone();
+    s_on = false;
+    s_nextMs = millis();
+}
+
+void stop() {
+    s_pattern[0] = 0;
+    s_pos = 0;
+    if (s_on) exio8_noTone();
+    s_on = false;
+}
+
+bool busy() { return s_on || s_pattern[s_pos]; }
+
+// Steps the pattern; playMorseXBOX() still blocks
+void update() {
+    if (!busy() || (int32_t)(millis() - s_nextMs) < 0) return;
+    if (s_on) {
+        exio8_noTone();
+        s_on = false;
+        s_nextMs = millis() + PAUSE;
+        return;
+    }
+    const char c = s_pattern[s_pos++];
+    if (c == '.' || c == '-') {
+        Set_EXIO(8, 1);
+        s_on = true;
+        s_nextMs = millis() + (c == '.' ? DOT : DASH);
+    } else {
+        s_nextMs = millis() + LTR_PAUSE;
+    }
+}
 
 } // end namespace Beep
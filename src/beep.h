@@ -1,3 +1,4 @@
+
 #pragma once
 
 #include <Arduino.h>
@@ -5,5 +6,11 @@
 namespace Beep {
     void begin(int pin);
     void playMorseXBOX();
+
+    // Pattern of '.' (short), '-' (long) and '_' (pause), played by update()
+    // without blocking; a new one replaces what is playing
+    void play(const char* pattern);
+    void stop();
+    bool busy();
     void update();
 }
@@ -0,0 +1,316 @@
+// cast_rx.cpp
+//
+// Slots move Free -> Filling -> Ready -> Showing -> Free. The receive task
+// owns a Filling slot's bytes and the main loop a Showing one's, so payloads
+// are copied without the lock; only slot states and counters are under it.
+// Times are micros(), compared wrap-safe.
+
+#include "cast_rx.h"
+#include "imagedisplay.h"
+#include "td_wire.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+#define CAST_MAX_FRAGS ((CAST_MAX_FRAME + td_wire::kCastPayload - 1) / td_wire::kCastPayload)
+#define CAST_DELTA_WINDOW_MS 10000   // how long the quickest frame's delay is trusted
+
+namespace CastRx {
+
+enum class Slot : uint8_t { Free, Filling, Ready, Showing };
+
+struct Frame {
+    uint8_t* data;
+    Slot     state;
+    uint32_t frame, size, captureUs;
+    uint16_t count, got;
+    uint32_t firstRxUs, readyUs, playUs;
+    uint8_t  have[(CAST_MAX_FRAGS + 7) / 8];
+};
+
+static Frame       s_slots[CAST_SLOTS];
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static Stats       s_stats = {};
+static uint32_t    s_lastShown = 0;
+static bool        s_anyShown = false;
+static uint32_t    s_e2eUs = 0;
+
+// Jitter buffer clock: the smallest (arrival - capture) seen, in two
+// windows so a drifting sender clock doesn't leave a stale minimum behind
+static bool     s_haveDelta = false;
+static uint32_t s_minDelta = 0, s_nextMinDelta = 0, s_windowFromMs = 0;
+
+static sockaddr_in s_sender = {};
+static bool        s_haveSender = false;
+static int         s_ackSock = -1;
+
+// Main-loop side
+static uint32_t s_lastShowMs = 0, s_fpsFromUs = 0, s_fpsFrames = 0;
+static uint64_t s_latencyTotal = 0, s_waitTotal = 0, s_decodeTotal = 0;
+
+static bool newer(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+
+static void freeSlot(Frame& f) {
+    f.state = Slot::Free;
+    f.got = 0;
+}
+
+static void trackDelta(uint32_t delta) {
+    const uint32_t now = millis();
+    if (!s_haveDelta) {
+        s_minDelta = s_nextMinDelta = delta;
+        s_windowFromMs = now;
+        s_haveDelta = true;
+        return;
+    }
+    if ((int32_t)(delta - s_minDelta) < 0) s_minDelta = delta;
+    if ((int32_t)(delta - s_nextMinDelta) < 0) s_nextMinDelta = delta;
+    if (now - s_windowFromMs >= CAST_DELTA_WINDOW_MS) {
+        s_minDelta = s_nextMinDelta;
+        s_nextMinDelta = delta;
+        s_windowFromMs = now;
+    }
+}
+
+// Slot for a frame's fragment: the one already filling it, a free one, or
+// one taken from the oldest frame. nullptr if the frame is older than all.
+static Frame* slotFor(uint32_t frame) {
+    Frame* freeSlot = nullptr;
+    Frame* oldFilling = nullptr;
+    Frame* oldReady = nullptr;
+    for (Frame& f : s_slots) {
+        if (f.state == Slot::Filling && f.frame == frame) return &f;
+        if (f.state == Slot::Free && !freeSlot) freeSlot = &f;
+        if (f.state == Slot::Filling && (!oldFilling || newer(oldFilling->frame, f.frame))) oldFilling = &f;
+        if (f.state == Slot::Ready && (!oldReady || newer(oldReady->frame, f.frame))) oldReady = &f;
+    }
+    if (freeSlot) return freeSlot;
+    Frame* victim = oldFilling ? oldFilling : oldReady;
+    if (!victim || !newer(frame, victim->frame)) return nullptr;
+    if (victim->state == Slot::Filling) s_stats.droppedIncomplete++;
+    else s_stats.droppedFull++;
+    return victim;
+}
+
+static void expireFilling(uint32_t now) {
+    for (Frame& f : s_slots) {
+        if (f.state == Slot::Filling && now - f.firstRxUs > CAST_FRAGMENT_TIMEOUT_MS * 1000u) {
+            freeSlot(f);
+            s_stats.droppedIncomplete++;
+        }
+    }
+}
+
+static void onFragment(const uint8_t* buf, size_t n, const sockaddr_in& from) {
+    const uint32_t now = micros();
+    td_wire::CastFragment h;
+    if (n < sizeof(h)) return;
+    memcpy(&h, buf, sizeof(h));
+    if (memcmp(h.magic, "TDV1", 4) != 0) return;
+    const size_t payload = n - sizeof(h);
+    const size_t off = (size_t)h.index * td_wire::kCastPayload;
+    if (h.size == 0 || h.size > CAST_MAX_FRAME ||
+        h.count != (h.size + td_wire::kCastPayload - 1) / td_wire::kCastPayload || h.index >= h.count ||
+        payload != min(td_wire::kCastPayload, (size_t)h.size - off)) {
+        portENTER_CRITICAL(&s_mux);
+        s_stats.badFragments++;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    s_sender = from;
+    s_haveSender = true;
+    if (h.e2eUs) s_e2eUs = h.e2eUs;
+    Frame* f = (s_anyShown && !newer(h.frame, s_lastShown)) ? nullptr : slotFor(h.frame);
+    if (f && (f->state != Slot::Filling || f->frame != h.frame)) {   // free, or taken from an older frame
+        f->state = Slot::Filling;
+        f->frame = h.frame;
+        f->size = h.size;
+        f->count = h.count;
+        f->captureUs = h.captureUs;
+        f->got = 0;
+        f->firstRxUs = now;
+        memset(f->have, 0, sizeof(f->have));
+    }
+    const bool dup = f && (f->have[h.index >> 3] & (1 << (h.index & 7)));
+    portEXIT_CRITICAL(&s_mux);
+    if (!f || dup) return;
+
+    memcpy(f->data + off, buf + sizeof(h), payload);
+    f->have[h.index >> 3] |= 1 << (h.index & 7);
+    if (++f->got < f->count) return;
+
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t delta = now - f->captureUs;
+    trackDelta(delta);
+    f->readyUs = now;
+    f->playUs = f->captureUs + s_minDelta + CAST_JITTER_MS * 1000u;
+    if (newer(f->playUs, now + CAST_JITTER_MS * 1000u)) f->playUs = now + CAST_JITTER_MS * 1000u;   // sender clock jumped
+    f->state = Slot::Ready;
+    s_stats.frames++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+static int openSocket() {
+    const int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) return -1;
+    sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(td_wire::kPortCast);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    timeval tv = { 0, 50 * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void rxTask(void*) {
+    static uint8_t buf[sizeof(td_wire::CastFragment) + td_wire::kCastPayload];
+    int fd = -1;
+    for (;;) {
+        if (fd < 0 && (fd = openSocket()) < 0) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        sockaddr_in from = {};
+        socklen_t fl = sizeof(from);
+        const int n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &fl);
+        if (n > 0) onFragment(buf, (size_t)n, from);
+        portENTER_CRITICAL(&s_mux);
+        expireFilling(micros());
+        portEXIT_CRITICAL(&s_mux);
+    }
+}
+
+void begin() {
+    for (Frame& f : s_slots) {
+        f.data = (uint8_t*)heap_caps_malloc(CAST_MAX_FRAME, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!f.data) {
+            Serial.println("[CastRx] No PSRAM for frame slots; screen cast off");
+            return;
+        }
+        freeSlot(f);
+    }
+    if (xTaskCreatePinnedToCore(rxTask, "cast_rx", 4096, nullptr, 2, nullptr, 0) != pdPASS) {
+        Serial.println("[CastRx] Task start failed");
+        return;
+    }
+    Serial.printf("[CastRx] Listening on UDP %u, %u slots of %u KB, %u ms jitter buffer\n",
+                  td_wire::kPortCast, CAST_SLOTS, CAST_MAX_FRAME / 1024, CAST_JITTER_MS);
+}
+
+static void sendAck(const Frame& f, uint32_t displayUs) {
+    if (s_ackSock < 0) s_ackSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_ackSock < 0) return;
+    portENTER_CRITICAL(&s_mux);
+    const sockaddr_in to = s_sender;
+    const bool have = s_haveSender;
+    portEXIT_CRITICAL(&s_mux);
+    if (!have) return;
+    td_wire::CastAck a;
+    memcpy(a.magic, "TDVA", 4);
+    a.frame = f.frame;
+    a.captureUs = f.captureUs;
+    a.displayUs = displayUs;
+    sendto(s_ackSock, &a, sizeof(a), 0, (const sockaddr*)&to, sizeof(to));
+}
+
+static void start() {
+    portENTER_CRITICAL(&s_mux);
+    s_stats = Stats{};
+    s_stats.frames = 1;   // the one that started it
+    s_stats.active = true;
+    s_e2eUs = 0;
+    portEXIT_CRITICAL(&s_mux);
+    s_latencyTotal = s_waitTotal = s_decodeTotal = 0;
+    s_fpsFromUs = micros();
+    s_fpsFrames = 0;
+    ImageDisplay::setPaused(true);
+    Serial.println("[CastRx] Cast started");
+}
+
+static void stop() {
+    portENTER_CRITICAL(&s_mux);
+    s_stats.active = false;
+    s_stats.fps = 0;
+    s_anyShown = false;   // a new sender starts its frame numbers and clock afresh
+    s_haveDelta = false;
+    const Stats s = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    Serial.printf("[CastRx] Cast ended: %u shown of %u, dropped %u incomplete, %u late, %u full\n",
+                  s.shown, s.frames, s.droppedIncomplete, s.droppedLate, s.droppedFull);
+    ImageDisplay::setPaused(false);
+    ImageDisplay::resume();
+}
+
+void loop() {
+    const uint32_t now = micros();
+
+    // The newest frame that is due; any older ready ones are dropped
+    Frame* show = nullptr;
+    portENTER_CRITICAL(&s_mux);
+    for (Frame& f : s_slots) {
+        if (f.state != Slot::Ready || newer(f.playUs, now)) continue;
+        if (!show || newer(f.frame, show->frame)) {
+            if (show) { freeSlot(*show); s_stats.droppedLate++; }
+            show = &f;
+        } else {
+            freeSlot(f);
+            s_stats.droppedLate++;
+        }
+    }
+    if (show) show->state = Slot::Showing;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (!show) {
+        if (s_stats.active && millis() - s_lastShowMs > CAST_IDLE_MS) stop();
+        return;
+    }
+    if (!s_stats.active) start();
+
+    ImageDisplay::drawCastFrame(show->data, show->size);
+    const uint32_t done = micros();
+    const uint32_t latency = done - show->firstRxUs;
+    s_latencyTotal += latency;
+    s_waitTotal += now - show->readyUs;
+    s_decodeTotal += done - now;
+    s_lastShowMs = millis();
+    s_fpsFrames++;
+    sendAck(*show, latency);
+
+    portENTER_CRITICAL(&s_mux);
+    s_lastShown = show->frame;
+    s_anyShown = true;
+    s_stats.shown++;
+    s_stats.lastBytes = show->size;
+    if (latency > s_stats.latencyMaxUs) s_stats.latencyMaxUs = latency;
+    s_stats.latencyAvgUs = s_latencyTotal / s_stats.shown;
+    s_stats.waitAvgUs = s_waitTotal / s_stats.shown;
+    s_stats.decodeAvgUs = s_decodeTotal / s_stats.shown;
+    if (done - s_fpsFromUs >= 1000000u) {
+        s_stats.fps = s_fpsFrames * 1e6f / (done - s_fpsFromUs);
+        s_fpsFromUs = done;
+        s_fpsFrames = 0;
+    }
+    freeSlot(*show);
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool active() { return s_stats.active; }
+
+Stats stats() {
+    portENTER_CRITICAL(&s_mux);
+    Stats s = s_stats;
+    s.e2eUs = s_e2eUs;
+    portEXIT_CRITICAL(&s_mux);
+    return s;
+}
+
+}
@@ -0,0 +1,61 @@
+// cast_rx.h
+#pragma once
+#include <stdint.h>
+
+// Screen cast: shows a stream of JPEG frames sent over UDP (format in
+// td_wire.h, sender in host/cast/tdcast) at whatever rate they come, 10-20
+// fps for a 480x480 dashboard. A task on core 0, next to WiFi, reassembles
+// fragments into a few PSRAM frame slots. The main loop on core 1 decodes
+// and draws, so the next frame arrives while this one decodes.
+//
+// Jitter buffer: a frame is shown CAST_JITTER_MS after the time the
+// quickest recent frame would have been, going by the sender's capture
+// clock. That absorbs WiFi delay spikes at the cost of that much latency.
+// Drop policy, newest wins: when several frames are due only the latest is
+// drawn, a frame with fragments missing after CAST_FRAGMENT_TIMEOUT_MS is
+// dropped, and with every slot taken the oldest unfinished (then oldest
+// finished) frame makes room.
+//
+// The slideshow pauses while frames arrive and resumes CAST_IDLE_MS after
+// the last one. Counters and latency are on /diag.
+#ifndef CAST_SLOTS
+#define CAST_SLOTS 3
+#endif
+#ifndef CAST_MAX_FRAME
+#define CAST_MAX_FRAME (96 * 1024)      // bytes of JPEG, per slot
+#endif
+#ifndef CAST_JITTER_MS
+#define CAST_JITTER_MS 40
+#endif
+#ifndef CAST_FRAGMENT_TIMEOUT_MS
+#define CAST_FRAGMENT_TIMEOUT_MS 200
+#endif
+#ifndef CAST_IDLE_MS
+#define CAST_IDLE_MS 2000
+#endif
+
+namespace CastRx {
+
+// Since the current (or last) cast started
+struct Stats {
+    bool     active;
+    uint32_t frames;            // complete frames received
+    uint32_t shown;
+    uint32_t droppedIncomplete; // fragments missing
+    uint32_t droppedLate;       // a newer frame was due as well
+    uint32_t droppedFull;       // no free slot
+    uint32_t badFragments;      // malformed or too big for a slot
+    float    fps;               // shown, over the last second
+    uint32_t latencyAvgUs, latencyMaxUs;   // first fragment in to pixels out
+    uint32_t waitAvgUs;         // complete frame held in the jitter buffer
+    uint32_t decodeAvgUs;       // decode and draw
+    uint32_t e2eUs;             // capture to on screen, as the sender measured it
+    uint32_t lastBytes;
+};
+
+void begin();          // starts the receive task; WiFi may come up later
+void loop();           // draws due frames; main loop
+bool active();
+Stats stats();
+
+}
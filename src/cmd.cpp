@@ -16,6 +16,7 @@ enum {
     CMD_DISPLAY_MODE    = 0x04,
     CMD_DISPLAY_IMAGE   = 0x05,
     CMD_DISPLAY_CLEAR   = 0x06,
+    CMD_PNG_BACKDROP    = 0x07,
 
     CMD_BRIGHTNESS_SET  = 0x20,
 
@@ -120,6 +121,7 @@ static void execute_cmd(uint8_t code, AsyncWebServerRequest* request, Stream* se
         case CMD_DISPLAY_MODE:
             if (param_mode == "jpg" || val == 0) ImageDisplay::setMode(ImageDisplay::MODE_JPG);
             else if (param_mode == "gif" || val == 1) ImageDisplay::setMode(ImageDisplay::MODE_GIF);
+            else if (param_mode == "kb" || val == 3) ImageDisplay::setMode(ImageDisplay::MODE_KENBURNS);
             else ImageDisplay::setMode(ImageDisplay::MODE_RANDOM);
             break;
         case CMD_DISPLAY_IMAGE:
@@ -128,6 +130,11 @@ static void execute_cmd(uint8_t code, AsyncWebServerRequest* request, Stream* se
         case CMD_DISPLAY_CLEAR:
             ImageDisplay::clear();
             break;
+        case CMD_PNG_BACKDROP:
+            // mode=prev composites over the current image; val is an RGB565 colour
+            if (param_mode == "prev") ImageDisplay::setPngBackdrop(ImageDisplay::PNG_OVER_PREVIOUS);
+            else if (val >= 0 && val <= 0xFFFF) ImageDisplay::setPngBackdrop(val);
+            break;
         case CMD_BRIGHTNESS_SET:
              if (val >= 5 && val <= 100) {
                 // Set brightness in hardware and preferences just like ui_bright
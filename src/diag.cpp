@@ -3,7 +3,15 @@
 #include <WiFi.h>
 #include <esp_system.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "alerts.h"
+#include "cast_rx.h"
 #include "disp_cfg.h"
+#include "imagedisplay.h"
+#include "jpeg_kernels.h"
+#include "panel_bounce.h"
+#include "panel_clock.h"
+#include "td_wire.h"
 #include <Update.h>
 #include <ESPAsyncWebServer.h>
 
@@ -67,6 +75,189 @@ static void handleUpdateUpload(AsyncWebServerRequest *request, String filename,
     }
 }
 
+// --- Scan-out path ---
+static uint32_t panelHtotal() { return 480 + PANEL_TIMING.hfp + PANEL_TIMING.hpw + PANEL_TIMING.hbp; }
+static uint32_t panelVtotal() { return 480 + PANEL_TIMING.vfp + PANEL_TIMING.vpw + PANEL_TIMING.vbp; }
+static float panelFps() { return (float)PANEL_TIMING.pclk_hz / (panelHtotal() * panelVtotal()); }
+// Bytes per second the panel pulls out of the frame buffer
+static float scanoutMBps() { return panelFps() * 480 * 480 * 2 / 1e6f; }
+
+static String panelMode() {
+    char line[96];
+    if (TD_RGB_BOUNCE_LINES)
+        snprintf(line, sizeof(line), "bounce buffers 2 x %d lines, %.1f MHz, %.1f fps",
+                 TD_RGB_BOUNCE_LINES, PANEL_TIMING.pclk_hz / 1e6f, panelFps());
+    else
+        snprintf(line, sizeof(line), "Bus_RGB (GDMA reads PSRAM), %.1f MHz, %.1f fps",
+                 PANEL_TIMING.pclk_hz / 1e6f, panelFps());
+    return line;
+}
+
+// --- PSRAM bandwidth (/diag/psram) ---
+// The CPU copies a 256 KB PSRAM block (larger than the data cache) to and
+// from internal RAM for PSRAM_BENCH_MS each way, while the panel keeps
+// scanning out. What it gets is the PSRAM bandwidth left for decoding.
+#define PSRAM_BENCH_MS    250
+#define PSRAM_BENCH_BYTES (256 * 1024)
+static bool s_psramBenchPending = false;
+static float s_psramReadMBps = 0, s_psramWriteMBps = 0;
+
+static float psramCopyMBps(uint8_t* ext, uint8_t* sram, size_t chunk, bool toPsram) {
+    uint64_t bytes = 0;
+    const uint32_t t0 = micros();
+    uint32_t dt = 0;
+    while (dt < PSRAM_BENCH_MS * 1000u) {
+        for (size_t off = 0; off < PSRAM_BENCH_BYTES; off += chunk) {
+            if (toPsram) memcpy(ext + off, sram, chunk);
+            else memcpy(sram, ext + off, chunk);
+        }
+        bytes += PSRAM_BENCH_BYTES;
+        dt = micros() - t0;
+    }
+    return bytes / (float)dt;   // bytes per us = MB/s
+}
+
+static void runPsramBench() {
+    const size_t chunk = 4096;
+    uint8_t* ext = (uint8_t*)heap_caps_malloc(PSRAM_BENCH_BYTES, MALLOC_CAP_SPIRAM);
+    uint8_t* sram = (uint8_t*)heap_caps_malloc(chunk, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (ext && sram) {
+        memset(sram, 0x5A, chunk);
+        s_psramWriteMBps = psramCopyMBps(ext, sram, chunk, true);
+        s_psramReadMBps = psramCopyMBps(ext, sram, chunk, false);
+    }
+    if (ext) heap_caps_free(ext);
+    if (sram) heap_caps_free(sram);
+}
+
+static void handlePsram(AsyncWebServerRequest *request) {
+    if (request->hasParam("run")) {
+        s_psramBenchPending = true;
+        request->redirect("/diag/psram");
+        return;
+    }
+    if (request->hasParam("reset")) {
+        bounceResetStats();
+        request->redirect("/diag/psram");
+        return;
+    }
+    char line[128];
+    String out = "panel: " + panelMode() + "\n";
+    snprintf(line, sizeof(line), "scan-out: %.1f MB/s of frame buffer reads, all the time\n", scanoutMBps());
+    out += line;
+    if (s_psramBenchPending) {
+        out += "PSRAM copy: running... reload in a second.\n";
+    } else if (s_psramReadMBps > 0) {
+        snprintf(line, sizeof(line), "PSRAM copy by the CPU while scanning out: read %.1f MB/s, write %.1f MB/s\n",
+                 s_psramReadMBps, s_psramWriteMBps);
+        out += line;
+    } else {
+        out += "PSRAM copy: open /diag/psram?run=1 to measure.\n";
+    }
+
+    const BounceStats b = bounceStats();
+    if (b.lines) {
+        const float secs = (esp_timer_get_time() - b.sinceUs) / 1e6f;
+        snprintf(line, sizeof(line), "\nbounce refills: %lu in %.0f s, budget %lu us each, worst %lu us, avg %.1f us\n",
+                 (unsigned long)b.fills, secs, (unsigned long)b.budgetUs, (unsigned long)b.worstFillUs,
+                 b.fills ? (float)b.fillUsTotal / b.fills : 0.0f);
+        out += line;
+        snprintf(line, sizeof(line), "refill CPU load: %.1f%% of one core\n",
+                 secs > 0 ? b.fillUsTotal / (secs * 1e4f) : 0.0f);
+        out += line;
+        snprintf(line, sizeof(line), "late refills (underruns): %lu; frames with a glitch: %lu of %lu\n",
+                 (unsigned long)b.lateFills, (unsigned long)b.glitchFrames, (unsigned long)b.frames);
+        out += line;
+        out += "/diag/psram?reset=1 clears the counters.\n";
+    } else {
+        out += "\nunderrun and glitch counters need bounce buffers (TD_RGB_BOUNCE_LINES in disp_cfg.h).\n";
+    }
+    const PanelClock::Stats pc = PanelClock::stats();
+    if (pc.staticHz != pc.fullHz && pc.totalUs) {
+        const float slowShare = (float)pc.slowUs / pc.totalUs;
+        // Scan-out reads avoided while at the static clock
+        const float savedMB = pc.slowUs / 1e6f * scanoutMBps() * (1.0f - (float)pc.staticHz / pc.fullHz);
+        snprintf(line, sizeof(line), "\nadaptive clock: %.1f MHz now; %.1f MHz when still, %.0f%% of the time, %lu switches\n",
+                 (pc.slow ? pc.staticHz : pc.fullHz) / 1e6f, pc.staticHz / 1e6f, slowShare * 100, (unsigned long)pc.switches);
+        out += line;
+        snprintf(line, sizeof(line), "scan-out reads saved: %.0f MB since boot (%.1f MB/s on average)\n",
+                 savedMB, savedMB / (pc.totalUs / 1e6f));
+        out += line;
+    } else {
+        out += "\nadaptive clock: off\n";
+    }
+    out += "\nDecode times with this panel setup: /diag/jpeg?run=1\n";
+    request->send(200, "text/plain", out);
+}
+
+// --- JPEG decode benchmark (/diag/jpeg) ---
+// Runs from Diag::handle() in the main loop, not in the web server's task:
+// each /jpg still is read into PSRAM and drawn JPEG_BENCH_RUNS times by every
+// path, and the best time is kept. The slideshow resumes afterwards.
+#define JPEG_BENCH_RUNS  3
+#define JPEG_BENCH_FILES 8
+static bool s_jpegBenchPending = false;
+static String s_jpegBenchResult;
+
+static void runJpegBench() {
+    String out = "panel: " + panelMode() + "\n";
+    out += "file                          TJpgDec    1 core   2 cores    scalar  (ms, best of " + String(JPEG_BENCH_RUNS) + ")\n";
+    int files = 0;
+    File dir = FFat.open("/jpg");
+    File f = dir ? dir.openNextFile() : File();
+    while (f && files < JPEG_BENCH_FILES) {
+        String name = f.name();
+        String lower = name;
+        lower.toLowerCase();
+        if (!f.isDirectory() && (lower.endsWith(".jpg") || lower.endsWith(".jpeg"))) {
+            size_t size = f.size();
+            uint8_t* buf = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+            if (buf && (size_t)f.read(buf, size) == size) {
+                char line[96];
+                snprintf(line, sizeof(line), "%-28s", name.c_str());
+                out += line;
+                for (int p = 0; p < 4; p++) {
+                    uint32_t best = UINT32_MAX;
+                    bool ok = true;
+                    for (int r = 0; r < JPEG_BENCH_RUNS && ok; r++) {
+                        uint32_t t0 = micros();
+                        ok = ImageDisplay::drawJpgWith(buf, size, (ImageDisplay::JpegPath)p);
+                        uint32_t dt = micros() - t0;
+                        if (dt < best) best = dt;
+                        yield();
+                    }
+                    if (ok) snprintf(line, sizeof(line), " %9.1f", best / 1000.0);
+                    else snprintf(line, sizeof(line), " %9s", "-");
+                    out += line;
+                }
+                out += "\n";
+                files++;
+                Serial.printf("[Diag] JPEG bench: %s done\n", name.c_str());
+            }
+            if (buf) heap_caps_free(buf);
+        }
+        f = dir.openNextFile();
+    }
+    if (!files) out += "(no JPGs in /jpg)\n";
+    out += "\n'2 cores' equals '1 core' for files without restart markers at MCU rows; run them through tdasset.\n";
+    out += "'scalar' is one core with the reference kernels; '1 core' uses the " + String(jpeg::defaultKernels().name) + " ones.\n";
+    s_jpegBenchResult = out;
+}
+
+static void handleJpegBench(AsyncWebServerRequest *request) {
+    if (request->hasParam("run")) {
+        s_jpegBenchPending = true;
+        s_jpegBenchResult = "";
+        request->redirect("/diag/jpeg");
+        return;
+    }
+    String msg;
+    if (s_jpegBenchPending) msg = "Running... reload in a few seconds.\n";
+    else if (s_jpegBenchResult.length()) msg = s_jpegBenchResult;
+    else msg = "Open /diag/jpeg?run=1 to decode every /jpg still with each decoder.\n";
+    request->send(200, "text/plain", msg);
+}
+
 // --- Main Diagnostics Page Handler ---
 static void handleDiag(AsyncWebServerRequest *request) {
     // Formatting requested?
@@ -158,6 +349,52 @@ input[type=number] {width:60px; margin:0 4px 0 8px; padding:2px 4px;}
     html += "<b>IP Address:</b> " + ip + "<br>";
     html += "</div></div>";
 
+    // --- SCREEN CAST ---
+    const CastRx::Stats cs = CastRx::stats();
+    html += "<div class='section'><h2>Screen Cast</h2><div style='text-align:left;display:inline-block;margin:auto;'>";
+    if (!cs.frames) {
+        html += "No frames received yet. Send with host/cast/tdcast to UDP port " + String(td_wire::kPortCast) + ".<br>";
+    } else {
+        char line[160];
+        snprintf(line, sizeof(line), "<b>%s:</b> %.1f fps, %lu shown of %lu frames (last %lu KB)<br>",
+                 cs.active ? "Casting" : "Last cast", cs.fps, (unsigned long)cs.shown, (unsigned long)cs.frames,
+                 (unsigned long)(cs.lastBytes / 1024));
+        html += line;
+        snprintf(line, sizeof(line), "<b>Dropped:</b> %lu incomplete, %lu late, %lu no slot, %lu bad fragments<br>",
+                 (unsigned long)cs.droppedIncomplete, (unsigned long)cs.droppedLate, (unsigned long)cs.droppedFull,
+                 (unsigned long)cs.badFragments);
+        html += line;
+        snprintf(line, sizeof(line), "<b>On the display:</b> %.1f ms avg, %.1f ms worst (jitter buffer %.1f ms, decode %.1f ms)<br>",
+                 cs.latencyAvgUs / 1000.0f, cs.latencyMaxUs / 1000.0f, cs.waitAvgUs / 1000.0f, cs.decodeAvgUs / 1000.0f);
+        html += line;
+        if (cs.e2eUs) {
+            snprintf(line, sizeof(line), "<b>End to end:</b> %.1f ms, capture to on screen, from the sender<br>", cs.e2eUs / 1000.0f);
+            html += line;
+        }
+    }
+    html += "</div></div>";
+
+    // --- ALERTS ---
+    const Alerts::Stats as = Alerts::stats();
+    html += "<div class='section'><h2>Alerts</h2><div style='text-align:left;display:inline-block;margin:auto;'>";
+    {
+        char line[160];
+        snprintf(line, sizeof(line), "<b>Rules:</b> %u, %u raised now (%lu raised, %lu cleared since boot)<br>",
+                 as.rules, as.raisedNow, (unsigned long)as.raised, (unsigned long)as.cleared);
+        html += line;
+        snprintf(line, sizeof(line), "<b>Evaluation:</b> %lu telemetry changes, %lu rule checks, %lu us avg, %lu us worst<br>",
+                 (unsigned long)as.updates, (unsigned long)as.evaluations, (unsigned long)as.evalAvgUs,
+                 (unsigned long)as.evalMaxUs);
+        html += line;
+        if (as.raised) {
+            snprintf(line, sizeof(line), "<b>Raised to on screen:</b> %.1f ms avg, %.1f ms worst, %.1f ms last; %lu preempted the screen<br>",
+                     as.latencyAvgUs / 1000.0f, as.latencyMaxUs / 1000.0f, as.latencyLastUs / 1000.0f,
+                     (unsigned long)as.preempts);
+            html += line;
+        }
+    }
+    html += "</div></div>";
+
     // --- RESOURCE CHECK ---
     html += "<div class='section'><h2>Resource Check</h2>";
     bool anyMissing = false;
@@ -220,12 +457,18 @@ input[type=number] {width:60px; margin:0 4px 0 8px; padding:2px 4px;}
         {"JPG Mode",         "/cmd?c=04&mode=jpg"},
         {"GIF Mode",         "/cmd?c=04&mode=gif"},
         {"Random Mode",      "/cmd?c=04"},
+        {"Ken Burns Mode",   "/cmd?c=04&mode=kb"},
         {"Clear Display",    "/cmd?c=06"},
         {"WiFi Restart",     "/cmd?c=30"},
         {"WiFi Forget",      "/cmd?c=31"},
         {"Reboot",           "/cmd?c=40"},
         {"Display ON",       "/cmd?c=60"},
         {"Display OFF",      "/cmd?c=61"},
+        {"Expansion",        "/exp"},
+        {"UDP Capture",      "/capture"},
+        {"Alerts",           "/alerts"},
+        {"JPEG Benchmark",   "/diag/jpeg?run=1"},
+        {"PSRAM Bandwidth",  "/diag/psram?run=1"},
     };
 
     for (auto& cmd : cmds) {
@@ -263,11 +506,21 @@ input[type=number] {width:60px; margin:0 4px 0 8px; padding:2px 4px;}
 
 namespace Diag {
 void begin(AsyncWebServer &server) {
+    server.on("/diag/jpeg", HTTP_GET, handleJpegBench);
+    server.on("/diag/psram", HTTP_GET, handlePsram);
     server.on("/diag", HTTP_GET, handleDiag);
     // OTA endpoints:
     server.on("/update", HTTP_POST, handleUpdate, handleUpdateUpload);
 }
 void handle() {
-    // No periodic tasks needed yet.
+    if (s_jpegBenchPending) {
+        runJpegBench();
+        s_jpegBenchPending = false;
+        ImageDisplay::nextImage();
+    }
+    if (s_psramBenchPending) {
+        runPsramBench();
+        s_psramBenchPending = false;
+    }
 }
 }
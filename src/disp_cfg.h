@@ -3,10 +3,34 @@
 #include <Arduino.h>
 #define LGFX_USE_V1
 #include <LovyanGFX.hpp>
+#if defined(TD_HOST_SIM)
+#include <lgfx/v1/platforms/sdl/Panel_sdl.hpp>
+#else
 #include <lgfx/v1/platforms/esp32s3/Bus_RGB.hpp>
 #include <lgfx/v1/platforms/esp32s3/Panel_RGB.hpp>
+#endif
 #include "TCA9554PWR.h"
 
+// RGB scan-out timing, shared by both panel drivers below and by the
+// bandwidth figures on /diag/psram.
+struct PanelTiming {
+  uint32_t pclk_hz;
+  uint16_t hfp, hpw, hbp;    // horizontal front porch, sync pulse, back porch
+  uint16_t vfp, vpw, vbp;
+};
+static constexpr PanelTiming PANEL_TIMING = { 16000000, 50, 8, 10, 8, 3, 8 };
+
+// Scan-out path. 0: LovyanGFX's Bus_RGB, whose GDMA reads the frame buffer
+// straight from PSRAM. N: panel_bounce.h's esp_lcd driver, which scans out of
+// two N-line buffers in internal SRAM that the CPU refills from the PSRAM
+// frame buffer. N must divide 480; each line costs 960 B of SRAM per buffer.
+#ifndef TD_RGB_BOUNCE_LINES
+#define TD_RGB_BOUNCE_LINES 0
+#endif
+static_assert(TD_RGB_BOUNCE_LINES >= 0 && 480 % (TD_RGB_BOUNCE_LINES ? TD_RGB_BOUNCE_LINES : 1) == 0,
+              "TD_RGB_BOUNCE_LINES must divide 480");
+#include "panel_bounce.h"
+
 // Define EXIO pins as in vendor code
 #define LCD_CS_PIN  EXIO_PIN3
 #define LCD_RST_PIN EXIO_PIN1
@@ -97,31 +121,78 @@ inline void vendor_ST7701_init()
 }
 
 
+#if defined(TD_HOST_HEADLESS)
+// Host simulator without a window (host/sim): the 480x480 panel is an
+// RGB565 sprite in memory, so runs need no display and can be profiled.
+class LGFX : public lgfx::LGFX_Sprite
+{
+  uint8_t _brightness = 255;
+public:
+  LGFX(void) { setColorDepth(16); }
+  bool begin(void) { return createSprite(480, 480) != nullptr; }
+  bool init(void) { return begin(); }
+  void setBrightness(uint8_t b) { _brightness = b; }
+  uint8_t getBrightness(void) const { return _brightness; }
+};
+#elif defined(TD_HOST_SIM)
+// Host simulator (host/sim): the same 480x480 panel in an SDL window
+class LGFX : public lgfx::LGFX_Device
+{
+  lgfx::Panel_sdl      _panel_instance;
+public:
+  LGFX(void)
+  {
+    auto cfg = _panel_instance.config();
+    cfg.memory_width  = 480;
+    cfg.memory_height = 480;
+    cfg.panel_width   = 480;
+    cfg.panel_height  = 480;
+    cfg.offset_x      = 0;
+    cfg.offset_y      = 0;
+    _panel_instance.config(cfg);
+    _panel_instance.setWindowTitle("Type D XL");
+    setPanel(&_panel_instance);
+  }
+};
+#else
 // LGFX device for ESP32S3+RGB
 class LGFX : public lgfx::LGFX_Device
 {
+#if TD_RGB_BOUNCE_LINES
+  Panel_RGBBounce      _panel_instance;
+#else
   lgfx::Panel_RGB      _panel_instance;
   lgfx::Bus_RGB        _bus_instance;
+#endif
   lgfx::Light_PWM      _light_instance;
 public:
   LGFX(void)
   {
     { // RGB Bus
+#if TD_RGB_BOUNCE_LINES
+      auto cfg = _panel_instance.bus_config();
+#else
       auto cfg = _bus_instance.config();
       cfg.panel = &_panel_instance;
+#endif
       cfg.pin_d0  = 5;   cfg.pin_d1  = 45;  cfg.pin_d2  = 48;  cfg.pin_d3  = 47;  cfg.pin_d4  = 21;
       cfg.pin_d5  = 14;  cfg.pin_d6  = 13;  cfg.pin_d7  = 12;  cfg.pin_d8  = 11;  cfg.pin_d9  = 10; cfg.pin_d10 = 9;
       cfg.pin_d11 = 46;  cfg.pin_d12 = 3;   cfg.pin_d13 = 8;   cfg.pin_d14 = 18;  cfg.pin_d15 = 17;
       cfg.pin_hsync = 38; cfg.pin_vsync = 39;
       cfg.pin_henable = 40;    cfg.pin_pclk = 41;
-      cfg.freq_write = 16000000;
-      cfg.hsync_polarity = 1; cfg.hsync_front_porch = 50; cfg.hsync_pulse_width = 8; cfg.hsync_back_porch = 10;
-      cfg.vsync_polarity = 1; cfg.vsync_front_porch = 8;  cfg.vsync_pulse_width = 3; cfg.vsync_back_porch = 8;
+      cfg.freq_write = PANEL_TIMING.pclk_hz;
+      cfg.hsync_polarity = 1; cfg.hsync_front_porch = PANEL_TIMING.hfp; cfg.hsync_pulse_width = PANEL_TIMING.hpw; cfg.hsync_back_porch = PANEL_TIMING.hbp;
+      cfg.vsync_polarity = 1; cfg.vsync_front_porch = PANEL_TIMING.vfp; cfg.vsync_pulse_width = PANEL_TIMING.vpw; cfg.vsync_back_porch = PANEL_TIMING.vbp;
       cfg.pclk_active_neg = false;
       cfg.de_idle_high = false;
       cfg.pclk_idle_high = false;
+#if TD_RGB_BOUNCE_LINES
+      _panel_instance.bus_config(cfg);
+      _panel_instance.bounce_lines(TD_RGB_BOUNCE_LINES);
+#else
       _bus_instance.config(cfg);
       _panel_instance.setBus(&_bus_instance);
+#endif
     }
     { // Panel
       auto cfg = _panel_instance.config();
@@ -152,6 +223,7 @@ public:
     setPanel(&_panel_instance);
   }
 };
+#endif
 
 // Version
 static constexpr char VERSION_TEXT[] = "v0.7.2 Beta";
@@ -0,0 +1,271 @@
+// exp_link.cpp
+//
+// - Config: POST /exp/config?k=v&... sends "CFG:SET:k=v,..." to the expansion
+//   (or broadcasts it with all=1, so every expansion on the LAN takes it).
+//   The "CFG:{json}" reply is kept and shown by GET /exp/status.
+// - OTA relay: POST /exp/ota (multipart) stores the bundle on FFat, checks
+//   its header and starts a task on core 0. The task drives the expansion's
+//   /ota/begin, /ota/chunk and /ota/end endpoints. After any failure it calls
+//   /ota/begin again and continues from the "next" offset the expansion
+//   reports, so only the chunk in flight is resent. The expansion checks the
+//   signature; the display never needs the key.
+
+#include "exp_link.h"
+#include "udp_detect.h"
+#include <FFat.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <HTTPClient.h>
+
+#define EXP_CFG_PORT          50508
+#define EXP_CFG_LOCAL_PORT    50509
+#define EXP_OTA_PATH          "/exp_ota.bin"
+#define EXP_OTA_HDR_BYTES     104           // ExpRemote::OtaHeader
+#define EXP_OTA_CHUNK         8192
+#define EXP_OTA_MAX_RETRIES   8
+#define EXP_OTA_HTTP_TIMEOUT  15000
+
+namespace ExpLink {
+
+enum class Relay : uint8_t { Idle, Running, Done, Failed };
+
+static WiFiUDP           s_udp;
+static bool              s_udpBound = false;
+static String            s_cfgJson = "{}";
+static uint32_t          s_cfgAtMs = 0;
+
+static volatile Relay    s_relay = Relay::Idle;
+static volatile uint32_t s_sent = 0, s_total = 0, s_retries = 0;
+static char              s_relayMsg[64] = "";
+static IPAddress         s_target;
+
+static File              s_upload;
+static bool              s_uploadOk = false;
+
+static void set_msg(const char* m) {
+    snprintf(s_relayMsg, sizeof(s_relayMsg), "%s", m);
+    Serial.printf("[ExpLink] %s\n", m);
+}
+
+static const char* relay_name() {
+    switch (s_relay) {
+        case Relay::Running: return "running";
+        case Relay::Done:    return "done";
+        case Relay::Failed:  return "failed";
+        default:             return "idle";
+    }
+}
+
+// ---------- OTA relay task ----------
+static int post(const String& url, const uint8_t* data, size_t len, String& reply) {
+    HTTPClient http;
+    http.setTimeout(EXP_OTA_HTTP_TIMEOUT);
+    if (!http.begin(url)) return -1;
+    http.addHeader("Content-Type", "application/octet-stream");
+    const int code = http.POST(const_cast<uint8_t*>(data), len);
+    reply = code > 0 ? http.getString() : String();
+    http.end();
+    return code;
+}
+
+static long json_next(const String& reply) {
+    const int i = reply.indexOf("\"next\":");
+    return i < 0 ? -1 : reply.substring(i + 7).toInt();
+}
+
+static void relay_task(void*) {
+    File f = FFat.open(EXP_OTA_PATH, "r");
+    uint8_t hdr[EXP_OTA_HDR_BYTES];
+    uint8_t* buf = (uint8_t*)malloc(EXP_OTA_CHUNK);
+    const String base = "http://" + s_target.toString();
+
+    bool ok = false;
+    if (!f || !buf || f.read(hdr, sizeof(hdr)) != sizeof(hdr)) {
+        set_msg("bundle unreadable");
+    } else {
+        uint32_t next = 0;
+        while (s_retries <= EXP_OTA_MAX_RETRIES) {
+            String reply;
+            int code = post(base + "/ota/begin", hdr, sizeof(hdr), reply);
+            if (code == 403 || code == 400) { set_msg("expansion refused the image"); break; }
+            if (code != 200 || json_next(reply) < 0) {
+                s_retries++;
+                set_msg("expansion unreachable, retrying");
+                vTaskDelay(pdMS_TO_TICKS(1000u << (s_retries < 5 ? s_retries : 5)));
+                continue;
+            }
+            next = (uint32_t)json_next(reply);
+
+            // Stream chunks from wherever the expansion says it is
+            bool linkDropped = false;
+            while (next < s_total) {
+                s_sent = next;
+                const size_t n = f.seek(EXP_OTA_HDR_BYTES + next) ? f.read(buf, EXP_OTA_CHUNK) : 0;
+                if (n == 0) { set_msg("bundle read failed"); linkDropped = true; s_retries = EXP_OTA_MAX_RETRIES + 1; break; }
+                code = post(base + "/ota/chunk?off=" + String(next), buf, n, reply);
+                const long at = json_next(reply);
+                if ((code == 200 || code == 409) && at >= 0 && reply.indexOf("\"receiving\"") >= 0) {
+                    next = (uint32_t)at;   // 409: out of step; jump to where it is
+                    continue;
+                }
+                linkDropped = true;        // error state or network: begin again, which resumes
+                s_retries++;
+                set_msg("chunk failed, resuming");
+                vTaskDelay(pdMS_TO_TICKS(1000));
+                break;
+            }
+            if (linkDropped) continue;
+
+            s_sent = s_total;
+            code = post(base + "/ota/end", nullptr, 0, reply);
+            ok = code == 200;
+            set_msg(ok ? "verified; expansion rebooting" : "expansion rejected the image");
+            break;
+        }
+        if (!ok && s_retries > EXP_OTA_MAX_RETRIES) set_msg("gave up after retries");
+    }
+
+    if (f) f.close();
+    free(buf);
+    s_relay = ok ? Relay::Done : Relay::Failed;
+    vTaskDelete(nullptr);
+}
+
+static bool start_relay() {
+    if (s_relay == Relay::Running) return false;
+    s_target = UDPDetect::expansionIP();
+    if (s_target == IPAddress()) { set_msg("no expansion seen yet"); s_relay = Relay::Failed; return false; }
+
+    File f = FFat.open(EXP_OTA_PATH, "r");
+    char magic[4] = {0};
+    uint32_t size = 0;
+    const bool hdrOk = f && f.read((uint8_t*)magic, 4) == 4 && f.read((uint8_t*)&size, 4) == 4 &&
+                       !memcmp(magic, "TDO1", 4) && f.size() == EXP_OTA_HDR_BYTES + size;
+    if (f) f.close();
+    if (!hdrOk) { set_msg("not a signed bundle (use exp_ota.py sign)"); s_relay = Relay::Failed; return false; }
+
+    s_total = size;
+    s_sent = 0;
+    s_retries = 0;
+    s_relay = Relay::Running;
+    set_msg("relaying");
+    if (xTaskCreatePinnedToCore(relay_task, "exp_ota", 8192, nullptr, 1, nullptr, 0) != pdPASS) {
+        s_relay = Relay::Failed;
+        set_msg("task start failed");
+        return false;
+    }
+    return true;
+}
+
+// ---------- config ----------
+static void send_cfg(const String& msg, bool broadcast) {
+    if (!s_udpBound) return;
+    const IPAddress to = broadcast ? IPAddress(255, 255, 255, 255) : UDPDetect::expansionIP();
+    if (to == IPAddress()) return;
+    s_udp.beginPacket(to, EXP_CFG_PORT);
+    s_udp.print(msg);
+    s_udp.endPacket();
+}
+
+// ---------- HTTP ----------
+static void handleStatus(AsyncWebServerRequest* request) {
+    String j = "{\"expansion\":\"" + UDPDetect::expansionIP().toString() + "\"";
+    j += ",\"ota\":{\"state\":\"" + String(relay_name()) + "\",\"sent\":" + String(s_sent);
+    j += ",\"total\":" + String(s_total) + ",\"retries\":" + String(s_retries);
+    j += ",\"msg\":\"" + String(s_relayMsg) + "\"}";
+    j += ",\"configAgeMs\":" + String(s_cfgAtMs ? millis() - s_cfgAtMs : 0);
+    j += ",\"config\":" + s_cfgJson + "}";
+    request->send(200, "application/json", j);
+}
+
+static void handleConfig(AsyncWebServerRequest* request) {
+    String list;
+    bool all = false;
+    for (size_t i = 0; i < request->params(); ++i) {
+        const AsyncWebParameter* p = request->getParam(i);
+        if (p->name() == "all") { all = p->value() == "1"; continue; }
+        if (p->value().length() == 0) continue;
+        if (list.length()) list += ",";
+        list += p->name() + "=" + p->value();
+    }
+    send_cfg(list.length() ? "CFG:SET:" + list : String("CFG:GET"), all);
+    request->redirect("/exp");
+}
+
+static void handleOtaUpload(AsyncWebServerRequest*, String, size_t index, uint8_t* data, size_t len, bool final) {
+    if (index == 0) {
+        if (s_upload) s_upload.close();
+        s_uploadOk = s_relay != Relay::Running;
+        if (s_uploadOk) s_upload = FFat.open(EXP_OTA_PATH, "w");
+        s_uploadOk = s_uploadOk && s_upload;
+    }
+    if (s_uploadOk && s_upload.write(data, len) != len) s_uploadOk = false;
+    if (final && s_upload) s_upload.close();
+}
+
+static void handleOtaDone(AsyncWebServerRequest* request) {
+    if (!s_uploadOk) { request->send(409, "text/plain", "Upload failed or a relay is already running"); return; }
+    start_relay();
+    request->redirect("/exp");
+}
+
+static void handlePage(AsyncWebServerRequest* request) {
+    String html = R"(<!DOCTYPE html><html><head><title>Type D Expansion</title>
+<meta name='viewport' content='width=device-width,initial-scale=1'>
+<style>body{background:#111;color:#eee;font-family:sans-serif;margin:20px}
+.section{background:#222;padding:14px;border-radius:8px;margin-bottom:14px}
+input{width:110px}.qbtn{background:#299a2c;color:#fff;border:0;padding:6px 12px;border-radius:5px}
+pre{white-space:pre-wrap;color:#aaa}</style></head><body>
+<h2>Expansion</h2>
+<div class='section'><h3>Status</h3><pre id='st'>...</pre></div>
+<div class='section'><h3>Pacing</h3><form method='POST' action='/exp/config' id='cf'></form></div>
+<div class='section'><h3>Firmware (signed bundle)</h3>
+<form method='POST' action='/exp/ota' enctype='multipart/form-data'>
+<input type='file' name='bundle' accept='.tdo,.bin' required style='width:auto'>
+<button class='qbtn' type='submit'>Upload &amp; relay</button></form></div>
+<a href='/diag' style='color:#8cf'>Back to Diagnostics</a>
+<script>
+let built=false;
+function tick(){fetch('/exp/status').then(r=>r.json()).then(s=>{
+ let o=s.ota;document.getElementById('st').textContent='Expansion: '+(s.expansion||'-')+
+ '\nOTA: '+o.state+' '+o.sent+'/'+o.total+' retries '+o.retries+' '+o.msg;
+ if(!built&&Object.keys(s.config).length){built=true;let f=document.getElementById('cf'),h='';
+  for(const k in s.config){const c=s.config[k];h+=`<label>${k} <input name='${k}' type='number' min='${c.min}' max='${c.max}' placeholder='${c.v}'> (default ${c.def})</label><br>`;}
+  h+="<label><input type='checkbox' name='all' value='1' style='width:auto'> all expansions</label><br><button class='qbtn' type='submit'>Apply</button>";f.innerHTML=h;}
+});}
+fetch('/exp/config',{method:'POST'});tick();setInterval(tick,1500);
+</script></body></html>)";
+    request->send(200, "text/html", html);
+}
+
+// ---------- Public ----------
+void begin(AsyncWebServer& server) {
+    server.on("/exp", HTTP_GET, handlePage);
+    server.on("/exp/status", HTTP_GET, handleStatus);
+    server.on("/exp/config", HTTP_POST, handleConfig);
+    server.on("/exp/ota", HTTP_POST, handleOtaDone, handleOtaUpload);
+}
+
+void loop() {
+    if (WiFi.status() != WL_CONNECTED) return;
+    if (!s_udpBound) {
+        if (!s_udp.begin(EXP_CFG_LOCAL_PORT)) return;
+        s_udpBound = true;
+        send_cfg("CFG:GET", false);
+    }
+    const int sz = s_udp.parsePacket();
+    if (sz <= 0) return;
+    char buf[600];
+    const int n = s_udp.read(buf, sizeof(buf) - 1);
+    if (n <= 4) return;
+    buf[n] = 0;
+    if (strncmp(buf, "CFG:{", 5) != 0) return;
+    s_cfgJson = String(buf + 4);
+    s_cfgAtMs = millis();
+}
+
+bool otaBusy() {
+    return s_relay == Relay::Running;
+}
+
+} // namespace ExpLink
@@ -0,0 +1,17 @@
+// exp_link.h
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Display -> expansion management link. The expansion's address is learned
+// from its 50505 status packets. Pacing config is relayed over UDP (50508,
+// "CFG:..."), and signed OTA bundles (script/exp_ota.py) uploaded here are
+// pushed to the expansion in chunks by a background task that resumes after
+// link drops.
+namespace ExpLink {
+    void begin(AsyncWebServer& server);   // GET /exp, /exp/status; POST /exp/config, /exp/ota
+    void loop();                          // config replies
+
+    // True while a relay is running
+    bool otaBusy();
+}
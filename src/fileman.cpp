@@ -3,6 +3,7 @@
 #include <FFat.h>
 #include "fileman.h"
 #include "imagedisplay.h"
+#include "gallery_index.h"
 
 // --- Internal state ---
 static AsyncWebServer* _server = nullptr;
@@ -104,6 +105,7 @@ void FileMan::begin(AsyncWebServer& server) {
     server.on("/sd/jpg", HTTP_GET, serveFile);
     server.on("/sd/gif", HTTP_GET, serveFile);
     server.on("/sd/resource", HTTP_GET, serveFile);
+    server.on("/sd/thumb", HTTP_GET, serveFile);
 
     // Upload handlers
     server.on("/upload_boot", HTTP_POST, 
@@ -209,14 +211,16 @@ String listGallerySection() {
     String html = "<div class='section'><h2>Manage Images</h2>";
 
     // JPGs
-    html += "<div class='file-list'><strong>JPGs:</strong><br>";
+    html += "<div class='file-list'><strong>Stills (JPG, PNG, QOI, 565):</strong><br>";
     File jpg = FFat.open("/jpg");
     bool hasJpg = false;
     if (jpg) {
         File f = jpg.openNextFile();
         while (f) {
             String fn = f.name();
-            if (fn.endsWith(".jpg")) {
+            if (fn.endsWith(".jpg") || fn.endsWith(".png") || fn.endsWith(".qoi") || fn.endsWith(".565")) {
+                String thumb = GalleryIndex::thumbPath("/jpg/" + fn);
+                if (FFat.exists(thumb)) html += "<img src='/sd/thumb?file=" + thumb.substring(7) + "' width='48' height='48' style='vertical-align:middle;'> ";
                 html += fn + " ";
                 html += "<form style='display:inline;' method='POST' action='/delete_gallery'>";
                 html += "<input type='hidden' name='file' value='" + fn + "'>";
@@ -232,9 +236,9 @@ String listGallerySection() {
         }
         jpg.close();
     }
-    if (!hasJpg) html += "No jpg files found.";
+    if (!hasJpg) html += "No still images found.";
     html += "<form method='POST' enctype='multipart/form-data' action='/upload_jpg'>";
-    html += "<input type='file' name='upload' accept='.jpg' multiple required><button class='qbtn' type='submit'>Upload</button></form></div>";
+    html += "<input type='file' name='upload' accept='.jpg,.png,.qoi,.565' multiple required><button class='qbtn' type='submit'>Upload</button></form></div>";
 
     // GIFs
     html += "<div class='file-list'><strong>GIFs:</strong><br>";
@@ -245,6 +249,8 @@ String listGallerySection() {
         while (f) {
             String fn = f.name();
             if (fn.endsWith(".gif")) {
+                String thumb = GalleryIndex::thumbPath("/gif/" + fn);
+                if (FFat.exists(thumb)) html += "<img src='/sd/thumb?file=" + thumb.substring(7) + "' width='48' height='48' style='vertical-align:middle;'> ";
                 html += fn + " ";
                 html += "<form style='display:inline;' method='POST' action='/delete_gallery'>";
                 html += "<input type='hidden' name='file' value='" + fn + "'>";
@@ -326,6 +332,7 @@ void serveFile(AsyncWebServerRequest *request) {
     else if (type == "/sd/jpg") path = "/jpg/" + file;
     else if (type == "/sd/gif") path = "/gif/" + file;
     else if (type == "/sd/resource") path = "/resource/" + file;
+    else if (type == "/sd/thumb") path = "/thumb/" + file;
     else {
         request->send(404, "text/plain", "Invalid file type");
         return;
@@ -379,6 +386,12 @@ void handleUpload(AsyncWebServerRequest *request, String filename, size_t index,
     }
     if (final) {
         if (uploadFile) uploadFile.close();
+        if (folder == "/jpg" || folder == "/gif") {
+            // A replaced file's sidecar and preview describe the old one
+            FFat.remove(GalleryIndex::sidecarPath(uploadTargetPath));
+            FFat.remove(GalleryIndex::thumbPath(uploadTargetPath));
+            GalleryIndex::invalidate();
+        }
         Serial.printf("[FileMan] Upload complete: %s\n", uploadTargetPath.c_str());
     }
 }
@@ -391,6 +404,11 @@ void handleDelete(AsyncWebServerRequest *request) {
 
     if (FFat.exists(path.c_str())) {
         FFat.remove(path.c_str());
+        if (folder == "/jpg" || folder == "/gif") {
+            FFat.remove(GalleryIndex::sidecarPath(path));
+            FFat.remove(GalleryIndex::thumbPath(path));
+            GalleryIndex::invalidate();
+        }
         Serial.printf("[FileMan] Deleted: %s\n", path.c_str());
     } else {
         Serial.printf("[FileMan] File not found for delete: %s\n", path.c_str());
@@ -0,0 +1,182 @@
+// gallery_index.cpp
+//
+// - /gallery.idx is read in one go at refresh; a missing or malformed index
+//   falls back to the directory walk, which then writes a new one.
+// - Sidecars are only read during that walk, so a rebuild costs one small
+//   open per gallery file, once per change instead of on every refresh.
+// - FileMan calls invalidate() on upload and delete; nothing else writes the
+//   gallery.
+//
+// gallery.idx (little-endian):
+//   0  "TDG1"   4 u32 count   8 u32 paths offset
+//   12 entries: count x { u32 pathOffset (from paths offset); Meta }, sorted by path
+//   .. paths: NUL-terminated, "/jpg/..." or "/gif/..."
+// <file>.tdm sidecar:
+//   0  "TDM1"   4 Meta (u32 size, u16 width, u16 height, u16 frames, u16 flags, u32 durationMs)
+
+#include "gallery_index.h"
+#include <FFat.h>
+#include <algorithm>
+
+#define GALLERY_INDEX_PATH   "/gallery.idx"
+#define GALLERY_INDEX_TMP    "/gallery.tmp"
+#define GALLERY_INDEX_MAX    (64 * 1024)
+
+namespace GalleryIndex {
+
+static_assert(sizeof(Meta) == 16, "sidecar layout");
+
+struct Entry { uint32_t off; Meta m; };
+
+static inline uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline void wr32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+// /jpg holds the stills: JPG, PNG, QOI and raw RGB565
+static bool isStill(const String& name) {
+  String lower = name;
+  lower.toLowerCase();
+  return lower.endsWith(".jpg") || lower.endsWith(".jpeg") || lower.endsWith(".png") || lower.endsWith(".qoi") || lower.endsWith(".565");
+}
+static bool isGif(const String& name) {
+  String lower = name;
+  lower.toLowerCase();
+  return lower.endsWith(".gif");
+}
+
+String sidecarPath(const String& path) { return path + ".tdm"; }
+
+// "/jpg/a.jpg" -> "/thumb/jpg/a.jpg", "/gif/b.gif" -> "/thumb/gif/b.gif.jpg":
+// the full name stays, so a.jpg and a.qoi don't share a preview
+String thumbPath(const String& path) {
+  String lower = path;
+  lower.toLowerCase();
+  return String("/thumb") + path + (lower.endsWith(".jpg") ? "" : ".jpg");
+}
+
+bool meta(const String& path, Meta& out) {
+  File f = FFat.open(sidecarPath(path), "r");
+  if (!f) return false;
+  uint8_t buf[4 + sizeof(Meta)];
+  const bool ok = f.read(buf, sizeof(buf)) == sizeof(buf) && memcmp(buf, "TDM1", 4) == 0;
+  f.close();
+  if (!ok) return false;
+  memcpy(&out, buf + 4, sizeof(Meta));   // ESP32 is little-endian
+
+  File m = FFat.open(path, "r");
+  const uint32_t sz = m ? (uint32_t)m.size() : 0;
+  if (m) m.close();
+  return sz == out.size;
+}
+
+void invalidate() {
+  if (FFat.exists(GALLERY_INDEX_PATH)) FFat.remove(GALLERY_INDEX_PATH);
+}
+
+static void take(const String& path, const Meta& m, std::vector<String>& jpgs, std::vector<String>& gifs) {
+  if (m.flags & F_GIF) gifs.push_back(path);
+  else if (!(m.flags & F_PROGRESSIVE)) jpgs.push_back(path);
+}
+
+static bool readIndex(std::vector<String>& jpgs, std::vector<String>& gifs) {
+  File f = FFat.open(GALLERY_INDEX_PATH, "r");
+  if (!f) return false;
+  const size_t sz = f.size();
+  if (sz < 12 || sz > GALLERY_INDEX_MAX) { f.close(); return false; }
+  std::vector<uint8_t> buf(sz);
+  const bool ok = f.read(buf.data(), sz) == sz;
+  f.close();
+
+  const uint32_t n = ok ? rd32(&buf[4]) : 0;
+  const uint32_t pathsOff = ok ? rd32(&buf[8]) : 0;
+  if (!ok || memcmp(buf.data(), "TDG1", 4) != 0 || 12 + (uint64_t)n * sizeof(Entry) > pathsOff || pathsOff > sz) {
+    Serial.println("[Gallery] gallery.idx invalid; rescanning.");
+    return false;
+  }
+  const char* paths = (const char*)&buf[pathsOff];
+  const size_t pathsLen = sz - pathsOff;
+  for (uint32_t i = 0; i < n; ++i) {
+    Entry e;
+    memcpy(&e, &buf[12 + i * sizeof(Entry)], sizeof(e));
+    if (e.off >= pathsLen || !memchr(paths + e.off, 0, pathsLen - e.off)) return false;
+    take(String(paths + e.off), e.m, jpgs, gifs);
+  }
+  return true;
+}
+
+static void scanDir(const char* dir, bool gif, std::vector<String>& paths) {
+  File d = FFat.open(dir);
+  if (!d || !d.isDirectory()) return;
+  File f = d.openNextFile();
+  while (f) {
+    if (!f.isDirectory()) {
+      const String name = String(f.name());
+      if (gif ? isGif(name) : isStill(name)) paths.push_back(String(dir) + "/" + name);
+    }
+    f = d.openNextFile();
+  }
+  d.close();
+}
+
+static void writeIndex(const std::vector<String>& paths, const std::vector<Meta>& metas) {
+  const uint32_t n = (uint32_t)paths.size();
+  const uint32_t pathsOff = 12 + n * sizeof(Entry);
+
+  File f = FFat.open(GALLERY_INDEX_TMP, FILE_WRITE);
+  if (!f) return;
+  uint8_t hdr[12];
+  memcpy(hdr, "TDG1", 4);
+  wr32(hdr + 4, n);
+  wr32(hdr + 8, pathsOff);
+  bool ok = f.write(hdr, sizeof(hdr)) == sizeof(hdr);
+  uint32_t off = 0;
+  for (uint32_t i = 0; ok && i < n; ++i) {
+    Entry e = { off, metas[i] };
+    ok = f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+    off += paths[i].length() + 1;
+  }
+  for (uint32_t i = 0; ok && i < n; ++i)
+    ok = f.write((const uint8_t*)paths[i].c_str(), paths[i].length() + 1) == paths[i].length() + 1;
+  f.close();
+
+  if (ok) {
+    invalidate();
+    ok = FFat.rename(GALLERY_INDEX_TMP, GALLERY_INDEX_PATH);
+  }
+  if (!ok) FFat.remove(GALLERY_INDEX_TMP);
+}
+
+void load(std::vector<String>& jpgs, std::vector<String>& gifs) {
+  jpgs.clear();
+  gifs.clear();
+  if (readIndex(jpgs, gifs)) return;
+  jpgs.clear();
+  gifs.clear();
+
+  std::vector<String> paths;
+  scanDir("/jpg", false, paths);
+  scanDir("/gif", true, paths);
+  std::sort(paths.begin(), paths.end(), [](const String& a, const String& b) { return strcmp(a.c_str(), b.c_str()) < 0; });
+
+  std::vector<Meta> metas;
+  metas.reserve(paths.size());
+  for (auto& p : paths) {
+    Meta m;
+    if (!meta(p, m)) {
+      // No sidecar (uploaded through FileMan): size and type only
+      const bool gif = p.startsWith("/gif/");
+      File f = FFat.open(p, "r");
+      m = Meta{ f ? (uint32_t)f.size() : 0, 0, 0, (uint16_t)(gif ? 0 : 1), (uint16_t)(gif ? F_GIF : 0), 0 };
+      if (f) f.close();
+    }
+    metas.push_back(m);
+    take(p, m, jpgs, gifs);
+  }
+  writeIndex(paths, metas);
+  Serial.printf("[Gallery] indexed %u files\n", (unsigned)paths.size());
+}
+
+} // namespace GalleryIndex
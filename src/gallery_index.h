@@ -0,0 +1,34 @@
+// gallery_index.h
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// Gallery index: /gallery.idx lists the slideshow files so ImageDisplay does
+// not walk /jpg and /gif on every refresh. host/ffat/tdmkffat writes it into
+// the FATFS image together with a .tdm sidecar per gallery file and /thumb/
+// previews; after FileMan changes the gallery the device rebuilds it once from
+// the directories and the sidecars.
+namespace GalleryIndex {
+    enum : uint16_t {
+        F_GIF         = 1 << 0,
+        F_PROGRESSIVE = 1 << 1,   // progressive JPG: TJpgDec can't draw it
+        F_THUMB       = 1 << 2,   // thumbPath() exists
+    };
+
+    struct Meta {                 // the sidecar, also one index entry
+        uint32_t size;            // of the media file; a mismatch means stale
+        uint16_t width, height;
+        uint16_t frames;          // 1 for JPG
+        uint16_t flags;
+        uint32_t durationMs;      // one GIF loop
+    };
+
+    // Fills the slideshow lists from /gallery.idx, or scans and rewrites it.
+    void load(std::vector<String>& jpgs, std::vector<String>& gifs);
+    void invalidate();            // after an upload or delete
+
+    // Sidecar metadata for a gallery file; false if none or stale.
+    bool meta(const String& path, Meta& out);
+    String sidecarPath(const String& path);
+    String thumbPath(const String& path);
+}
@@ -5,12 +5,25 @@
 #include <algorithm>
 #include <AnimatedGIF.h>
 #include <FFat.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <LovyanGFX.hpp>
 #include "esp_heap_caps.h"
 #include "disp_cfg.h"
+#include "gallery_index.h"
+#include "jpeg_dec.h"
+#include "jpeg_kernels.h"
+#include "kenburns.h"
+#include "panel_clock.h"
+#include "png_dec.h"
+#include "qoi_dec.h"
+#include "td565.h"
 #include <WiFi.h>
 #include <esp_system.h>
 #include <ctime>
+#include <string.h>
 
 class LGFX;
 
@@ -37,8 +50,10 @@ struct RAMGIFHandle {
     size_t pos;
 };
 static RAMGIFHandle* s_gifHandle = nullptr;
+static int s_gifX = 0, s_gifY = 0;   // canvas offset, centred on the panel
 
 static bool imageDone = false;
+static FrameHook s_frameHook = nullptr;
 
 void removeFromPlaylist(const String& path) {
     auto removeIt = [&](std::vector<String>& list) {
@@ -50,6 +65,7 @@ void removeFromPlaylist(const String& path) {
 }
 
 void setPaused(bool p) { paused = p; }
+void setFrameHook(FrameHook hook) { s_frameHook = hook; }
 
 void drawNoImagesMessage(LGFX* tft) {
     tft->fillScreen(TFT_BLACK);
@@ -122,23 +138,524 @@ int32_t GIFSeekRAM(GIFFILE* pFile, int32_t iPosition) {
 }
 
 // --- GIF draw callback ---
+// Frames may cover only part of the canvas (tdasset crops each one to what
+// changed), so lines are placed by the canvas offset plus the frame's own.
 void gifDraw(GIFDRAW* pDraw) {
     if (!_tft || !pDraw || !pDraw->pPalette || !pDraw->pPixels) return;
-    int x_offset = (_tft->width() - pDraw->iWidth) / 2;
-    int y_offset = (_tft->height() - pDraw->iHeight) / 2;
-    int16_t y = pDraw->iY + pDraw->y;
-    if (y < 0 || y >= _tft->height() || pDraw->iX >= _tft->width() || pDraw->iWidth < 1) return;
+    int16_t y = s_gifY + pDraw->iY + pDraw->y;
+    int x0 = s_gifX + pDraw->iX;
+    if (y < 0 || y >= _tft->height() || x0 >= _tft->width() || pDraw->iWidth < 1) return;
     static uint16_t lineBuffer[480];
-    for (int x = 0; x < pDraw->iWidth; x++) {
-        lineBuffer[x] = pDraw->pPalette[pDraw->pPixels[x]];
+    const int w = pDraw->iWidth < 480 ? pDraw->iWidth : 480;
+    const uint8_t* px = pDraw->pPixels;
+    if (!pDraw->ucHasTransparency) {
+        for (int x = 0; x < w; x++) {
+            lineBuffer[x] = pDraw->pPalette[px[x]];
+        }
+        _tft->pushImage(x0, y, w, 1, lineBuffer);
+        return;
+    }
+    // Transparent pixels leave the panel as it is: push the opaque runs
+    const uint8_t t = pDraw->ucTransparent;
+    int x = 0;
+    while (x < w) {
+        while (x < w && px[x] == t) x++;
+        int start = x;
+        while (x < w && px[x] != t) {
+            lineBuffer[x - start] = pDraw->pPalette[px[x]];
+            x++;
+        }
+        if (x > start) _tft->pushImage(x0 + start, y, x - start, 1, lineBuffer);
+    }
+}
+
+// --- Raw stills (.qoi, .565) ---
+// Pixels reach the panel in blocks of STILL_ROWS full-width rows from one
+// buffer in internal, DMA-capable RAM: one pushImage() per block.
+#define STILL_ROWS 16
+static uint16_t* s_rowBuf = nullptr;
+static uint16_t* s_bandBuf = nullptr;   // the second core's, for JPEG bands
+
+static uint16_t* stripBuffer(uint16_t*& buf) {
+    if (!buf) {
+        buf = (uint16_t*)heap_caps_malloc(480 * STILL_ROWS * sizeof(uint16_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!buf) buf = (uint16_t*)heap_caps_malloc(480 * STILL_ROWS * sizeof(uint16_t), MALLOC_CAP_8BIT);
+    }
+    return buf;
+}
+
+static uint16_t* rowBuffer() { return stripBuffer(s_rowBuf); }
+
+struct StillPos { int x, y, w; };
+
+static void pushStrip(int y, int rows, const uint16_t* px, void* user) {
+    const StillPos* p = static_cast<const StillPos*>(user);
+    _tft->pushImage(p->x, p->y + y, p->w, rows, px);
+}
+
+// QOI held in RAM, decoded a strip at a time, centred
+static bool drawQoi(const uint8_t* data, size_t len) {
+    qoi::Info info;
+    if (!qoi::parseHeader(data, len, info) || info.width > 480 || info.height > 480) return false;
+    uint16_t* buf = rowBuffer();
+    if (!buf) return false;
+    StillPos pos{ (_tft->width() - (int)info.width) / 2, (_tft->height() - (int)info.height) / 2, (int)info.width };
+    return qoi::decode(data, len, buf, 480 * STILL_ROWS / info.width, pushStrip, &pos);
+}
+
+// .565 straight from FFat: rows are read into the block buffer and pushed,
+// nothing is decoded. A still is one frame; animations play once.
+static bool playRaw565(File& f) {
+    td565::Header h;
+    if (f.read((uint8_t*)&h, sizeof(h)) != sizeof(h) || memcmp(h.magic, td565::kMagic, 4) != 0 ||
+        h.width == 0 || h.width > 480 || h.height > 480) return false;
+    uint16_t* buf = rowBuffer();
+    if (!buf) return false;
+    const int ox = (_tft->width() - h.width) / 2, oy = (_tft->height() - h.height) / 2;
+    for (uint16_t i = 0; i < h.frames; i++) {
+        const unsigned long start = millis();
+        td565::Frame fr;
+        if (f.read((uint8_t*)&fr, sizeof(fr)) != sizeof(fr) || fr.w == 0 ||
+            fr.x + fr.w > h.width || fr.y + fr.h > h.height) return false;
+        const int rowsPer = 480 * STILL_ROWS / fr.w;
+        for (int y = 0; y < fr.h; y += rowsPer) {
+            const int rows = (fr.h - y < rowsPer) ? fr.h - y : rowsPer;
+            const size_t bytes = (size_t)fr.w * rows * sizeof(uint16_t);
+            if ((size_t)f.read((uint8_t*)buf, bytes) != bytes) return false;
+            _tft->pushImage(ox + fr.x, oy + fr.y + y, fr.w, rows, buf);
+        }
+        if (h.frames > 1) {
+            PanelClock::activity();   // keeps the panel at full rate while it plays
+            if (s_frameHook && s_frameHook()) break;
+            const unsigned long spent = millis() - start;
+            if (spent < fr.delayMs) delay(fr.delayMs - spent);
+            yield();
+        }
+    }
+    return true;
+}
+
+// --- JPEG on both cores ---
+// A JPEG with restart markers at MCU rows (tdasset writes them) is cut into
+// two bands: the top one decodes here, the bottom one in a task on core 0,
+// below the WiFi and AsyncTCP tasks so it only takes their idle time. Strips
+// from both reach the panel under a lock. Anything else goes to drawJpg().
+static jpeg::Image s_jpeg;
+static StillPos s_jpegPos;
+static SemaphoreHandle_t s_bandGo = nullptr, s_bandDone = nullptr, s_panelLock = nullptr;
+static bool s_bandTask = false;
+
+struct JpegBand { int row0, row1; uint16_t* strip; bool ok; };
+static JpegBand s_band;
+
+static void lockedPushStrip(int y, int rows, const uint16_t* px, void* user) {
+    xSemaphoreTake(s_panelLock, portMAX_DELAY);
+    pushStrip(y, rows, px, user);
+    xSemaphoreGive(s_panelLock);
+}
+
+static void jpegBandTask(void*) {
+    for (;;) {
+        xSemaphoreTake(s_bandGo, portMAX_DELAY);
+        s_band.ok = s_jpeg.decodeRows(s_band.row0, s_band.row1, s_band.strip, lockedPushStrip, &s_jpegPos);
+        xSemaphoreGive(s_bandDone);
+    }
+}
+
+static bool startBandTask() {
+    if (s_bandTask) return true;
+    if (!s_panelLock) s_panelLock = xSemaphoreCreateMutex();
+    if (!s_bandGo) s_bandGo = xSemaphoreCreateBinary();
+    if (!s_bandDone) s_bandDone = xSemaphoreCreateBinary();
+    if (!s_panelLock || !s_bandGo || !s_bandDone) return false;
+    s_bandTask = xTaskCreatePinnedToCore(jpegBandTask, "jpg_band", 6144, nullptr, 1, nullptr, 0) == pdPASS;
+    return s_bandTask;
+}
+
+bool drawJpgWith(const uint8_t* data, size_t len, JpegPath path) {
+    if (!_tft) return false;
+    if (path == JPEG_TJPGD) return _tft->drawJpg(data, len, 0, 0);
+    if (!s_jpeg.parse(data, len)) return false;
+    s_jpeg.setKernels(path == JPEG_ONE_CORE_SCALAR ? jpeg::scalarKernels() : jpeg::defaultKernels());
+    const jpeg::Info& info = s_jpeg.info();
+    if (info.width > 480 || info.height > 480) return false;
+    uint16_t* strip = rowBuffer();
+    if (!strip) return false;
+    s_jpegPos = StillPos{ 0, 0, (int)info.width };   // where drawJpg() puts it
+    const int split = path == JPEG_TWO_CORES ? s_jpeg.splitRow(1, 2) : 0;
+    if (split == 0 || !stripBuffer(s_bandBuf) || !startBandTask())
+        return s_jpeg.decodeRows(0, info.mcuRows, strip, pushStrip, &s_jpegPos);
+    s_band = JpegBand{ split, info.mcuRows, s_bandBuf, false };
+    xSemaphoreGive(s_bandGo);
+    const bool ok = s_jpeg.decodeRows(0, split, strip, lockedPushStrip, &s_jpegPos);
+    xSemaphoreTake(s_bandDone, portMAX_DELAY);
+    return ok && s_band.ok;
+}
+
+static void drawJpgBuffer(const uint8_t* data, size_t len) {
+    if (s_jpeg.parse(data, len) && s_jpeg.splitRow(1, 2) > 0 && drawJpgWith(data, len, JPEG_TWO_CORES)) return;
+    _tft->drawJpg(data, len, 0, 0);
+}
+
+// --- PNG stills ---
+// Streamed from FFat: png_dec inflates through its 32 KB window and hands
+// over one RGBA row at a time, which is blended into the block buffer on
+// top of the backdrop and pushed every STILL_ROWS rows.
+static png::Decoder* s_png = nullptr;
+static int32_t s_pngBackdrop = 0x0000;
+
+struct PngOut {
+    int x, y, w, h;
+    int rowsPer, row0, rows;
+    bool alpha;
+    uint16_t* buf;
+};
+
+static size_t pngRead(uint8_t* buf, size_t len, void* user) {
+    return static_cast<File*>(user)->read(buf, len);
+}
+
+static void pngRow(int y, const uint8_t* rgba, void* user) {
+    PngOut* o = static_cast<PngOut*>(user);
+    if (y == o->row0) {   // new block: lay down what shows through
+        o->rows = (o->h - y < o->rowsPer) ? o->h - y : o->rowsPer;
+        if (o->alpha && s_pngBackdrop == PNG_OVER_PREVIOUS) {
+            _tft->readRect(o->x, o->y + y, o->w, o->rows, o->buf);
+        } else if (o->alpha) {
+            const uint16_t c = (uint16_t)s_pngBackdrop;
+            const uint16_t be = (uint16_t)((c >> 8) | (c << 8));
+            const size_t n = (size_t)o->w * o->rows;
+            for (size_t i = 0; i < n; i++) o->buf[i] = be;
+        }
+    }
+    png::blend565(rgba, o->w, o->buf + (size_t)(y - o->row0) * o->w);
+    if (y + 1 == o->row0 + o->rows) {
+        _tft->pushImage(o->x, o->y + o->row0, o->w, o->rows, o->buf);
+        o->row0 += o->rows;
     }
-    _tft->pushImage(x_offset + pDraw->iX, y_offset + y, pDraw->iWidth, 1, lineBuffer);
 }
 
+static bool drawPng(File& f) {
+    if (!s_png) s_png = new png::Decoder();
+    if (!s_png->begin(pngRead, &f)) {
+        Serial.printf("[ImageDisplay] PNG: %s\n", s_png->error());
+        return false;
+    }
+    const png::Info& info = s_png->info();
+    if (info.width > 480 || info.height > 480) {
+        Serial.printf("[ImageDisplay] PNG %ux%u is larger than the panel\n", info.width, info.height);
+        return false;
+    }
+    uint16_t* buf = rowBuffer();
+    if (!buf) return false;
+    PngOut out{ (_tft->width() - (int)info.width) / 2, (_tft->height() - (int)info.height) / 2,
+                (int)info.width, (int)info.height, 480 * STILL_ROWS / (int)info.width, 0, 0, info.alpha, buf };
+    if (!s_png->decode(pngRow, &out)) {
+        Serial.printf("[ImageDisplay] PNG: %s\n", s_png->error());
+        return false;
+    }
+    return true;
+}
+
+void setPngBackdrop(int32_t backdrop) {
+    if (backdrop != PNG_OVER_PREVIOUS) backdrop &= 0xFFFF;
+    s_pngBackdrop = backdrop;
+    Preferences prefs;
+    prefs.begin("type_d", false);
+    prefs.putInt("png_bg", backdrop);
+    prefs.end();
+}
+
+int32_t getPngBackdrop() { return s_pngBackdrop; }
+
 void closeGif() {
     gif.close();
 }
 
+// --- Streamed stills (POST /api/show) ---
+// The first bytes are read to tell QOI from JPEG and then handed back to the
+// decoder ahead of the rest of the stream.
+struct StreamIn {
+    StreamReadFn read;
+    void* user;
+    uint8_t head[4];
+    size_t headLen, headPos;
+    int32_t pos;
+    bool stopped;   // the frame hook wants the screen: reads as the end
+};
+
+// Between strips: once the frame hook says stop, the decoder runs out of data
+static void streamHook(StreamIn* in) {
+    if (!in->stopped && s_frameHook && s_frameHook()) in->stopped = true;
+}
+
+static size_t streamRead(uint8_t* buf, size_t len, void* user) {
+    StreamIn* in = static_cast<StreamIn*>(user);
+    if (in->stopped) return 0;
+    size_t n = 0;
+    while (n < len && in->headPos < in->headLen) buf[n++] = in->head[in->headPos++];
+    if (n < len) n += in->read(buf + n, len - n, in->user);
+    in->pos += (int32_t)n;
+    return n;
+}
+
+// TJpgDec only reads forward, so skip() and seek() read and discard
+struct StreamJpeg : public lgfx::DataWrapper {
+    StreamIn* in;
+    int read(uint8_t* buf, uint32_t len) override {
+        streamHook(in);   // TJpgDec refills its input between MCUs
+        return (int)streamRead(buf, len, in);
+    }
+    void skip(int32_t offset) override {
+        uint8_t tmp[64];
+        while (offset > 0) {
+            const size_t n = streamRead(tmp, offset < 64 ? offset : 64, in);
+            if (!n) break;
+            offset -= n;
+        }
+    }
+    bool seek(uint32_t offset) override {
+        if ((int32_t)offset < in->pos) return false;
+        skip(offset - in->pos);
+        return in->pos == (int32_t)offset;
+    }
+    void close() override {}
+    int32_t tell() override { return in->pos; }
+};
+
+struct StreamStrip {
+    StillPos pos;
+    uint32_t t0, firstUs;
+    StreamIn* in;
+};
+
+static void streamStrip(int y, int rows, const uint16_t* px, void* user) {
+    StreamStrip* s = static_cast<StreamStrip*>(user);
+    pushStrip(y, rows, px, &s->pos);
+    if (!s->firstUs) s->firstUs = micros() - s->t0;
+    streamHook(s->in);
+}
+
+bool drawStream(StreamReadFn read, void* user, const char** format, uint32_t* firstPixelsUs) {
+    if (format) *format = "unknown";
+    if (firstPixelsUs) *firstPixelsUs = 0;
+    if (!_tft) return false;
+    const uint32_t t0 = micros();
+    StreamIn in{ read, user, {0}, 0, 0, 0, false };
+    while (in.headLen < sizeof(in.head)) {
+        const size_t n = read(in.head + in.headLen, sizeof(in.head) - in.headLen, user);
+        if (!n) return false;
+        in.headLen += n;
+    }
+    closeGif();
+    freeRamGifHandle();
+    currentIsGif = false;
+    PanelClock::activity();
+
+    if (memcmp(in.head, "qoif", 4) == 0) {
+        if (format) *format = "qoi";
+        qoi::Stream q;
+        if (!q.begin(streamRead, &in)) return false;
+        const qoi::Info& info = q.info();
+        uint16_t* buf = rowBuffer();
+        if (info.width > 480 || info.height > 480 || !buf) return false;
+        _tft->fillScreen(TFT_BLACK);
+        StreamStrip out{ { (_tft->width() - (int)info.width) / 2, (_tft->height() - (int)info.height) / 2, (int)info.width }, t0, 0, &in };
+        const bool ok = q.decode(buf, 480 * STILL_ROWS / info.width, streamStrip, &out);
+        if (firstPixelsUs) *firstPixelsUs = out.firstUs;
+        lastImageChange = millis();
+        return ok;
+    }
+    if (in.head[0] == 0xFF && in.head[1] == 0xD8) {
+        if (format) *format = "jpeg";
+        _tft->fillScreen(TFT_BLACK);
+        StreamJpeg data;
+        data.in = &in;
+        const bool ok = _tft->drawJpg(&data, 0, 0);   // where drawJpg() puts gallery JPGs
+        lastImageChange = millis();
+        return ok;
+    }
+    return false;
+}
+
+// Screen-cast frames stay on this core: the other one is receiving the next
+bool drawCastFrame(const uint8_t* data, size_t len) {
+    if (!_tft) return false;
+    PanelClock::activity();
+    if (currentIsGif) {
+        closeGif();
+        freeRamGifHandle();
+        currentIsGif = false;
+    }
+    lastImageChange = millis();
+    return drawJpgWith(data, len, JPEG_ONE_CORE) || _tft->drawJpg(data, len, 0, 0);
+}
+
+// --- Ken Burns slideshow (MODE_KENBURNS) ---
+// Each still is decoded once into a PSRAM canvas, then every frame is
+// resampled from it (kenburns.cpp) and pushed in STILL_ROWS strips. Frames
+// start on a vsync and go top to bottom, behind the scan-out. A JPEG much
+// larger than the panel is decoded by TJpgDec at 1/2, 1/4 or 1/8 scale,
+// which drops DCT coefficients rather than pixels: the smallest scale that
+// still leaves the short side KB_ZOOM_PCT% of the panel. Others go through
+// jpeg_dec or qoi_dec at full size. Those two give the frame hook a turn
+// between strips and stop there if it wants the screen; resume() decodes
+// the still again.
+static uint16_t* s_kbCanvas = nullptr;
+static int s_kbW = 0, s_kbH = 0;
+static bool s_kbLoaded = false;
+static bool s_kbStopped = false;   // the frame hook cut the last decode short
+static kb::Motion s_kbMotion;
+static uint32_t s_kbStartMs = 0, s_kbFrameMs = 0, s_kbVsync = 0;
+
+struct CanvasSink { uint16_t* px; int w; };
+
+static void canvasStrip(int y, int rows, const uint16_t* px, void* user) {
+    const CanvasSink* c = static_cast<const CanvasSink*>(user);
+    memcpy(c->px + (size_t)y * c->w, px, (size_t)rows * c->w * sizeof(uint16_t));
+    if (!s_kbStopped && s_frameHook && s_frameHook()) s_kbStopped = true;
+}
+
+// A QOI in PSRAM fed to qoi::Stream, which stops when the reads do
+struct KbQoiIn { const uint8_t* data; size_t len, pos; };
+
+static size_t kbQoiRead(uint8_t* buf, size_t len, void* user) {
+    KbQoiIn* in = static_cast<KbQoiIn*>(user);
+    if (s_kbStopped) return 0;
+    const size_t n = len < in->len - in->pos ? len : in->len - in->pos;
+    memcpy(buf, in->data + in->pos, n);
+    in->pos += n;
+    return n;
+}
+
+static uint8_t* readToPsram(const String& path, size_t& size) {
+    File f = FFat.open(path, "r");
+    size = f ? f.size() : 0;
+    uint8_t* buf = size ? (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM) : nullptr;
+    if (buf && (size_t)f.read(buf, size) != size) {
+        heap_caps_free(buf);
+        buf = nullptr;
+    }
+    if (f) f.close();
+    return buf;
+}
+
+// Decodes a JPG or QOI into the canvas; false for anything else
+static bool kenBurnsDecode(const uint8_t* data, size_t len) {
+    const int minSide = 480 * KB_ZOOM_PCT / 100;
+    uint16_t* strip = nullptr;
+    bool ok = false;
+    qoi::Info qi;
+    if (s_jpeg.parse(data, len)) {
+        const int w = s_jpeg.info().width, h = s_jpeg.info().height;
+        int shift = 0;
+        while (shift < 3 && ((w < h ? w : h) >> (shift + 1)) >= minSide) shift++;
+        while (shift < 3 && (size_t)(w >> shift) * (h >> shift) > KB_CANVAS_PIXELS) shift++;
+        s_kbW = w >> shift;
+        s_kbH = h >> shift;
+        if ((size_t)s_kbW * s_kbH > KB_CANVAS_PIXELS) return false;
+        if (shift == 0) {
+            strip = (uint16_t*)heap_caps_malloc(s_jpeg.stripPixels() * sizeof(uint16_t), MALLOC_CAP_8BIT);
+            CanvasSink sink{ s_kbCanvas, s_kbW };
+            s_jpeg.setKernels(jpeg::defaultKernels());
+            // A band per restart interval, so a stop doesn't wait for the rest
+            const int rows = s_jpeg.info().mcuRows;
+            ok = strip != nullptr;
+            for (int row = 0; ok && row < rows && !s_kbStopped;) {
+                int end = row + 1;
+                while (end < rows && !s_jpeg.canStartAt(end)) end++;
+                ok = s_jpeg.decodeRows(row, end, strip, canvasStrip, &sink);
+                row = end;
+            }
+            ok = ok && !s_kbStopped;
+        } else {
+            lgfx::LGFX_Sprite canvas;
+            canvas.setColorDepth(16);
+            canvas.setBuffer(s_kbCanvas, s_kbW, s_kbH, 16);
+            const float scale = 1.0f / (1 << shift);
+            ok = canvas.drawJpg(data, len, 0, 0, s_kbW, s_kbH, 0, 0, scale, scale);
+        }
+    } else if (qoi::parseHeader(data, len, qi) && (size_t)qi.width * qi.height <= KB_CANVAS_PIXELS) {
+        s_kbW = qi.width;
+        s_kbH = qi.height;
+        strip = (uint16_t*)heap_caps_malloc((size_t)s_kbW * STILL_ROWS * sizeof(uint16_t), MALLOC_CAP_8BIT);
+        CanvasSink sink{ s_kbCanvas, s_kbW };
+        KbQoiIn in{ data, len, 0 };
+        qoi::Stream q;
+        ok = strip && q.begin(kbQoiRead, &in) && q.decode(strip, STILL_ROWS, canvasStrip, &sink) && !s_kbStopped;
+    }
+    if (strip) heap_caps_free(strip);
+    return ok;
+}
+
+static void kenBurnsFrame() {
+    uint16_t* strip = rowBuffer();
+    if (!strip) return;
+    PanelClock::activity();
+    const kb::View v = s_kbMotion.at((millis() - s_kbStartMs) / (float)KB_SLIDE_MS, 480);
+    for (int y = 0; y < 480; y += STILL_ROWS) {
+        kb::render(s_kbCanvas, s_kbW, s_kbH, v, 480, y, STILL_ROWS, strip, KB_BILINEAR);
+        _tft->pushImage(0, y, 480, STILL_ROWS, strip);
+    }
+}
+
+// Starts a slide; what can't be decoded to the canvas is shown as a still
+static void kenBurnsShow(const String& path) {
+    if (!s_kbCanvas) s_kbCanvas = (uint16_t*)heap_caps_malloc(KB_CANVAS_PIXELS * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    s_kbLoaded = false;
+    s_kbStopped = false;
+    size_t size = 0;
+    uint8_t* data = s_kbCanvas ? readToPsram(path, size) : nullptr;
+    if (data) {
+        const uint32_t t0 = millis();
+        s_kbLoaded = kenBurnsDecode(data, size);
+        heap_caps_free(data);
+        if (s_kbLoaded)
+            Serial.printf("[ImageDisplay] Ken Burns %s: %dx%d canvas in %lu ms\n", path.c_str(), s_kbW, s_kbH,
+                          (unsigned long)(millis() - t0));
+    }
+    if (s_kbStopped) {
+        s_kbStartMs = millis();   // resume() picks the slide up again
+        return;
+    }
+    if (!s_kbLoaded) displayImage(path);
+    s_kbStartMs = millis();
+    lastImageChange = s_kbStartMs;
+    if (s_kbLoaded) {
+        closeGif();
+        freeRamGifHandle();
+        currentIsGif = false;
+        s_kbMotion = kb::plan(s_kbW, s_kbH, KB_ZOOM_PCT, rng());
+        kenBurnsFrame();
+    }
+}
+
+static void kenBurnsStop() {
+    s_kbLoaded = false;
+    if (s_kbCanvas) heap_caps_free(s_kbCanvas);
+    s_kbCanvas = nullptr;
+}
+
+static void kenBurnsUpdate() {
+    if (jpgList.empty()) return;
+    if (millis() - s_kbStartMs >= KB_SLIDE_MS || (!s_kbLoaded && !s_kbStartMs)) {
+        imgIndex = (imgIndex + 1) % jpgList.size();
+        kenBurnsShow(jpgList[imgIndex]);
+        return;
+    }
+    if (!s_kbLoaded) return;
+    // On the first poll after every KB_VSYNC_DIV-th vsync, or by the clock
+    const uint32_t vs = PanelClock::vsyncs();
+    if (vs) {
+        if (vs - s_kbVsync < KB_VSYNC_DIV) return;
+        s_kbVsync = vs;
+    } else if (millis() - s_kbFrameMs < 1000 / KB_FPS) {
+        return;
+    }
+    s_kbFrameMs = millis();
+    kenBurnsFrame();
+}
+
 void begin(LGFX* tft) {
     _tft = tft;
     if (!seeded) {
@@ -147,11 +664,22 @@ void begin(LGFX* tft) {
     }
     refreshFileLists();
     currentMode = MODE_RANDOM;
+
+    Preferences prefs;
+    prefs.begin("type_d", true);
+    s_pngBackdrop = prefs.getInt("png_bg", 0x0000);
+    prefs.end();
 }
 
 void setMode(Mode m) {
+    if (currentMode == MODE_KENBURNS && m != MODE_KENBURNS) kenBurnsStop();
     currentMode = m;
     imgIndex = 0;
+    if (m == MODE_KENBURNS) {
+        refreshFileLists();
+        s_kbStartMs = 0;   // the next update() starts a slide
+        s_kbLoaded = false;
+    }
 }
 
 Mode getMode() {
@@ -159,38 +687,7 @@ Mode getMode() {
 }
 
 void refreshFileLists() {
-    jpgList.clear();
-    gifList.clear();
-
-    File jpgDir = FFat.open("/jpg");
-    if (jpgDir && jpgDir.isDirectory()) {
-        File f = jpgDir.openNextFile();
-        while (f) {
-            if (!f.isDirectory()) {
-                String fn = String(f.name());
-                fn.toLowerCase();
-                if (fn.endsWith(".jpg") || fn.endsWith(".jpeg")) {
-                    jpgList.push_back(String("/jpg/") + String(f.name()));
-                }
-            }
-            f = jpgDir.openNextFile();
-        }
-    }
-
-    File gifDir = FFat.open("/gif");
-    if (gifDir && gifDir.isDirectory()) {
-        File f = gifDir.openNextFile();
-        while (f) {
-            if (!f.isDirectory()) {
-                String fn = String(f.name());
-                fn.toLowerCase();
-                if (fn.endsWith(".gif")) {
-                    gifList.push_back(String("/gif/") + String(f.name()));
-                }
-            }
-            f = gifDir.openNextFile();
-        }
-    }
+    GalleryIndex::load(jpgList, gifList);
 }
 
 void displayImage(const String& path) {
@@ -198,7 +695,13 @@ void displayImage(const String& path) {
         Serial.println("[ImageDisplay] _tft pointer is NULL!");
         return;
     }
-    _tft->fillScreen(TFT_BLACK);
+    PanelClock::activity();   // full frame rate while the new image goes up
+    String lower = path;
+    lower.toLowerCase();
+    const bool isPng = lower.endsWith(".png");
+
+    if (!isPng) _tft->fillScreen(TFT_BLACK);
+    else if (s_pngBackdrop != PNG_OVER_PREVIOUS) _tft->fillScreen((uint16_t)s_pngBackdrop);
 
     closeGif();
     freeRamGifHandle();
@@ -206,9 +709,6 @@ void displayImage(const String& path) {
     currentIsGif = false;
     imageDone = false;
 
-    String lower = path;
-    lower.toLowerCase();
-
     if (lower.endsWith(".jpg") || lower.endsWith(".jpeg")) {
         File jpgFile = FFat.open(path, "r");
         if (!jpgFile || jpgFile.size() == 0) {
@@ -226,13 +726,61 @@ void displayImage(const String& path) {
             if ((size_t)bytesRead != jpgSize) {
                 Serial.printf("[ImageDisplay] JPG read mismatch: %d != %u\n", bytesRead, jpgSize);
             }
-            _tft->drawJpg(jpgBuffer, jpgSize, 0, 0);
+            drawJpgBuffer(jpgBuffer, jpgSize);
             heap_caps_free(jpgBuffer);
             jpgBuffer = nullptr;
         } else {
             jpgFile.close();
             Serial.println("[ImageDisplay] PSRAM alloc failed!");
         }
+    } else if (lower.endsWith(".qoi")) {
+        File qoiFile = FFat.open(path, "r");
+        if (!qoiFile || qoiFile.size() == 0) {
+            Serial.printf("[ImageDisplay] QOI missing or empty: %s\n", path.c_str());
+            if (qoiFile) qoiFile.close();
+            removeFromPlaylist(path);
+            nextImage();
+            return;
+        }
+        size_t qoiSize = qoiFile.size();
+        uint8_t* qoiBuffer = (uint8_t*)heap_caps_malloc(qoiSize, MALLOC_CAP_SPIRAM);
+        if (qoiBuffer) {
+            int bytesRead = qoiFile.read(qoiBuffer, qoiSize);
+            qoiFile.close();
+            if ((size_t)bytesRead != qoiSize || !drawQoi(qoiBuffer, qoiSize)) {
+                Serial.printf("[ImageDisplay] QOI decode failed: %s\n", path.c_str());
+            }
+            heap_caps_free(qoiBuffer);
+        } else {
+            qoiFile.close();
+            Serial.println("[ImageDisplay] PSRAM alloc failed!");
+        }
+    } else if (lower.endsWith(".565")) {
+        File rawFile = FFat.open(path, "r");
+        if (!rawFile || rawFile.size() == 0) {
+            Serial.printf("[ImageDisplay] 565 missing or empty: %s\n", path.c_str());
+            if (rawFile) rawFile.close();
+            removeFromPlaylist(path);
+            nextImage();
+            return;
+        }
+        if (!playRaw565(rawFile)) {
+            Serial.printf("[ImageDisplay] 565 bad or truncated: %s\n", path.c_str());
+        }
+        rawFile.close();
+    } else if (isPng) {
+        File pngFile = FFat.open(path, "r");
+        if (!pngFile || pngFile.size() == 0) {
+            Serial.printf("[ImageDisplay] PNG missing or empty: %s\n", path.c_str());
+            if (pngFile) pngFile.close();
+            removeFromPlaylist(path);
+            nextImage();
+            return;
+        }
+        if (!drawPng(pngFile)) {
+            Serial.printf("[ImageDisplay] PNG decode failed: %s\n", path.c_str());
+        }
+        pngFile.close();
     } else if (lower.endsWith(".gif")) {
         File f = FFat.open(path, "r");
         if (!f || f.size() == 0) {
@@ -255,10 +803,14 @@ void displayImage(const String& path) {
             s_gifHandle = new RAMGIFHandle{gifBuffer, gifSize, 0};
             gif.begin(GIF_PALETTE_RGB565_BE);
             if (gif.open("", GIFOpenRAM, GIFCloseRAM, GIFReadRAM, GIFSeekRAM, gifDraw)) {
+                s_gifX = (_tft->width() - gif.getCanvasWidth()) / 2;
+                s_gifY = (_tft->height() - gif.getCanvasHeight()) / 2;
                 currentIsGif = true;
                 int startLoop = gif.getLoopCount();
                 int frameDelay = 0;
                 while (gif.playFrame(true, &frameDelay)) {
+                    PanelClock::activity();
+                    if (s_frameHook && s_frameHook()) break;
                     delay(frameDelay);
                     yield();
                     if (gif.getLoopCount() > startLoop) break;
@@ -301,6 +853,15 @@ void displayRandomImage() {
     displayImage(randomStack[imgIndex]);
 }
 
+void resume() {
+    if (currentMode != MODE_KENBURNS) {
+        displayRandomImage();
+        return;
+    }
+    if (s_kbLoaded) kenBurnsFrame();
+    else if (s_kbStartMs && !jpgList.empty()) kenBurnsShow(jpgList[imgIndex % jpgList.size()]);
+}
+
 void displayRandomJpg() {
     refreshFileLists();
     if (jpgList.empty()) return;
@@ -331,6 +892,9 @@ void nextImage() {
     } else if (currentMode == MODE_GIF && !gifList.empty()) {
         imgIndex = (imgIndex + 1) % gifList.size();
         displayImage(gifList[imgIndex]);
+    } else if (currentMode == MODE_KENBURNS && !jpgList.empty()) {
+        imgIndex = (imgIndex + 1) % jpgList.size();
+        kenBurnsShow(jpgList[imgIndex]);
     }
 }
 
@@ -344,6 +908,9 @@ void prevImage() {
     } else if (currentMode == MODE_GIF && !gifList.empty()) {
         imgIndex = (imgIndex - 1 + gifList.size()) % gifList.size();
         displayImage(gifList[imgIndex]);
+    } else if (currentMode == MODE_KENBURNS && !jpgList.empty()) {
+        imgIndex = (imgIndex - 1 + jpgList.size()) % jpgList.size();
+        kenBurnsShow(jpgList[imgIndex]);
     }
 }
 
@@ -353,6 +920,7 @@ void loop() {
 
 void update() {
     if (paused) return; 
+    if (currentMode == MODE_KENBURNS) { kenBurnsUpdate(); return; }
     if (currentMode != MODE_RANDOM) return;
     if (randomStack.empty()) return;   // <-- ADD THIS GUARD LINE
     if (!currentIsGif) {
@@ -361,6 +929,7 @@ void update() {
             displayImage(randomStack[imgIndex]);
         }
     } else {
+        PanelClock::activity();
         int ret = gif.playFrame(false, nullptr);
         if (ret == 0) {
             imgIndex = (imgIndex + 1) % randomStack.size();
@@ -15,7 +15,8 @@ namespace ImageDisplay {
 enum Mode {
     MODE_RANDOM,
     MODE_JPG,
-    MODE_GIF
+    MODE_GIF,
+    MODE_KENBURNS   // stills with a slow pan and zoom (kenburns.h)
 };
 
 void begin(LGFX* tft);
@@ -27,6 +28,10 @@ void refreshFileLists();
 
 void displayImage(const String& path);
 void displayRandomImage();
+// Puts the slideshow back after something covered it (the status overlay,
+// an alert, a held or cast image). Ken Burns redraws the slide from its
+// canvas and carries on; the other modes move to a random image as before.
+void resume();
 void displayRandomJpg();
 void displayRandomGif();
 
@@ -38,6 +43,39 @@ void update();
 void clear();
 void showIdle();
 
+// What transparent PNG pixels show: an RGB565 colour, or PNG_OVER_PREVIOUS
+// to composite onto the image already on the panel. Saved across reboots.
+static const int32_t PNG_OVER_PREVIOUS = -1;
+void setPngBackdrop(int32_t backdrop);
+int32_t getPngBackdrop();
+
+// Ways to draw a JPG held in RAM, for the /diag/jpeg benchmark: LovyanGFX's
+// TJpgDec, jpeg_dec on this core, or jpeg_dec split over both cores (needs
+// restart markers at MCU rows; otherwise it runs on this core). The jpeg_dec
+// paths use the build's default kernels; JPEG_ONE_CORE_SCALAR forces the
+// scalar reference ones for comparison.
+enum JpegPath { JPEG_TJPGD, JPEG_ONE_CORE, JPEG_TWO_CORES, JPEG_ONE_CORE_SCALAR };
+bool drawJpgWith(const uint8_t* data, size_t len, JpegPath path);
+// One screen-cast frame (cast_rx.h): jpeg_dec on the calling core, TJpgDec
+// for what it can't parse. Stops a playing GIF.
+bool drawCastFrame(const uint8_t* data, size_t len);
+
+// Draws a QOI or baseline JPEG as its bytes arrive, for POST /api/show: QOI
+// through qoi::Stream, JPEG through LovyanGFX's TJpgDec. read blocks until
+// data comes and returns 0 at the end. Stops a playing GIF; pausing the
+// slideshow is up to the caller. format gets "qoi", "jpeg" or "unknown";
+// firstPixelsUs the time to the first strip on screen (QOI only, as TJpgDec
+// draws from inside LovyanGFX).
+typedef size_t (*StreamReadFn)(uint8_t* buf, size_t len, void* user);
+bool drawStream(StreamReadFn read, void* user, const char** format, uint32_t* firstPixelsUs);
+
+// Called between the frames of a GIF or .565 played through in
+// displayImage(), between the strips of drawStream() and of a Ken Burns
+// decode; returning true stops it there (alerts.h: an alert wants the
+// screen). drawStream() then returns false.
+typedef bool (*FrameHook)();
+void setFrameHook(FrameHook hook);
+
 const std::vector<String>& getJpgList();
 const std::vector<String>& getGifList();
 
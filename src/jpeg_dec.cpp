@@ -0,0 +1,299 @@
+// jpeg_dec.cpp
+
+#include "jpeg_dec.h"
+#include "jpeg_kernels.h"
+#include <string.h>
+
+namespace jpeg {
+
+static const uint8_t kZigzag[64 + 16] = {
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+  // a corrupt run can step past 63; those land here and are dropped
+  63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+static inline uint16_t rd16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+bool Image::buildHuff(Huff& h, const uint8_t* counts, const uint8_t* values, int n) {
+  if (n > 256) return false;
+  memcpy(h.values, values, n);
+  memset(h.fast, 0, sizeof(h.fast));
+  int32_t code = 0;
+  int k = 0;
+  for (int len = 1; len <= 16; ++len) {
+    const int cnt = counts[len - 1];
+    h.valoff[len] = k - code;
+    for (int i = 0; i < cnt; ++i, ++code, ++k) {
+      if (code >= (1 << len)) return false;   // over-subscribed; would run past fast[]
+      if (len <= 9) {
+        const int shift = 9 - len;
+        for (int j = 0; j < (1 << shift); ++j)
+          h.fast[(code << shift) | j] = (uint16_t)((len << 8) | values[k]);
+      }
+    }
+    h.maxcode[len] = cnt ? code - 1 : -1;
+    code <<= 1;
+  }
+  h.maxcode[17] = 0x7FFFFFFF;              // stops the search on bad data
+  return k == n;
+}
+
+bool Image::parse(const uint8_t* d, size_t len) {
+  data_ = d;
+  len_ = len;
+  err_ = nullptr;
+  info_ = Info{};
+  if (len < 4 || d[0] != 0xFF || d[1] != 0xD8) return fail("not a JPEG");
+  bool haveFrame = false;
+  uint8_t haveDc = 0, haveAc = 0;
+  size_t p = 2;
+  for (;;) {
+    if (p + 4 > len) return fail("truncated");
+    if (d[p] != 0xFF) return fail("bad marker");
+    const uint8_t m = d[p + 1];
+    if (m == 0xFF) { ++p; continue; }
+    const size_t segLen = rd16(d + p + 2);
+    if (segLen < 2 || p + 2 + segLen > len) return fail("truncated");
+    const uint8_t* s = d + p + 4;
+    const size_t n = segLen - 2;
+    if (m == 0xC0 || m == 0xC1) {
+      if (n < 6 || s[0] != 8) return fail("not 8-bit");
+      info_.height = rd16(s + 1);
+      info_.width = rd16(s + 3);
+      info_.components = s[5];
+      if (info_.components != 1 && info_.components != 3) return fail("not greyscale or YCbCr");
+      if (n < 6 + 3u * info_.components) return fail("truncated");
+      for (int c = 0; c < info_.components; ++c) {
+        comp_[c].id = s[6 + c * 3];
+        comp_[c].h = s[7 + c * 3] >> 4;
+        comp_[c].v = s[7 + c * 3] & 15;
+        comp_[c].tq = s[8 + c * 3] & 3;
+      }
+      if (info_.components == 1) {
+        comp_[0].h = comp_[0].v = 1;       // a single-component scan isn't interleaved
+      } else if (comp_[0].h < 1 || comp_[0].h > 2 || comp_[0].v < 1 || comp_[0].v > 2 ||
+                 comp_[1].h != 1 || comp_[1].v != 1 || comp_[2].h != 1 || comp_[2].v != 1) {
+        return fail("unsupported sampling");
+      }
+      info_.hSamp = comp_[0].h;
+      info_.vSamp = comp_[0].v;
+      info_.mcuWidth = 8 * info_.hSamp;
+      info_.mcuHeight = 8 * info_.vSamp;
+      info_.mcusPerRow = (uint16_t)((info_.width + info_.mcuWidth - 1) / info_.mcuWidth);
+      info_.mcuRows = (uint16_t)((info_.height + info_.mcuHeight - 1) / info_.mcuHeight);
+      if (info_.width == 0 || info_.height == 0 || info_.mcuRows > 256) return fail("unsupported size");
+      haveFrame = true;
+    } else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+      return fail("progressive, lossless or arithmetic");
+    } else if (m == 0xDB) {
+      for (size_t q = 0; q < n;) {
+        const int pq = s[q] >> 4, tq = s[q] & 15;
+        if (tq > 3 || q + 1 + 64 * (pq + 1) > n) return fail("bad DQT");
+        for (int i = 0; i < 64; ++i)
+          quant_[tq][kZigzag[i]] = pq ? rd16(s + q + 1 + i * 2) : s[q + 1 + i];
+        q += 1 + 64 * (pq + 1);
+      }
+    } else if (m == 0xC4) {
+      for (size_t q = 0; q < n;) {
+        if (q + 17 > n) return fail("bad DHT");
+        const int tc = s[q] >> 4, th = s[q] & 15;
+        int total = 0;
+        for (int i = 0; i < 16; ++i) total += s[q + 1 + i];
+        if (tc > 1 || th > 1 || q + 17 + total > n) return fail("bad DHT");
+        Huff& h = tc ? ac_[th] : dc_[th];
+        if (!buildHuff(h, s + q + 1, s + q + 17, total)) return fail("bad DHT");
+        (tc ? haveAc : haveDc) |= 1 << th;
+        q += 17 + total;
+      }
+    } else if (m == 0xDD) {
+      if (n < 2) return fail("bad DRI");
+      info_.restartInterval = rd16(s);
+    } else if (m == 0xDA) {
+      if (!haveFrame || n < 1 || s[0] != info_.components || n < 4u + 2 * s[0]) return fail("unsupported scan");
+      for (int c = 0; c < info_.components; ++c) {
+        if (s[1 + c * 2] != comp_[c].id) return fail("unsupported scan");
+        comp_[c].td = s[2 + c * 2] >> 4;
+        comp_[c].ta = s[2 + c * 2] & 15;
+        if (comp_[c].td > 1 || comp_[c].ta > 1 || !(haveDc >> comp_[c].td & 1) || !(haveAc >> comp_[c].ta & 1))
+          return fail("missing Huffman table");
+      }
+      scanStart_ = (uint32_t)(p + 2 + segLen);
+      break;
+    } else if (m == 0xD9) {
+      return fail("no image data");
+    }
+    p += 2 + segLen;
+  }
+
+  // Entry points: row 0, and each row that a restart interval begins
+  memset(rowStart_, 0, sizeof(rowStart_));
+  rowStart_[0] = scanStart_;
+  const uint32_t ri = info_.restartInterval;
+  if (ri) {
+    uint32_t markers = 0;
+    const uint8_t* q = d + scanStart_;
+    const uint8_t* end = d + len - 1;
+    while (q < end) {
+      q = (const uint8_t*)memchr(q, 0xFF, end - q);
+      if (!q) break;
+      const uint8_t nx = q[1];
+      if (nx >= 0xD0 && nx <= 0xD7) {
+        const uint32_t mcu = ++markers * ri;
+        if (mcu % info_.mcusPerRow == 0 && mcu / info_.mcusPerRow < info_.mcuRows)
+          rowStart_[mcu / info_.mcusPerRow] = (uint32_t)(q + 2 - d);
+        q += 2;
+      } else if (nx == 0x00 || nx == 0xFF) {
+        q += 1 + (nx == 0x00);
+      } else {
+        break;                               // EOI
+      }
+    }
+  }
+  return true;
+}
+
+bool Image::canStartAt(int mcuRow) const {
+  return mcuRow >= 0 && mcuRow < info_.mcuRows && rowStart_[mcuRow] != 0;
+}
+
+int Image::splitRow(int k, int parts) const {
+  const int target = (int)info_.mcuRows * k / parts;
+  for (int d = 0; d < info_.mcuRows; ++d) {
+    if (target - d > 0 && canStartAt(target - d)) return target - d;
+    if (target + d < info_.mcuRows && target + d > 0 && canStartAt(target + d)) return target + d;
+  }
+  return 0;
+}
+
+// ---------- entropy decoding ----------
+// MSB-first bit buffer over the scan data. It stops in front of a marker and
+// feeds zeros from there, so after a restart interval pos is left on the RSTn.
+struct Bits {
+  const uint8_t* pos;
+  const uint8_t* end;
+  uint32_t buf;
+  int cnt;
+
+  inline void fill() {
+    while (cnt <= 24) {
+      uint32_t b = 0;
+      if (pos < end) {
+        b = *pos;
+        if (b == 0xFF) {
+          if (pos + 1 < end && pos[1] == 0x00) pos += 2;
+          else b = 0;                        // marker: stay put
+        } else {
+          pos++;
+        }
+      }
+      buf |= b << (24 - cnt);
+      cnt += 8;
+    }
+  }
+  inline int get(int n) {
+    if (cnt < n) fill();
+    const int v = (int)(buf >> (32 - n));
+    buf <<= n;
+    cnt -= n;
+    return v;
+  }
+  inline int decode(const Huff& h) {
+    if (cnt < 16) fill();
+    const uint16_t e = h.fast[buf >> (32 - 9)];
+    if (e) {
+      const int n = e >> 8;
+      buf <<= n;
+      cnt -= n;
+      return e & 0xFF;
+    }
+    int len = 10;
+    while ((int32_t)(buf >> (32 - len)) > h.maxcode[len]) {
+      if (++len > 16) return 0;              // bad code: carry on with zero
+    }
+    const int code = (int)(buf >> (32 - len));
+    buf <<= len;
+    cnt -= len;
+    return h.values[(code + h.valoff[len]) & 0xFF];
+  }
+};
+
+static inline int extend(int v, int n) { return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v; }
+
+// ---------- bands ----------
+bool Image::decodeRows(int row0, int row1, uint16_t* strip, StripFn fn, void* user) const {
+  if (!data_ || !strip || !fn || !canStartAt(row0) || row1 > info_.mcuRows || row1 <= row0) return false;
+  const int ncomp = info_.components, hs = info_.hSamp, vs = info_.vSamp;
+  const int lumaBlocks = hs * vs;
+  const int W = info_.width, H = info_.height;
+  const uint32_t ri = info_.restartInterval;
+  const Kernels& kn = kern_ ? *kern_ : defaultKernels();
+
+  Bits bits{ data_ + rowStart_[row0], data_ + len_, 0, 0 };
+  int pred[3] = { 0, 0, 0 };
+  uint32_t todo = ri;
+  int32_t coef[64];
+  uint8_t ys[16 * 16], cbs[64], crs[64];
+  bool ok = true;
+
+  for (int row = row0; row < row1; ++row) {
+    const int y0 = row * info_.mcuHeight;
+    const int rows = H - y0 < info_.mcuHeight ? H - y0 : info_.mcuHeight;
+    for (int mx = 0; mx < info_.mcusPerRow; ++mx) {
+      if (ri && todo == 0) {
+        // Drop the padding bits; the reader is parked on the RSTn
+        bits.buf = 0;
+        bits.cnt = 0;
+        if (bits.pos + 1 < bits.end && bits.pos[0] == 0xFF && bits.pos[1] >= 0xD0 && bits.pos[1] <= 0xD7) {
+          bits.pos += 2;
+        } else {
+          ok = false;                        // lost sync: resume after the next RSTn
+          while (bits.pos + 1 < bits.end && !(bits.pos[0] == 0xFF && bits.pos[1] >= 0xD0 && bits.pos[1] <= 0xD7)) bits.pos++;
+          if (bits.pos + 1 < bits.end) bits.pos += 2;
+        }
+        pred[0] = pred[1] = pred[2] = 0;
+        todo = ri;
+      }
+      for (int c = 0; c < ncomp; ++c) {
+        const Huff& dc = dc_[comp_[c].td];
+        const Huff& ac = ac_[comp_[c].ta];
+        const uint16_t* q = quant_[comp_[c].tq];
+        const int nb = c == 0 ? lumaBlocks : 1;
+        for (int b = 0; b < nb; ++b) {
+          memset(coef, 0, sizeof(coef));
+          int last = 0;
+          int s = bits.decode(dc);
+          if (s) pred[c] += extend(bits.get(s), s);
+          coef[0] = pred[c] * q[0];
+          for (int k = 1; k < 64; ++k) {
+            const int rs = bits.decode(ac);
+            s = rs & 15;
+            const int run = rs >> 4;
+            if (s == 0) {
+              if (run != 15) break;
+              k += 15;
+              continue;
+            }
+            k += run;
+            const int z = kZigzag[k];
+            coef[z] = extend(bits.get(s), s) * q[z];
+            last = k;
+          }
+          uint8_t* dst = c == 0 ? ys + (b / hs) * 8 * 16 + (b % hs) * 8 : c == 1 ? cbs : crs;
+          kn.idct(coef, last, dst, c == 0 ? 16 : 8);
+        }
+      }
+      const int x0 = mx * info_.mcuWidth;
+      const int w = W - x0 < info_.mcuWidth ? W - x0 : info_.mcuWidth;
+      if (ncomp == 3) kn.ycc(ys, cbs, crs, hs, vs, strip + x0, W, w, rows);
+      else kn.grey(ys, strip + x0, W, w, rows);
+      if (ri) todo--;
+    }
+    fn(y0, rows, strip, user);
+  }
+  return ok;
+}
+
+} // namespace jpeg
@@ -0,0 +1,86 @@
+// jpeg_dec.h
+//
+// Baseline JPEG decoder for gallery stills that can split one image across
+// cores. parse() reads the headers and finds the restart markers (RSTn) that
+// begin an MCU row; decoding can start at any of those rows, so two callers
+// can each decode a band of rows at the same time. tdasset writes a restart
+// marker at every MCU row. Files without them still decode, as one band.
+//
+// Huffman-coded, 8-bit, greyscale or YCbCr with luma sampled 1x1, 2x1, 1x2
+// or 2x2 and chroma 1x1; progressive, arithmetic and 12-bit files are refused.
+// The IDCT is libjpeg's accurate integer one, chroma is replicated (not
+// smoothed) and colours are converted with libjpeg's fixed-point factors, so
+// output matches libjpeg with do_fancy_upsampling off before the cut to
+// RGB565. Those stages come from a Kernels set (jpeg_kernels.h). Plain C++
+// with no Arduino dependency; the host tools use it too.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace jpeg {
+
+struct Info {
+  uint16_t width, height;
+  uint8_t  components;       // 1 or 3
+  uint8_t  hSamp, vSamp;     // luma sampling: 2x2 = 4:2:0
+  uint8_t  mcuWidth, mcuHeight;
+  uint16_t mcusPerRow, mcuRows;
+  uint16_t restartInterval;  // MCUs, 0 = none
+};
+
+// Receives image rows [y, y + rows), width pixels each, big-endian RGB565 as
+// pushImage() takes uint16_t data.
+typedef void (*StripFn)(int y, int rows, const uint16_t* px, void* user);
+
+struct Kernels;
+
+struct Huff {
+  uint16_t fast[1 << 9];     // (length << 8) | value for codes up to 9 bits
+  int32_t  maxcode[18];      // largest code of each length, -1 if none
+  int32_t  valoff[17];       // values[] index of a code = code + valoff[length]
+  uint8_t  values[256];
+};
+
+class Image {
+ public:
+  // data must stay valid while the Image is used.
+  bool parse(const uint8_t* data, size_t len);
+  const Info& info() const { return info_; }
+  const char* error() const { return err_; }
+
+  // True if a band can start at this MCU row: row 0, or a row that begins
+  // right after a restart marker.
+  bool canStartAt(int mcuRow) const;
+  // The row a band can start at closest to mcuRows * k / parts; 0 if none.
+  int splitRow(int k, int parts) const;
+
+  // Decodes MCU rows [row0, row1), one strip of width * mcuHeight pixels at
+  // a time. row0 must satisfy canStartAt(). Holds no state in the Image, so
+  // disjoint bands may be decoded concurrently, each with its own strip.
+  bool decodeRows(int row0, int row1, uint16_t* strip, StripFn fn, void* user) const;
+  size_t stripPixels() const { return (size_t)info_.width * info_.mcuHeight; }
+
+  // IDCT and colour conversion to use; defaultKernels() until set.
+  void setKernels(const Kernels& k) { kern_ = &k; }
+
+ private:
+  bool fail(const char* why) { err_ = why; return false; }
+  bool buildHuff(Huff& h, const uint8_t* counts, const uint8_t* values, int n);
+
+  struct Comp {
+    uint8_t id, h, v, tq, td, ta;
+  };
+
+  const uint8_t* data_ = nullptr;
+  size_t len_ = 0;
+  const char* err_ = nullptr;
+  const Kernels* kern_ = nullptr;
+  Info info_ = {};
+  Comp comp_[3] = {};
+  uint16_t quant_[4][64] = {};         // natural order
+  Huff dc_[2], ac_[2];
+  uint32_t scanStart_ = 0;
+  uint32_t rowStart_[256] = {};        // byte offset each MCU row starts at; 0 = not an entry point
+};
+
+} // namespace jpeg
@@ -0,0 +1,218 @@
+// jpeg_kernels.cpp
+
+#include "jpeg_kernels.h"
+#include <string.h>
+
+namespace jpeg {
+
+// ---------- reference IDCT: libjpeg's jidctint.c (islow) ----------
+#define CONST_BITS 13
+#define PASS1_BITS 2
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+#define DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+static inline uint8_t clamp8(int v) { return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v; }
+
+static void idctRef(const int32_t* coef, int, uint8_t* out, int stride) {
+  int32_t ws[64];
+  for (int c = 0; c < 8; ++c) {
+    const int32_t* in = coef + c;
+    int32_t* w = ws + c;
+    if ((in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56]) == 0) {
+      const int32_t dc = in[0] << PASS1_BITS;
+      for (int r = 0; r < 8; ++r) w[r * 8] = dc;
+      continue;
+    }
+    int32_t z2 = in[16], z3 = in[48];
+    int32_t z1 = (z2 + z3) * FIX_0_541196100;
+    int32_t tmp2 = z1 + z3 * (-FIX_1_847759065);
+    int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+    z2 = in[0]; z3 = in[32];
+    int32_t tmp0 = (z2 + z3) << CONST_BITS;
+    int32_t tmp1 = (z2 - z3) << CONST_BITS;
+    const int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3, tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+    tmp0 = in[56]; tmp1 = in[40]; tmp2 = in[24]; tmp3 = in[8];
+    z1 = tmp0 + tmp3; z2 = tmp1 + tmp2; z3 = tmp0 + tmp2;
+    int32_t z4 = tmp1 + tmp3;
+    const int32_t z5 = (z3 + z4) * FIX_1_175875602;
+    tmp0 *= FIX_0_298631336; tmp1 *= FIX_2_053119869; tmp2 *= FIX_3_072711026; tmp3 *= FIX_1_501321110;
+    z1 *= -FIX_0_899976223; z2 *= -FIX_2_562915447; z3 *= -FIX_1_961570560; z4 *= -FIX_0_390180644;
+    z3 += z5; z4 += z5;
+    tmp0 += z1 + z3; tmp1 += z2 + z4; tmp2 += z2 + z3; tmp3 += z1 + z4;
+
+    w[0]  = DESCALE(tmp10 + tmp3, CONST_BITS - PASS1_BITS);
+    w[56] = DESCALE(tmp10 - tmp3, CONST_BITS - PASS1_BITS);
+    w[8]  = DESCALE(tmp11 + tmp2, CONST_BITS - PASS1_BITS);
+    w[48] = DESCALE(tmp11 - tmp2, CONST_BITS - PASS1_BITS);
+    w[16] = DESCALE(tmp12 + tmp1, CONST_BITS - PASS1_BITS);
+    w[40] = DESCALE(tmp12 - tmp1, CONST_BITS - PASS1_BITS);
+    w[24] = DESCALE(tmp13 + tmp0, CONST_BITS - PASS1_BITS);
+    w[32] = DESCALE(tmp13 - tmp0, CONST_BITS - PASS1_BITS);
+  }
+  for (int r = 0; r < 8; ++r, out += stride) {
+    const int32_t* w = ws + r * 8;
+    if ((w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) == 0) {
+      memset(out, clamp8(DESCALE(w[0], PASS1_BITS + 3) + 128), 8);
+      continue;
+    }
+    int32_t z2 = w[2], z3 = w[6];
+    int32_t z1 = (z2 + z3) * FIX_0_541196100;
+    int32_t tmp2 = z1 + z3 * (-FIX_1_847759065);
+    int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+    int32_t tmp0 = (w[0] + w[4]) << CONST_BITS;
+    int32_t tmp1 = (w[0] - w[4]) << CONST_BITS;
+    const int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3, tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+    tmp0 = w[7]; tmp1 = w[5]; tmp2 = w[3]; tmp3 = w[1];
+    z1 = tmp0 + tmp3; z2 = tmp1 + tmp2; z3 = tmp0 + tmp2;
+    int32_t z4 = tmp1 + tmp3;
+    const int32_t z5 = (z3 + z4) * FIX_1_175875602;
+    tmp0 *= FIX_0_298631336; tmp1 *= FIX_2_053119869; tmp2 *= FIX_3_072711026; tmp3 *= FIX_1_501321110;
+    z1 *= -FIX_0_899976223; z2 *= -FIX_2_562915447; z3 *= -FIX_1_961570560; z4 *= -FIX_0_390180644;
+    z3 += z5; z4 += z5;
+    tmp0 += z1 + z3; tmp1 += z2 + z4; tmp2 += z2 + z3; tmp3 += z1 + z4;
+
+    const int sh = CONST_BITS + PASS1_BITS + 3;
+    out[0] = clamp8(DESCALE(tmp10 + tmp3, sh) + 128);
+    out[7] = clamp8(DESCALE(tmp10 - tmp3, sh) + 128);
+    out[1] = clamp8(DESCALE(tmp11 + tmp2, sh) + 128);
+    out[6] = clamp8(DESCALE(tmp11 - tmp2, sh) + 128);
+    out[2] = clamp8(DESCALE(tmp12 + tmp1, sh) + 128);
+    out[5] = clamp8(DESCALE(tmp12 - tmp1, sh) + 128);
+    out[3] = clamp8(DESCALE(tmp13 + tmp0, sh) + 128);
+    out[4] = clamp8(DESCALE(tmp13 - tmp0, sh) + 128);
+  }
+}
+
+// ---------- reference colour conversion ----------
+static inline uint16_t pack565be(int r, int g, int b) {
+  const uint16_t c = (uint16_t)(((clamp8(r) & 0xF8) << 8) | ((clamp8(g) & 0xFC) << 3) | (clamp8(b) >> 3));
+  return (uint16_t)((c >> 8) | (c << 8));
+}
+
+// Chroma is replicated over hs x vs pixels
+static void yccRef(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, int hs, int vs,
+                   uint16_t* out, int stride, int w, int h) {
+  for (int r = 0; r < h; ++r, out += stride) {
+    const uint8_t* yr = y + r * 16;
+    const int cr0 = (r / vs) * 8;
+    for (int x = 0; x < w; ++x) {
+      const int ci = cr0 + x / hs;
+      const int cbx = cb[ci] - 128, crx = cr[ci] - 128;
+      const int Y = yr[x];
+      out[x] = pack565be(Y + ((91881 * crx + 32768) >> 16),
+                         Y + ((-22554 * cbx - 46802 * crx + 32768) >> 16),
+                         Y + ((116130 * cbx + 32768) >> 16));
+    }
+  }
+}
+
+static void greyRef(const uint8_t* y, uint16_t* out, int stride, int w, int h) {
+  for (int r = 0; r < h; ++r, out += stride) {
+    for (int x = 0; x < w; ++x) {
+      const int v = y[r * 16 + x];
+      out[x] = pack565be(v, v, v);
+    }
+  }
+}
+
+// ---------- fast set ----------
+// libjpeg's own colour tables (jdcolor.c) with the range limit and the
+// RGB565 packing folded in. Index r/g/b with a sample + 256; each entry is
+// that channel's bits of a big-endian RGB565 pixel, so a pixel is three
+// lookups OR'ed together. About 9 KB, in internal RAM on the device.
+struct Tables {
+  int16_t  crR[256], cbB[256];
+  int32_t  crG[256], cbG[256];   // summed, then >> 16
+  uint16_t r[768], g[768], b[768];
+  uint16_t grey[256];
+
+  Tables() {
+    for (int i = 0; i < 256; ++i) {
+      const int x = i - 128;
+      crR[i] = (int16_t)((91881 * x + 32768) >> 16);
+      cbB[i] = (int16_t)((116130 * x + 32768) >> 16);
+      crG[i] = -46802 * x;
+      cbG[i] = -22554 * x + 32768;
+      grey[i] = pack565be(i, i, i);
+    }
+    for (int i = 0; i < 768; ++i) {
+      r[i] = pack565be(i - 256, 0, 0);
+      g[i] = pack565be(0, i - 256, 0);
+      b[i] = pack565be(0, 0, i - 256);
+    }
+  }
+};
+static const Tables s_tab;
+
+static void idctFast(const int32_t* coef, int last, uint8_t* out, int stride) {
+  if (last) {
+    idctRef(coef, last, out, stride);
+    return;
+  }
+  // What the reference computes when every AC term is zero
+  const uint8_t v = clamp8(DESCALE(coef[0] << PASS1_BITS, PASS1_BITS + 3) + 128);
+  for (int r = 0; r < 8; ++r, out += stride) memset(out, v, 8);
+}
+
+static void yccFast(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, int hs, int vs,
+                    uint16_t* out, int stride, int w, int h) {
+  const Tables& t = s_tab;
+  for (int r = 0; r < h; ++r, out += stride) {
+    const uint8_t* yr = y + r * 16;
+    const uint8_t* cbr = cb + (r / vs) * 8;
+    const uint8_t* crr = cr + (r / vs) * 8;
+    int x = 0;
+    if (hs == 2) {
+      for (; x + 1 < w; x += 2) {
+        const int c = x >> 1;
+        const int dr = t.crR[crr[c]], db = t.cbB[cbr[c]];
+        const int dg = (t.cbG[cbr[c]] + t.crG[crr[c]]) >> 16;
+        const int y0 = yr[x] + 256, y1 = yr[x + 1] + 256;
+        out[x]     = t.r[y0 + dr] | t.g[y0 + dg] | t.b[y0 + db];
+        out[x + 1] = t.r[y1 + dr] | t.g[y1 + dg] | t.b[y1 + db];
+      }
+    }
+    for (; x < w; ++x) {
+      const int c = x / hs;
+      const int Y = yr[x] + 256;
+      out[x] = t.r[Y + t.crR[crr[c]]] |
+               t.g[Y + ((t.cbG[cbr[c]] + t.crG[crr[c]]) >> 16)] |
+               t.b[Y + t.cbB[cbr[c]]];
+    }
+  }
+}
+
+static void greyFast(const uint8_t* y, uint16_t* out, int stride, int w, int h) {
+  for (int r = 0; r < h; ++r, out += stride) {
+    for (int x = 0; x < w; ++x) out[x] = s_tab.grey[y[r * 16 + x]];
+  }
+}
+
+static const Kernels kScalar = { "scalar", idctRef, yccRef, greyRef };
+static const Kernels kFast = { "fast", idctFast, yccFast, greyFast };
+
+const Kernels& scalarKernels() { return kScalar; }
+const Kernels& fastKernels() { return kFast; }
+
+const Kernels& defaultKernels() {
+#if defined(TD_JPEG_SCALAR)
+  return kScalar;
+#else
+  return kFast;
+#endif
+}
+
+} // namespace jpeg
@@ -0,0 +1,39 @@
+// jpeg_kernels.h
+//
+// The per-block stages of jpeg_dec: IDCT, chroma upsampling and YCbCr to
+// RGB565. They sit behind a table of function pointers so another set can
+// replace the reference one. Every set must produce the same pixels as
+// scalarKernels(); td_bench checks this on the host before it times them.
+//
+// scalarKernels()  straight C, a line-for-line port of libjpeg's islow IDCT
+//                  and colour conversion. The reference.
+// fastKernels()    the same arithmetic, reordered for the ESP32-S3: DC-only
+//                  blocks skip the IDCT, colour conversion is table lookups
+//                  (no multiplies or clamps per pixel), and with 2x
+//                  horizontal sampling each chroma sample is converted once
+//                  for the pixel pair that shares it.
+//
+// defaultKernels() is fastKernels() unless the firmware is built with
+// -DTD_JPEG_SCALAR.
+#pragma once
+#include <stdint.h>
+
+namespace jpeg {
+
+struct Kernels {
+  const char* name;
+  // coef: 64 dequantised coefficients in natural order; last: zigzag index
+  // of the last non-zero one (0 = DC only). Writes 8x8 samples at stride.
+  void (*idct)(const int32_t* coef, int last, uint8_t* out, int stride);
+  // One MCU into big-endian RGB565: luma at a 16-byte stride, cb/cr 8x8
+  // covering hs x vs luma pixels each. w, h clip the right and bottom edge.
+  void (*ycc)(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, int hs, int vs,
+              uint16_t* out, int stride, int w, int h);
+  void (*grey)(const uint8_t* y, uint16_t* out, int stride, int w, int h);
+};
+
+const Kernels& scalarKernels();
+const Kernels& fastKernels();
+const Kernels& defaultKernels();
+
+} // namespace jpeg
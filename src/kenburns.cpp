@@ -0,0 +1,94 @@
+// kenburns.cpp
+
+#include "kenburns.h"
+
+namespace kb {
+
+static float rnd(uint32_t& s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return (s >> 8) * (1.0f / 16777216.0f);
+}
+
+Motion plan(int srcW, int srcH, int zoomPct, uint32_t seed) {
+  uint32_t s = seed ? seed : 1;
+  const float base = (float)(srcW < srcH ? srcW : srcH);   // cover: the short side fills the panel
+  const float deep = base * 100.0f / (zoomPct > 100 ? zoomPct : 100);
+  Motion m;
+  m.srcW = srcW;
+  m.srcH = srcH;
+  const bool zoomIn = rnd(s) < 0.5f;
+  m.s0 = zoomIn ? base : deep;
+  m.s1 = zoomIn ? deep : base;
+  // Centres anywhere the view fits; at() keeps the edges inside
+  m.x0 = m.s0 / 2 + rnd(s) * (srcW - m.s0);
+  m.y0 = m.s0 / 2 + rnd(s) * (srcH - m.s0);
+  m.x1 = m.s1 / 2 + rnd(s) * (srcW - m.s1);
+  m.y1 = m.s1 / 2 + rnd(s) * (srcH - m.s1);
+  return m;
+}
+
+View Motion::at(float t, int outSide) const {
+  if (t < 0) t = 0;
+  if (t > 1) t = 1;
+  const float e = t * t * (3 - 2 * t);
+  const float side = s0 + (s1 - s0) * e;
+  float x = x0 + (x1 - x0) * e - side / 2;
+  float y = y0 + (y1 - y0) * e - side / 2;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (x > srcW - side) x = srcW - side;
+  if (y > srcH - side) y = srcH - side;
+  View v;
+  v.x = (int32_t)(x * 65536.0f);
+  v.y = (int32_t)(y * 65536.0f);
+  v.step = (int32_t)(side * 65536.0f / outSide);
+  return v;
+}
+
+static inline uint16_t swap16(uint16_t c) { return (uint16_t)((c << 8) | (c >> 8)); }
+
+// RGB565 spread as 00000GGGGGG00000RRRRR000000BBBBB: each channel has room
+// for a 5-bit weight, so one multiply blends all three
+static inline uint32_t spread(uint16_t be) {
+  const uint32_t c = swap16(be);
+  return (c | (c << 16)) & 0x07E0F81Fu;
+}
+
+static inline uint16_t pack(uint32_t p) {
+  p &= 0x07E0F81Fu;
+  return swap16((uint16_t)(p | (p >> 16)));
+}
+
+static inline uint32_t lerp(uint32_t a, uint32_t b, uint32_t w) {
+  return ((a * (32 - w) + b * w) >> 5) & 0x07E0F81Fu;
+}
+
+void render(const uint16_t* src, int srcW, int srcH, const View& v, int outW, int y0, int rows,
+            uint16_t* out, bool bilinear) {
+  for (int j = 0; j < rows; ++j) {
+    const int32_t sy = v.y + (y0 + j) * v.step;
+    int iy = sy >> 16;
+    if (iy > srcH - 1) iy = srcH - 1;
+    const uint16_t* r0 = src + (size_t)iy * srcW;
+    uint16_t* o = out + (size_t)j * outW;
+    int32_t sx = v.x;
+    if (!bilinear) {
+      for (int i = 0; i < outW; ++i, sx += v.step) o[i] = r0[sx >> 16];
+      continue;
+    }
+    const uint16_t* r1 = iy + 1 < srcH ? r0 + srcW : r0;
+    const uint32_t fy = (sy >> 11) & 31;
+    for (int i = 0; i < outW; ++i, sx += v.step) {
+      const int ix = sx >> 16;
+      const int ix1 = ix + 1 < srcW ? ix + 1 : ix;
+      const uint32_t fx = (sx >> 11) & 31;
+      const uint32_t top = lerp(spread(r0[ix]), spread(r0[ix1]), fx);
+      const uint32_t bot = lerp(spread(r1[ix]), spread(r1[ix1]), fx);
+      o[i] = pack(lerp(top, bot, fy));
+    }
+  }
+}
+
+}
@@ -0,0 +1,56 @@
+// kenburns.h
+//
+// Pan and zoom over a still decoded once into RAM, for the Ken Burns
+// slideshow (ImageDisplay::MODE_KENBURNS). Every frame resamples a square
+// view of the source into panel rows with 16.16 fixed-point steps, nearest
+// or bilinear, on big-endian RGB565 as pushImage() takes it. No decoding
+// happens after the first frame, so a frame costs a resample and a push.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef KB_SLIDE_MS
+#define KB_SLIDE_MS 8000            // one image's pan and zoom
+#endif
+#ifndef KB_ZOOM_PCT
+#define KB_ZOOM_PCT 130             // deepest zoom, from the image just covering the panel
+#endif
+#ifndef KB_VSYNC_DIV
+#define KB_VSYNC_DIV 2              // a frame every 2 vsyncs, about 29 fps
+#endif
+#ifndef KB_FPS
+#define KB_FPS 30                   // when there's no vsync count to follow
+#endif
+#ifndef KB_BILINEAR
+#define KB_BILINEAR 1               // 0: nearest, about 5x cheaper but it shimmers on slow pans
+#endif
+#ifndef KB_CANVAS_PIXELS
+#define KB_CANVAS_PIXELS (1024 * 1024)   // the decoded image, in PSRAM (2 MB)
+#endif
+
+namespace kb {
+
+// Top-left corner of the view and source pixels per panel pixel, all 16.16
+struct View {
+  int32_t x, y, step;
+};
+
+// One slide: the view's centre and side (source pixels) at the start and end
+struct Motion {
+  float x0, y0, s0;
+  float x1, y1, s1;
+  int srcW, srcH;
+
+  // View at t in [0, 1], eased in and out, kept inside the source
+  View at(float t, int outSide) const;
+};
+
+// A random zoom in or out between covering the panel and zoomPct%, panning
+// across the image. seed picks the motion.
+Motion plan(int srcW, int srcH, int zoomPct, uint32_t seed);
+
+// Output rows [y0, y0 + rows), outW pixels each, into out
+void render(const uint16_t* src, int srcW, int srcH, const View& v, int outW, int y0, int rows,
+            uint16_t* out, bool bilinear);
+
+}
@@ -0,0 +1,173 @@
+// panel_bounce.cpp
+
+#include "disp_cfg.h"
+#include "panel_bounce.h"
+
+#if TD_RGB_BOUNCE_LINES && !defined(TD_HOST_SIM)
+#include <esp_heap_caps.h>
+#include <esp_lcd_panel_ops.h>
+#include <esp_lcd_panel_rgb.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static BounceStats s_stats = {};
+static portMUX_TYPE s_statsMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_prevFillStart = 0;
+static bool s_lateThisFrame = false;
+static esp_lcd_panel_handle_t s_rgb = nullptr;
+static uint32_t s_htotal = 0;
+static uint32_t s_nextBudgetUs = 0;     // takes over at the vsync the new clock does
+
+struct BounceCtx {
+  const uint8_t* fb;
+};
+static BounceCtx s_ctx;
+
+// Copies the next TD_RGB_BOUNCE_LINES lines of the frame buffer into the
+// buffer the GDMA just finished with. It must end before the GDMA comes back
+// to this buffer, one budget after the previous refill started.
+static bool IRAM_ATTR onBounceEmpty(esp_lcd_panel_handle_t, void* buf, int pos_px, int len_bytes, void* user)
+{
+  const BounceCtx* ctx = static_cast<const BounceCtx*>(user);
+  const int64_t t0 = esp_timer_get_time();
+  memcpy(buf, ctx->fb + (size_t)pos_px * 2, len_bytes);
+  const int64_t t1 = esp_timer_get_time();
+  const uint32_t us = (uint32_t)(t1 - t0);
+
+  portENTER_CRITICAL_ISR(&s_statsMux);
+  s_stats.fills++;
+  s_stats.fillUsTotal += us;
+  if (us > s_stats.worstFillUs) s_stats.worstFillUs = us;
+  if (s_prevFillStart && t1 - s_prevFillStart > 2 * (int64_t)s_stats.budgetUs) {
+    s_stats.lateFills++;
+    s_lateThisFrame = true;
+  }
+  s_prevFillStart = t0;
+  portEXIT_CRITICAL_ISR(&s_statsMux);
+  return false;
+}
+
+static bool IRAM_ATTR onVsync(esp_lcd_panel_handle_t, const esp_lcd_rgb_panel_event_data_t*, void*)
+{
+  portENTER_CRITICAL_ISR(&s_statsMux);
+  s_stats.frames++;
+  if (s_lateThisFrame) s_stats.glitchFrames++;
+  s_lateThisFrame = false;
+  if (s_nextBudgetUs) {
+    s_stats.budgetUs = s_nextBudgetUs;
+    s_nextBudgetUs = 0;
+    s_prevFillStart = 0;   // don't judge the first refill against the old clock
+  }
+  portEXIT_CRITICAL_ISR(&s_statsMux);
+  return false;
+}
+
+bool Panel_RGBBounce::init(bool use_reset)
+{
+  const int w = _cfg.memory_width, h = _cfg.memory_height;
+  const size_t line = (size_t)w * 2;
+  if (_bounce_lines == 0 || h % _bounce_lines) return false;
+
+  // LovyanGFX draws into this exactly as it would into Panel_RGB's buffer
+  _fb = (uint8_t*)heap_caps_aligned_alloc(64, line * h, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  _lines_buffer = (uint8_t**)heap_caps_malloc(sizeof(uint8_t*) * h, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!_fb || !_lines_buffer) return false;
+  memset(_fb, 0, line * h);
+  for (int y = 0; y < h; ++y) _lines_buffer[y] = _fb + y * line;
+
+  const auto& b = _bus_cfg;
+  esp_lcd_rgb_panel_config_t pc = {};
+  pc.clk_src = LCD_CLK_SRC_DEFAULT;
+  pc.timings.pclk_hz = b.freq_write;
+  pc.timings.h_res = w;
+  pc.timings.v_res = h;
+  pc.timings.hsync_pulse_width = b.hsync_pulse_width;
+  pc.timings.hsync_back_porch = b.hsync_back_porch;
+  pc.timings.hsync_front_porch = b.hsync_front_porch;
+  pc.timings.vsync_pulse_width = b.vsync_pulse_width;
+  pc.timings.vsync_back_porch = b.vsync_back_porch;
+  pc.timings.vsync_front_porch = b.vsync_front_porch;
+  pc.timings.flags.hsync_idle_low = !b.hsync_polarity;   // Bus_RGB's polarity is the idle level
+  pc.timings.flags.vsync_idle_low = !b.vsync_polarity;
+  pc.timings.flags.de_idle_high = b.de_idle_high;
+  pc.timings.flags.pclk_active_neg = b.pclk_active_neg;
+  pc.timings.flags.pclk_idle_high = b.pclk_idle_high;
+  pc.data_width = 16;
+  pc.bits_per_pixel = 16;
+  pc.bounce_buffer_size_px = (size_t)w * _bounce_lines;
+  pc.hsync_gpio_num = b.pin_hsync;
+  pc.vsync_gpio_num = b.pin_vsync;
+  pc.de_gpio_num = b.pin_henable;
+  pc.pclk_gpio_num = b.pin_pclk;
+  pc.disp_gpio_num = -1;
+  // LovyanGFX keeps RGB565 byte-swapped in the frame buffer. Bus_RGB routes
+  // data line n to pin_d[n ^ 8] to undo that; do the same rather than swap
+  // every pixel in the refill.
+  const int8_t pins[16] = { b.pin_d0, b.pin_d1, b.pin_d2,  b.pin_d3,  b.pin_d4,  b.pin_d5,  b.pin_d6,  b.pin_d7,
+                            b.pin_d8, b.pin_d9, b.pin_d10, b.pin_d11, b.pin_d12, b.pin_d13, b.pin_d14, b.pin_d15 };
+  for (int i = 0; i < 16; ++i) pc.data_gpio_nums[i] = pins[i ^ 8];
+  pc.flags.no_fb = 1;   // the frame buffer is ours; esp_lcd only owns the bounce buffers
+
+  s_ctx.fb = _fb;
+  s_htotal = w + b.hsync_front_porch + b.hsync_pulse_width + b.hsync_back_porch;
+  portENTER_CRITICAL(&s_statsMux);
+  s_stats = BounceStats{};
+  s_stats.lines = _bounce_lines;
+  s_stats.budgetUs = (uint32_t)((uint64_t)_bounce_lines * s_htotal * 1000000ULL / b.freq_write);
+  s_stats.sinceUs = esp_timer_get_time();
+  portEXIT_CRITICAL(&s_statsMux);
+
+  esp_lcd_panel_handle_t rgb = nullptr;
+  if (esp_lcd_new_rgb_panel(&pc, &rgb) != ESP_OK) return false;
+  esp_lcd_rgb_panel_event_callbacks_t cbs = {};
+  cbs.on_vsync = onVsync;
+  cbs.on_bounce_empty = onBounceEmpty;
+  esp_lcd_rgb_panel_register_event_callbacks(rgb, &cbs, &s_ctx);
+  esp_lcd_panel_reset(rgb);
+  esp_lcd_panel_init(rgb);
+  _rgb = rgb;
+  s_rgb = rgb;
+  Serial.printf("[Panel] RGB bounce buffers: 2 x %u lines (%u B internal), %u us per refill\n",
+                _bounce_lines, (unsigned)(2 * line * _bounce_lines), (unsigned)s_stats.budgetUs);
+
+  return Panel_FrameBufferBase::init(use_reset);
+}
+
+BounceStats bounceStats()
+{
+  portENTER_CRITICAL(&s_statsMux);
+  const BounceStats s = s_stats;
+  portEXIT_CRITICAL(&s_statsMux);
+  return s;
+}
+
+bool bounceSetPclk(uint32_t hz)
+{
+  if (!s_rgb || !hz) return false;
+  portENTER_CRITICAL(&s_statsMux);
+  s_nextBudgetUs = (uint32_t)((uint64_t)s_stats.lines * s_htotal * 1000000ULL / hz);
+  portEXIT_CRITICAL(&s_statsMux);
+  return esp_lcd_rgb_panel_set_pclk(s_rgb, hz) == ESP_OK;   // esp_lcd applies it at vsync
+}
+
+void bounceResetStats()
+{
+  portENTER_CRITICAL(&s_statsMux);
+  const uint32_t lines = s_stats.lines, budget = s_stats.budgetUs;
+  s_stats = BounceStats{};
+  s_stats.lines = lines;
+  s_stats.budgetUs = budget;
+  s_stats.sinceUs = esp_timer_get_time();
+  s_prevFillStart = 0;
+  s_lateThisFrame = false;
+  portEXIT_CRITICAL(&s_statsMux);
+}
+
+#else
+
+// Panel_RGB/Bus_RGB: the GDMA reads PSRAM directly and reports nothing
+BounceStats bounceStats() { return BounceStats{}; }
+void bounceResetStats() {}
+bool bounceSetPclk(uint32_t) { return false; }
+
+#endif
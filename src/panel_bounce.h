@@ -0,0 +1,60 @@
+// panel_bounce.h
+//
+// RGB panel driver with bounce buffers, used instead of LovyanGFX's
+// Panel_RGB/Bus_RGB when TD_RGB_BOUNCE_LINES (disp_cfg.h) is non-zero.
+//
+// Bus_RGB has the LCD peripheral's GDMA read the 450 KB frame buffer straight
+// out of PSRAM, about 27 MB/s at 16 MHz, all the time. Here the frame buffer
+// stays in PSRAM where LovyanGFX draws into it, but ESP-IDF's esp_lcd RGB
+// driver scans out of two small internal-SRAM buffers of TD_RGB_BOUNCE_LINES
+// lines each. The CPU refills one in an interrupt while the GDMA sends the
+// other. PSRAM is then read by the CPU through its cache, in bursts, instead
+// of by the GDMA, and a refill that runs late is visible and counted.
+//
+// Each refill has one buffer's worth of scan-out time (budgetUs) before the
+// LCD wraps round to it. One that ends later than that shows stale lines for
+// a frame: it is counted in lateFills and the frame in glitchFrames. Flash
+// writes (uploads, FFat) stall the interrupt unless the esp_lcd ISR is built
+// IRAM-safe, so expect late fills while files are being written.
+#pragma once
+#include <stdint.h>
+
+struct BounceStats {
+  uint32_t lines;           // per bounce buffer; 0 = bounce buffers not in use
+  uint32_t budgetUs;        // scan-out time of one bounce buffer
+  uint32_t frames;          // vsyncs since the last reset
+  uint32_t fills;
+  uint32_t lateFills;
+  uint32_t glitchFrames;    // frames with at least one late fill
+  uint32_t worstFillUs;
+  uint64_t fillUsTotal;     // CPU time spent refilling
+  uint64_t sinceUs;         // when the counters were reset
+};
+
+BounceStats bounceStats();
+void bounceResetStats();
+// Changes the pixel clock from the next vsync (PanelClock uses it); false
+// when bounce buffers aren't in use.
+bool bounceSetPclk(uint32_t hz);
+
+#if !defined(TD_HOST_SIM)
+#include <LovyanGFX.hpp>
+#include <lgfx/v1/platforms/esp32s3/Bus_RGB.hpp>
+
+class Panel_RGBBounce : public lgfx::Panel_FrameBufferBase
+{
+public:
+  // Pins, clock and porches, in the same form Bus_RGB takes them
+  const lgfx::Bus_RGB::config_t& bus_config(void) const { return _bus_cfg; }
+  void bus_config(const lgfx::Bus_RGB::config_t& cfg) { _bus_cfg = cfg; }
+  void bounce_lines(uint16_t lines) { _bounce_lines = lines; }
+
+  bool init(bool use_reset) override;
+
+private:
+  lgfx::Bus_RGB::config_t _bus_cfg = {};
+  uint16_t _bounce_lines = 10;
+  void* _rgb = nullptr;        // esp_lcd_panel_handle_t
+  uint8_t* _fb = nullptr;
+};
+#endif
@@ -0,0 +1,132 @@
+// panel_clock.cpp
+
+#include "panel_clock.h"
+#include "disp_cfg.h"
+#include <Arduino.h>
+
+#if !defined(TD_HOST_SIM) && !TD_RGB_BOUNCE_LINES
+#include <esp_intr_alloc.h>
+#include <soc/lcd_cam_struct.h>
+#include <soc/periph_defs.h>
+#endif
+
+namespace PanelClock {
+
+static bool     s_begun = false;
+static bool     s_slow = false;
+static uint32_t s_lastActivityMs = 0;
+static uint32_t s_lastTickUs = 0;
+static uint32_t s_switches = 0;
+static uint64_t s_slowUs = 0, s_totalUs = 0;
+
+#if defined(TD_HOST_SIM)
+// Nothing is scanned out; keep the bookkeeping so the sim shows the pattern
+static bool setup() { return true; }
+static void apply(bool) {}
+static uint32_t vsyncCount() { return 0; }
+#elif TD_RGB_BOUNCE_LINES
+static bool setup() { return true; }
+static void apply(bool slow) {
+    bounceSetPclk(slow ? PANEL_TIMING.pclk_hz / PANEL_STATIC_DIV : PANEL_TIMING.pclk_hz);
+}
+static uint32_t vsyncCount() { return bounceStats().frames; }
+#else
+// Bus_RGB leaves the LCD_CAM running from its GDMA loop. Its pixel clock is
+// lcd_clk / (clkcnt_n + 1); the divider is swapped in from the vsync
+// interrupt, between frames, and latched with lcd_update.
+static uint32_t s_fullPrescale = 1;
+static volatile uint32_t s_wantPrescale = 0;
+static volatile uint32_t s_vsyncs = 0;
+static intr_handle_t s_intr = nullptr;
+
+static void setPrescale(uint32_t p) {
+    if (p <= 1) {
+        LCD_CAM.lcd_clock.lcd_clk_equ_sysclk = 1;
+    } else {
+        LCD_CAM.lcd_clock.lcd_clk_equ_sysclk = 0;
+        LCD_CAM.lcd_clock.lcd_clkcnt_n = p - 1;
+    }
+    LCD_CAM.lcd_user.lcd_update = 1;
+}
+
+static void IRAM_ATTR onVsync(void*) {
+    if (!LCD_CAM.lc_dma_int_st.lcd_vsync_int_st) return;
+    LCD_CAM.lc_dma_int_clr.lcd_vsync_int_clr = 1;
+    s_vsyncs++;
+    const uint32_t p = s_wantPrescale;
+    if (p) {
+        setPrescale(p);
+        s_wantPrescale = 0;
+    }
+}
+
+static bool setup() {
+    s_fullPrescale = LCD_CAM.lcd_clock.lcd_clk_equ_sysclk ? 1 : LCD_CAM.lcd_clock.lcd_clkcnt_n + 1;
+    if (s_fullPrescale * PANEL_STATIC_DIV > 64) return false;   // clkcnt_n is 6 bits
+    if (esp_intr_alloc(ETS_LCD_CAM_INTR_SOURCE, ESP_INTR_FLAG_SHARED | ESP_INTR_FLAG_LOWMED, onVsync, nullptr, &s_intr) != ESP_OK)
+        return false;
+    LCD_CAM.lc_dma_int_clr.lcd_vsync_int_clr = 1;
+    LCD_CAM.lc_dma_int_ena.lcd_vsync_int_ena = 1;
+    return true;
+}
+
+static void apply(bool slow) {
+    s_wantPrescale = slow ? s_fullPrescale * PANEL_STATIC_DIV : s_fullPrescale;
+}
+static uint32_t vsyncCount() { return s_vsyncs; }
+#endif
+
+// Adds the time since the last call to the totals
+static void tick() {
+    const uint32_t now = micros();
+    const uint32_t dt = now - s_lastTickUs;
+    s_lastTickUs = now;
+    s_totalUs += dt;
+    if (s_slow) s_slowUs += dt;
+}
+
+void begin() {
+    if (PANEL_STATIC_DIV <= 1 || !setup()) {
+        Serial.println("[Panel] Adaptive pixel clock off");
+        return;
+    }
+    s_begun = true;
+    s_lastActivityMs = millis();
+    s_lastTickUs = micros();
+    Serial.printf("[Panel] Pixel clock %lu Hz, %lu Hz when still\n",
+                  (unsigned long)PANEL_TIMING.pclk_hz, (unsigned long)(PANEL_TIMING.pclk_hz / PANEL_STATIC_DIV));
+}
+
+void activity() {
+    s_lastActivityMs = millis();
+    if (!s_begun || !s_slow) return;
+    tick();
+    s_slow = false;
+    apply(false);
+}
+
+void loop() {
+    if (!s_begun) return;
+    tick();
+    if (!s_slow && millis() - s_lastActivityMs >= PANEL_STATIC_AFTER_MS) {
+        s_slow = true;
+        s_switches++;
+        apply(true);
+    }
+}
+
+uint32_t vsyncs() { return s_begun ? vsyncCount() : 0; }
+
+// Totals as of the last loop(); the web handlers call this from their own task
+Stats stats() {
+    Stats s;
+    s.fullHz = PANEL_TIMING.pclk_hz;
+    s.staticHz = s_begun ? PANEL_TIMING.pclk_hz / PANEL_STATIC_DIV : PANEL_TIMING.pclk_hz;
+    s.slow = s_slow;
+    s.switches = s_switches;
+    s.slowUs = s_slowUs;
+    s.totalUs = s_totalUs;
+    return s;
+}
+
+}
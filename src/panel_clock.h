@@ -0,0 +1,44 @@
+// panel_clock.h
+//
+// Lowers the RGB pixel clock while the screen is still and restores it as
+// soon as something moves. A still JPG or a paused slideshow doesn't need 58
+// frames a second. At 1/PANEL_STATIC_DIV of the clock the panel reads that
+// much less from the PSRAM frame buffer, and the bus and LCD draw less power.
+//
+// The new clock takes effect at the next vsync, between frames, so a switch
+// never tears a frame. With bounce buffers (TD_RGB_BOUNCE_LINES) esp_lcd makes
+// the change itself. On Bus_RGB a vsync interrupt rewrites the LCD_CAM pixel
+// clock divider.
+//
+// Anything that animates calls activity() before each frame: GIF playback,
+// menus, the status overlay, touches. loop() drops the clock once
+// PANEL_STATIC_AFTER_MS has passed with no activity.
+#pragma once
+#include <stdint.h>
+
+#ifndef PANEL_STATIC_DIV
+#define PANEL_STATIC_DIV 2          // 16 MHz / 2 = 8 MHz, about 29 fps
+#endif
+#ifndef PANEL_STATIC_AFTER_MS
+#define PANEL_STATIC_AFTER_MS 500
+#endif
+
+namespace PanelClock {
+
+struct Stats {
+    uint32_t fullHz, staticHz;
+    bool     slow;           // static clock requested
+    uint32_t switches;       // full -> static transitions
+    uint64_t slowUs;         // time at the static clock
+    uint64_t totalUs;        // since begin()
+};
+
+void begin();               // after tft.begin()
+void activity();
+void loop();
+Stats stats();
+// Vsyncs counted so far, for pacing animation to the panel. 0 when nothing
+// counts them (adaptive clock off, or the host simulator).
+uint32_t vsyncs();
+
+}
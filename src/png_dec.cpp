@@ -0,0 +1,519 @@
+// png_dec.cpp
+
+#include "png_dec.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace png {
+
+static const uint8_t kSignature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+static constexpr size_t kInBytes = 1024;
+static constexpr uint32_t kWindow = 32768;
+static constexpr int kFastBits = 10;
+
+// Canonical Huffman code: codes up to kFastBits long resolve with one table
+// lookup on the next bits of the stream, longer ones walk the code lengths.
+struct Decoder::Huff {
+  uint16_t fast[1 << kFastBits];       // (symbol << 4) | length, 0 = long code
+  uint16_t count[16];                  // codes of each length
+  uint16_t symbol[288];                // symbols in canonical order
+};
+
+static inline uint32_t rd32be(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool build(Decoder::Huff& h, const uint8_t* lens, int n);
+
+Decoder::Decoder() {}
+
+Decoder::~Decoder() {
+  free(in_);
+  free(window_);
+  free(lit_);
+  free(dist_);
+  free(rows_);
+}
+
+size_t Decoder::workingBytes() const {
+  return (in_ ? kInBytes : 0) + (window_ ? kWindow : 0) + (lit_ ? 2 * sizeof(Huff) : 0) + rowsCap_;
+}
+
+// ---------- raw file and chunks ----------
+bool Decoder::readRaw(uint8_t* dst, size_t n) {
+  while (n > 0) {
+    if (inPos_ == inLen_) {
+      inPos_ = 0;
+      inLen_ = read_(in_, kInBytes, user_);
+      if (inLen_ == 0) return fail("truncated");
+    }
+    size_t k = inLen_ - inPos_ < n ? inLen_ - inPos_ : n;
+    if (dst) { memcpy(dst, in_ + inPos_, k); dst += k; }
+    inPos_ += k;
+    n -= k;
+  }
+  return true;
+}
+
+bool Decoder::skipRaw(uint32_t n) { return readRaw(nullptr, n); }
+
+// Moves past the current IDAT's CRC to the next chunk; false once the IDAT
+// run is over.
+bool Decoder::nextIdat() {
+  if (idatDone_) return false;
+  uint8_t hdr[8];
+  if (!skipRaw(4) || !readRaw(hdr, 8) || memcmp(hdr + 4, "IDAT", 4) != 0) {
+    idatDone_ = true;
+    return false;
+  }
+  chunkLeft_ = rd32be(hdr);
+  return true;
+}
+
+int Decoder::idatByte() {
+  while (chunkLeft_ == 0) {
+    if (!nextIdat()) return -1;
+  }
+  if (inPos_ == inLen_) {
+    inPos_ = 0;
+    inLen_ = read_(in_, kInBytes, user_);
+    if (inLen_ == 0) { idatDone_ = true; chunkLeft_ = 0; return -1; }
+  }
+  chunkLeft_--;
+  return in_[inPos_++];
+}
+
+bool Decoder::begin(ReadFn read, void* user) {
+  read_ = read;
+  user_ = user;
+  err_ = nullptr;
+  info_ = Info{};
+  inPos_ = inLen_ = 0;
+  chunkLeft_ = 0;
+  idatDone_ = false;
+  hasKey_ = false;
+  memset(palette_, 0, sizeof(palette_));
+  for (int i = 0; i < 256; ++i) palette_[i * 4 + 3] = 255;
+
+  if (!read) return fail("no reader");
+  if (!in_ && !(in_ = (uint8_t*)malloc(kInBytes))) return fail("out of memory");
+
+  uint8_t sig[8];
+  if (!readRaw(sig, 8) || memcmp(sig, kSignature, 8) != 0) return fail("not a PNG");
+  bool haveHeader = false, havePalette = false;
+  for (;;) {
+    uint8_t hdr[8];
+    if (!readRaw(hdr, 8)) return false;
+    const uint32_t len = rd32be(hdr);
+    const uint8_t* type = hdr + 4;
+    if (memcmp(type, "IHDR", 4) == 0) {
+      uint8_t d[13];
+      if (len != 13 || !readRaw(d, 13)) return fail("bad IHDR");
+      info_.width = rd32be(d);
+      info_.height = rd32be(d + 4);
+      info_.bitDepth = d[8];
+      info_.colorType = d[9];
+      if (d[10] != 0 || d[11] != 0) return fail("unknown compression or filter method");
+      if (d[12] != 0) return fail("interlaced PNGs aren't supported");
+      haveHeader = true;
+    } else if (!haveHeader) {
+      return fail("IHDR missing");
+    } else if (memcmp(type, "PLTE", 4) == 0) {
+      uint8_t d[768];
+      if (len > 768 || len % 3 != 0 || !readRaw(d, len)) return fail("bad PLTE");
+      for (uint32_t i = 0; i < len / 3; ++i) memcpy(&palette_[i * 4], &d[i * 3], 3);
+      havePalette = true;
+    } else if (memcmp(type, "tRNS", 4) == 0) {
+      uint8_t d[256];
+      if (len > 256 || !readRaw(d, len)) return fail("bad tRNS");
+      if (info_.colorType == 3) {
+        for (uint32_t i = 0; i < len; ++i) palette_[i * 4 + 3] = d[i];
+      } else if (info_.colorType == 0 && len >= 2) {
+        key_[0] = (uint16_t)((d[0] << 8) | d[1]);
+        hasKey_ = true;
+      } else if (info_.colorType == 2 && len >= 6) {
+        for (int c = 0; c < 3; ++c) key_[c] = (uint16_t)((d[c * 2] << 8) | d[c * 2 + 1]);
+        hasKey_ = true;
+      }
+      info_.alpha = true;
+    } else if (memcmp(type, "IDAT", 4) == 0) {
+      chunkLeft_ = len;
+      break;
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      return fail("no image data");
+    } else {
+      if (!skipRaw(len)) return false;
+    }
+    if (!skipRaw(4)) return false;   // CRC
+  }
+
+  const uint8_t ct = info_.colorType, bd = info_.bitDepth;
+  int channels;
+  bool okDepth;
+  switch (ct) {
+    case 0: channels = 1; okDepth = bd == 1 || bd == 2 || bd == 4 || bd == 8 || bd == 16; break;
+    case 3: channels = 1; okDepth = bd == 1 || bd == 2 || bd == 4 || bd == 8; break;
+    case 2: channels = 3; okDepth = bd == 8 || bd == 16; break;
+    case 4: channels = 2; okDepth = bd == 8 || bd == 16; break;
+    case 6: channels = 4; okDepth = bd == 8 || bd == 16; break;
+    default: return fail("unknown colour type");
+  }
+  if (!okDepth) return fail("bad bit depth");
+  if (ct == 3 && !havePalette) return fail("PLTE missing");
+  if (info_.width == 0 || info_.height == 0 || info_.width > 4096 || info_.height > 4096)
+    return fail("implausible size");
+  if (ct == 4 || ct == 6) info_.alpha = true;
+
+  const uint32_t bitsPerPixel = (uint32_t)channels * bd;
+  stride_ = (info_.width * bitsPerPixel + 7) / 8;
+  bpp_ = bitsPerPixel >= 8 ? bitsPerPixel / 8 : 1;
+  const size_t need = 2 * (size_t)stride_ + 4 * (size_t)info_.width;
+  if (need > rowsCap_) {
+    free(rows_);
+    rowsCap_ = 0;
+    if (!(rows_ = (uint8_t*)malloc(need))) return fail("out of memory");
+    rowsCap_ = need;
+  }
+  if (!window_ && !(window_ = (uint8_t*)malloc(kWindow))) return fail("out of memory");
+  if (!lit_) {
+    lit_ = (Huff*)malloc(sizeof(Huff));
+    dist_ = (Huff*)malloc(sizeof(Huff));
+    if (!lit_ || !dist_) {
+      free(lit_); free(dist_);
+      lit_ = dist_ = nullptr;
+      return fail("out of memory");
+    }
+  }
+  return true;
+}
+
+// ---------- inflate (RFC 1951) ----------
+// Input beyond the end of the IDAT run reads as zeros; a few bytes of that
+// are normal lookahead, more means the stream is cut short.
+void Decoder::need(int n) {
+  while (bitCnt_ < n) {
+    int b = idatByte();
+    if (b < 0) {
+      if (++overrun_ > 4) fail("truncated image data");
+      b = 0;
+    }
+    bitBuf_ |= (uint32_t)b << bitCnt_;
+    bitCnt_ += 8;
+  }
+}
+
+uint32_t Decoder::bits(int n) {
+  if (n == 0) return 0;
+  need(n);
+  const uint32_t v = bitBuf_ & ((1u << n) - 1);
+  bitBuf_ >>= n;
+  bitCnt_ -= n;
+  return v;
+}
+
+static bool build(Decoder::Huff& h, const uint8_t* lens, int n) {
+  memset(h.count, 0, sizeof(h.count));
+  for (int i = 0; i < n; ++i) h.count[lens[i]]++;
+  h.count[0] = 0;
+  int left = 1;
+  for (int len = 1; len < 16; ++len) {
+    left = (left << 1) - h.count[len];
+    if (left < 0) return false;        // over-subscribed
+  }
+  uint16_t offs[16];
+  offs[1] = 0;
+  for (int len = 1; len < 15; ++len) offs[len + 1] = offs[len] + h.count[len];
+  for (int i = 0; i < n; ++i)
+    if (lens[i]) h.symbol[offs[lens[i]]++] = (uint16_t)i;
+
+  memset(h.fast, 0, sizeof(h.fast));
+  uint32_t code = 0, index = 0;
+  for (int len = 1; len <= kFastBits; ++len) {
+    for (int k = 0; k < h.count[len]; ++k, ++code, ++index) {
+      uint32_t rev = 0;                // deflate sends codes MSB first
+      for (int b = 0; b < len; ++b) rev |= ((code >> b) & 1) << (len - 1 - b);
+      const uint16_t e = (uint16_t)((h.symbol[index] << 4) | len);
+      for (uint32_t i = rev; i < (1u << kFastBits); i += 1u << len) h.fast[i] = e;
+    }
+    code <<= 1;
+  }
+  return true;
+}
+
+int Decoder::decodeSym(const Huff& h) {
+  need(15);
+  const uint16_t e = h.fast[bitBuf_ & ((1u << kFastBits) - 1)];
+  if (e) {
+    const int n = e & 15;
+    bitBuf_ >>= n;
+    bitCnt_ -= n;
+    return e >> 4;
+  }
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len < 16; ++len) {
+    code |= bitBuf_ & 1;
+    bitBuf_ >>= 1;
+    bitCnt_--;
+    const int count = h.count[len];
+    if (code - count < first) return h.symbol[index + (code - first)];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  fail("bad Huffman code");
+  return -1;
+}
+
+bool Decoder::stored() {
+  bitBuf_ >>= bitCnt_ & 7;
+  bitCnt_ -= bitCnt_ & 7;
+  uint32_t len = bits(16);
+  if (len != (~bits(16) & 0xFFFF)) return fail("bad stored block");
+  while (len-- && !err_ && y_ < info_.height) put((uint8_t)bits(8));
+  return !err_;
+}
+
+bool Decoder::fixed() {
+  uint8_t lens[288 + 30];
+  memset(lens, 8, 144);
+  memset(lens + 144, 9, 112);
+  memset(lens + 256, 7, 24);
+  memset(lens + 280, 8, 8);
+  memset(lens + 288, 5, 30);
+  build(*lit_, lens, 288);
+  build(*dist_, lens + 288, 30);
+  return codes();
+}
+
+bool Decoder::dynamic() {
+  static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+  const int nlen = (int)bits(5) + 257, ndist = (int)bits(5) + 1, ncode = (int)bits(4) + 4;
+  if (nlen > 286 || ndist > 30) return fail("bad code counts");
+  uint8_t lens[286 + 30];
+  memset(lens, 0, sizeof(lens));
+  for (int i = 0; i < ncode; ++i) lens[order[i]] = (uint8_t)bits(3);
+  if (!build(*dist_, lens, 19)) return fail("bad code lengths");   // code-length code, briefly
+  int i = 0;
+  while (i < nlen + ndist && !err_) {
+    int sym = decodeSym(*dist_);
+    if (sym < 0) return false;
+    if (sym < 16) {
+      lens[i++] = (uint8_t)sym;
+      continue;
+    }
+    uint8_t len = 0;
+    int rep;
+    if (sym == 16) {
+      if (i == 0) return fail("repeat with no length");
+      len = lens[i - 1];
+      rep = 3 + (int)bits(2);
+    } else if (sym == 17) {
+      rep = 3 + (int)bits(3);
+    } else {
+      rep = 11 + (int)bits(7);
+    }
+    if (i + rep > nlen + ndist) return fail("too many lengths");
+    while (rep--) lens[i++] = len;
+  }
+  if (err_) return false;
+  if (lens[256] == 0) return fail("no end-of-block code");
+  if (!build(*lit_, lens, nlen) || !build(*dist_, lens + nlen, ndist)) return fail("bad code lengths");
+  return codes();
+}
+
+bool Decoder::codes() {
+  static const uint16_t lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  static const uint8_t lext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  static const uint16_t dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                      8193, 12289, 16385, 24577 };
+  static const uint8_t dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+  while (!err_ && y_ < info_.height) {
+    int sym = decodeSym(*lit_);
+    if (sym < 0) return false;
+    if (sym < 256) {
+      put((uint8_t)sym);
+    } else if (sym == 256) {
+      return true;
+    } else {
+      sym -= 257;
+      if (sym >= 29) return fail("bad length code");
+      uint32_t len = lbase[sym] + bits(lext[sym]);
+      const int ds = decodeSym(*dist_);
+      if (ds < 0 || ds >= 30) return fail("bad distance code");
+      const uint32_t d = dbase[ds] + bits(dext[ds]);
+      if (d > wpos_) return fail("distance too far back");
+      while (len--) put(window_[(wpos_ - d) & (kWindow - 1)]);
+    }
+  }
+  return !err_;
+}
+
+// ---------- scanlines ----------
+inline void Decoder::put(uint8_t b) {
+  window_[wpos_++ & (kWindow - 1)] = b;
+  if (rowPos_ == 0) {
+    filter_ = b;
+    rowPos_ = 1;
+    return;
+  }
+  cur_[rowPos_++ - 1] = b;
+  if (rowPos_ > stride_) endRow();
+}
+
+static inline uint8_t paeth(int a, int b, int c) {
+  const int p = a + b - c;
+  const int pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+  return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+void Decoder::endRow() {
+  uint8_t* c = cur_;
+  const uint8_t* p = prev_;
+  const uint32_t n = stride_, bpp = bpp_;
+  switch (filter_) {
+    case 0: break;
+    case 1: for (uint32_t i = bpp; i < n; ++i) c[i] += c[i - bpp]; break;
+    case 2: for (uint32_t i = 0; i < n; ++i) c[i] += p[i]; break;
+    case 3:
+      for (uint32_t i = 0; i < bpp; ++i) c[i] += p[i] >> 1;
+      for (uint32_t i = bpp; i < n; ++i) c[i] += (uint8_t)((c[i - bpp] + p[i]) >> 1);
+      break;
+    case 4:
+      for (uint32_t i = 0; i < bpp; ++i) c[i] += p[i];
+      for (uint32_t i = bpp; i < n; ++i) c[i] += paeth(c[i - bpp], p[i], p[i - bpp]);
+      break;
+    default:
+      fail("bad filter type");
+      return;
+  }
+  toRgba();
+  rowFn_((int)y_, rgba_, rowUser_);
+  cur_ = prev_;
+  prev_ = c;
+  rowPos_ = 0;
+  y_++;
+}
+
+void Decoder::toRgba() {
+  const uint8_t* s = cur_;
+  uint8_t* o = rgba_;
+  const uint32_t w = info_.width;
+  const int bd = info_.bitDepth;
+  switch (info_.colorType) {
+    case 0:
+      if (bd < 8) {
+        const int mask = (1 << bd) - 1, scale = 255 / mask;
+        for (uint32_t x = 0; x < w; ++x) {
+          const uint32_t bit = x * bd;
+          const int v = (s[bit >> 3] >> (8 - bd - (bit & 7))) & mask;
+          o[0] = o[1] = o[2] = (uint8_t)(v * scale);
+          o[3] = hasKey_ && v == key_[0] ? 0 : 255;
+          o += 4;
+        }
+      } else {
+        const int step = bd / 8;
+        for (uint32_t x = 0; x < w; ++x, s += step, o += 4) {
+          const uint16_t v = step == 2 ? (uint16_t)((s[0] << 8) | s[1]) : s[0];
+          o[0] = o[1] = o[2] = s[0];
+          o[3] = hasKey_ && v == key_[0] ? 0 : 255;
+        }
+      }
+      break;
+    case 2:
+      if (bd == 8) {
+        for (uint32_t x = 0; x < w; ++x, s += 3, o += 4) {
+          o[0] = s[0]; o[1] = s[1]; o[2] = s[2];
+          o[3] = hasKey_ && s[0] == key_[0] && s[1] == key_[1] && s[2] == key_[2] ? 0 : 255;
+        }
+      } else {
+        for (uint32_t x = 0; x < w; ++x, s += 6, o += 4) {
+          o[0] = s[0]; o[1] = s[2]; o[2] = s[4];
+          o[3] = hasKey_ && ((s[0] << 8) | s[1]) == key_[0] && ((s[2] << 8) | s[3]) == key_[1] &&
+                 ((s[4] << 8) | s[5]) == key_[2] ? 0 : 255;
+        }
+      }
+      break;
+    case 3: {
+      const int mask = (1 << bd) - 1;
+      for (uint32_t x = 0; x < w; ++x, o += 4) {
+        const uint32_t bit = x * bd;
+        const int v = bd == 8 ? s[x] : (s[bit >> 3] >> (8 - bd - (bit & 7))) & mask;
+        memcpy(o, &palette_[v * 4], 4);
+      }
+      break;
+    }
+    case 4: {
+      const int step = bd / 4;
+      for (uint32_t x = 0; x < w; ++x, s += step, o += 4) {
+        o[0] = o[1] = o[2] = s[0];
+        o[3] = s[step / 2];
+      }
+      break;
+    }
+    case 6:
+      if (bd == 8) {
+        memcpy(o, s, (size_t)w * 4);
+      } else {
+        for (uint32_t x = 0; x < w; ++x, s += 8, o += 4) {
+          o[0] = s[0]; o[1] = s[2]; o[2] = s[4]; o[3] = s[6];
+        }
+      }
+      break;
+  }
+}
+
+bool Decoder::decode(RowFn fn, void* user) {
+  if (err_) return false;
+  if (!fn || !rows_) return fail("not started");
+  rowFn_ = fn;
+  rowUser_ = user;
+  cur_ = rows_;
+  prev_ = rows_ + stride_;
+  rgba_ = rows_ + 2 * (size_t)stride_;
+  memset(prev_, 0, stride_);
+  rowPos_ = y_ = 0;
+  bitBuf_ = 0;
+  bitCnt_ = 0;
+  wpos_ = 0;
+  overrun_ = 0;
+
+  const uint32_t cmf = bits(8), flg = bits(8);
+  if ((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20))
+    return fail("bad zlib header");
+  bool last = false;
+  while (!last && !err_ && y_ < info_.height) {
+    last = bits(1) != 0;
+    switch (bits(2)) {
+      case 0: stored(); break;
+      case 1: fixed(); break;
+      case 2: dynamic(); break;
+      default: fail("bad block type"); break;
+    }
+  }
+  if (!err_ && y_ < info_.height) fail("image data ends early");
+  return !err_;
+}
+
+// ---------- compositing ----------
+void blend565(const uint8_t* rgba, uint32_t n, uint16_t* dst) {
+  for (uint32_t i = 0; i < n; ++i, rgba += 4) {
+    const uint32_t a = rgba[3];
+    if (a == 0) continue;
+    uint32_t r = rgba[0], g = rgba[1], b = rgba[2];
+    if (a != 255) {
+      const uint16_t d = (uint16_t)((dst[i] >> 8) | (dst[i] << 8));
+      const uint32_t dr = ((d >> 11) & 0x1F) * 255 / 31, dg = ((d >> 5) & 0x3F) * 255 / 63, db = (d & 0x1F) * 255 / 31;
+      r = (r * a + dr * (255 - a) + 127) / 255;
+      g = (g * a + dg * (255 - a) + 127) / 255;
+      b = (b * a + db * (255 - a) + 127) / 255;
+    }
+    const uint16_t c = (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+    dst[i] = (uint16_t)((c >> 8) | (c << 8));
+  }
+}
+
+} // namespace png
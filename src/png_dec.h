@@ -0,0 +1,105 @@
+// png_dec.h
+//
+// Streaming PNG decoder for gallery stills. The file is pulled through a
+// small read buffer, IDAT data is inflated through the 32 KB deflate window
+// and unfiltered with two scanline buffers, so peak memory is the window plus
+// a few rows whatever the image size; nothing is inflated whole. Rows come out
+// as RGBA8888 one at a time; blend565() composites them over whatever backdrop
+// the caller holds.
+//
+// All colour types and bit depths are read (16-bit samples are cut to 8).
+// Interlaced (Adam7) files aren't: their passes can't be shown a strip at a
+// time. Chunk CRCs and the zlib Adler-32 aren't checked.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace png {
+
+struct Info {
+  uint32_t width, height;
+  uint8_t  bitDepth;
+  uint8_t  colorType;    // 0 grey, 2 RGB, 3 palette, 4 grey+alpha, 6 RGBA
+  bool     alpha;        // alpha channel or tRNS: rows need a backdrop
+};
+
+// Fills buf with up to len bytes of the file; 0 at the end
+typedef size_t (*ReadFn)(uint8_t* buf, size_t len, void* user);
+// Receives row y as width RGBA8888 pixels
+typedef void (*RowFn)(int y, const uint8_t* rgba, void* user);
+
+class Decoder {
+ public:
+  struct Huff;
+
+  Decoder();
+  ~Decoder();
+
+  // Reads the signature and the chunks before the first IDAT. Buffers are
+  // kept between images and only grow.
+  bool begin(ReadFn read, void* user);
+  const Info& info() const { return info_; }
+
+  // Inflates, unfilters and emits every row. False on corrupt or truncated
+  // data (rows already emitted stay).
+  bool decode(RowFn fn, void* user);
+
+  // Heap held right now: window, rows and read buffer
+  size_t workingBytes() const;
+  const char* error() const { return err_; }
+
+ private:
+  bool fail(const char* why) { if (!err_) err_ = why; return false; }
+  bool readRaw(uint8_t* dst, size_t n);
+  bool skipRaw(uint32_t n);
+  bool nextIdat();
+  int idatByte();
+  void need(int n);
+  uint32_t bits(int n);
+  int decodeSym(const Huff& h);
+  bool stored();
+  bool fixed();
+  bool dynamic();
+  bool codes();
+  void put(uint8_t b);
+  void endRow();
+  void toRgba();
+
+  ReadFn read_ = nullptr;
+  void* user_ = nullptr;
+  RowFn rowFn_ = nullptr;
+  void* rowUser_ = nullptr;
+  Info info_ = {};
+  const char* err_ = nullptr;
+
+  uint8_t* in_ = nullptr;              // raw file bytes
+  size_t inPos_ = 0, inLen_ = 0;
+  uint32_t chunkLeft_ = 0;             // IDAT payload still unread
+  bool idatDone_ = false;
+  int overrun_ = 0;
+
+  uint32_t bitBuf_ = 0;
+  int bitCnt_ = 0;
+  uint8_t* window_ = nullptr;          // last 32 KB of inflated data
+  uint32_t wpos_ = 0;
+  Huff* lit_ = nullptr;
+  Huff* dist_ = nullptr;
+
+  uint8_t* rows_ = nullptr;            // current and previous scanline, then RGBA
+  size_t rowsCap_ = 0;
+  uint8_t* cur_ = nullptr;
+  uint8_t* prev_ = nullptr;
+  uint8_t* rgba_ = nullptr;
+  uint32_t stride_ = 0, bpp_ = 0, rowPos_ = 0, y_ = 0;
+  uint8_t filter_ = 0;
+
+  uint8_t palette_[256 * 4];
+  uint16_t key_[3];                    // tRNS colour for grey/RGB
+  bool hasKey_ = false;
+};
+
+// Composites n RGBA pixels over dst, which holds the backdrop as big-endian
+// RGB565 (as pushImage() and readRect() use) and receives the result.
+void blend565(const uint8_t* rgba, uint32_t n, uint16_t* dst);
+
+} // namespace png
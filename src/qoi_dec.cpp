@@ -0,0 +1,131 @@
+// qoi_dec.cpp
+
+#include "qoi_dec.h"
+#include <string.h>
+
+namespace qoi {
+
+static inline uint32_t rd32be(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+bool parseHeader(const uint8_t* data, size_t len, Info& out) {
+  if (len < kHeaderSize || memcmp(data, "qoif", 4) != 0) return false;
+  out.width = rd32be(data + 4);
+  out.height = rd32be(data + 8);
+  out.channels = data[12];
+  out.colorspace = data[13];
+  return out.width > 0 && out.height > 0 && out.width <= 4096 && out.height <= 4096 &&
+         (out.channels == 3 || out.channels == 4);
+}
+
+struct Px { uint8_t r, g, b, a; };
+
+static inline uint16_t to565be(Px p) {
+  if (p.a != 255) {   // over black
+    p.r = (uint8_t)((p.r * p.a + 127) / 255);
+    p.g = (uint8_t)((p.g * p.a + 127) / 255);
+    p.b = (uint8_t)((p.b * p.a + 127) / 255);
+  }
+  const uint16_t c = (uint16_t)(((p.r & 0xF8) << 8) | ((p.g & 0xFC) << 3) | (p.b >> 3));
+  return (uint16_t)((c >> 8) | (c << 8));
+}
+
+// Byte sources for decodePixels(): a file in memory (the last 8 bytes are
+// the end marker, never an op) or a Stream's refilled buffer.
+struct MemSrc {
+  const uint8_t* p;
+  const uint8_t* end;
+  inline bool get(uint8_t& b) {
+    if (p >= end) return false;
+    b = *p++;
+    return true;
+  }
+};
+
+inline bool Stream::Src::get(uint8_t& b) {
+  if (pos == len) {
+    len = read ? read(buf, sizeof(buf), user) : 0;
+    pos = 0;
+    if (len == 0) return false;
+  }
+  b = buf[pos++];
+  return true;
+}
+
+template <class Src>
+static bool decodePixels(Src& src, const Info& info, uint16_t* strip, int stripRows, StripFn fn, void* user) {
+  const uint32_t w = info.width, h = info.height;
+  Px cache[64];
+  memset(cache, 0, sizeof(cache));
+  Px px = {0, 0, 0, 255};
+  uint16_t out = to565be(px);
+  uint32_t run = 0;
+  int stripY = 0, row = 0;
+
+  for (uint32_t y = 0; y < h; ++y) {
+    uint16_t* line = strip + (size_t)row * w;
+    for (uint32_t x = 0; x < w; ++x) {
+      if (run > 0) {
+        run--;
+      } else {
+        uint8_t b1;
+        if (!src.get(b1)) return false;
+        if (b1 == 0xFE) {                       // QOI_OP_RGB
+          if (!src.get(px.r) || !src.get(px.g) || !src.get(px.b)) return false;
+        } else if (b1 == 0xFF) {                // QOI_OP_RGBA
+          if (!src.get(px.r) || !src.get(px.g) || !src.get(px.b) || !src.get(px.a)) return false;
+        } else if ((b1 & 0xC0) == 0x00) {       // QOI_OP_INDEX
+          px = cache[b1];
+        } else if ((b1 & 0xC0) == 0x40) {       // QOI_OP_DIFF
+          px.r += ((b1 >> 4) & 3) - 2;
+          px.g += ((b1 >> 2) & 3) - 2;
+          px.b += (b1 & 3) - 2;
+        } else if ((b1 & 0xC0) == 0x80) {       // QOI_OP_LUMA
+          uint8_t b2;
+          if (!src.get(b2)) return false;
+          const int vg = (b1 & 0x3F) - 32;
+          px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+          px.g += vg;
+          px.b += vg - 8 + (b2 & 0x0F);
+        } else {                                // QOI_OP_RUN
+          run = b1 & 0x3F;
+        }
+        cache[(px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) & 63] = px;
+        out = to565be(px);
+      }
+      line[x] = out;
+    }
+    if (++row == stripRows || y + 1 == h) {
+      fn(stripY, row, strip, user);
+      stripY += row;
+      row = 0;
+    }
+  }
+  return true;
+}
+
+bool decode(const uint8_t* data, size_t len, uint16_t* strip, int stripRows, StripFn fn, void* user) {
+  Info info;
+  if (!parseHeader(data, len, info) || !strip || stripRows < 1 || !fn) return false;
+  MemSrc src{ data + kHeaderSize, data + (len >= 8 ? len - 8 : 0) };   // 7 x 0x00, 0x01 padding
+  return decodePixels(src, info, strip, stripRows, fn, user);
+}
+
+bool Stream::begin(ReadFn read, void* user) {
+  src_ = Src{};
+  src_.read = read;
+  src_.user = user;
+  uint8_t head[kHeaderSize];
+  for (size_t i = 0; i < kHeaderSize; ++i) {
+    if (!src_.get(head[i])) return false;
+  }
+  return parseHeader(head, sizeof(head), info_);
+}
+
+bool Stream::decode(uint16_t* strip, int stripRows, StripFn fn, void* user) {
+  if (!strip || stripRows < 1 || !fn) return false;
+  return decodePixels(src_, info_, strip, stripRows, fn, user);
+}
+
+} // namespace qoi
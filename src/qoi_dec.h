@@ -0,0 +1,58 @@
+// qoi_dec.h
+//
+// QOI ("Quite OK Image", qoiformat.org) decoder for gallery stills: one pass
+// over the data with a 64-colour cache, no Huffman and no IDCT. Rows come
+// out as RGB565 a strip at a time, so the caller's buffer holds a few rows
+// rather than the image. Alpha is blended over black, the slideshow's
+// background.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace qoi {
+
+static constexpr size_t kHeaderSize = 14;
+
+struct Info {
+  uint32_t width, height;
+  uint8_t  channels;     // 3 RGB, 4 RGBA
+  uint8_t  colorspace;
+};
+
+// False if it isn't a QOI header or the size is implausible (> 4096 a side)
+bool parseHeader(const uint8_t* data, size_t len, Info& out);
+
+// Receives rows [y, y + rows) of width pixels, big-endian RGB565 as
+// pushImage() takes uint16_t data.
+typedef void (*StripFn)(int y, int rows, const uint16_t* px, void* user);
+
+// Decodes a whole file held in memory. strip must hold width * stripRows
+// pixels. False on a bad header or truncated data (rows already emitted stay).
+bool decode(const uint8_t* data, size_t len, uint16_t* strip, int stripRows, StripFn fn, void* user);
+
+// Pulls up to len bytes into buf; returns how many, 0 when there are no more.
+typedef size_t (*ReadFn)(uint8_t* buf, size_t len, void* user);
+
+// The same decoder fed as the data arrives (POST /api/show): begin() reads
+// the header, decode() the pixels, pulling 256 bytes at a time. The last
+// read may take some of the end marker; whatever follows is left unread.
+class Stream {
+ public:
+  bool begin(ReadFn read, void* user);
+  const Info& info() const { return info_; }
+  bool decode(uint16_t* strip, int stripRows, StripFn fn, void* user);
+
+  struct Src {
+    ReadFn read;
+    void* user;
+    size_t pos, len;
+    uint8_t buf[256];
+    bool get(uint8_t& b);
+  };
+
+ private:
+  Src src_ = {};
+  Info info_ = {};
+};
+
+} // namespace qoi
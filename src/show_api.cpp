@@ -0,0 +1,242 @@
+// show_api.cpp
+//
+// The body arrives on the async_tcp task. onBody() copies each chunk into a
+// stream buffer and leaves it unacknowledged (ackLater()), so the sender's
+// TCP window, not a buffer here, bounds what is in flight. The main loop
+// (loop()) takes the bytes out, acks them to reopen the window, and decodes
+// them straight to the panel, as drawImage() would from a file. Nothing on
+// the async_tcp task waits: onRequest() hands the request to loop(), which
+// replies once the draw is done.
+//
+// The request and its client belong to the async_tcp task, which frees them
+// after the onDisconnect() handler runs. That handler and every use of
+// s_client or s_reply from loop() hold s_lock, so loop() either finishes
+// its ack or reply first or finds the pointers already cleared.
+
+#include "show_api.h"
+#include "alerts.h"
+#include "imagedisplay.h"
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
+
+#define SHOW_REPLY_WAIT_MS 5000   // a drawn body whose request never completes is dropped
+
+// A window's worth of unacked body has to fit, or onBody() has nowhere to put it
+#if defined(CONFIG_LWIP_TCP_WND_DEFAULT)
+static_assert(SHOW_STREAM_BYTES >= CONFIG_LWIP_TCP_WND_DEFAULT, "SHOW_STREAM_BYTES is smaller than the TCP window");
+#endif
+
+namespace ShowApi {
+
+enum class State : uint8_t { Idle, Pending, Drawing, Done };
+
+static StreamBufferHandle_t s_stream = nullptr;
+static SemaphoreHandle_t    s_lock = nullptr;     // s_client, s_reply and s_held vs. the async_tcp task
+static volatile State       s_state = State::Idle;
+static volatile bool        s_abort = false;
+static const void* volatile s_owner = nullptr;    // request whose body is being drawn
+static AsyncClient* volatile s_client = nullptr;  // its connection, acked as loop() takes bytes
+static AsyncWebServerRequest* volatile s_reply = nullptr;   // owner with its body in; loop() answers
+static uint32_t             s_doneMs = 0;
+static bool                 s_dropped = false;    // an alert took the screen before or during the draw
+static uint32_t             s_total = 0, s_consumed = 0, s_holdS = SHOW_HOLD_DEFAULT_S;
+static uint32_t             s_held = 0, s_acked = 0;   // body bytes left with ackLater(), and acked since
+static int64_t              s_t0Us = 0;           // first byte received
+
+// Result of the last draw, sent by loop() once s_state is Done
+static bool        s_ok = false;
+static const char* s_format = "unknown";
+static uint32_t    s_firstUs = 0, s_doneUs = 0;
+
+static bool     s_holding = false;
+static uint32_t s_holdFromMs = 0, s_holdMs = 0;
+
+// Acks up to n of the held body bytes; the caller holds s_lock
+static void ackHeld(uint32_t n) {
+    if (n > s_held - s_acked) n = s_held - s_acked;
+    if (!n) return;
+    if (AsyncClient* c = s_client) c->ack(n);
+    s_acked += n;
+}
+
+// Fills buf unless the body ends or stalls; drawStream() treats a short read
+// as the end of the image
+static size_t readBody(uint8_t* buf, size_t len, void*) {
+    size_t got = 0;
+    while (got < len && s_consumed < s_total && !s_abort) {
+        const size_t n = xStreamBufferReceive(s_stream, buf + got, len - got, pdMS_TO_TICKS(SHOW_STALL_MS));
+        if (!n) { s_abort = true; break; }
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        ackHeld(n);
+        xSemaphoreGive(s_lock);
+        got += n;
+        s_consumed += n;
+    }
+    return got;
+}
+
+static void keepBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        if (s_state != State::Idle) return;   // onRequest() says 409
+        if (!s_stream) s_stream = xStreamBufferCreate(SHOW_STREAM_BYTES, 1);
+        if (!s_stream) return;
+        xStreamBufferReset(s_stream);
+        s_holdS = SHOW_HOLD_DEFAULT_S;
+        if (request->hasParam("hold")) s_holdS = constrain(request->getParam("hold")->value().toInt(), 1, 86400);
+        s_total = total;
+        s_consumed = 0;
+        s_held = s_acked = 0;
+        s_abort = false;
+        s_t0Us = esp_timer_get_time();
+        s_owner = request;
+        s_client = request->client();
+        s_reply = nullptr;
+        request->onDisconnect([request]() {
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            if (request == s_owner) {
+                s_abort = true;
+                s_client = nullptr;
+                s_reply = nullptr;
+                s_owner = nullptr;
+            }
+            xSemaphoreGive(s_lock);
+        });
+        s_state = State::Pending;
+    }
+    if (request != s_owner || s_abort) return;   // bytes not kept are acked as usual
+    if (xStreamBufferSend(s_stream, data, len, 0) < len) {
+        s_abort = true;   // more in flight than the window should allow
+        return;
+    }
+    request->client()->ackLater();
+    s_held += len;
+}
+
+static void onBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    keepBody(request, data, len, index, total);
+    xSemaphoreGive(s_lock);
+}
+
+static void onRequest(AsyncWebServerRequest* request) {
+    if (request != s_owner) {
+        const bool busy = s_state != State::Idle;
+        request->send(busy ? 409 : 400, "application/json",
+                      busy ? "{\"err\":\"busy\"}" : "{\"err\":\"empty body\"}");
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (request == s_owner) s_reply = request;
+    xSemaphoreGive(s_lock);
+}
+
+// The caller holds s_lock
+static void finish() {
+    ackHeld(UINT32_MAX);   // anything still held, or the connection stalls
+    s_client = nullptr;
+    s_reply = nullptr;
+    s_owner = nullptr;
+    s_dropped = false;
+    s_state = State::Idle;
+}
+
+static void reply(AsyncWebServerRequest* request) {
+    if (s_dropped) {
+        request->send(503, "application/json", "{\"err\":\"screen taken by an alert\"}");
+        return;
+    }
+    char first[16] = "null";
+    if (s_firstUs) snprintf(first, sizeof(first), "%.1f", s_firstUs / 1000.0f);
+    char j[160];
+    snprintf(j, sizeof(j), "{\"ok\":%d,\"format\":\"%s\",\"bytes\":%u,\"first_pixels_ms\":%s,\"done_ms\":%.1f,\"hold_s\":%u}",
+             s_ok ? 1 : 0, s_format, (unsigned)s_consumed, first, s_doneUs / 1000.0f, (unsigned)s_holdS);
+    request->send(s_ok ? 200 : 415, "application/json", j);
+}
+
+// Answers a drawn (or dropped) request once its body is in
+static void settle() {
+    if (s_state != State::Done) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (AsyncWebServerRequest* r = s_reply) {
+        reply(r);
+        finish();
+    } else if (!s_owner || millis() - s_doneMs >= SHOW_REPLY_WAIT_MS) {
+        finish();   // the client went away, or never finished sending
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void begin(AsyncWebServer& server) {
+    s_lock = xSemaphoreCreateMutex();
+    server.on("/api/show", HTTP_POST, onRequest, nullptr, onBody);
+}
+
+void loop() {
+    if (s_state == State::Pending) {
+        s_state = State::Drawing;
+        ImageDisplay::setPaused(true);
+        const int64_t start = esp_timer_get_time();
+        uint32_t firstUs = 0;
+        s_ok = ImageDisplay::drawStream(readBody, nullptr, &s_format, &firstUs);
+        const int64_t end = esp_timer_get_time();
+        s_firstUs = firstUs ? (uint32_t)(start - s_t0Us) + firstUs : 0;
+        s_doneUs = (uint32_t)(end - s_t0Us);
+        if (!s_ok && Alerts::preempting()) {
+            s_abort = true;     // the frame hook stopped the draw for an alert
+            s_dropped = true;
+        }
+
+        // Whatever the decoder left (the QOI end marker, trailing bytes, a
+        // failed image) still has to be taken so onBody() can finish
+        uint8_t skip[256];
+        while (readBody(skip, sizeof(skip), nullptr)) {}
+        if (s_abort) {
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            xStreamBufferReset(s_stream);
+            ackHeld(UINT32_MAX);
+            xSemaphoreGive(s_lock);
+        }
+
+        Serial.printf("[ShowApi] %s, %u bytes: %s, first pixels %.1f ms, done %.1f ms, hold %u s\n",
+                      s_format, s_consumed, s_ok ? "shown" : "failed", s_firstUs / 1000.0f, s_doneUs / 1000.0f, s_holdS);
+        if (s_ok) {
+            s_holding = true;
+            s_holdFromMs = millis();
+            s_holdMs = s_holdS * 1000u;
+        } else if (!s_holding) {
+            ImageDisplay::setPaused(false);
+        }
+        s_doneMs = millis();
+        s_state = State::Done;
+        return;
+    }
+    settle();
+    if (s_holding && millis() - s_holdFromMs >= s_holdMs) {
+        s_holding = false;
+        ImageDisplay::setPaused(false);
+        ImageDisplay::resume();
+    }
+}
+
+void abort() {
+    if (s_state == State::Pending) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_abort = true;
+        xStreamBufferReset(s_stream);
+        ackHeld(UINT32_MAX);
+        xSemaphoreGive(s_lock);
+        s_dropped = true;
+        s_doneMs = millis();
+        s_state = State::Done;
+        Serial.println("[ShowApi] Posted image dropped: an alert has the screen");
+    }
+    settle();
+}
+
+bool holding() { return s_holding; }
+
+}
@@ -0,0 +1,29 @@
+// show_api.h
+#pragma once
+#include <stdint.h>
+
+class AsyncWebServer;
+
+// POST /api/show: the request body, a QOI or baseline JPEG, is drawn as it
+// arrives, without going through FFat. The slideshow then holds the image
+// for ?hold= seconds (SHOW_HOLD_DEFAULT_S) before carrying on. The reply is
+// JSON with the format, byte count and the time from the first byte received
+// to the first pixels on screen, and to the whole image.
+//
+//   curl --data-binary @score.qoi "http://<ip>:8080/api/show?hold=10"
+#ifndef SHOW_HOLD_DEFAULT_S
+#define SHOW_HOLD_DEFAULT_S 30
+#endif
+#ifndef SHOW_STREAM_BYTES
+#define SHOW_STREAM_BYTES 16384   // between the web task and the decoder; at least the TCP window
+#endif
+#ifndef SHOW_STALL_MS
+#define SHOW_STALL_MS 2000        // gives up on a body that stops arriving
+#endif
+
+namespace ShowApi {
+    void begin(AsyncWebServer& server);
+    void loop();        // draws posted images and ends the hold; main loop
+    void abort();       // instead of loop() while an alert has the screen: drops what is posted (503)
+    bool holding();     // an image from /api/show is on screen
+}
@@ -0,0 +1,33 @@
+// td565.h
+//
+// Raw RGB565 stills and animations (.565), written by the host asset tool
+// (host/asset/tdasset) for content that should cost nothing to decode: the
+// display only copies pixels. All header integers little-endian.
+#pragma once
+#include <stdint.h>
+
+namespace td565 {
+
+static constexpr char kMagic[4] = {'T', '5', '6', '5'};
+
+// 16 bytes, then `frames` frames
+struct Header {
+  char     magic[4];   // "T565"
+  uint16_t width;      // canvas
+  uint16_t height;
+  uint16_t frames;     // 1 = still
+  uint16_t loops;      // plays; 0 = forever
+  uint32_t reserved;
+};
+
+// 12 bytes, then w * h pixels, rows top first, big-endian RGB565 (as
+// pushImage() takes uint16_t data). A frame only covers the rectangle that
+// changed; the rest of the canvas keeps the previous frame.
+struct Frame {
+  uint16_t x, y, w, h;
+  uint32_t delayMs;    // before the next frame
+};
+
+static_assert(sizeof(Header) == 16 && sizeof(Frame) == 12, "td565 layout");
+
+} // namespace td565
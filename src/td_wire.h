@@ -0,0 +1,117 @@
+// td_wire.h
+//
+// Telemetry wire formats, shared by the display (udp_detect.cpp) and the
+// host tools under host/ (recorder, replay, benchmarks). Plain C++ with no
+// Arduino dependency; all integers little-endian (ESP32 and x86 alike).
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace td_wire {
+
+// ---- UDP ports ----
+static constexpr uint16_t kPortCore = 50504;   // CorePacket, TitlePacket
+static constexpr uint16_t kPortExp  = 50505;   // ExpPacket (or legacy "KEY=val;" ASCII)
+static constexpr uint16_t kPortEE   = 50506;   // "EE:..." frames, "APP:<name>|TID:<hex>"
+
+// 50504: fan/cpu/ambient/app (44 bytes). Sentinels: fan -1, temps -1000.
+struct CorePacket {
+  int32_t fanSpeed;
+  int32_t cpuTemp;
+  int32_t ambientTemp;
+  char    currentApp[32];
+};
+
+// 50504: title frame sent after the core packet (72 bytes)
+struct TitlePacket {
+  char     magic[4];   // "TDT1"
+  uint32_t titleId;
+  char     name[64];
+};
+
+// 50505: expansion status (28 bytes), in this order
+struct ExpPacket {
+  int32_t trayState;
+  int32_t avPackState;
+  int32_t picVersion;
+  int32_t xboxVersion;
+  int32_t videoWidth;
+  int32_t videoHeight;
+  int32_t encoderType;   // I2C addr: 0x45 Conexant, 0x6A Focus, 0x70 Xcalibur
+};
+
+static_assert(sizeof(CorePacket)  == 44, "50504 core layout");
+static_assert(sizeof(TitlePacket) == 72, "50504 title layout");
+static_assert(sizeof(ExpPacket)   == 28, "50505 layout");
+
+// ---- Capture files (.tdc) ----
+// Raw datagrams as received, for replay (host/replay). Written by the
+// display (UDPCapture, /capture) and by host/recorder/tdrecord -w.
+// File: CaptureHeader, then per datagram a CaptureRecord + `len` bytes.
+struct CaptureHeader {
+  char     magic[4];      // "TDC1"
+  uint8_t  version;       // 1
+  uint8_t  source;        // 0 display, 1 host recorder
+  uint16_t reserved;
+  uint64_t startUnixMs;   // wall clock at t=0, 0 if unknown (the display has no RTC)
+};
+
+struct CaptureRecord {
+  uint64_t tUs;           // since the start of the capture
+  uint16_t port;
+  uint16_t len;
+  uint8_t  src[4];        // sender IPv4, a.b.c.d
+};
+
+static_assert(sizeof(CaptureHeader) == 16, "capture header layout");
+static_assert(sizeof(CaptureRecord) == 16, "capture record layout");
+
+// ---- Screen cast (host/cast/tdcast -> display, cast_rx.cpp) ----
+// A JPEG per frame, cut into CastFragments of up to kCastPayload bytes so a
+// datagram fits a 1500-byte MTU. Fragments can arrive in any order.
+static constexpr uint16_t kPortCast    = 50510;
+static constexpr size_t   kCastPayload = 1400;
+
+struct CastFragment {
+  char     magic[4];      // "TDV1"
+  uint32_t frame;         // +1 per frame sent
+  uint32_t captureUs;     // sender's clock when the frame was captured (wraps)
+  uint32_t size;          // of the whole JPEG
+  uint16_t index, count;  // this fragment, fragments in the frame
+  uint32_t e2eUs;         // sender's last capture-to-ack time, 0 if none yet
+};
+
+// Display -> the fragment's source address, once a frame is on screen
+struct CastAck {
+  char     magic[4];      // "TDVA"
+  uint32_t frame;
+  uint32_t captureUs;     // echoed, so the sender can time the round trip
+  uint32_t displayUs;     // on the display: first fragment in to pixels out
+};
+
+static_assert(sizeof(CastFragment) == 24, "cast fragment layout");
+static_assert(sizeof(CastAck)      == 16, "cast ack layout");
+
+inline bool isTitle(const void* buf, size_t n) {
+  return n == sizeof(TitlePacket) && memcmp(buf, "TDT1", 4) == 0;
+}
+
+// Value of "KEY=" inside a '|'-separated frame ("EE:SN=..|MAC=..", "APP:x|TID:y"
+// uses ':' so pass "TID:"). Copies up to cap-1 bytes; false if absent.
+inline bool field(const char* line, const char* key, char* out, size_t cap) {
+  if (!line || !key || !out || !cap) return false;
+  const size_t kl = strlen(key);
+  for (const char* p = line; (p = strstr(p, key)) != nullptr; p += kl) {
+    if (p != line && p[-1] != '|' && p[-1] != ':') continue;   // part of another key
+    p += kl;
+    size_t n = strcspn(p, "|\r\n");
+    if (n >= cap) n = cap - 1;
+    memcpy(out, p, n);
+    out[n] = 0;
+    return true;
+  }
+  return false;
+}
+
+} // namespace td_wire
@@ -0,0 +1,138 @@
+// title_db.cpp
+//
+// - /titles.bin is small (~40 bytes/title) and read once into PSRAM; the
+//   sorted index is searched in place, so name() never allocates.
+// - /titleart.bin can be large, so only its index is loaded; a cover is read
+//   by offset into one reusable PSRAM buffer when drawn.
+// - Files are optional; missing or malformed files just mean no lookups.
+//
+// titles.bin (little-endian):
+//   0  "TDB1"   4 u32 count   8 u32 names offset
+//   12 index: count x { u32 titleId; u32 nameOffset (from names offset) }, sorted by titleId
+//   .. names: NUL-terminated UTF-8
+// titleart.bin:
+//   0  "TDA1"   4 u32 count
+//   8  index: count x { u32 titleId; u32 offset (from file start); u32 length }, sorted
+//   .. JPG data
+
+#include "title_db.h"
+#include <FFat.h>
+#include <esp_heap_caps.h>
+
+#define TITLE_DB_PATH      "/titles.bin"
+#define TITLE_ART_PATH     "/titleart.bin"
+#define TITLE_ART_MAX      (48 * 1024)   // largest cover we'll draw
+
+namespace TitleDB {
+
+struct NameEntry { uint32_t tid; uint32_t off; };
+struct ArtEntry  { uint32_t tid; uint32_t off; uint32_t len; };
+
+static uint8_t*         s_db = nullptr;
+static const NameEntry* s_names = nullptr;
+static const char*      s_pool = nullptr;
+static size_t           s_poolSize = 0;
+static uint32_t         s_count = 0;
+
+static ArtEntry*        s_art = nullptr;
+static uint32_t         s_artCount = 0;
+static uint8_t*         s_artBuf = nullptr;
+
+static inline uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+template <typename T>
+static const T* find(const T* tab, uint32_t n, uint32_t tid) {
+  uint32_t lo = 0, hi = n;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if (tab[mid].tid < tid) lo = mid + 1;
+    else hi = mid;
+  }
+  return (lo < n && tab[lo].tid == tid) ? &tab[lo] : nullptr;
+}
+
+static bool loadNames() {
+  File f = FFat.open(TITLE_DB_PATH, "r");
+  if (!f) return false;
+  const size_t sz = f.size();
+  if (sz < 12) { f.close(); return false; }
+  s_db = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_SPIRAM);
+  if (!s_db) { f.close(); return false; }
+  const bool ok = f.read(s_db, sz) == sz;
+  f.close();
+
+  const uint32_t n = ok ? rd32(s_db + 4) : 0;
+  const uint32_t namesOff = ok ? rd32(s_db + 8) : 0;
+  if (!ok || memcmp(s_db, "TDB1", 4) != 0 || 12 + (uint64_t)n * sizeof(NameEntry) > namesOff || namesOff > sz) {
+    Serial.println("[TitleDB] titles.bin invalid; ignoring.");
+    heap_caps_free(s_db);
+    s_db = nullptr;
+    return false;
+  }
+  s_names    = (const NameEntry*)(s_db + 12);   // ESP32 is little-endian, header keeps 4-byte alignment
+  s_pool     = (const char*)(s_db + namesOff);
+  s_poolSize = sz - namesOff;
+  s_count    = n;
+  return true;
+}
+
+static bool loadArtIndex() {
+  File f = FFat.open(TITLE_ART_PATH, "r");
+  if (!f) return false;
+  uint8_t hdr[8];
+  if (f.read(hdr, 8) != 8 || memcmp(hdr, "TDA1", 4) != 0) { f.close(); return false; }
+  const uint32_t n = rd32(hdr + 4);
+  const size_t idxBytes = (size_t)n * sizeof(ArtEntry);
+  if (n == 0 || 8 + idxBytes > f.size()) { f.close(); return false; }
+
+  s_art    = (ArtEntry*)heap_caps_malloc(idxBytes, MALLOC_CAP_SPIRAM);
+  s_artBuf = (uint8_t*)heap_caps_malloc(TITLE_ART_MAX, MALLOC_CAP_SPIRAM);
+  const bool ok = s_art && s_artBuf && f.read((uint8_t*)s_art, idxBytes) == idxBytes;
+  f.close();
+  if (!ok) {
+    if (s_art) heap_caps_free(s_art);
+    if (s_artBuf) heap_caps_free(s_artBuf);
+    s_art = nullptr; s_artBuf = nullptr;
+    return false;
+  }
+  s_artCount = n;
+  return true;
+}
+
+bool begin() {
+  const bool names = loadNames();
+  const bool art = loadArtIndex();
+  Serial.printf("[TitleDB] %u titles, %u covers\n", (unsigned)s_count, (unsigned)s_artCount);
+  return names || art;
+}
+
+size_t count() { return s_count; }
+
+const char* name(uint32_t titleId) {
+  if (!titleId || !s_count) return nullptr;
+  const NameEntry* e = find(s_names, s_count, titleId);
+  if (!e || e->off >= s_poolSize) return nullptr;
+  return s_pool + e->off;
+}
+
+bool hasArt(uint32_t titleId) {
+  return titleId && s_artCount && find(s_art, s_artCount, titleId);
+}
+
+bool drawArt(LGFX* tft, uint32_t titleId, int x, int y, int w, int h) {
+  if (!titleId || !s_artCount) return false;
+  const ArtEntry* e = find(s_art, s_artCount, titleId);
+  if (!e || e->len == 0 || e->len > TITLE_ART_MAX) return false;
+
+  File f = FFat.open(TITLE_ART_PATH, "r");
+  if (!f) return false;
+  const bool ok = f.seek(e->off) && f.read(s_artBuf, e->len) == e->len;
+  f.close();
+  if (!ok) return false;
+  tft->drawJpg(s_artBuf, e->len, x, y, w, h);
+  return true;
+}
+
+} // namespace TitleDB
@@ -0,0 +1,19 @@
+// title_db.h
+#pragma once
+#include <Arduino.h>
+#include "disp_cfg.h"
+
+// Title-ID database: /titles.bin (names) and optional /titleart.bin (64x64
+// cover JPGs), both built by script/title_db.py. Names are loaded into PSRAM
+// once at boot; lookups are a binary search with no allocation.
+namespace TitleDB {
+    bool begin();                       // after FFat is mounted
+    size_t count();
+
+    // Full title name, or nullptr if the ID is unknown. Pointer stays valid.
+    const char* name(uint32_t titleId);
+
+    bool hasArt(uint32_t titleId);
+    // Draws the cover thumbnail into (x,y,w,h); false if none.
+    bool drawArt(LGFX* tft, uint32_t titleId, int x, int y, int w, int h);
+}
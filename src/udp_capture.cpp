@@ -0,0 +1,133 @@
+// udp_capture.cpp
+//
+// The web handlers run on the async_tcp task, so they only post a request;
+// the file is opened, written and closed from the main loop (loop() and
+// record(), both called from there). Writes go through the FFat stdio
+// buffer; the file is closed, and so complete, when the capture stops.
+
+#include "udp_capture.h"
+#include "td_wire.h"
+#include <Arduino.h>
+#include <FFat.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+
+#define UDP_CAPTURE_PATH     "/capture.tdc"
+#define UDP_CAPTURE_MAX_KB   512       // stops by itself at this size
+
+namespace UDPCapture {
+
+enum class Req : uint8_t { None, Start, Stop };
+
+static volatile Req      s_req = Req::None;
+static volatile uint32_t s_reqMaxBytes = UDP_CAPTURE_MAX_KB * 1024u;
+static volatile bool     s_active = false;
+static File              s_file;
+static int64_t           s_startUs = 0;
+static uint32_t          s_bytes = 0, s_maxBytes = 0, s_count = 0, s_dropped = 0;
+
+static void stop_now(const char* why) {
+    if (s_file) s_file.close();
+    if (s_active) Serial.printf("[UDPCapture] Stopped (%s): %u datagrams, %u bytes\n", why, s_count, s_bytes);
+    s_active = false;
+}
+
+static void start_now() {
+    stop_now("restart");
+    s_file = FFat.open(UDP_CAPTURE_PATH, "w");
+    if (!s_file) { Serial.println("[UDPCapture] Cannot create " UDP_CAPTURE_PATH); return; }
+    td_wire::CaptureHeader h = {};
+    memcpy(h.magic, "TDC1", 4);
+    h.version = 1;
+    h.source = 0;
+    h.startUnixMs = 0;
+    s_file.write((const uint8_t*)&h, sizeof(h));
+    s_startUs = esp_timer_get_time();
+    s_bytes = sizeof(h);
+    s_maxBytes = s_reqMaxBytes;
+    s_count = s_dropped = 0;
+    s_active = true;
+    Serial.printf("[UDPCapture] Capturing to " UDP_CAPTURE_PATH " (max %u KB)\n", s_maxBytes / 1024);
+}
+
+void loop() {
+    const Req r = s_req;
+    if (r == Req::None) return;
+    s_req = Req::None;
+    if (r == Req::Start) start_now();
+    else stop_now("request");
+}
+
+void record(uint16_t port, const IPAddress& src, const void* data, size_t len) {
+    if (!s_active || len > 0xFFFF) return;
+    td_wire::CaptureRecord rec;
+    rec.tUs = (uint64_t)(esp_timer_get_time() - s_startUs);
+    rec.port = port;
+    rec.len = (uint16_t)len;
+    for (int i = 0; i < 4; ++i) rec.src[i] = src[i];
+
+    if (s_bytes + sizeof(rec) + len > s_maxBytes) { stop_now("full"); return; }
+    if (s_file.write((const uint8_t*)&rec, sizeof(rec)) != sizeof(rec) ||
+        s_file.write((const uint8_t*)data, len) != len) {
+        s_dropped++;
+        stop_now("write failed");
+        return;
+    }
+    s_bytes += sizeof(rec) + len;
+    s_count++;
+}
+
+bool active() { return s_active; }
+
+// ---------- HTTP ----------
+static void handlePage(AsyncWebServerRequest* request) {
+    if (request->hasParam("start")) {
+        uint32_t kb = request->hasParam("kb") ? request->getParam("kb")->value().toInt() : UDP_CAPTURE_MAX_KB;
+        if (kb < 16) kb = 16;
+        if (kb > 4096) kb = 4096;
+        s_reqMaxBytes = kb * 1024u;
+        s_req = Req::Start;
+        request->redirect("/capture");
+        return;
+    }
+    if (request->hasParam("stop")) {
+        s_req = Req::Stop;
+        request->redirect("/capture");
+        return;
+    }
+
+    String html = R"(<!DOCTYPE html><html><head><title>UDP Capture</title>
+<meta name='viewport' content='width=device-width,initial-scale=1'>
+<style>body{background:#111;color:#eee;font-family:sans-serif;margin:20px}
+.section{background:#222;padding:14px;border-radius:8px;margin-bottom:14px}
+.qbtn{background:#299a2c;color:#fff;border:0;padding:6px 12px;border-radius:5px;text-decoration:none}</style></head><body>
+<h2>UDP Capture</h2><div class='section'>)";
+    html += s_active ? "<b>Capturing</b>" : "Idle";
+    html += "<br>" + String(s_count) + " datagrams, " + String(s_bytes) + " bytes";
+    if (s_dropped) html += " (write failed)";
+    html += "<br><br>";
+    if (s_active) {
+        html += "<a class='qbtn' href='/capture?stop=1'>Stop</a>";
+    } else {
+        html += "<a class='qbtn' href='/capture?start=1'>Start</a> ";
+        if (FFat.exists(UDP_CAPTURE_PATH)) html += "<a class='qbtn' href='/capture.tdc'>Download capture.tdc</a>";
+    }
+    html += R"(</div><p style='color:#aaa'>Replay on a PC with host/replay/tdreplay.</p>
+<a href='/diag' style='color:#8cf'>Back to Diagnostics</a></body></html>)";
+    request->send(200, "text/html", html);
+}
+
+static void handleDownload(AsyncWebServerRequest* request) {
+    if (s_active || !FFat.exists(UDP_CAPTURE_PATH)) {
+        request->send(409, "text/plain", "Stop the capture first");
+        return;
+    }
+    request->send(FFat, UDP_CAPTURE_PATH, "application/octet-stream", true);
+}
+
+void begin(AsyncWebServer& server) {
+    server.on("/capture", HTTP_GET, handlePage);
+    server.on("/capture.tdc", HTTP_GET, handleDownload);
+}
+
+} // namespace UDPCapture
@@ -0,0 +1,19 @@
+// udp_capture.h
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+class AsyncWebServer;
+class IPAddress;
+
+// Records every telemetry datagram UDPDetect receives to /capture.tdc on
+// FFat (format in td_wire.h), so a real session can be replayed on a PC
+// with host/replay/tdreplay. Off until started from /capture.
+namespace UDPCapture {
+    void begin(AsyncWebServer& server);   // GET /capture (page, start/stop), /capture.tdc
+    void loop();                          // applies start/stop requests from the web task
+
+    // Called by UDPDetect for each datagram read; no-op unless capturing
+    void record(uint16_t port, const IPAddress& src, const void* data, size_t len);
+    bool active();
+}
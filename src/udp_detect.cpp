@@ -1,13 +1,15 @@
 #include "udp_detect.h"
 #include <WiFiUdp.h>
 #include "xbox_status.h"
+#include "td_wire.h"
+#include "udp_capture.h"
 #include <string.h>
 #include <ctype.h>
 
 // ---- UDP ports ----
-#define UDP_PORT_CORE   50504  // core (fan/cpu/ambient/app)
-#define UDP_PORT_EXP    50505  // expansion status (7 x int32_t)
-#define UDP_PORT_EE     50506  // EEPROM ASCII frames
+#define UDP_PORT_CORE   td_wire::kPortCore  // core (fan/cpu/ambient/app)
+#define UDP_PORT_EXP    td_wire::kPortExp   // expansion status (7 x int32_t)
+#define UDP_PORT_EE     td_wire::kPortEE    // EEPROM ASCII frames
 
 static WiFiUDP udpCore;
 static WiFiUDP udpExp;
@@ -15,14 +17,14 @@ static WiFiUDP udpEE;
 
 static XboxStatus lastStatus;
 static bool gotPacket = false;
+static XboxStatus prevStatus;   // lastStatus before the datagram being parsed
+static IPAddress expIP;
+static uint32_t rxUs = 0;       // first datagram taken by the last loop(); 0 if none
 
-// -------------------- Core wire format (50504) --------------------
-struct CorePacket {
-  int32_t fanSpeed;
-  int32_t cpuTemp;
-  int32_t ambientTemp;
-  char    currentApp[32];
-};
+// -------------------- Wire formats (td_wire.h) --------------------
+using td_wire::CorePacket;    // 50504, 44 bytes
+using td_wire::TitlePacket;   // 50504, "TDT1", 72 bytes
+using td_wire::ExpPacket;     // 50505, 28 bytes
 
 // -------------------- helpers --------------------
 static inline void safe_copy(char* dst, size_t dstsz, const char* src) {
@@ -173,16 +175,17 @@ static char* trim_inplace(char* s) {
 // Binary Status packet (actual order from expansion):
 // trayState, avPackState, picVersion, xboxVersion, videoWidth, videoHeight, encoderType
 static void parseExpansionBinary(const uint8_t* buf, int n) {
-  if (n != 28) return;
-  const int32_t* f = (const int32_t*)buf;
-
-  lastStatus.trayState   = f[0];
-  lastStatus.avPackState = f[1];
-  lastStatus.picVersion  = f[2];
-  lastStatus.xboxVersion = f[3];
-  lastStatus.videoWidth  = f[4];
-  lastStatus.videoHeight = f[5];
-  lastStatus.encoderType = f[6];  // I2C addr: 0x45/0x6A/0x70
+  if (n != (int)sizeof(ExpPacket)) return;
+  ExpPacket ep;
+  memcpy(&ep, buf, sizeof(ep));
+
+  lastStatus.trayState   = ep.trayState;
+  lastStatus.avPackState = ep.avPackState;
+  lastStatus.picVersion  = ep.picVersion;
+  lastStatus.xboxVersion = ep.xboxVersion;
+  lastStatus.videoWidth  = ep.videoWidth;
+  lastStatus.videoHeight = ep.videoHeight;
+  lastStatus.encoderType = ep.encoderType;  // I2C addr: 0x45/0x6A/0x70
 
   formatResolution(lastStatus.videoWidth, lastStatus.videoHeight,
                    lastStatus.avPackState, lastStatus.resolution, sizeof(lastStatus.resolution));
@@ -255,7 +258,29 @@ static void parseExpansionAscii(char* buf, int n) {
 }
 
 // ==================== EEPROM (50506) ====================
+// "APP:<name>|TID:<hex>" straight from the XBMC4Gamers service (no expansion)
+static void parseApp_line(const char* line) {
+  const char* name = line + 4;
+  while (*name == ' ') ++name;
+  size_t n = strcspn(name, "|\r\n");
+  while (n > 0 && name[n - 1] == ' ') --n;
+  if (n == 0) return;
+  if (n >= sizeof(lastStatus.titleName)) n = sizeof(lastStatus.titleName) - 1;
+  memcpy(lastStatus.titleName, name, n);
+  lastStatus.titleName[n] = 0;
+  safe_copy(lastStatus.currentApp, sizeof(lastStatus.currentApp), lastStatus.titleName);
+
+  const char* t = strstr(line, "TID:");
+  lastStatus.titleId = t ? (uint32_t)strtoul(t + 4, nullptr, 16) : 0;
+  Serial.printf("[UDPDetect] APP: '%s' TID=%08X\n", lastStatus.titleName, (unsigned)lastStatus.titleId);
+  gotPacket = true;
+}
+
 static void parseEE_line(const char* line) {
+  if (!strncmp(line, "APP:", 4)) {
+    parseApp_line(line);
+    return;
+  }
   if (!strncmp(line, "EE:RAW=", 7)) {
     const char* b64 = line + 7;
     lastStatus.eeRawLen = base64_decode(b64, lastStatus.eeRaw, (int)sizeof(lastStatus.eeRaw));
@@ -300,6 +325,14 @@ static void parseEE_line(const char* line) {
   }
 }
 
+// A loop pass is news only if its datagrams changed a field. The expansion
+// resends an unchanged status every UDP_HEARTBEAT_MS, and each repeat used to
+// bring up the status overlay and skip to the next image.
+static void beforeDatagram() { memcpy(&prevStatus, &lastStatus, sizeof(lastStatus)); }
+static void afterDatagram(bool wasPending) {
+  if (!wasPending && gotPacket && memcmp(&prevStatus, &lastStatus, sizeof(lastStatus)) == 0) gotPacket = false;
+}
+
 // -------------------- public API --------------------
 void UDPDetect::begin() {
   udpCore.begin(UDP_PORT_CORE);
@@ -321,11 +354,17 @@ void UDPDetect::begin() {
 }
 
 void UDPDetect::loop() {
+  const bool wasPending = gotPacket;
+  beforeDatagram();
+  rxUs = 0;
+
   // --- CORE (50504): Fan/CPU/Ambient/App ---
   int sz = udpCore.parsePacket();
+  if (sz > 0) rxUs = micros() | 1;
   if (sz == (int)sizeof(CorePacket)) {
     CorePacket cp;
     int n = udpCore.read(reinterpret_cast<char*>(&cp), sizeof(cp));
+    if (n > 0) UDPCapture::record(UDP_PORT_CORE, udpCore.remoteIP(), &cp, n);
     if (n == (int)sizeof(cp)) {
       lastStatus.fanSpeed    = cp.fanSpeed;
       lastStatus.cpuTemp     = cp.cpuTemp;
@@ -339,39 +378,64 @@ void UDPDetect::loop() {
       uint8_t tmp[256]; if (sz > (int)sizeof(tmp)) sz = sizeof(tmp);
       udpCore.read(tmp, sz);
     }
+  } else if (sz == (int)sizeof(TitlePacket)) {
+    TitlePacket tp;
+    int n = udpCore.read(reinterpret_cast<char*>(&tp), sizeof(tp));
+    if (n > 0) UDPCapture::record(UDP_PORT_CORE, udpCore.remoteIP(), &tp, n);
+    if (td_wire::isTitle(&tp, n)) {
+      tp.name[sizeof(tp.name) - 1] = 0;
+      if (tp.titleId != lastStatus.titleId || strcmp(tp.name, lastStatus.titleName) != 0) {
+        lastStatus.titleId = tp.titleId;
+        safe_copy(lastStatus.titleName, sizeof(lastStatus.titleName), tp.name);
+        gotPacket = true;
+        Serial.printf("[UDPDetect] TITLE: '%s' TID=%08X\n", lastStatus.titleName, (unsigned)lastStatus.titleId);
+      }
+    }
   } else if (sz > 0) {
     uint8_t tmp[256]; if (sz > (int)sizeof(tmp)) sz = sizeof(tmp);
-    udpCore.read(tmp, sz);
+    int n = udpCore.read(tmp, sz);
+    if (n > 0) UDPCapture::record(UDP_PORT_CORE, udpCore.remoteIP(), tmp, n);
   }
 
   // --- EXPANSION (50505): binary status (or legacy ASCII) ---
   sz = udpExp.parsePacket();
+  if (sz > 0 && !rxUs) rxUs = micros() | 1;
   if (sz > 0) {
-    if (sz == 28) {
-      uint8_t buf[28];
+    expIP = udpExp.remoteIP();
+    if (sz == (int)sizeof(ExpPacket)) {
+      uint8_t buf[sizeof(ExpPacket)];
       int n = udpExp.read(buf, sizeof(buf));
-      if (n == 28) parseExpansionBinary(buf, n);
+      if (n > 0) UDPCapture::record(UDP_PORT_EXP, expIP, buf, n);
+      if (n == (int)sizeof(buf)) parseExpansionBinary(buf, n);
     } else {
       char buf[256];
       if (sz > (int)sizeof(buf) - 1) sz = sizeof(buf) - 1;
       int n = udpExp.read(buf, sz);
-      if (n > 0) parseExpansionAscii(buf, n);
+      if (n > 0) {
+        UDPCapture::record(UDP_PORT_EXP, expIP, buf, n);
+        parseExpansionAscii(buf, n);
+      }
     }
   }
 
   // --- EEPROM (50506): ASCII frames ---
   sz = udpEE.parsePacket();
+  if (sz > 0 && !rxUs) rxUs = micros() | 1;
   if (sz > 0) {
     char buf[1024];
     if (sz > (int)sizeof(buf) - 1) sz = sizeof(buf) - 1;
     int n = udpEE.read(buf, sz);
     if (n > 0) {
+      UDPCapture::record(UDP_PORT_EE, udpEE.remoteIP(), buf, n);
       buf[n] = 0;
       parseEE_line(buf);
     }
   }
+  afterDatagram(wasPending);
 }
 
 bool UDPDetect::hasPacket() { return gotPacket; }
 void UDPDetect::acknowledge() { gotPacket = false; }
 const XboxStatus& UDPDetect::getLatest() { return lastStatus; }
+IPAddress UDPDetect::expansionIP() { return expIP; }
+uint32_t UDPDetect::receivedUs() { return rxUs; }
@@ -42,4 +42,10 @@ namespace UDPDetect {
     // New: clear only one channel’s “new packet” flag (optional)
     void acknowledge(Channel ch);
 
+    // Address of the expansion (source of the last 50505 packet); 0.0.0.0 until seen
+    IPAddress expansionIP();
+
+    // micros() when the last loop() took its first datagram off a socket; 0 if it took none
+    uint32_t receivedUs();
+
 } // namespace UDPDetect
@@ -2,6 +2,8 @@
 #include <Arduino.h>
 #include <FFat.h>
 #include "disp_cfg.h"
+#include "title_db.h"
+#include "panel_clock.h"
 #include <esp_heap_caps.h>   // PSRAM for JPG buffers
 
 // ----------------- small helpers -----------------
@@ -42,6 +44,21 @@ static void drawIconOrPlaceholder(LGFX* tft, const char* path, int x, int y, int
   }
 }
 
+// ----- title: DB name by ID, then the sender's full name, then the short one -----
+static String titleText(const XboxStatus& pkt) {
+  if (const char* n = TitleDB::name(pkt.titleId)) return String(n);
+  if (pkt.titleName[0]) return String(pkt.titleName);
+  return String(pkt.currentApp);
+}
+
+// Shorten with "..." until it fits maxW pixels
+static String fitText(LGFX* tft, String s, int font, int maxW) {
+  if (measureTextWidth(tft, s, font) <= maxW) return s;
+  while (s.length() > 1 && measureTextWidth(tft, s + "...", font) > maxW) s.remove(s.length() - 1);
+  s.trim();
+  return s + "...";
+}
+
 // ----- A/V pack label (primary + fallback) -----
 static String avPackString(int avVal) {
   uint8_t v = (uint8_t)avVal;
@@ -121,6 +138,7 @@ static uint32_t s_lastFlip = 0;
 static int      s_page = 0;               // 0..2
 
 void show(LGFX* tft, const XboxStatus& packet) {
+  PanelClock::activity();
   // Pager
   uint32_t now = millis();
   if (now - s_lastFlip >= PAGE_MS) {
@@ -160,9 +178,13 @@ void show(LGFX* tft, const XboxStatus& packet) {
     const int offX = 150;
 
     struct Item { const char* icon; String label; String value; int x,y; } items[] = {
-      { "/resource/fan.jpg",  "Fan",     String(packet.fanSpeed) + "%",    CX,           topY },
-      { "/resource/cpu.jpg",  "CPU",     String(packet.cpuTemp) + "C",     CX - offX,    botY },
-      { "/resource/amb.jpg",  "Ambient", String(packet.ambientTemp) + "C", CX + offX,    botY },
+      // Expansion sends -1 / -1000 for fields it has no fresh sample for
+      { "/resource/fan.jpg",  "Fan",     packet.fanSpeed < 0 ? String("-") : String(packet.fanSpeed) + "%",
+        CX,        topY },
+      { "/resource/cpu.jpg",  "CPU",     packet.cpuTemp <= -100 ? String("-") : String(packet.cpuTemp) + "C",
+        CX - offX, botY },
+      { "/resource/amb.jpg",  "Ambient", packet.ambientTemp <= -100 ? String("-") : String(packet.ambientTemp) + "C",
+        CX + offX, botY },
     };
 
     for (auto& it : items) {
@@ -198,7 +220,8 @@ void show(LGFX* tft, const XboxStatus& packet) {
     if (rightX > maxCenter) rightX = maxCenter;
 
     struct Item { const char* icon; String label; String value; int x,y; } items[] = {
-      { "/resource/app.jpg",  "App",        String(packet.currentApp),        CX,     topY },
+      { "/resource/app.jpg",  "App",        fitText(tft, titleText(packet), valueFont, SAFE_R - SAFE_L - 80),
+        CX,     topY },
       { "/resource/res.jpg",  "Resolution", String(packet.resolution),        leftX,  botY },
       { "/resource/av.jpg",   "A/V Pack",   avPackString(packet.avPackState), rightX, botY },
     };
@@ -206,7 +229,9 @@ void show(LGFX* tft, const XboxStatus& packet) {
     for (auto& it : items) {
       int iconX = it.x - iconSize / 2;
       int iconY = it.y - iconSize / 2;
-      drawIconOrPlaceholder(tft, it.icon, iconX, iconY, iconSize, iconSize);
+      // Per-title cover replaces the generic app icon when the bundle has one
+      if (&it != &items[0] || !TitleDB::drawArt(tft, packet.titleId, iconX, iconY, iconSize, iconSize))
+        drawIconOrPlaceholder(tft, it.icon, iconX, iconY, iconSize, iconSize);
 
       int labelY = iconY + iconSize + 6;
       int lw = measureTextWidth(tft, it.label, labelFont);
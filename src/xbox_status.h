@@ -1,5 +1,7 @@
 #pragma once
-#include "disp_cfg.h"
+#include <stdint.h>
+
+class LGFX;   // disp_cfg.h; kept out so the struct also builds on the host (host/replay)
 
 // --- Status structure for UDP/packet sending/receiving ---
 struct XboxStatus {
@@ -8,6 +10,8 @@ struct XboxStatus {
     int  cpuTemp       = -1000;     // Celsius
     int  ambientTemp   = -1000;     // Celsius
     char currentApp[32] = {0};      // App name
+    uint32_t titleId    = 0;        // Title ID (title frame on 50504, or APP:..|TID: on 50506)
+    char titleName[64]  = {0};      // Untruncated title name
 
     // ---- Expansion / Video (UDP 50505) ----
     int trayState      = -1;        // Tray state